@@ -11,8 +11,8 @@ echo "--------------------------------------------------"
 echo "      Parallel Normalization - Program Build      "
 echo "--------------------------------------------------"
 make clean
-rm -rf bin/tests && rm -rf bin/
-mkdir bin && mkdir bin/tests
+rm -rf bin/tests && rm -rf bin/benchs && rm -rf bin/
+mkdir bin && mkdir bin/tests && mkdir bin/benchs
 echo "\n[OK] Binary files directory cleaned\n"
 make make
 echo "\n[OK] Host program correctly compiled\n"
@@ -0,0 +1,47 @@
+#    AY 19/20
+#    Salvatore Campisi
+#    Parallel Programming on GPU
+#    CSV Parallel Normalization
+
+#   shard.sh
+#   Script for normalizing a CSV file with N local processes, one for each shard
+
+if [ $# -ge 3 ]
+then
+    N=$1
+    CSV=$2
+    NAME=$(basename $CSV)
+
+    cd bin
+
+    # Partial statistics of every shard:
+    for i in $(seq 0 $((N - 1)))
+    do
+        ./main fit --shard $i/$N data/$NAME.stats.$i $CSV "${@:3}" > /dev/null &
+    done
+    wait
+
+    # Merged statistics:
+    ./main merge-stats data/$NAME.stats $(for i in $(seq 0 $((N - 1))); do echo data/$NAME.stats.$i; done)
+
+    # Normalized segment of every shard:
+    for i in $(seq 0 $((N - 1)))
+    do
+        ./main transform --shard $i/$N --output data/$NAME.normalized.$i data/$NAME.stats $CSV > /dev/null &
+    done
+    wait
+
+    cd ..
+
+    # Concatenating the segments in shard order:
+    rm -f data/normalized.csv
+    for i in $(seq 0 $((N - 1)))
+    do
+        cat data/$NAME.normalized.$i >> data/normalized.csv
+        rm data/$NAME.normalized.$i data/$NAME.stats.$i
+    done
+
+else
+    echo "[FAIL] Example of use: bash shard.sh N_SHARDS csv_pathname_to_normalize col_index1 col_index2 ... col_indexN"
+    echo "                       bash shard.sh N_SHARDS csv_pathname_to_normalize ALL"
+fi
@@ -0,0 +1,131 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    binl_bench.c
+    C program for comparing write time and output size of normalized
+    columns written as CSV text and in the binary formats of BINL,
+    as float32 or quantized
+*/
+
+#include <time.h>
+#include <sys/stat.h>
+
+#include "../libs/binl/binl.h"
+
+double elapsed_ms(struct timespec from, struct timespec to){
+    return (to.tv_sec - from.tv_sec) * 1.0e3 + (to.tv_nsec - from.tv_nsec) * 1.0e-6;
+}
+
+long file_size(const char * pathname){
+    struct stat st;
+    if(stat(pathname, &st) != 0) return 0;
+    return st.st_size;
+}
+
+int main(int argc, char * argv[]){
+    const int n_rows = argc > 1 ? atoi(argv[1]) : 284807;
+    const int n_cols = argc > 2 ? atoi(argv[2]) : 30;
+    struct timespec start, end;
+
+    // Creating normalized columns in range [0,1]:
+    float ** columns = (float **) malloc(sizeof(float *) * n_cols);
+    unsigned int seed = 42;
+    for(int c = 0; c < n_cols; ++c){
+        columns[c] = (float *) malloc(sizeof(float) * n_rows);
+        for(int r = 0; r < n_rows; ++r){
+            seed = seed * 1103515245 + 12345;
+            columns[c][r] = (seed >> 8) / 16777216.0f;
+        }
+    }
+
+    fprintf(stdout, "[BINL BENCH] %d rows x %d columns\n", n_rows, n_cols);
+
+    // CSV text, formatted as csvl_write_fcolumn does:
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    FILE * csv_fd = fopen("./binl_bench.csv", "w");
+    for(int r = 0; r < n_rows; ++r){
+        for(int c = 0; c < n_cols; ++c){
+            fprintf(csv_fd, c == n_cols - 1 ? "%.6f\n" : "%.6f,", columns[c][r]);
+        }
+    }
+    fclose(csv_fd);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double csv_ms = elapsed_ms(start, end);
+    const long csv_bytes = file_size("./binl_bench.csv");
+    fprintf(stdout, "[BINL BENCH] %-12s %10.3f ms %12ld bytes\n", "csv", csv_ms, csv_bytes);
+    remove("./binl_bench.csv");
+
+    // Binary formats:
+    const char * formats[] = {"npy", "npy-columns", "raw"};
+    for(int f = 0; f < 3; ++f){
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        binl_writer * writer = binl_open("./binl_bench.out", binl_format(formats[f]), n_rows, n_cols, BINL_FLOAT32);
+        for(int c = 0; c < n_cols; ++c){
+            binl_write_column(writer, columns[c], c + 1);
+        }
+        const size_t written_bytes = writer->written_bytes;
+        binl_close(writer);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        const double ms = elapsed_ms(start, end);
+        fprintf(stdout, "[BINL BENCH] %-12s %10.3f ms %12zu bytes (%.1fx faster, %.1fx smaller than csv)\n",
+                formats[f], ms, written_bytes, csv_ms / ms, (double) csv_bytes / written_bytes);
+
+        // Removing the outputs:
+        remove("./binl_bench.out");
+        for(int c = 0; c < n_cols; ++c){
+            char pathname[64];
+            sprintf(pathname, "./binl_bench.out_%d.npy", c + 1);
+            remove(pathname);
+        }
+    }
+
+    // Quantized columns, as compact CSV integers (u8) and in npy format:
+    uint8_t * quantized_u8 = (uint8_t *) malloc(n_rows);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    csv_fd = fopen("./binl_bench.csv", "w");
+    for(int r = 0; r < n_rows; ++r){
+        for(int c = 0; c < n_cols; ++c){
+            binl_quantize(columns[c] + r, quantized_u8, 1, BINL_UINT8);
+            fprintf(csv_fd, c == n_cols - 1 ? "%u\n" : "%u,", quantized_u8[0]);
+        }
+    }
+    fclose(csv_fd);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double csv_u8_ms = elapsed_ms(start, end);
+    const long csv_u8_bytes = file_size("./binl_bench.csv");
+    fprintf(stdout, "[BINL BENCH] %-12s %10.3f ms %12ld bytes (%.1fx faster, %.1fx smaller than csv)\n",
+            "csv-u8", csv_u8_ms, csv_u8_bytes, csv_ms / csv_u8_ms, (double) csv_bytes / csv_u8_bytes);
+    remove("./binl_bench.csv");
+    free(quantized_u8);
+
+    const char * elements[] = {"u8", "u16", "fp16"};
+    for(int e = 0; e < 3; ++e){
+        const int element = binl_element(elements[e]);
+        void * quantized = malloc(binl_element_size(element) * n_rows);
+        char name[32];
+        sprintf(name, "npy-%s", elements[e]);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        binl_writer * writer = binl_open("./binl_bench.out", BINL_NPY, n_rows, n_cols, element);
+        for(int c = 0; c < n_cols; ++c){
+            binl_quantize(columns[c], quantized, n_rows, element);
+            binl_write_column(writer, quantized, c + 1);
+        }
+        const size_t written_bytes = writer->written_bytes;
+        binl_close(writer);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        const double ms = elapsed_ms(start, end);
+        fprintf(stdout, "[BINL BENCH] %-12s %10.3f ms %12zu bytes (%.1fx faster, %.1fx smaller than csv)\n",
+                name, ms, written_bytes, csv_ms / ms, (double) csv_bytes / written_bytes);
+
+        remove("./binl_bench.out");
+        free(quantized);
+    }
+
+    return 0;
+}
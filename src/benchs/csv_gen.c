@@ -0,0 +1,121 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    csv_gen.c
+    C program for generating synthetic CSV files of any size, the same
+    for a given seed, to benchmark the normalization end to end
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+// Distributions of the values:
+#define GEN_UNIFORM 0
+#define GEN_NORMAL 1
+#define GEN_LOGNORMAL 2
+#define GEN_FRAUD 3
+
+const char * distribution_names[] = { "uniform", "normal", "lognormal", "fraud" };
+
+// xorshift64* generator, so that the same seed gives the same file on every platform:
+uint64_t state;
+
+double next_uniform(){
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return ((state * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Box-Muller transform, one of the two values is dropped to keep the generator simple:
+double next_normal(){
+    const double u = 1.0 - next_uniform();
+    const double v = next_uniform();
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+/*
+    Writing a value of column c (counted from 0) of row r:
+    - uniform:   values in [-1000, 1000] with 6 decimals
+    - normal:    standard normal values with 17 significant digits
+    - lognormal: positive skewed values (e.g. amounts) with 2 decimals
+    - fraud:     the shape of the credit card fraud dataset: an increasing time, PCA-like
+                 normal columns with 17 significant digits, a lognormal amount and a quoted class
+*/
+void write_value(FILE * fd, int distribution, int64_t r, int c, int n_cols){
+    switch(distribution){
+        case GEN_UNIFORM:
+            fprintf(fd, "%.6f", next_uniform() * 2000.0 - 1000.0);
+            break;
+        case GEN_NORMAL:
+            fprintf(fd, "%.17g", next_normal());
+            break;
+        case GEN_LOGNORMAL:
+            fprintf(fd, "%.2f", exp(3.0 + 1.5 * next_normal()));
+            break;
+        default:
+            if(c == 0) fprintf(fd, "%lld", (long long) (r / 2));
+            else if(c == n_cols - 1) fprintf(fd, "\"%d\"", next_uniform() < 0.0017);
+            else if(c == n_cols - 2) fprintf(fd, "%.2f", exp(3.0 + 1.5 * next_normal()));
+            else fprintf(fd, "%.17g", next_normal() * (2.0 - c / (double) n_cols));
+    }
+}
+
+int main(int argc, char * argv[]){
+    if(argc < 4){
+        fprintf(stdout, "[CSV GEN][FAIL] Example of use: %s csv_pathname rows columns [uniform|normal|lognormal|fraud] [seed]\n", argv[0]);
+        return -1;
+    }
+
+    const char * csv_pathname = argv[1];
+    const int64_t n_rows = atoll(argv[2]);
+    const int n_cols = atoi(argv[3]);
+    const char * distribution_name = argc > 4 ? argv[4] : "uniform";
+    const uint64_t seed = argc > 5 ? strtoull(argv[5], NULL, 10) : 42;
+
+    int distribution = -1;
+    for(int d = 0; d < 4; ++d){
+        if(strcmp(distribution_name, distribution_names[d]) == 0) distribution = d;
+    }
+    if(n_rows < 1 || n_cols < 1 || distribution == -1 || (distribution == GEN_FRAUD && n_cols < 4)){
+        fprintf(stdout, "[CSV GEN][FAIL] Not valid rows, columns or distribution (fraud needs at least 4 columns)\n");
+        return -1;
+    }
+
+    FILE * fd = fopen(csv_pathname, "w");
+    if(fd == NULL){
+        fprintf(stdout, "[CSV GEN][FAIL] Can't create %s\n", csv_pathname);
+        return -1;
+    }
+    setvbuf(fd, NULL, _IOFBF, 1 << 20);
+
+    // A zero state would give only zeros:
+    state = seed * 0x9E3779B97F4A7C15ULL + 1;
+
+    // First row, with the column names:
+    for(int c = 0; c < n_cols; ++c){
+        fprintf(fd, c == n_cols - 1 ? "\"C%d\"\n" : "\"C%d\",", c + 1);
+    }
+
+    for(int64_t r = 0; r < n_rows; ++r){
+        for(int c = 0; c < n_cols; ++c){
+            write_value(fd, distribution, r, c, n_cols);
+            fputc(c == n_cols - 1 ? '\n' : ',', fd);
+        }
+    }
+
+    if(fclose(fd) != 0){
+        fprintf(stdout, "[CSV GEN][FAIL] Can't write %s\n", csv_pathname);
+        return -1;
+    }
+
+    fprintf(stdout, "[CSV GEN] %s: %lld rows x %d columns, %s values, seed %llu\n",
+            csv_pathname, (long long) n_rows, n_cols, distribution_name, (unsigned long long) seed);
+    return 0;
+}
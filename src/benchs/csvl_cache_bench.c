@@ -0,0 +1,83 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    csvl_cache_bench.c
+    C program for comparing the startup of a cold run (parsing the CSV file
+    and writing the columnar cache) with the startup of a cached run
+*/
+
+#include <time.h>
+
+#include "../libs/csvl/csvl.h"
+
+double elapsed_ms(struct timespec from, struct timespec to){
+    return (to.tv_sec - from.tv_sec) * 1.0e3 + (to.tv_nsec - from.tv_nsec) * 1.0e-6;
+}
+
+int main(int argc, char * argv[]){
+    if(argc < 2){
+        fprintf(stdout, "[CSVL CACHE BENCH][FAIL] Example of use: %s csv_pathname [repetitions]\n", argv[0]);
+        return -1;
+    }
+
+    const char * csv_pathname = argv[1];
+    const int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+    struct timespec start, end;
+    double sum = 0;
+
+    char * cache_pathname = malloc(strlen(csv_pathname) + strlen(CSVL_CACHE_SUFFIX) + 1);
+    strcpy(cache_pathname, csv_pathname);
+    strcat(cache_pathname, CSVL_CACHE_SUFFIX);
+
+    // Loading every column without cache, as done by the host program before:
+    const int n_cols = csvl_ncols(csv_pathname);
+    size_t n_elements;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(int c = 1; c <= n_cols; ++c){
+        free(csvl_load_fcolumn(csv_pathname, c, &n_elements));
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double uncached_ms = elapsed_ms(start, end);
+
+    // Cold run: parsing the CSV file and writing the cache:
+    remove(cache_pathname);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    csvl_cache * cache = csvl_cache_open(csv_pathname);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if(cache == NULL){
+        fprintf(stdout, "[CSVL CACHE BENCH][FAIL] Can't build the cache of %s\n", csv_pathname);
+        return -1;
+    }
+    csvl_cache_close(cache);
+    const double cold_ms = elapsed_ms(start, end);
+
+    // Cached runs: mapping the cache and touching every column:
+    for(int r = 0; r < repetitions; ++r){
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        cache = csvl_cache_open(csv_pathname);
+
+        volatile float checksum = 0;
+        for(int c = 1; c <= n_cols; ++c){
+            const float * column = csvl_cache_column(cache, c);
+            for(uint64_t i = 0; i < cache->header.n_rows; ++i) checksum += column[i];
+        }
+
+        csvl_cache_close(cache);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        sum += elapsed_ms(start, end);
+    }
+    const double cached_ms = sum / repetitions;
+
+    fprintf(stdout, "\n[CSVL CACHE BENCH] %s (%d columns)\n", csv_pathname, n_cols);
+    fprintf(stdout, "[CSVL CACHE BENCH] Per-column parsing: %10.3f ms\n", uncached_ms);
+    fprintf(stdout, "[CSVL CACHE BENCH] Cold (build cache): %10.3f ms\n", cold_ms);
+    fprintf(stdout, "[CSVL CACHE BENCH] Cached (mmap):      %10.3f ms (average of %d runs)\n", cached_ms, repetitions);
+    fprintf(stdout, "[CSVL CACHE BENCH] Speedup cold/cached: %.1fx\n", cold_ms / cached_ms);
+
+    free(cache_pathname);
+    return 0;
+}
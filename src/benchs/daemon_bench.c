@@ -0,0 +1,192 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    daemon_bench.c
+    C program for benchmarking the normalization of many small CSV files: main is
+    run once per file (cold, as from a script) and then the daemon normalizes all of
+    them with a warm context, and the throughput of both is compared
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#define DAEMON_BENCH_FILES 10000
+#define DAEMON_BENCH_ROWS 100
+#define DAEMON_BENCH_COLD_FILES 20
+
+// Numeric columns of the generated files, after the id:
+#define DAEMON_BENCH_COLUMNS 4
+
+// main runs in bin to find the kernels, the pathnames given to it are relative to the root of the project:
+char main_directory[] = "bin";
+
+// xorshift64*, so that the files are the same on every run:
+uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+double next_uniform(){
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return ((state * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double now_s(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1.0e-9;
+}
+
+void file_pathname(char * pathname, const char * directory, int f){
+    sprintf(pathname, "%s/daemon_bench_%05d.csv", directory, f);
+}
+
+int generate_files(const char * directory, int n_files, int n_rows){
+    char pathname[4096];
+
+    for(int f = 0; f < n_files; ++f){
+        file_pathname(pathname, directory, f);
+        FILE * fd = fopen(pathname, "w");
+        if(fd == NULL){
+            fprintf(stderr, "[DAEMON BENCH][FAIL] Can't create %s\n", pathname);
+            return -1;
+        }
+
+        fprintf(fd, "id");
+        for(int c = 0; c < DAEMON_BENCH_COLUMNS; ++c) fprintf(fd, ",value_%d", c);
+        fprintf(fd, "\n");
+        for(int r = 0; r < n_rows; ++r){
+            fprintf(fd, "%d", r);
+            for(int c = 0; c < DAEMON_BENCH_COLUMNS; ++c) fprintf(fd, ",%.4f", next_uniform() * 1000.0 * (c + 1));
+            fprintf(fd, "\n");
+        }
+        fclose(fd);
+    }
+    return 0;
+}
+
+/*
+    Running main in bin with the given arguments, the standard input and output
+    redirected to the given pathnames (NULL for /dev/null), and waiting for it.
+*/
+int run_main(char ** args, const char * input_pathname, const char * output_pathname){
+    fflush(stdout);
+    const pid_t pid = fork();
+    if(pid == 0){
+        const int null_fd = open("/dev/null", O_RDWR);
+        const int input_fd = input_pathname != NULL ? open(input_pathname, O_RDONLY) : null_fd;
+        const int output_fd = output_pathname != NULL ? open(output_pathname, O_WRONLY | O_CREAT | O_TRUNC, 0644) : null_fd;
+        dup2(input_fd, STDIN_FILENO);
+        dup2(output_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+
+        if(chdir(main_directory) == 0) execv("./main", args);
+        exit(127);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+int bench(const char * directory, int n_files, int n_rows, int n_cold, const char * n_threads){
+    char pathname[4096], jobs_pathname[4096], replies_pathname[4096], line[4096];
+
+    mkdir(directory, 0755);
+    fprintf(stdout, "[DAEMON BENCH] Generating %d files of %d rows in %s\n", n_files, n_rows, directory);
+    if(generate_files(directory, n_files, n_rows) != 0) return -1;
+
+    // Cold: one run of main per file, with its own context and compile:
+    double start = now_s();
+    for(int f = 0; f < n_cold; ++f){
+        file_pathname(pathname, directory, f);
+        char * args[] = { "./main", pathname, "ALL", NULL };
+        if(run_main(args, NULL, NULL) != 0){
+            fprintf(stderr, "[DAEMON BENCH][FAIL] main failed on %s\n", pathname);
+            return -1;
+        }
+    }
+    const double cold_s = now_s() - start;
+    const double cold_files_s = n_cold > 0 ? n_cold / cold_s : 0;
+    if(n_cold > 0){
+        fprintf(stdout, "[DAEMON BENCH] main per file: %d files in %.3f s, %.1f files/s (%.3f ms per file)\n",
+                n_cold, cold_s, cold_files_s, cold_s * 1.0e3 / n_cold);
+    }
+
+    // Warm: every file is a job of one daemon, started and stopped within the measure:
+    sprintf(jobs_pathname, "%s/daemon_bench_jobs.txt", directory);
+    sprintf(replies_pathname, "%s/daemon_bench_replies.txt", directory);
+    FILE * jobs_fd = fopen(jobs_pathname, "w");
+    if(jobs_fd == NULL){
+        fprintf(stderr, "[DAEMON BENCH][FAIL] Can't create %s\n", jobs_pathname);
+        return -1;
+    }
+    for(int f = 0; f < n_files; ++f){
+        file_pathname(pathname, directory, f);
+        fprintf(jobs_fd, "%s ALL\n", pathname);
+    }
+    fclose(jobs_fd);
+
+    char * args[] = { "./main", "daemon", n_threads != NULL ? "--threads" : NULL, (char *) n_threads, NULL };
+    start = now_s();
+    int result = run_main(args, jobs_pathname, replies_pathname);
+    const double warm_s = now_s() - start;
+
+    // Every job must have been done:
+    int n_done = 0;
+    FILE * replies_fd = fopen(replies_pathname, "r");
+    while(replies_fd != NULL && fgets(line, sizeof(line), replies_fd) != NULL) n_done += strncmp(line, "OK ", 3) == 0;
+    if(replies_fd != NULL) fclose(replies_fd);
+    if(result != 0 || n_done != n_files){
+        fprintf(stderr, "[DAEMON BENCH][FAIL] The daemon normalized %d files of %d\n", n_done, n_files);
+        result = -1;
+    }
+    else{
+        fprintf(stdout, "[DAEMON BENCH] daemon:       %d files in %.3f s, %.1f files/s (%.3f ms per file), %.0f rows/s\n",
+                n_files, warm_s, n_files / warm_s, warm_s * 1.0e3 / n_files, (double) n_files * n_rows / warm_s);
+        if(n_cold > 0) fprintf(stdout, "[DAEMON BENCH] Speedup of the daemon: %.1fx\n", n_files / warm_s / cold_files_s);
+    }
+
+    for(int f = 0; f < n_files; ++f){
+        file_pathname(pathname, directory, f);
+        remove(pathname);
+
+        // Columnar caches left by the runs of main:
+        strcat(pathname, ".csvlc");
+        remove(pathname);
+    }
+    remove(jobs_pathname);
+    remove(replies_pathname);
+    return result;
+}
+
+int main(int argc, char * argv[]){
+    int n_files = DAEMON_BENCH_FILES, n_rows = DAEMON_BENCH_ROWS, n_cold = DAEMON_BENCH_COLD_FILES;
+    const char * n_threads = NULL;
+
+    int a = 1;
+    for(; a + 1 < argc && strncmp(argv[a], "--", 2) == 0; a += 2){
+        if(strcmp(argv[a], "--files") == 0) n_files = atoi(argv[a + 1]);
+        else if(strcmp(argv[a], "--rows") == 0) n_rows = atoi(argv[a + 1]);
+        else if(strcmp(argv[a], "--cold") == 0) n_cold = atoi(argv[a + 1]);
+        else if(strcmp(argv[a], "--threads") == 0) n_threads = argv[a + 1];
+        else break;
+    }
+
+    if(argc - a != 1 || n_files < 1 || n_rows < 1 || n_cold < 0){
+        fprintf(stderr, "[DAEMON BENCH][FAIL] Example of use: %s [--files n] [--rows n] [--cold n] [--threads n] directory\n", argv[0]);
+        return -1;
+    }
+    if(n_cold > n_files) n_cold = n_files;
+
+    return bench(argv[a], n_files, n_rows, n_cold, n_threads) == 0 ? 0 : 1;
+}
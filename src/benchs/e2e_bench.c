@@ -0,0 +1,269 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    e2e_bench.c
+    C program for benchmarking the whole normalization of a CSV file: main is run
+    several times and the median and 95th percentile of the time spent in each stage
+    are written as JSON; two JSON results can be compared to catch regressions
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+#include "../libs/stagel/stagel.h"
+
+#define E2E_BENCH_RUNS 5
+#define E2E_BENCH_WARMUP_RUNS 1
+
+// Stages are compared only when they take at least this time, shorter ones are noise:
+#define E2E_BENCH_NOISE_MS 1.0
+#define E2E_BENCH_THRESHOLD 10.0
+
+// Stages of the results, and the total time of the run:
+#define N_TIMES (STAGEL_N_STAGES + 1)
+
+const char * time_name(int t){
+    return t < STAGEL_N_STAGES ? stagel_name(t) : "total";
+}
+
+// main runs in bin to find the kernels, the pathnames given to it are relative to the root of the project:
+char main_directory[] = "bin";
+
+int copy_file(const char * from_pathname, const char * to_pathname){
+    char buffer[1 << 16];
+    size_t n;
+
+    FILE * from = fopen(from_pathname, "rb");
+    FILE * to = fopen(to_pathname, "wb");
+    if(from == NULL || to == NULL){
+        if(from != NULL) fclose(from);
+        if(to != NULL) fclose(to);
+        return -1;
+    }
+    while((n = fread(buffer, 1, sizeof(buffer), from)) > 0) fwrite(buffer, 1, n, to);
+
+    fclose(from);
+    return fclose(to) == 0 ? 0 : -1;
+}
+
+// Reading the number following "name": in a JSON text, from the given position:
+int json_number(const char * json, const char * name, double * value){
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\": ", name);
+
+    const char * found = strstr(json, key);
+    if(found == NULL) return -1;
+
+    char * end;
+    * value = strtod(found + strlen(key), &end);
+    return end == found + strlen(key) ? -1 : 0;
+}
+
+char * read_text(const char * pathname){
+    FILE * fd = fopen(pathname, "rb");
+    if(fd == NULL) return NULL;
+
+    fseek(fd, 0, SEEK_END);
+    const long size = ftell(fd);
+    fseek(fd, 0, SEEK_SET);
+
+    char * text = malloc(size + 1);
+    text[fread(text, 1, size, fd)] = '\0';
+    fclose(fd);
+    return text;
+}
+
+/*
+    Running main once on a fresh copy of the CSV file (normalized in place), with the time of
+    its stages written to stages_pathname, and reading them back in times.
+*/
+int run_main(const char * csv_pathname, const char * scratch_pathname, const char * stages_pathname,
+             char ** columns, int n_columns, double * times){
+    // Every run is cold: the copy has no columnar cache:
+    char * cache_pathname = malloc(strlen(scratch_pathname) + 8);
+    sprintf(cache_pathname, "%s.csvlc", scratch_pathname);
+    remove(cache_pathname);
+    free(cache_pathname);
+    remove(stages_pathname);
+
+    if(copy_file(csv_pathname, scratch_pathname) != 0){
+        fprintf(stderr, "[E2E BENCH][FAIL] Can't copy %s\n", csv_pathname);
+        return -1;
+    }
+
+    fflush(stdout);
+    const pid_t pid = fork();
+    if(pid == 0){
+        // Logs are not needed, only the times of the stages:
+        const int null_fd = open("/dev/null", O_WRONLY);
+        dup2(null_fd, STDOUT_FILENO);
+        setenv("CSVL_STAGES", stages_pathname, 1);
+
+        char ** args = (char **) malloc(sizeof(char *) * (n_columns + 3));
+        args[0] = "./main";
+        args[1] = (char *) scratch_pathname;
+        for(int c = 0; c < n_columns; ++c) args[c + 2] = columns[c];
+        args[n_columns + 2] = NULL;
+
+        if(chdir(main_directory) == 0) execv("./main", args);
+        exit(127);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+        fprintf(stderr, "[E2E BENCH][FAIL] main failed on %s\n", csv_pathname);
+        return -1;
+    }
+
+    char * json = read_text(stages_pathname);
+    int result = json == NULL ? -1 : 0;
+    for(int t = 0; t < N_TIMES && result == 0; ++t){
+        result = json_number(json, time_name(t), &times[t]);
+    }
+    if(result != 0) fprintf(stderr, "[E2E BENCH][FAIL] Can't read the times of the stages from %s\n", stages_pathname);
+
+    free(json);
+    return result;
+}
+
+static int compare_doubles(const void * a, const void * b){
+    const double x = * (const double *) a, y = * (const double *) b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of n sorted values:
+double percentile(const double * sorted, int n, double p){
+    int rank = (int) (p / 100.0 * n + 0.999999);
+    if(rank < 1) rank = 1;
+    if(rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+double median(const double * sorted, int n){
+    return n % 2 == 1 ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+}
+
+int bench(const char * csv_pathname, char ** columns, int n_columns, int runs, int warmup_runs){
+    char * scratch_pathname = malloc(strlen(csv_pathname) + 24);
+    char * stages_pathname = malloc(strlen(csv_pathname) + 16);
+    sprintf(scratch_pathname, "%s.bench.csv", csv_pathname);
+    sprintf(stages_pathname, "%s.bench.json", csv_pathname);
+
+    double * times[N_TIMES];
+    for(int t = 0; t < N_TIMES; ++t) times[t] = (double *) malloc(sizeof(double) * runs);
+
+    int result = 0;
+    double run_times[N_TIMES];
+    for(int r = -warmup_runs; r < runs && result == 0; ++r){
+        result = run_main(csv_pathname, scratch_pathname, stages_pathname, columns, n_columns, run_times);
+        if(result == 0 && r >= 0){
+            for(int t = 0; t < N_TIMES; ++t) times[t][r] = run_times[t];
+            fprintf(stderr, "[E2E BENCH] Run %d of %d: %.3f ms\n", r + 1, runs, run_times[STAGEL_N_STAGES]);
+        }
+    }
+
+    remove(scratch_pathname);
+    remove(stages_pathname);
+    strcat(scratch_pathname, ".csvlc");
+    remove(scratch_pathname);
+
+    if(result == 0){
+        // JSON result on the standard output:
+        fprintf(stdout, "{\n  \"csv\": \"%s\",\n  \"columns\": \"", csv_pathname);
+        for(int c = 0; c < n_columns; ++c) fprintf(stdout, c == 0 ? "%s" : " %s", columns[c]);
+        fprintf(stdout, "\",\n  \"runs\": %d,\n  \"stages\": {\n", runs);
+
+        for(int t = 0; t < N_TIMES; ++t){
+            qsort(times[t], runs, sizeof(double), compare_doubles);
+            fprintf(stdout, "    \"%s\": {\"median_ms\": %.6f, \"p95_ms\": %.6f}%s\n",
+                    time_name(t), median(times[t], runs), percentile(times[t], runs, 95), t == N_TIMES - 1 ? "" : ",");
+        }
+        fprintf(stdout, "  }\n}\n");
+    }
+
+    for(int t = 0; t < N_TIMES; ++t) free(times[t]);
+    free(scratch_pathname);
+    free(stages_pathname);
+    return result;
+}
+
+/*
+    Comparing the medians of two results: a stage regresses when its median grows by more
+    than threshold percent (and by more than E2E_BENCH_NOISE_MS).
+    The routine returns the number of regressed stages, or -1 if fails.
+*/
+int compare(const char * baseline_pathname, const char * current_pathname, double threshold){
+    char * baseline = read_text(baseline_pathname);
+    char * current = read_text(current_pathname);
+    if(baseline == NULL || current == NULL){
+        fprintf(stderr, "[E2E BENCH][FAIL] Can't read %s\n", baseline == NULL ? baseline_pathname : current_pathname);
+        return -1;
+    }
+
+    int regressions = 0;
+    fprintf(stdout, "[E2E BENCH] %-10s %14s %14s %9s\n", "stage", "baseline ms", "current ms", "change");
+
+    for(int t = 0; t < N_TIMES; ++t){
+        char key[64];
+        double baseline_ms, current_ms;
+
+        // Each stage is an object with its median first:
+        snprintf(key, sizeof(key), "%s\": {\"median_ms", time_name(t));
+        if(json_number(baseline, key, &baseline_ms) != 0 || json_number(current, key, &current_ms) != 0){
+            fprintf(stderr, "[E2E BENCH][FAIL] Stage %s is missing\n", time_name(t));
+            free(baseline);
+            free(current);
+            return -1;
+        }
+
+        // A stage which took no time in the baseline (e.g. not run) has an infinite change:
+        const double change = baseline_ms > 0 ? (current_ms - baseline_ms) / baseline_ms * 100.0 : (current_ms > 0 ? INFINITY : 0);
+        const int regressed = current_ms - baseline_ms > E2E_BENCH_NOISE_MS && change > threshold;
+        regressions += regressed;
+
+        fprintf(stdout, "[E2E BENCH] %-10s %14.3f %14.3f %+8.1f%%%s\n",
+                time_name(t), baseline_ms, current_ms, change, regressed ? "  REGRESSION" : "");
+    }
+
+    free(baseline);
+    free(current);
+    return regressions;
+}
+
+int main(int argc, char * argv[]){
+    if(argc > 1 && strcmp(argv[1], "--compare") == 0){
+        if(argc < 4){
+            fprintf(stderr, "[E2E BENCH][FAIL] Example of use: %s --compare baseline.json current.json [threshold_percent]\n", argv[0]);
+            return -1;
+        }
+        const double threshold = argc > 4 ? atof(argv[4]) : E2E_BENCH_THRESHOLD;
+        const int regressions = compare(argv[2], argv[3], threshold);
+
+        if(regressions > 0) fprintf(stdout, "[E2E BENCH] %d stages regressed by more than %.1f%%\n", regressions, threshold);
+        return regressions == 0 ? 0 : 1;
+    }
+
+    int runs = E2E_BENCH_RUNS, warmup_runs = E2E_BENCH_WARMUP_RUNS;
+    int a = 1;
+    for(; a + 1 < argc && strncmp(argv[a], "--", 2) == 0; a += 2){
+        if(strcmp(argv[a], "--runs") == 0) runs = atoi(argv[a + 1]);
+        else if(strcmp(argv[a], "--warmup") == 0) warmup_runs = atoi(argv[a + 1]);
+        else break;
+    }
+
+    if(argc - a < 2 || runs < 1 || warmup_runs < 0){
+        fprintf(stderr, "[E2E BENCH][FAIL] Example of use: %s [--runs n] [--warmup n] csv_pathname col_index... > result.json\n", argv[0]);
+        return -1;
+    }
+
+    return bench(argv[a], argv + a + 1, argc - a - 1, runs, warmup_runs) == 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    io_bench.c
+    C program for benchmarking the backends of iol on a cold page cache: the
+    rows of a CSV file are read with fgets and written back with fprintf,
+    through stdio, pread and pwrite, and io_uring
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include "../libs/iol/iol.h"
+
+#define IO_BENCH_RUNS 3
+#define IO_BENCH_ROW_SIZE 4096
+
+static const char * backend_names[] = { "stdio", "pread", "uring" };
+
+double now_s(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1.0e-9;
+}
+
+// Dropping the pages of a file from the page cache, so that it is read from the disk:
+void drop_cache(const char * pathname){
+    const int fd = open(pathname, O_RDONLY);
+    if(fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/*
+    Reading every row of csv_pathname and writing it to output_pathname, filling
+    the seconds spent reading (the cache of the input dropped first) and writing
+    (the output on the disk included).
+*/
+int read_write(const char * csv_pathname, const char * output_pathname, double * read_s, double * write_s, uint64_t * n_bytes){
+    char row[IO_BENCH_ROW_SIZE];
+
+    drop_cache(csv_pathname);
+    double start = now_s();
+    FILE * csv_fd = iol_fopen(csv_pathname, "r");
+    if(csv_fd == NULL) return -1;
+
+    // Keeping the rows, so that the writes are measured on their own:
+    size_t size = 0, capacity = 1 << 20;
+    char * text = (char *) malloc(capacity);
+    while(fgets(row, sizeof(row), csv_fd) != NULL){
+        const size_t length = strlen(row);
+        if(size + length + 1 > capacity){
+            capacity *= 2;
+            text = (char *) realloc(text, capacity);
+        }
+        memcpy(text + size, row, length + 1);
+        size += length + 1;
+    }
+    fclose(csv_fd);
+    * read_s = now_s() - start;
+
+    start = now_s();
+    FILE * output_fd = iol_fopen(output_pathname, "w");
+    int result = output_fd == NULL ? -1 : 0;
+    for(size_t i = 0; result == 0 && i < size; i += strlen(text + i) + 1){
+        if(fprintf(output_fd, "%s", text + i) < 0) result = -1;
+    }
+    if(output_fd != NULL && fclose(output_fd) != 0) result = -1;
+
+    // Until the rows are on the disk, as the page cache would hide the writes otherwise:
+    const int fd = open(output_pathname, O_RDONLY);
+    if(fd >= 0){
+        fdatasync(fd);
+        close(fd);
+    }
+    * write_s = now_s() - start;
+
+    * n_bytes = size;
+    free(text);
+    return result;
+}
+
+/*
+    Running the given backend in a child process, since the backend of iol is chosen once per process.
+*/
+int bench_backend(const int backend, const char * csv_pathname, const char * output_pathname, const int n_runs){
+    fflush(stdout);
+    const pid_t pid = fork();
+    if(pid == 0){
+        setenv("CSVL_IO", backend_names[backend], 1);
+        if(iol_backend() != backend){
+            fprintf(stdout, "[IO BENCH] %-6s not available\n", backend_names[backend]);
+            exit(0);
+        }
+
+        double best_read_s = 0, best_write_s = 0, read_s, write_s;
+        uint64_t n_bytes = 0;
+        for(int r = 0; r < n_runs; ++r){
+            if(read_write(csv_pathname, output_pathname, &read_s, &write_s, &n_bytes) != 0){
+                fprintf(stderr, "[IO BENCH][FAIL] Can't copy %s to %s with %s\n", csv_pathname, output_pathname, backend_names[backend]);
+                exit(1);
+            }
+            if(r == 0 || read_s < best_read_s) best_read_s = read_s;
+            if(r == 0 || write_s < best_write_s) best_write_s = write_s;
+        }
+
+        const double mb = n_bytes / (1024.0 * 1024.0);
+        fprintf(stdout, "[IO BENCH] %-6s read (fgets) %8.1f MB/s  write (fprintf) %8.1f MB/s\n",
+                backend_names[backend], mb / best_read_s, mb / best_write_s);
+        exit(0);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+int main(int argc, char * argv[]){
+    int n_runs = IO_BENCH_RUNS;
+
+    int a = 1;
+    for(; a + 1 < argc && strncmp(argv[a], "--", 2) == 0; a += 2){
+        if(strcmp(argv[a], "--runs") == 0) n_runs = atoi(argv[a + 1]);
+        else if(strcmp(argv[a], "--depth") == 0) setenv("CSVL_IO_DEPTH", argv[a + 1], 1);
+        else if(strcmp(argv[a], "--block") == 0) setenv("CSVL_IO_BLOCK", argv[a + 1], 1);
+        else break;
+    }
+
+    if(argc - a != 1 || n_runs < 1){
+        fprintf(stderr, "[IO BENCH][FAIL] Example of use: %s [--runs n] [--depth n] [--block bytes] csv_pathname\n", argv[0]);
+        return -1;
+    }
+
+    char * output_pathname = (char *) malloc(strlen(argv[a]) + 16);
+    sprintf(output_pathname, "%s.io_bench", argv[a]);
+
+    struct stat st;
+    if(stat(argv[a], &st) != 0){
+        fprintf(stderr, "[IO BENCH][FAIL] Can't read %s\n", argv[a]);
+        return -1;
+    }
+    fprintf(stdout, "[IO BENCH] %s: %.1f MB, best of %d runs on a cold page cache\n", argv[a], st.st_size / (1024.0 * 1024.0), n_runs);
+
+    int result = 0;
+    for(int backend = IOL_STDIO; backend <= IOL_URING; ++backend){
+        if(bench_backend(backend, argv[a], output_pathname, n_runs) != 0) result = -1;
+    }
+
+    remove(output_pathname);
+    free(output_pathname);
+    return result == 0 ? 0 : 1;
+}
@@ -0,0 +1,292 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    kernel_bench.c
+    C program for benchmarking the reduction and normalize kernels on their own, on
+    device-resident data: element counts, WorkGroup configurations and variants (index
+    and compile-time specializations) are swept, and the bandwidth of each kernel is
+    compared with the one of a device copy
+*/
+
+#include <string.h>
+
+#include "../libs/ocl_wrapper/ocl_wrapper.h"
+#include "../libs/kernel_launchers/kernel_launchers.h"
+
+// The benchmark runs from the root of the project:
+#define KERNELS_PATHNAME "src/kernels/kernels.ocl"
+
+#define KERNEL_BENCH_WARMUP_RUNS 2
+#define KERNEL_BENCH_RUNS 5
+#define KERNEL_BENCH_MIN_ELEMENTS (1 << 10)
+#define KERNEL_BENCH_MAX_ELEMENTS (1 << 30)
+
+// Element counts grow by this factor at each step of the sweep:
+#define KERNEL_BENCH_STEP 4
+#define KERNEL_BENCH_MAX_STEPS 16
+#define KERNEL_BENCH_N_VARIANTS 3
+
+typedef cl_event (* reduction_launcher)(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                                        cl_mem output_buffer, cl_mem input_buffer, cl_ulong n_elements,
+                                        cl_int n_work_items, cl_int n_work_groups);
+
+/*
+    Kernels of the benchmark: reductions are launched twice (to one value for each
+    WorkGroup, then to the result), as the host program does, normal once
+*/
+typedef struct {
+    const char * name;
+    reduction_launcher launcher;
+    int outputs_per_group;
+    int bytes_per_element;
+    double ops_per_element;
+} bench_kernel;
+
+bench_kernel kernels[] = {
+    { MAX_MIN_FIND_KERNEL_NAME, launch_max_min_find, 2, sizeof(float), 2 },
+    { MAX_FIND_KERNEL_NAME, launch_max_find, 1, sizeof(float), 1 },
+    { MIN_FIND_KERNEL_NAME, launch_min_find, 1, sizeof(float), 1 },
+    { NORMALIZE_KERNEL_NAME, NULL, 0, 2 * sizeof(float), 2 }
+};
+const int n_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+// WorkGroup configurations of the reductions (normal always uses the preferred multiple):
+const int work_items_configs[] = { 64, 128, 256, 512, 1024 };
+const int work_groups_configs[] = { 16, 32, 64, 128 };
+#define KERNEL_BENCH_N_CONFIGS (sizeof(work_items_configs) / sizeof(int) * sizeof(work_groups_configs) / sizeof(int))
+
+static int compare_ulongs(const void * a, const void * b){
+    const cl_ulong x = * (const cl_ulong *) a, y = * (const cl_ulong *) b;
+    return (x > y) - (x < y);
+}
+
+// Element counts with an optional K, M or G suffix (powers of 1024):
+cl_ulong parse_elements(const char * text){
+    char * end;
+    cl_ulong value = strtoull(text, &end, 10);
+    if(* end == 'K' || * end == 'k') value <<= 10;
+    if(* end == 'M' || * end == 'm') value <<= 20;
+    if(* end == 'G' || * end == 'g') value <<= 30;
+    return value;
+}
+
+// Median runtime in nanoseconds of a kernel on n_elements elements, after the warmup runs:
+cl_ulong run_kernel(const bench_kernel * kernel, cl_kernel k, cl_command_queue q, cl_device_id d,
+                    cl_mem data_buffer, cl_mem support_buffer, cl_ulong n_elements, int n_work_items, int n_work_groups){
+    cl_ulong times[KERNEL_BENCH_RUNS];
+    cl_event events[2];
+
+    for(int r = -KERNEL_BENCH_WARMUP_RUNS; r < KERNEL_BENCH_RUNS; ++r){
+        if(kernel->launcher != NULL){
+            events[0] = kernel->launcher(k, q, NULL, support_buffer, data_buffer, n_elements, n_work_items, n_work_groups);
+            events[1] = kernel->launcher(k, q, events[0], support_buffer, support_buffer,
+                                         n_work_groups * kernel->outputs_per_group, n_work_items, 1);
+        }
+        else{
+            // Normalizing in [0,1] with max 1 and min 0 leaves the data as it is, run after run:
+            events[0] = events[1] = launch_normalize(k, q, d, data_buffer, n_elements, 1.0f, 0.0f);
+        }
+
+        if(r >= 0) times[r] = total_runtime_ns(events[0], events[1]);
+        clReleaseEvent(events[0]);
+        if(events[1] != events[0]) clReleaseEvent(events[1]);
+    }
+
+    qsort(times, KERNEL_BENCH_RUNS, sizeof(cl_ulong), compare_ulongs);
+    return times[KERNEL_BENCH_RUNS / 2];
+}
+
+// Best bandwidth in GB/s of a device copy of n_elements elements (from the first half of the buffer to the second one):
+double copy_bandwidth(cl_command_queue q, cl_mem data_buffer, cl_ulong n_elements){
+    const size_t half = n_elements / 2 * sizeof(float);
+    cl_ulong best = 0;
+    cl_event copy_event;
+
+    for(int r = -KERNEL_BENCH_WARMUP_RUNS; r < KERNEL_BENCH_RUNS; ++r){
+        cl_int err = clEnqueueCopyBuffer(q, data_buffer, data_buffer, 0, half, half, 0, NULL, &copy_event);
+        ocl_check(err, "[FAIL] Can't enqueue the copy of the buffer");
+        err = clWaitForEvents(1, &copy_event);
+        ocl_check(err, "[FAIL] Can't complete the copy of the buffer");
+
+        const cl_ulong ns = runtime_ns(copy_event);
+        if(r >= 0 && (best == 0 || ns < best)) best = ns;
+        clReleaseEvent(copy_event);
+    }
+
+    return best == 0 ? 0 : 2.0 * half / best;
+}
+
+int main(int argc, char * argv[]){
+    cl_int err;
+    cl_ulong max_elements = argc > 1 ? parse_elements(argv[1]) : KERNEL_BENCH_MAX_ELEMENTS;
+    const cl_ulong min_elements = argc > 2 ? parse_elements(argv[2]) : KERNEL_BENCH_MIN_ELEMENTS;
+
+    if(min_elements < 2 || max_elements < min_elements){
+        fprintf(stderr, "[KERNEL BENCH][FAIL] Example of use: %s [max_elements (e.g. 1G)] [min_elements (e.g. 1K)]\n", argv[0]);
+        return -1;
+    }
+
+    cl_platform_id p = select_platform();
+    cl_device_id d = select_device(p);
+    cl_context c = create_context(p, d);
+    cl_command_queue q = create_queue(c, d);
+
+    char device_name[256];
+    cl_ulong max_alloc;
+    size_t max_work_items;
+    err = clGetDeviceInfo(d, CL_DEVICE_NAME, sizeof(device_name), device_name, NULL);
+    ocl_check(err, "[FAIL] Can't get the device name");
+    err = clGetDeviceInfo(d, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, NULL);
+    ocl_check(err, "[FAIL] Can't get the max allocation size");
+    err = clGetDeviceInfo(d, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(max_work_items), &max_work_items, NULL);
+    ocl_check(err, "[FAIL] Can't get the max WorkGroup size");
+
+    // The largest element count must fit in a single buffer:
+    while(max_elements * sizeof(float) > max_alloc) max_elements /= 2;
+
+    // Uploading the data once, it stays on the device for the whole benchmark:
+    cl_mem data_buffer = clCreateBuffer(c, CL_MEM_READ_WRITE | CL_MEM_HOST_WRITE_ONLY, max_elements * sizeof(float), NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the data buffer");
+    cl_mem support_buffer = clCreateBuffer(c, CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS, 128 * 2 * sizeof(float), NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the support buffer");
+
+    const size_t chunk_elements = 1 << 20;
+    float * chunk = (float *) malloc(sizeof(float) * chunk_elements);
+    unsigned int seed = 42;
+    for(cl_ulong offset = 0; offset < max_elements; offset += chunk_elements){
+        const size_t n = max_elements - offset < chunk_elements ? max_elements - offset : chunk_elements;
+        for(size_t i = 0; i < n; ++i){
+            seed = seed * 1103515245 + 12345;
+            chunk[i] = (seed >> 8) / 16777216.0f;
+        }
+        err = clEnqueueWriteBuffer(q, data_buffer, CL_TRUE, offset * sizeof(float), n * sizeof(float), chunk, 0, NULL, NULL);
+        ocl_check(err, "[FAIL] Can't write the data buffer");
+    }
+    free(chunk);
+
+    // Roofline ceiling: the best bandwidth of a device copy over the sweep:
+    double ceiling = 0;
+    for(cl_ulong n = min_elements; n <= max_elements; n *= KERNEL_BENCH_STEP){
+        const double gbs = copy_bandwidth(q, data_buffer, n);
+        if(gbs > ceiling) ceiling = gbs;
+    }
+
+    fprintf(stdout, "[KERNEL BENCH] %s: copy ceiling %.3f GB/s, %llu to %llu elements, median of %d runs after %d warmup runs\n\n",
+            device_name, ceiling, (unsigned long long) min_elements, (unsigned long long) max_elements,
+            KERNEL_BENCH_RUNS, KERNEL_BENCH_WARMUP_RUNS);
+    // Variants: the generic kernels with both indexes (the 32 bits one only for the buffers it
+    // can index) and the ones specialized as the host program builds them for this device:
+    const char * variant_names[] = { "index32", "index64", "special" };
+    kernel_variant variants[KERNEL_BENCH_N_VARIANTS] = {
+        { 0, 0, 0, 1, 1, KERNEL_NAN_KEEP },
+        { 1, 0, 0, 1, 1, KERNEL_NAN_KEEP },
+        kernel_variant_for(d, 0)
+    };
+    const int n_variants = KERNEL_BENCH_N_VARIANTS;
+    variants[2].fp64 = 0;
+
+    char special_options[KERNEL_OPTIONS_SIZE];
+    kernel_variant_options(&variants[2], special_options, sizeof(special_options));
+    fprintf(stdout, "[KERNEL BENCH] special: %s\n\n", special_options);
+
+    // Medians of every variant, kernel, element count and configuration, and the best configurations, for the speedups:
+    static cl_ulong all_times[KERNEL_BENCH_N_VARIANTS][sizeof(kernels) / sizeof(kernels[0])][KERNEL_BENCH_MAX_STEPS][KERNEL_BENCH_N_CONFIGS];
+    int best_configs[KERNEL_BENCH_N_VARIANTS][sizeof(kernels) / sizeof(kernels[0])][KERNEL_BENCH_MAX_STEPS];
+    memset(best_configs, -1, sizeof(best_configs));
+
+    for(int v = 0; v < n_variants; ++v){
+        cl_program prog = kernel_program(KERNELS_PATHNAME, c, d, &variants[v]);
+        fprintf(stdout, "[KERNEL BENCH] %-13s %-8s %12s %5s %6s %12s %10s %8s %6s\n",
+                "kernel", "variant", "elements", "lws", "groups", "median ms", "GB/s", "ceiling", "ops/B");
+
+        for(int kn = 0; kn < n_kernels; ++kn){
+            const bench_kernel * kernel = &kernels[kn];
+            cl_kernel k = clCreateKernel(prog, kernel->name, &err);
+            ocl_check(err, "[FAIL] Can't create the kernel ", kernel->name);
+
+            size_t kernel_work_items;
+            err = clGetKernelWorkGroupInfo(k, d, CL_KERNEL_WORK_GROUP_SIZE, sizeof(kernel_work_items), &kernel_work_items, NULL);
+            ocl_check(err, "[FAIL] Can't get the WorkGroup size of the kernel ", kernel->name);
+
+            int step = 0;
+            for(cl_ulong n = min_elements; n <= max_elements && step < KERNEL_BENCH_MAX_STEPS; n *= KERNEL_BENCH_STEP, ++step){
+                if(!variants[v].index64 && n > KERNEL_INDEX32_MAX) break;
+
+                const int n_wi_configs = kernel->launcher != NULL ? sizeof(work_items_configs) / sizeof(int) : 1;
+                const int n_wg_configs = kernel->launcher != NULL ? sizeof(work_groups_configs) / sizeof(int) : 1;
+                cl_ulong best_ns = 0;
+                int best_config = -1;
+                cl_ulong * times = all_times[v][kn][step];
+
+                for(int config = 0; config < n_wi_configs * n_wg_configs; ++config){
+                    const int n_work_items = work_items_configs[config / n_wg_configs];
+                    const int n_work_groups = work_groups_configs[config % n_wg_configs];
+                    times[config] = 0;
+
+                    // WorkGroups larger than the device or the kernel allow are skipped, as the ones
+                    // of another size than the one the reductions are specialized for:
+                    if(kernel->launcher != NULL && ((size_t) n_work_items > max_work_items || (size_t) n_work_items > kernel_work_items)) continue;
+                    if(kernel->launcher != NULL && variants[v].local_size > 0 && n_work_items != variants[v].local_size) continue;
+
+                    times[config] = run_kernel(kernel, k, q, d, data_buffer, support_buffer, n, n_work_items, n_work_groups);
+                    if(best_config == -1 || times[config] < best_ns){
+                        best_ns = times[config];
+                        best_config = config;
+                    }
+                }
+                best_configs[v][kn][step] = best_config;
+
+                // Every configuration, the best one marked with '*':
+                for(int config = 0; config < n_wi_configs * n_wg_configs; ++config){
+                    if(times[config] == 0) continue;
+
+                    const double ms = times[config] * 1.0e-6;
+                    const double gbs = (double) n * kernel->bytes_per_element / times[config];
+                    char lws[8] = "auto", groups[8] = "auto";
+                    if(kernel->launcher != NULL){
+                        snprintf(lws, sizeof(lws), "%d", work_items_configs[config / n_wg_configs]);
+                        snprintf(groups, sizeof(groups), "%d", work_groups_configs[config % n_wg_configs]);
+                    }
+
+                    fprintf(stdout, "[KERNEL BENCH] %-13s %-8s %12llu %5s %6s %12.5f %10.3f %7.1f%% %6.2f%s\n",
+                            kernel->name, variant_names[v], (unsigned long long) n, lws, groups, ms, gbs,
+                            ceiling > 0 ? gbs / ceiling * 100.0 : 0, kernel->ops_per_element / kernel->bytes_per_element,
+                            config == best_config ? " *" : "");
+                }
+            }
+
+            clReleaseKernel(k);
+        }
+
+        clReleaseProgram(prog);
+    }
+
+    // Speedups of the specialized kernels over the generic ones, both in the best configuration of the
+    // specialized kernels (the generic reductions run faster with other WorkGroups on some devices, but
+    // the host program always launches them with N_WORK_ITEMS_PER_WORK_GROUP WorkItems):
+    fprintf(stdout, "\n[KERNEL BENCH] %-13s %12s %12s %12s %8s\n", "kernel", "elements", "generic ms", "special ms", "speedup");
+    for(int kn = 0; kn < n_kernels; ++kn){
+        int step = 0;
+        for(cl_ulong n = min_elements; n <= max_elements && step < KERNEL_BENCH_MAX_STEPS; n *= KERNEL_BENCH_STEP, ++step){
+            const int config = best_configs[2][kn][step];
+            const int generic = n > KERNEL_INDEX32_MAX || variants[2].index64 ? 1 : 0;
+            if(config == -1) continue;
+
+            const cl_ulong generic_ns = all_times[generic][kn][step][config];
+            const cl_ulong special_ns = all_times[2][kn][step][config];
+            if(generic_ns == 0 || special_ns == 0) continue;
+
+            fprintf(stdout, "[KERNEL BENCH] %-13s %12llu %12.5f %12.5f %7.2fx\n", kernels[kn].name, (unsigned long long) n,
+                    generic_ns * 1.0e-6, special_ns * 1.0e-6, (double) generic_ns / special_ns);
+        }
+    }
+
+    clReleaseMemObject(data_buffer);
+    clReleaseMemObject(support_buffer);
+    clReleaseCommandQueue(q);
+    clReleaseContext(c);
+    return 0;
+}
@@ -0,0 +1,695 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    arrowl.c
+    Self-contained C library for reading and writing Apache Arrow IPC
+    files (Feather v2) and streams with float32/float64 columns
+*/
+
+#include "./arrowl.h"
+
+// Arrow IPC constants (Schema.fbs / Message.fbs / File.fbs):
+#define ARROWL_METADATA_V5 4
+#define ARROWL_HEADER_SCHEMA 1
+#define ARROWL_HEADER_DICTIONARY_BATCH 2
+#define ARROWL_HEADER_RECORD_BATCH 3
+#define ARROWL_TYPE_FLOATING_POINT 3
+#define ARROWL_CONTINUATION 0xFFFFFFFFu
+
+/*
+    ---------------- Flatbuffers ----------------
+
+    Minimal builder: tables are written before the objects they refer to,
+    so that every uoffset is forward, and patched once the object is written.
+*/
+
+typedef struct {
+    unsigned char * data;
+    size_t size;
+    size_t capacity;
+} fb_builder;
+
+typedef struct {
+    int id;
+    int size;           // 1, 2, 4 or 8 bytes, FB_OFFSET for a reference to another object
+    uint64_t value;
+} fb_field;
+
+#define FB_OFFSET 0
+#define FB_MAX_FIELDS 8
+
+static void fb_put(fb_builder * b, const void * value, size_t size)
+{
+    if(b->size + size > b->capacity){
+        b->capacity = (b->size + size) * 2 + 256;
+        b->data = (unsigned char *) realloc(b->data, b->capacity);
+    }
+    if(value != NULL) memcpy(b->data + b->size, value, size);
+    else memset(b->data + b->size, 0, size);
+    b->size += size;
+}
+
+static void fb_pad(fb_builder * b, size_t align, size_t remainder)
+{
+    while(b->size % align != remainder) fb_put(b, NULL, 1);
+}
+
+static void fb_put_u32(fb_builder * b, uint32_t value)
+{
+    fb_put(b, &value, sizeof(value));
+}
+
+static void fb_patch(fb_builder * b, size_t slot, size_t target)
+{
+    const uint32_t offset = (uint32_t)(target - slot);
+    memcpy(b->data + slot, &offset, sizeof(offset));
+}
+
+// Writes vtable and table, filling 'slots' with the position of each FB_OFFSET field:
+static size_t fb_table(fb_builder * b, const fb_field * fields, int n_fields, size_t * slots)
+{
+    int order[FB_MAX_FIELDS];
+    size_t relative[FB_MAX_FIELDS];
+    int n_entries = 0;
+
+    // Biggest fields first, the table starts 4 bytes before an 8 bytes boundary:
+    for(int i = 0; i < n_fields; ++i){
+        int j = i;
+        const int size = fields[i].size == FB_OFFSET ? 4 : fields[i].size;
+        while(j > 0 && (fields[order[j-1]].size == FB_OFFSET ? 4 : fields[order[j-1]].size) < size){
+            order[j] = order[j-1];
+            --j;
+        }
+        order[j] = i;
+        if(fields[i].id + 1 > n_entries) n_entries = fields[i].id + 1;
+    }
+
+    size_t position = 8;
+    for(int k = 0; k < n_fields; ++k){
+        const int i = order[k];
+        const size_t size = fields[i].size == FB_OFFSET ? 4 : fields[i].size;
+        position = ((position + size - 1) / size) * size;
+        relative[i] = position - 4;
+        position += size;
+    }
+    const size_t table_size = position - 4;
+
+    // Vtable:
+    fb_pad(b, 2, 0);
+    const size_t vtable = b->size;
+    uint16_t vtable_head[2] = {(uint16_t)(4 + 2 * n_entries), (uint16_t) table_size};
+    fb_put(b, vtable_head, sizeof(vtable_head));
+    for(int id = 0; id < n_entries; ++id){
+        uint16_t entry = 0;
+        for(int i = 0; i < n_fields; ++i){
+            if(fields[i].id == id) entry = (uint16_t) relative[i];
+        }
+        fb_put(b, &entry, sizeof(entry));
+    }
+
+    // Table:
+    fb_pad(b, 8, 4);
+    const size_t table = b->size;
+    const int32_t soffset = (int32_t)(table - vtable);
+    fb_put(b, &soffset, sizeof(soffset));
+    fb_put(b, NULL, table_size - 4);
+
+    for(int i = 0; i < n_fields; ++i){
+        if(fields[i].size == FB_OFFSET){
+            slots[i] = table + relative[i];
+        }
+        else{
+            memcpy(b->data + table + relative[i], &fields[i].value, fields[i].size);
+        }
+    }
+
+    return table;
+}
+
+static size_t fb_string(fb_builder * b, const char * string)
+{
+    const uint32_t length = strlen(string);
+
+    fb_pad(b, 4, 0);
+    const size_t position = b->size;
+    fb_put_u32(b, length);
+    fb_put(b, string, length);
+    fb_put(b, NULL, 1);
+
+    return position;
+}
+
+// Vector of 8 bytes aligned structs:
+static size_t fb_struct_vector(fb_builder * b, const void * elements, uint32_t count, size_t element_size)
+{
+    fb_pad(b, 8, 4);
+    const size_t position = b->size;
+    fb_put_u32(b, count);
+    fb_put(b, elements, count * element_size);
+
+    return position;
+}
+
+// Vector of references, filling 'slots' with the position of each one:
+static size_t fb_offset_vector(fb_builder * b, uint32_t count, size_t * slots)
+{
+    fb_pad(b, 4, 0);
+    const size_t position = b->size;
+    fb_put_u32(b, count);
+    for(uint32_t i = 0; i < count; ++i){
+        slots[i] = b->size;
+        fb_put_u32(b, 0);
+    }
+
+    return position;
+}
+
+typedef struct {
+    const unsigned char * data;
+    size_t size;
+    int error;
+} fb_reader;
+
+static uint64_t fb_read(fb_reader * r, size_t position, size_t size)
+{
+    uint64_t value = 0;
+    if(position + size > r->size || position + size < position){
+        r->error = 1;
+        return 0;
+    }
+    memcpy(&value, r->data + position, size);
+    return value;
+}
+
+static size_t fb_deref(fb_reader * r, size_t position)
+{
+    return position + (uint32_t) fb_read(r, position, 4);
+}
+
+// Position of a table field, 0 if the field is not present:
+static size_t fb_field_position(fb_reader * r, size_t table, int id)
+{
+    const int32_t soffset = (int32_t) fb_read(r, table, 4);
+    const size_t vtable = table - soffset;
+    const uint16_t vtable_size = (uint16_t) fb_read(r, vtable, 2);
+
+    if((size_t)(4 + 2 * id) >= vtable_size) return 0;
+
+    const uint16_t entry = (uint16_t) fb_read(r, vtable + 4 + 2 * id, 2);
+    return entry == 0 ? 0 : table + entry;
+}
+
+static uint64_t fb_scalar(fb_reader * r, size_t table, int id, size_t size, uint64_t default_value)
+{
+    const size_t position = fb_field_position(r, table, id);
+    return position == 0 ? default_value : fb_read(r, position, size);
+}
+
+// Position of the object referenced by a table field, 0 if the field is not present:
+static size_t fb_reference(fb_reader * r, size_t table, int id)
+{
+    const size_t position = fb_field_position(r, table, id);
+    return position == 0 ? 0 : fb_deref(r, position);
+}
+
+/*
+    ---------------- Reader ----------------
+*/
+
+int arrowl_format(const char * name)
+{
+    if(strcmp(name, "arrow") == 0) return ARROWL_FILE;
+    if(strcmp(name, "arrow-stream") == 0) return ARROWL_STREAM;
+    return -1;
+}
+
+int arrowl_is_arrow(const char * pathname)
+{
+    const char * extensions[] = {".arrow", ".feather", ".arrows", ".ipc"};
+    const size_t length = strlen(pathname);
+
+    for(int i = 0; i < 4; ++i){
+        const size_t extension_length = strlen(extensions[i]);
+        if(length > extension_length && strcmp(pathname + length - extension_length, extensions[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static int arrowl_read_schema(arrowl_table * table, fb_reader * r, size_t schema)
+{
+    const size_t fields = fb_reference(r, schema, 1);
+    if(fields == 0 || r->error) return -1;
+
+    table->n_fields = (int) fb_read(r, fields, 4);
+    table->fields = (arrowl_field *) calloc(table->n_fields, sizeof(arrowl_field));
+
+    for(int i = 0; i < table->n_fields && !r->error; ++i){
+        const size_t field = fb_deref(r, fields + 4 + 4 * i);
+
+        // Name:
+        const size_t name = fb_reference(r, field, 0);
+        const uint32_t name_length = name == 0 ? 0 : (uint32_t) fb_read(r, name, 4);
+        if(name != 0) fb_read(r, name + 4, name_length);
+        if(r->error) return -1;
+
+        table->fields[i].name = (char *) malloc(name_length + 1);
+        if(name_length > 0) memcpy(table->fields[i].name, r->data + name + 4, name_length);
+        table->fields[i].name[name_length] = '\0';
+
+        // Type, only floating points are supported:
+        const int type_type = (int) fb_scalar(r, field, 2, 1, 0);
+        const size_t type = fb_reference(r, field, 3);
+        const int precision = type == 0 ? -1 : (int) fb_scalar(r, type, 0, 2, 0);
+
+        if(type_type != ARROWL_TYPE_FLOATING_POINT || (precision != ARROWL_FLOAT32 && precision != ARROWL_FLOAT64)){
+            fprintf(stderr, "[ARROWL - FAIL] Field %s is not a float32 or float64 column\n", table->fields[i].name);
+            return -1;
+        }
+        table->fields[i].precision = precision;
+    }
+
+    return r->error ? -1 : 0;
+}
+
+static int arrowl_read_batch(arrowl_table * table, fb_reader * r, size_t batch, size_t body, uint64_t body_length)
+{
+    if(fb_reference(r, batch, 3) != 0){
+        fprintf(stderr, "[ARROWL - FAIL] Compressed record batches are not supported\n");
+        return -1;
+    }
+
+    const size_t nodes = fb_reference(r, batch, 1);
+    const size_t buffers = fb_reference(r, batch, 2);
+    if(nodes == 0 || buffers == 0 || r->error) return -1;
+
+    const uint32_t n_nodes = (uint32_t) fb_read(r, nodes, 4);
+    const uint32_t n_buffers = (uint32_t) fb_read(r, buffers, 4);
+    if(n_nodes < (uint32_t) table->n_fields || n_buffers < 2 * (uint32_t) table->n_fields) return -1;
+
+    table->batches = (arrowl_batch *) realloc(table->batches, (table->n_batches + 1) * sizeof(arrowl_batch));
+    arrowl_batch * b = &table->batches[table->n_batches++];
+
+    b->length = (int64_t) fb_scalar(r, batch, 0, 8, 0);
+    b->columns = (void **) calloc(table->n_fields, sizeof(void *));
+    b->validity = (const uint8_t **) calloc(table->n_fields, sizeof(uint8_t *));
+    b->null_counts = (int64_t *) calloc(table->n_fields, sizeof(int64_t));
+
+    // Nodes are (length, null_count), buffers are (offset, length): validity and data for each field:
+    for(int i = 0; i < table->n_fields; ++i){
+        const size_t node = nodes + 4 + 16 * i;
+        const size_t validity = buffers + 4 + 16 * (2 * i);
+        const size_t data = buffers + 4 + 16 * (2 * i + 1);
+
+        const int64_t node_length = (int64_t) fb_read(r, node, 8);
+        b->null_counts[i] = (int64_t) fb_read(r, node + 8, 8);
+
+        const uint64_t validity_offset = fb_read(r, validity, 8);
+        const uint64_t validity_length = fb_read(r, validity + 8, 8);
+        const uint64_t data_offset = fb_read(r, data, 8);
+        const uint64_t data_length = fb_read(r, data + 8, 8);
+        const uint64_t element_size = table->fields[i].precision == ARROWL_FLOAT32 ? 4 : 8;
+
+        // Every field has the rows of the batch, and a bitmap covering all of them when it has nulls:
+        if(r->error || b->length < 0 || node_length != b->length ||
+           data_offset + data_length > body_length || validity_offset + validity_length > body_length ||
+           data_length < b->length * element_size ||
+           (b->null_counts[i] > 0 && validity_length > 0 && validity_length < (uint64_t) (b->length + 7) / 8)){
+            fprintf(stderr, "[ARROWL - FAIL] Record batch %d is not valid\n", table->n_batches - 1);
+            return -1;
+        }
+
+        b->columns[i] = (void *) (table->mapping + body + data_offset);
+        b->validity[i] = (b->null_counts[i] > 0 && validity_length > 0) ? (const uint8_t *) (table->mapping + body + validity_offset) : NULL;
+    }
+
+    table->n_rows += b->length;
+    return 0;
+}
+
+arrowl_table * arrowl_open(const char * pathname)
+{
+    int arrow_fd = open(pathname, O_RDONLY);
+    if(arrow_fd == -1){
+        fprintf(stderr, "[ARROWL - FAIL] Can't read %s\n", pathname);
+        return NULL;
+    }
+
+    struct stat arrow_st;
+    if(fstat(arrow_fd, &arrow_st) != 0 || arrow_st.st_size < 8){
+        fprintf(stderr, "[ARROWL - FAIL] %s is not an Arrow IPC file\n", pathname);
+        close(arrow_fd);
+        return NULL;
+    }
+
+    arrowl_table * table = (arrowl_table * ) calloc(1, sizeof(arrowl_table));
+    table->mapping_size = arrow_st.st_size;
+    table->mapping = mmap(NULL, table->mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, arrow_fd, 0);
+    close(arrow_fd);
+
+    if(table->mapping == MAP_FAILED){
+        fprintf(stderr, "[ARROWL - FAIL] Can't map %s\n", pathname);
+        free(table);
+        return NULL;
+    }
+
+    fb_reader r = {(const unsigned char *) table->mapping, table->mapping_size, 0};
+
+    // The file format is a stream between the magic and the footer:
+    size_t position = 0;
+    size_t end = table->mapping_size;
+    if(memcmp(table->mapping, ARROWL_MAGIC, 6) == 0){
+        const uint32_t footer_length = (uint32_t) fb_read(&r, table->mapping_size - 10, 4);
+        position = 8;
+        end = table->mapping_size - 10 - footer_length;
+    }
+
+    int result = 0;
+    int has_schema = 0;
+
+    // Reading the encapsulated messages:
+    while(result == 0 && position + 4 <= end){
+        uint32_t metadata_length = (uint32_t) fb_read(&r, position, 4);
+        size_t metadata = position + 4;
+
+        if(metadata_length == ARROWL_CONTINUATION){
+            metadata_length = (uint32_t) fb_read(&r, position + 4, 4);
+            metadata = position + 8;
+        }
+        if(metadata_length == 0 || r.error) break;
+
+        const size_t message = fb_deref(&r, metadata);
+        const int header_type = (int) fb_scalar(&r, message, 1, 1, 0);
+        const size_t header = fb_reference(&r, message, 2);
+        const uint64_t body_length = fb_scalar(&r, message, 3, 8, 0);
+        const size_t body = metadata + metadata_length;
+
+        if(r.error || header == 0 || body + body_length > table->mapping_size){
+            result = -1;
+        }
+        else if(header_type == ARROWL_HEADER_SCHEMA && !has_schema){
+            result = arrowl_read_schema(table, &r, header);
+            has_schema = 1;
+        }
+        else if(header_type == ARROWL_HEADER_RECORD_BATCH && has_schema){
+            result = arrowl_read_batch(table, &r, header, body, body_length);
+        }
+        else if(header_type == ARROWL_HEADER_DICTIONARY_BATCH){
+            fprintf(stderr, "[ARROWL - FAIL] Dictionary batches are not supported\n");
+            result = -1;
+        }
+        else{
+            result = -1;
+        }
+
+        position = body + body_length;
+    }
+
+    if(result != 0 || !has_schema || r.error){
+        fprintf(stderr, "[ARROWL - FAIL] Can't read %s\n", pathname);
+        arrowl_close(table);
+        return NULL;
+    }
+
+    fprintf(stdout, "[ARROWL - OK] Correctly mapped %d fields, %d record batches (%lld rows) from %s\n",
+            table->n_fields, table->n_batches, (long long) table->n_rows, pathname);
+    return table;
+}
+
+void arrowl_close(arrowl_table * table)
+{
+    for(int i = 0; i < table->n_fields; ++i){
+        free(table->fields[i].name);
+    }
+    for(int i = 0; i < table->n_batches; ++i){
+        free(table->batches[i].columns);
+        free(table->batches[i].validity);
+        free(table->batches[i].null_counts);
+    }
+    free(table->fields);
+    free(table->batches);
+    munmap(table->mapping, table->mapping_size);
+    free(table);
+}
+
+/*
+    ---------------- Writer ----------------
+*/
+
+// Schema table and every object it refers to:
+static size_t arrowl_build_schema(fb_builder * b, const arrowl_field * fields, int n_fields)
+{
+    size_t schema_slots[1];
+    const fb_field schema_fields[] = {{1, FB_OFFSET, 0}};
+    const size_t schema = fb_table(b, schema_fields, 1, schema_slots);
+
+    size_t * field_slots = (size_t *) malloc(sizeof(size_t) * (n_fields + 1));
+    fb_patch(b, schema_slots[0], fb_offset_vector(b, n_fields, field_slots));
+
+    for(int i = 0; i < n_fields; ++i){
+        size_t slots[5];
+        const fb_field field_fields[] = {
+            {0, FB_OFFSET, 0},                              // name
+            {1, 1, 1},                                      // nullable
+            {2, 1, ARROWL_TYPE_FLOATING_POINT},             // type_type
+            {3, FB_OFFSET, 0},                              // type
+            {5, FB_OFFSET, 0}                               // children
+        };
+        const size_t field = fb_table(b, field_fields, 5, slots);
+        fb_patch(b, field_slots[i], field);
+
+        fb_patch(b, slots[0], fb_string(b, fields[i].name));
+
+        size_t precision_slots[1];
+        const fb_field precision_fields[] = {{0, 2, (uint64_t) fields[i].precision}};
+        fb_patch(b, slots[3], fb_table(b, precision_fields, 1, precision_slots));
+
+        fb_patch(b, slots[4], fb_offset_vector(b, 0, NULL));
+    }
+
+    free(field_slots);
+    return schema;
+}
+
+static int arrowl_write_bytes(arrowl_writer * writer, const void * data, size_t size)
+{
+    static const char zeros[ARROWL_ALIGN] = {0};
+
+    if(size == 0) return 0;
+    if(fwrite(data != NULL ? data : zeros, 1, size, writer->fd) != size) return -1;
+    writer->position += size;
+    return 0;
+}
+
+// Encapsulated message: continuation, metadata length, metadata padded so that the body is aligned:
+static int arrowl_write_message(arrowl_writer * writer, fb_builder * metadata, int64_t * metadata_length)
+{
+    const uint32_t continuation = ARROWL_CONTINUATION;
+    const size_t body_start = writer->position + 8 + metadata->size;
+    const size_t padding = (ARROWL_ALIGN - body_start % ARROWL_ALIGN) % ARROWL_ALIGN;
+    const uint32_t length = metadata->size + padding;
+
+    if(arrowl_write_bytes(writer, &continuation, 4) != 0) return -1;
+    if(arrowl_write_bytes(writer, &length, 4) != 0) return -1;
+    if(arrowl_write_bytes(writer, metadata->data, metadata->size) != 0) return -1;
+    if(arrowl_write_bytes(writer, NULL, padding) != 0) return -1;
+
+    if(metadata_length != NULL) * metadata_length = 8 + length;
+    return 0;
+}
+
+static size_t arrowl_build_message(fb_builder * b, int header_type, int64_t body_length, size_t * header_slot)
+{
+    size_t slots[4];
+
+    fb_put_u32(b, 0);
+    const fb_field message_fields[] = {
+        {0, 2, ARROWL_METADATA_V5},                         // version
+        {1, 1, (uint64_t) header_type},                     // header_type
+        {2, FB_OFFSET, 0},                                  // header
+        {3, 8, (uint64_t) body_length}                      // bodyLength
+    };
+    const size_t message = fb_table(b, message_fields, 4, slots);
+    fb_patch(b, 0, message);
+
+    * header_slot = slots[2];
+    return message;
+}
+
+arrowl_writer * arrowl_writer_open(const char * pathname, int format, const arrowl_field * fields, int n_fields)
+{
+    arrowl_writer * writer = (arrowl_writer *) calloc(1, sizeof(arrowl_writer));
+    writer->format = format;
+    writer->n_fields = n_fields;
+    writer->fields = (arrowl_field *) malloc(sizeof(arrowl_field) * n_fields);
+    for(int i = 0; i < n_fields; ++i){
+        writer->fields[i].name = strdup(fields[i].name);
+        writer->fields[i].precision = fields[i].precision;
+    }
+
+    writer->fd = fopen(pathname, "wb");
+    if(writer->fd == NULL){
+        fprintf(stderr, "[ARROWL - FAIL] Can't create %s\n", pathname);
+        arrowl_writer_close(writer);
+        return NULL;
+    }
+
+    // Magic of the file format, padded to 8 bytes:
+    if(format == ARROWL_FILE){
+        const char magic[8] = ARROWL_MAGIC;
+        arrowl_write_bytes(writer, magic, sizeof(magic));
+    }
+
+    // Schema message:
+    fb_builder b = {NULL, 0, 0};
+    size_t header_slot;
+    arrowl_build_message(&b, ARROWL_HEADER_SCHEMA, 0, &header_slot);
+    fb_patch(&b, header_slot, arrowl_build_schema(&b, fields, n_fields));
+
+    const int result = arrowl_write_message(writer, &b, NULL);
+    free(b.data);
+
+    if(result != 0){
+        fprintf(stderr, "[ARROWL - FAIL] Can't write the schema of %s\n", pathname);
+        arrowl_writer_close(writer);
+        return NULL;
+    }
+
+    return writer;
+}
+
+int arrowl_write_batch(arrowl_writer * writer, int64_t length, void * const * columns,
+                       const uint8_t * const * validity, const int64_t * null_counts)
+{
+    const int n_fields = writer->n_fields;
+    int64_t * nodes = (int64_t *) malloc(sizeof(int64_t) * 2 * n_fields);
+    int64_t * buffers = (int64_t *) malloc(sizeof(int64_t) * 4 * n_fields);
+    int64_t body_length = 0;
+
+    // Body layout, every buffer padded to ARROWL_ALIGN bytes:
+    for(int i = 0; i < n_fields; ++i){
+        const int64_t nulls = (null_counts != NULL && validity != NULL && validity[i] != NULL) ? null_counts[i] : 0;
+        const int64_t validity_length = nulls > 0 ? (length + 7) / 8 : 0;
+        const int64_t data_length = length * (writer->fields[i].precision == ARROWL_FLOAT32 ? 4 : 8);
+
+        nodes[2 * i] = length;
+        nodes[2 * i + 1] = nulls;
+
+        buffers[4 * i] = body_length;
+        buffers[4 * i + 1] = validity_length;
+        body_length += ((validity_length + ARROWL_ALIGN - 1) / ARROWL_ALIGN) * ARROWL_ALIGN;
+
+        buffers[4 * i + 2] = body_length;
+        buffers[4 * i + 3] = data_length;
+        body_length += ((data_length + ARROWL_ALIGN - 1) / ARROWL_ALIGN) * ARROWL_ALIGN;
+    }
+
+    // Record batch message:
+    fb_builder b = {NULL, 0, 0};
+    size_t header_slot, slots[3];
+    arrowl_build_message(&b, ARROWL_HEADER_RECORD_BATCH, body_length, &header_slot);
+
+    const fb_field batch_fields[] = {
+        {0, 8, (uint64_t) length},                          // length
+        {1, FB_OFFSET, 0},                                  // nodes
+        {2, FB_OFFSET, 0}                                   // buffers
+    };
+    fb_patch(&b, header_slot, fb_table(&b, batch_fields, 3, slots));
+    fb_patch(&b, slots[1], fb_struct_vector(&b, nodes, n_fields, 16));
+    fb_patch(&b, slots[2], fb_struct_vector(&b, buffers, 2 * n_fields, 16));
+
+    const size_t block_offset = writer->position;
+    int64_t metadata_length;
+    int result = arrowl_write_message(writer, &b, &metadata_length);
+    free(b.data);
+
+    // Body:
+    for(int i = 0; i < n_fields && result == 0; ++i){
+        const int64_t validity_length = buffers[4 * i + 1];
+        const int64_t data_length = buffers[4 * i + 3];
+
+        if(validity_length > 0){
+            result |= arrowl_write_bytes(writer, validity[i], validity_length);
+            result |= arrowl_write_bytes(writer, NULL, (ARROWL_ALIGN - validity_length % ARROWL_ALIGN) % ARROWL_ALIGN);
+        }
+        result |= arrowl_write_bytes(writer, columns[i], data_length);
+        result |= arrowl_write_bytes(writer, NULL, (ARROWL_ALIGN - data_length % ARROWL_ALIGN) % ARROWL_ALIGN);
+    }
+
+    free(nodes);
+    free(buffers);
+
+    if(result != 0){
+        fprintf(stderr, "[ARROWL - FAIL] Can't write a record batch\n");
+        return -1;
+    }
+
+    // Remembering the block for the footer, as (offset, metaDataLength, bodyLength):
+    if(writer->n_blocks == writer->blocks_capacity){
+        writer->blocks_capacity = writer->blocks_capacity == 0 ? 16 : writer->blocks_capacity * 2;
+        writer->blocks = (int64_t *) realloc(writer->blocks, sizeof(int64_t) * 3 * writer->blocks_capacity);
+    }
+    writer->blocks[3 * writer->n_blocks] = block_offset;
+    writer->blocks[3 * writer->n_blocks + 1] = metadata_length;
+    writer->blocks[3 * writer->n_blocks + 2] = body_length;
+    ++writer->n_blocks;
+
+    return 0;
+}
+
+int arrowl_writer_close(arrowl_writer * writer)
+{
+    int result = 0;
+
+    if(writer->fd != NULL){
+        // End of stream:
+        const uint32_t eos[2] = {ARROWL_CONTINUATION, 0};
+        result |= arrowl_write_bytes(writer, eos, sizeof(eos));
+
+        if(writer->format == ARROWL_FILE){
+            // Footer, with the schema and the blocks of the record batches:
+            fb_builder b = {NULL, 0, 0};
+            size_t slots[3];
+
+            fb_put_u32(&b, 0);
+            const fb_field footer_fields[] = {
+                {0, 2, ARROWL_METADATA_V5},                 // version
+                {1, FB_OFFSET, 0},                          // schema
+                {3, FB_OFFSET, 0}                           // recordBatches
+            };
+            fb_patch(&b, 0, fb_table(&b, footer_fields, 3, slots));
+            fb_patch(&b, slots[1], arrowl_build_schema(&b, writer->fields, writer->n_fields));
+
+            // Block structs are (int64 offset, int32 metaDataLength, padding, int64 bodyLength):
+            unsigned char * blocks = (unsigned char *) calloc(writer->n_blocks + 1, 24);
+            for(int i = 0; i < writer->n_blocks; ++i){
+                const int32_t metadata_length = (int32_t) writer->blocks[3 * i + 1];
+                memcpy(blocks + 24 * i, &writer->blocks[3 * i], 8);
+                memcpy(blocks + 24 * i + 8, &metadata_length, 4);
+                memcpy(blocks + 24 * i + 16, &writer->blocks[3 * i + 2], 8);
+            }
+            fb_patch(&b, slots[2], fb_struct_vector(&b, blocks, writer->n_blocks, 24));
+            free(blocks);
+
+            const int32_t footer_length = b.size;
+            result |= arrowl_write_bytes(writer, b.data, b.size);
+            result |= arrowl_write_bytes(writer, &footer_length, sizeof(footer_length));
+            result |= arrowl_write_bytes(writer, ARROWL_MAGIC, 6);
+            free(b.data);
+        }
+
+        if(fclose(writer->fd) != 0) result = -1;
+        if(result != 0) fprintf(stderr, "[ARROWL - FAIL] Can't complete the Arrow output\n");
+    }
+
+    for(int i = 0; i < writer->n_fields; ++i){
+        free(writer->fields[i].name);
+    }
+    free(writer->fields);
+    free(writer->blocks);
+    free(writer);
+
+    return result == 0 ? 0 : -1;
+}
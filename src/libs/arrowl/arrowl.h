@@ -0,0 +1,122 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    arrowl.h
+    Self-contained C library for reading and writing Apache Arrow IPC
+    files (Feather v2) and streams with float32/float64 columns
+*/
+
+#pragma once
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#define ARROWL_FLOAT32 1
+#define ARROWL_FLOAT64 2
+
+#define ARROWL_FILE 0
+#define ARROWL_STREAM 1
+
+#define ARROWL_MAGIC "ARROW1"
+#define ARROWL_ALIGN 64
+
+// Rows of each record batch written from a CSV file:
+#define ARROWL_BATCH_ROWS (64 * 1024)
+
+typedef struct {
+    char * name;
+    int precision;
+} arrowl_field;
+
+/*
+    A record batch: for each field, its data (float or double, depending on
+    the field precision) and its validity bitmap (NULL if without nulls)
+*/
+typedef struct {
+    int64_t length;
+    void ** columns;
+    const uint8_t ** validity;
+    int64_t * null_counts;
+} arrowl_batch;
+
+/*
+    An Arrow IPC file or stream mapped in memory: the columns of the
+    record batches point directly into the (private) mapping
+*/
+typedef struct {
+    int n_fields;
+    arrowl_field * fields;
+    int n_batches;
+    arrowl_batch * batches;
+    int64_t n_rows;
+    char * mapping;
+    size_t mapping_size;
+} arrowl_table;
+
+typedef struct {
+    FILE * fd;
+    int format;
+    int n_fields;
+    arrowl_field * fields;
+    size_t position;
+
+    // Blocks of the written record batches, for the footer of the file format:
+    int n_blocks;
+    int blocks_capacity;
+    int64_t * blocks;
+} arrowl_writer;
+
+/*
+    This routine parses a format name ("arrow" or "arrow-stream").
+    The routine returns the format, or -1 if the name is not valid.
+*/
+int arrowl_format(const char * name);
+
+/*
+    This routine returns 1 if the pathname has an Arrow extension
+    (.arrow, .feather, .arrows, .ipc), 0 instead.
+*/
+int arrowl_is_arrow(const char * pathname);
+
+/*
+    This routine maps an Arrow IPC file or stream, whose fields must all be
+    float32 or float64, and reads its schema and record batches without copying them.
+    The mapping is private: columns can be changed in place.
+    The routine returns NULL if fails.
+*/
+arrowl_table * arrowl_open(const char * pathname);
+
+/*
+    This routine unmaps the table and frees it.
+*/
+void arrowl_close(arrowl_table * table);
+
+/*
+    This routine creates an Arrow IPC file (ARROWL_FILE) or stream (ARROWL_STREAM)
+    with the given fields, writing its schema.
+    The routine returns NULL if fails.
+*/
+arrowl_writer * arrowl_writer_open(const char * pathname, int format, const arrowl_field * fields, int n_fields);
+
+/*
+    This routine writes a record batch of 'length' rows: columns[i] must have the precision
+    of field i, validity and null_counts may be NULL when the batch has no nulls.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int arrowl_write_batch(arrowl_writer * writer, int64_t length, void * const * columns,
+                       const uint8_t * const * validity, const int64_t * null_counts);
+
+/*
+    This routine completes the file (end of stream, footer) and frees the writer.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int arrowl_writer_close(arrowl_writer * writer);
@@ -0,0 +1,252 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    binl.c
+    C library for writing normalized FLOAT columns in binary formats
+    (NumPy .npy or raw column-major float32, or quantized) instead of CSV text
+*/
+
+#include "./binl.h"
+
+static size_t binl_align(size_t size)
+{
+    return ((size + BINL_ALIGN - 1) / BINL_ALIGN) * BINL_ALIGN;
+}
+
+static int binl_write_padding(FILE * fd, size_t size)
+{
+    static const char zeros[BINL_ALIGN] = {0};
+    if(size == 0) return 0;
+    return fwrite(zeros, 1, size, fd) == size ? 0 : -1;
+}
+
+// Writes a NPY 1.0 header, little-endian elements, padded so that data starts BINL_ALIGN aligned:
+static int binl_write_npy_header(FILE * fd, size_t n_rows, int n_cols, int element, size_t * written_bytes)
+{
+    const char * descr[] = {"<f4", "|u1", "<u2", "<f2"};
+    char dict[256];
+    int dict_len;
+
+    if(n_cols < 0){
+        dict_len = snprintf(dict, sizeof(dict), "{'descr': '%s', 'fortran_order': False, 'shape': (%zu,), }", descr[element], n_rows);
+    }
+    else{
+        // Column-major data, so that columns can be written one after the other:
+        dict_len = snprintf(dict, sizeof(dict), "{'descr': '%s', 'fortran_order': True, 'shape': (%zu, %d), }", descr[element], n_rows, n_cols);
+    }
+
+    const size_t preamble = 10;
+    const size_t header_len = binl_align(preamble + dict_len + 1) - preamble;
+
+    unsigned char magic[10] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                               (unsigned char)(header_len & 0xff), (unsigned char)(header_len >> 8)};
+
+    if(fwrite(magic, 1, sizeof(magic), fd) != sizeof(magic)) return -1;
+    if(fwrite(dict, 1, dict_len, fd) != (size_t) dict_len) return -1;
+    for(size_t i = dict_len; i < header_len - 1; ++i){
+        if(fputc(' ', fd) == EOF) return -1;
+    }
+    if(fputc('\n', fd) == EOF) return -1;
+
+    * written_bytes += preamble + header_len;
+    return 0;
+}
+
+int binl_format(const char * name)
+{
+    if(strcmp(name, "npy") == 0) return BINL_NPY;
+    if(strcmp(name, "npy-columns") == 0) return BINL_NPY_COLUMNS;
+    if(strcmp(name, "raw") == 0) return BINL_RAW;
+    return -1;
+}
+
+// Half precision float of a float, with round-to-nearest-even:
+static uint16_t binl_float_to_half(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const int exponent = (int) ((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    // Infinities and NaNs:
+    if(((bits >> 23) & 0xff) == 0xff) return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    if(exponent >= 31) return sign | 0x7c00;
+
+    // Subnormal halfs (or zero):
+    if(exponent <= 0){
+        if(exponent < -10) return sign;
+        mantissa |= 0x800000;
+        const int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if(rest > halfway || (rest == halfway && (half & 1))) ++half;
+        return sign | half;
+    }
+
+    uint32_t half = ((uint32_t) exponent << 10) | (mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1fff;
+    if(rest > 0x1000 || (rest == 0x1000 && (half & 1))) ++half;
+    return sign | half;
+}
+
+int binl_element(const char * name)
+{
+    if(strcmp(name, "f32") == 0) return BINL_FLOAT32;
+    if(strcmp(name, "u8") == 0) return BINL_UINT8;
+    if(strcmp(name, "u16") == 0) return BINL_UINT16;
+    if(strcmp(name, "fp16") == 0) return BINL_FLOAT16;
+    return -1;
+}
+
+size_t binl_element_size(int element)
+{
+    if(element == BINL_UINT8) return sizeof(uint8_t);
+    if(element == BINL_UINT16 || element == BINL_FLOAT16) return sizeof(uint16_t);
+    return sizeof(float);
+}
+
+void binl_quantize(const float * values, void * quantized, size_t n, int element)
+{
+    for(size_t i = 0; i < n; ++i){
+        // Saturating, NaN (constant columns) becoming 0 as in the OpenCL conversions:
+        const float value = values[i] > 0 ? (values[i] < 1 ? values[i] : 1) : 0;
+
+        if(element == BINL_UINT8) ((uint8_t *) quantized)[i] = (uint8_t) lrintf(value * 255.0f);
+        else if(element == BINL_UINT16) ((uint16_t *) quantized)[i] = (uint16_t) lrintf(value * 65535.0f);
+        else if(element == BINL_FLOAT16) ((uint16_t *) quantized)[i] = binl_float_to_half(values[i]);
+        else ((float *) quantized)[i] = values[i];
+    }
+}
+
+binl_writer * binl_open(const char * pathname, int format, size_t n_rows, int n_cols, int element)
+{
+    if(format < BINL_NPY || format > BINL_RAW || n_cols <= 0 || element < BINL_FLOAT32 || element > BINL_FLOAT16){
+        fprintf(stderr, "[BINL - FAIL] Error creating %s, the given shape is not valid\n", pathname);
+        return NULL;
+    }
+
+    binl_writer * writer = (binl_writer *) calloc(1, sizeof(binl_writer));
+    writer->format = format;
+    writer->n_rows = n_rows;
+    writer->n_cols = n_cols;
+    writer->element = element;
+    writer->element_size = binl_element_size(element);
+    writer->pathname = strdup(pathname);
+
+    // One file for each column will be created while writing:
+    if(format == BINL_NPY_COLUMNS) return writer;
+
+    writer->fd = fopen(pathname, "wb");
+    if(writer->fd == NULL){
+        fprintf(stderr, "[BINL - FAIL] Can't create %s\n", pathname);
+        free(writer->pathname);
+        free(writer);
+        return NULL;
+    }
+
+    int result;
+    if(format == BINL_NPY){
+        result = binl_write_npy_header(writer->fd, n_rows, n_cols, element, &writer->written_bytes);
+    }
+    else{
+        binl_raw_header header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, BINL_RAW_MAGIC, sizeof(header.magic));
+        header.version = 1;
+        header.element_size = writer->element_size;
+        header.n_rows = n_rows;
+        header.n_cols = n_cols;
+        header.data_offset = binl_align(sizeof(header));
+        header.column_stride = binl_align(n_rows * writer->element_size);
+        header.element_type = element;
+
+        result = fwrite(&header, sizeof(header), 1, writer->fd) == 1 ? 0 : -1;
+        if(result == 0) result = binl_write_padding(writer->fd, header.data_offset - sizeof(header));
+        writer->written_bytes += header.data_offset;
+    }
+
+    if(result != 0){
+        fprintf(stderr, "[BINL - FAIL] Can't write the header of %s\n", pathname);
+        fclose(writer->fd);
+        free(writer->pathname);
+        free(writer);
+        return NULL;
+    }
+
+    return writer;
+}
+
+int binl_write_column(binl_writer * writer, const void * column, int column_number)
+{
+    const size_t column_memsize = writer->n_rows * writer->element_size;
+
+    if(writer->written_cols >= writer->n_cols){
+        fprintf(stderr, "[BINL - FAIL] Error writing %s, too many columns\n", writer->pathname);
+        return -1;
+    }
+
+    if(writer->format == BINL_NPY_COLUMNS){
+        // Creating the file of this column:
+        char * column_pathname = (char *) malloc(strlen(writer->pathname) + 16);
+        sprintf(column_pathname, "%s_%d.npy", writer->pathname, column_number);
+
+        FILE * column_fd = fopen(column_pathname, "wb");
+        if(column_fd == NULL){
+            fprintf(stderr, "[BINL - FAIL] Can't create %s\n", column_pathname);
+            free(column_pathname);
+            return -1;
+        }
+
+        int result = binl_write_npy_header(column_fd, writer->n_rows, -1, writer->element, &writer->written_bytes);
+        if(result == 0 && fwrite(column, 1, column_memsize, column_fd) != column_memsize) result = -1;
+        if(fclose(column_fd) != 0) result = -1;
+
+        if(result != 0) fprintf(stderr, "[BINL - FAIL] Can't write %s\n", column_pathname);
+        free(column_pathname);
+        if(result != 0) return -1;
+    }
+    else{
+        if(fwrite(column, 1, column_memsize, writer->fd) != column_memsize){
+            fprintf(stderr, "[BINL - FAIL] Can't write column %d to %s\n", column_number, writer->pathname);
+            return -1;
+        }
+
+        // In the raw format every column starts BINL_ALIGN aligned:
+        if(writer->format == BINL_RAW){
+            const size_t padding = binl_align(column_memsize) - column_memsize;
+            if(binl_write_padding(writer->fd, padding) != 0) return -1;
+            writer->written_bytes += padding;
+        }
+    }
+
+    writer->written_bytes += column_memsize;
+    ++writer->written_cols;
+    return 0;
+}
+
+int binl_close(binl_writer * writer)
+{
+    int result = 0;
+
+    if(writer->fd != NULL && fclose(writer->fd) != 0){
+        fprintf(stderr, "[BINL - FAIL] Can't complete %s\n", writer->pathname);
+        result = -1;
+    }
+    if(writer->written_cols != writer->n_cols){
+        fprintf(stderr, "[BINL - FAIL] %s has %d columns instead of %d\n", writer->pathname, writer->written_cols, writer->n_cols);
+        result = -1;
+    }
+    else{
+        fprintf(stdout, "[BINL - OK] Correctly written %d columns (%zu bytes) to %s\n", writer->n_cols, writer->written_bytes, writer->pathname);
+    }
+
+    free(writer->pathname);
+    free(writer);
+    return result;
+}
@@ -0,0 +1,105 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    binl.h
+    C library for writing normalized FLOAT columns in binary formats
+    (NumPy .npy or raw column-major float32, or quantized) instead of CSV text
+*/
+
+#pragma once
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+
+#define BINL_NPY 0
+#define BINL_NPY_COLUMNS 1
+#define BINL_RAW 2
+
+// Elements of the columns, float32 or quantized with round-to-nearest:
+#define BINL_FLOAT32 0
+#define BINL_UINT8 1
+#define BINL_UINT16 2
+#define BINL_FLOAT16 3
+
+#define BINL_ALIGN 64
+#define BINL_RAW_MAGIC "CSVLRAW1"
+
+/*
+    Header of the raw format: it is followed by n_cols arrays of n_rows elements
+    (element_type, float32 when 0), the first one at data_offset and each one
+    column_stride bytes apart
+*/
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t element_size;
+    uint64_t n_rows;
+    uint64_t n_cols;
+    uint64_t data_offset;
+    uint64_t column_stride;
+    uint64_t element_type;
+    uint64_t reserved;
+} binl_raw_header;
+
+typedef struct {
+    int format;
+    size_t n_rows;
+    int n_cols;
+    int written_cols;
+    int element;
+    size_t element_size;
+    char * pathname;
+    FILE * fd;
+    size_t written_bytes;
+} binl_writer;
+
+/*
+    This routine parses a format name ("npy", "npy-columns" or "raw").
+    The routine returns the format, or -1 if the name is not valid.
+*/
+int binl_format(const char * name);
+
+/*
+    This routine parses an element name ("f32", "u8", "u16" or "fp16").
+    The routine returns the element, or -1 if the name is not valid.
+*/
+int binl_element(const char * name);
+
+/*
+    This routine returns the size in bytes of an element.
+*/
+size_t binl_element_size(int element);
+
+/*
+    This routine quantizes n values in range [0,1] to the given element with round-to-nearest,
+    as the normal_u8, normal_u16 and normal_f16 kernels do (e.g. for the values normalized on the host).
+*/
+void binl_quantize(const float * values, void * quantized, size_t n, int element);
+
+/*
+    This routine creates a writer for n_cols columns of n_rows elements.
+    With BINL_NPY the pathname is a single (n_rows, n_cols) .npy file, with
+    BINL_NPY_COLUMNS it is the prefix of one .npy file for each column
+    ("prefix_<column_number>.npy"), with BINL_RAW it is the raw file.
+    The routine returns NULL if fails.
+*/
+binl_writer * binl_open(const char * pathname, int format, size_t n_rows, int n_cols, int element);
+
+/*
+    This routine appends a column of elements, as it is, to the output of the writer.
+    Columns are stored in the order they are written.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int binl_write_column(binl_writer * writer, const void * column, int column_number);
+
+/*
+    This routine completes the output and frees the writer.
+    The routine returns 0 if every column has been written, -1 instead.
+*/
+int binl_close(binl_writer * writer);
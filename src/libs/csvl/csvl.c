@@ -10,7 +10,18 @@
 
 #include "./csvl.h"
 
-int csvl_nrows(const char * csv_path)
+// Temporary files of the process, numbered so that no two calls (or threads) share one:
+static uint64_t csvl_n_temp_files = 0;
+
+char * csvl_temp_path(const char * csv_path)
+{
+    char * temp_path = (char *) malloc(strlen(csv_path) + 48);
+    sprintf(temp_path, "%s.%ld.%llu.tmp", csv_path, (long) getpid(),
+            (unsigned long long) __atomic_fetch_add(&csvl_n_temp_files, 1, __ATOMIC_RELAXED));
+    return temp_path;
+}
+
+int64_t csvl_nrows(const char * csv_path)
 {
     // Opening the CSV file:
     FILE * csv_fd = fopen(csv_path, "r");
@@ -19,7 +30,7 @@ int csvl_nrows(const char * csv_path)
         return -1;
     }
 
-    int rows_counter = 0;
+    int64_t rows_counter = 0;
     char temp_row[ROW_MAX_SIZE];
 
     // Rows counting:
@@ -33,9 +44,9 @@ int csvl_nrows(const char * csv_path)
 
 int csvl_ncols(const char * csv_path)
 {
-    // Opening the CSV file:
-    FILE * csv_fd = fopen(csv_path, "r");
-    if(csv_fd == NULL){
+    // Opening the CSV file, compressed or not:
+    zipl_file * csv_file = zipl_open_read(csv_path);
+    if(csv_file == NULL){
         fprintf(stderr, "[CSVL - FAIL] Can't read %s\n", csv_path);
         return -1;
     }
@@ -44,21 +55,59 @@ int csvl_ncols(const char * csv_path)
     char temp_row[ROW_MAX_SIZE];
     const char * sep = ",";
     char * temp_piece;
+    char * save;
 
     // Getting the file's first row:
-    fgets(temp_row, ROW_MAX_SIZE, csv_fd);
+    if(fgets(temp_row, ROW_MAX_SIZE, csv_file->fd) == NULL) temp_row[0] = '\0';
 
     // Counting the columns:
-    temp_piece = strtok(temp_row, sep);
+    temp_piece = strtok_r(temp_row, sep, &save);
     while(temp_piece != NULL){
         ++cols_counter;
-        temp_piece = strtok(NULL, sep);
+        temp_piece = strtok_r(NULL, sep, &save);
     }
 
-    fclose(csv_fd);
+    zipl_close(csv_file);
     return cols_counter;
 }
 
+char * csvl_column_name(const char * csv_path, const int column_number)
+{
+    // Opening the CSV file:
+    FILE * csv_fd = fopen(csv_path, "r");
+    if(csv_fd == NULL){
+        fprintf(stderr, "[CSVL - FAIL] Can't read %s\n", csv_path);
+        return NULL;
+    }
+
+    int current_column_index = 0;
+    char temp_row[ROW_MAX_SIZE];
+    const char * sep = ",\r\n";
+    char * temp_piece;
+    char * name = NULL;
+
+    // Getting the file's first row:
+    if(fgets(temp_row, ROW_MAX_SIZE, csv_fd) == NULL) temp_row[0] = '\0';
+    fclose(csv_fd);
+
+    // Looking for the column:
+    temp_piece = strtok(temp_row, sep);
+    while(temp_piece != NULL && name == NULL){
+        if(++current_column_index == column_number){
+            // Removing the quotes:
+            size_t length = strlen(temp_piece);
+            if(length >= 2 && temp_piece[0] == '"' && temp_piece[length - 1] == '"'){
+                temp_piece[length - 1] = '\0';
+                ++temp_piece;
+            }
+            name = strdup(temp_piece);
+        }
+        temp_piece = strtok(NULL, sep);
+    }
+
+    return name;
+}
+
 void csvl_print(const char * csv_path)
 {
     // Opening the CSV file:
@@ -179,37 +228,39 @@ int csvl_column_to_file(const char * csv_original_path,
     return 0;
 }
 
-float * csvl_load_fcolumn(const char * csv_path,
-                          const int column_number,
-                          int * buffer_dim)
+int64_t csvl_load_fcolumn_into(const char * csv_path,
+                               const int column_number,
+                               float * buffer,
+                               const size_t buffer_dim)
 {
-    char * temp_path = "./temp.csv";
+    char * temp_path = csvl_temp_path(csv_path);
 
     // Creating the temporary CSV file:
     int result = csvl_column_to_file(csv_path, temp_path, column_number);
-    if(result != 0) return NULL;
+    if(result != 0){
+        remove(temp_path);
+        free(temp_path);
+        return -1;
+    }
 
     // Opening the temporary CSV file:
     FILE * csv_fd = fopen(temp_path, "r");
     if(csv_fd == NULL){
         fprintf(stderr, "[CSVL - FAIL] Can't process %s\n", csv_path);
-        return NULL;
+        free(temp_path);
+        return -1;
     }
 
     char temp_row[ROW_MAX_SIZE];
 
-    // Allocating the array for the data:
-    int data_dim = csvl_nrows(temp_path) - 1;
-    float * csv_data = (float *) malloc(sizeof(float) * data_dim);
-
     // Skipping the first row of the CSV file (is the one with the column name):
     fgets(temp_row, ROW_MAX_SIZE, csv_fd);
 
     // Loading the specidied column into the buffer:
-    int i = 0;
+    size_t i = 0;
     while(fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL){
-        if(i < data_dim){
-            csv_data[i] = atof(temp_row);
+        if(i < buffer_dim){
+            buffer[i] = atof(temp_row);
             ++i;
         }
     }
@@ -217,18 +268,416 @@ float * csvl_load_fcolumn(const char * csv_path,
     // Removing the temporary CSV file:
     fclose(csv_fd);
     remove(temp_path);
+    free(temp_path);
 
     fprintf(stdout, "[CSVL - OK] Correctly loaded float column %d from %s\n", column_number, csv_path);
 
+    return i;
+}
+
+float * csvl_load_fcolumn(const char * csv_path,
+                          const int column_number,
+                          size_t * buffer_dim)
+{
+    // Allocating the array for the data:
+    const int64_t n_rows = csvl_nrows(csv_path);
+    if(n_rows < 1) return NULL;
+    const size_t data_dim = n_rows - 1;
+    float * csv_data = (float *) malloc(sizeof(float) * data_dim);
+
+    // Loading the specified column into the buffer:
+    if(csvl_load_fcolumn_into(csv_path, column_number, csv_data, data_dim) == -1){
+        free(csv_data);
+        return NULL;
+    }
+
     // Return values:
     * buffer_dim = data_dim;
     return csv_data;
 }
 
-int csvl_write_fcolumn(const char * csv_path,
-                       const float * buffer_to_write,
-                       const int buffer_dim,
-                       const int column_number_to_ovverride)
+int * csvl_load_groups(const char * csv_path,
+                       const int column_number,
+                       dictl * groups,
+                       size_t * buffer_dim)
+{
+    FILE * csv_fd = fopen(csv_path, "r");
+    if(csv_fd == NULL){
+        fprintf(stderr, "[CSVL - FAIL] Can't process %s\n", csv_path);
+        return NULL;
+    }
+
+    char temp_row[ROW_MAX_SIZE];
+    const char * sep = ",";
+    char * temp_piece;
+    int current_column_index = 0;
+    size_t rows_capacity = 1024;
+    size_t i = 0;
+    int * ids = (int *) malloc(sizeof(int) * rows_capacity);
+
+    // Skipping the first row of the CSV file (is the one with the column name):
+    fgets(temp_row, ROW_MAX_SIZE, csv_fd);
+
+    // Mapping the key of each row to its id while parsing:
+    while(fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL){
+        if(i == rows_capacity){
+            rows_capacity *= 2;
+            ids = (int *) realloc(ids, sizeof(int) * rows_capacity);
+        }
+
+        current_column_index = 0;
+        temp_piece = strtok(temp_row, sep);
+        while(temp_piece != NULL && ++current_column_index < column_number){
+            temp_piece = strtok(NULL, sep);
+        }
+
+        // Rows without the column belong to the group of the empty key:
+        if(temp_piece == NULL) temp_piece = "";
+        const size_t key_size = strcspn(temp_piece, "\r\n");
+
+        ids[i] = dictl_id(groups, temp_piece, key_size);
+        ++i;
+    }
+
+    fclose(csv_fd);
+
+    fprintf(stdout, "[CSVL - OK] Correctly loaded %zu keys of column %d (%d distinct) from %s\n", i, column_number, groups->n_keys, csv_path);
+
+    * buffer_dim = i;
+    return ids;
+}
+
+int csvl_max_row_size(const char * csv_path)
+{
+    FILE * csv_fd = fopen(csv_path, "r");
+    if(csv_fd == NULL){
+        fprintf(stderr, "[CSVL - FAIL] Can't read %s\n", csv_path);
+        return -1;
+    }
+
+    char temp_row[ROW_MAX_SIZE];
+    int max_row_size = 0;
+
+    while(fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL){
+        const int row_size = strlen(temp_row);
+        if(row_size > max_row_size) max_row_size = row_size;
+    }
+
+    fclose(csv_fd);
+    return max_row_size;
+}
+
+int * csvl_column_types(const char * csv_path,
+                        int * n_cols)
+{
+    zipl_file * csv_file = zipl_open_read(csv_path);
+    if(csv_file == NULL){
+        fprintf(stderr, "[CSVL - FAIL] Can't read %s\n", csv_path);
+        return NULL;
+    }
+    FILE * csv_fd = csv_file->fd;
+
+    const int csv_file_ncols = csvl_ncols(csv_path);
+    int * types = (int *) calloc(csv_file_ncols + 1, sizeof(int));
+
+    char temp_row[ROW_MAX_SIZE];
+    const char * sep = ",";
+    char * temp_piece;
+    char * save;
+    char * end;
+    int current_column_index = 0;
+
+    // Skipping the first row of the CSV file (is the one with the column name):
+    fgets(temp_row, ROW_MAX_SIZE, csv_fd);
+
+    // A value is a number only if it is parsed as a whole:
+    for(int i = 0; i < CSVL_TYPE_ROWS && fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL; ++i){
+        current_column_index = 0;
+        temp_piece = strtok_r(temp_row, sep, &save);
+        while(temp_piece != NULL && current_column_index < csv_file_ncols){
+            temp_piece[strcspn(temp_piece, "\r\n")] = '\0';
+            if(temp_piece[0] != '\0'){
+                strtod(temp_piece, &end);
+                if(*end != '\0') types[current_column_index] = CSVL_STRING;
+            }
+            ++current_column_index;
+            temp_piece = strtok_r(NULL, sep, &save);
+        }
+    }
+
+    zipl_close(csv_file);
+
+    * n_cols = csv_file_ncols;
+    return types;
+}
+
+// Byte range of the rows parsed by a thread, and the codes of its keys:
+typedef struct {
+    const char * csv_path;
+    int column_number;
+    dictl * dictionary;
+    uint64_t begin;
+    uint64_t end;
+    int * codes;
+    size_t n_codes;
+    int result;
+} csvl_codes_task;
+
+static void * csvl_codes_worker(void * arg)
+{
+    csvl_codes_task * task = (csvl_codes_task *) arg;
+
+    FILE * csv_fd = fopen(task->csv_path, "r");
+    if(csv_fd == NULL || fseeko(csv_fd, task->begin, SEEK_SET) != 0){
+        if(csv_fd != NULL) fclose(csv_fd);
+        task->result = -1;
+        return NULL;
+    }
+
+    // Rows of the current batch, each one keeping its key:
+    char * rows = (char *) malloc((size_t) CSVL_CODES_BATCH * ROW_MAX_SIZE);
+    char * keys[CSVL_CODES_BATCH];
+    size_t key_sizes[CSVL_CODES_BATCH];
+    int batched = 0;
+    size_t codes_capacity = 1024;
+    uint64_t position = task->begin;
+    const char * sep = ",";
+    char * save;
+
+    task->codes = (int *) malloc(sizeof(int) * codes_capacity);
+    task->n_codes = 0;
+
+    while(1){
+        char * temp_row = rows + (size_t) batched * ROW_MAX_SIZE;
+        const int has_row = position < task->end && fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL;
+
+        if(has_row){
+            position += strlen(temp_row);
+
+            int current_column_index = 1;
+            char * temp_piece = strtok_r(temp_row, sep, &save);
+            while(temp_piece != NULL && current_column_index < task->column_number){
+                temp_piece = strtok_r(NULL, sep, &save);
+                ++current_column_index;
+            }
+
+            // Rows without the column get the code of the empty value:
+            keys[batched] = temp_piece != NULL ? temp_piece : "";
+            key_sizes[batched] = strcspn(keys[batched], "\r\n");
+            ++batched;
+        }
+
+        // Handing the batch to the dictionary:
+        if(batched == CSVL_CODES_BATCH || (!has_row && batched > 0)){
+            while(task->n_codes + batched > codes_capacity){
+                codes_capacity *= 2;
+                task->codes = (int *) realloc(task->codes, sizeof(int) * codes_capacity);
+            }
+            dictl_ids(task->dictionary, keys, key_sizes, batched, task->codes + task->n_codes);
+            task->n_codes += batched;
+            batched = 0;
+        }
+
+        if(!has_row) break;
+    }
+
+    free(rows);
+    fclose(csv_fd);
+    task->result = 0;
+    return NULL;
+}
+
+int * csvl_load_codes(const char * csv_path,
+                      const int column_number,
+                      dictl * dictionary,
+                      const int n_threads,
+                      size_t * buffer_dim)
+{
+    csvl_codes_task * tasks = (csvl_codes_task *) calloc(n_threads, sizeof(csvl_codes_task));
+    pthread_t * threads = (pthread_t *) malloc(sizeof(pthread_t) * n_threads);
+    int result = 0;
+
+    // Each thread parses a byte range of the rows:
+    for(int t = 0; t < n_threads && result == 0; ++t){
+        tasks[t].csv_path = csv_path;
+        tasks[t].column_number = column_number;
+        tasks[t].dictionary = dictionary;
+        result = csvl_shard_range(csv_path, t, n_threads, &tasks[t].begin, &tasks[t].end);
+    }
+    if(result != 0){
+        free(tasks);
+        free(threads);
+        return NULL;
+    }
+
+    for(int t = 0; t < n_threads; ++t){
+        pthread_create(&threads[t], NULL, csvl_codes_worker, &tasks[t]);
+    }
+    for(int t = 0; t < n_threads; ++t){
+        pthread_join(threads[t], NULL);
+    }
+
+    // Gathering the codes of the ranges in row order:
+    size_t n_codes = 0;
+    for(int t = 0; t < n_threads; ++t){
+        if(tasks[t].result != 0) result = -1;
+        n_codes += tasks[t].n_codes;
+    }
+
+    int * codes = (int *) malloc(sizeof(int) * (n_codes + 1));
+    n_codes = 0;
+    for(int t = 0; t < n_threads; ++t){
+        if(tasks[t].n_codes > 0) memcpy(codes + n_codes, tasks[t].codes, sizeof(int) * tasks[t].n_codes);
+        n_codes += tasks[t].n_codes;
+        free(tasks[t].codes);
+    }
+
+    free(tasks);
+    free(threads);
+
+    if(result != 0){
+        fprintf(stderr, "[CSVL - FAIL] Can't read %s\n", csv_path);
+        free(codes);
+        return NULL;
+    }
+
+    fprintf(stdout, "[CSVL - OK] Correctly encoded %zu values of column %d (%d distinct) from %s with %d threads\n",
+            n_codes, column_number, dictionary->n_keys, csv_path, n_threads);
+
+    * buffer_dim = n_codes;
+    return codes;
+}
+
+// Writes a value (or the name of a column) without its quotes and line ending:
+static void csvl_write_unquoted(FILE * output_fd, const char * value)
+{
+    for(; *value != '\0' && *value != '\r' && *value != '\n'; ++value){
+        if(*value != '"') fputc(*value, output_fd);
+    }
+}
+
+int csvl_write_codes(const char * csv_path,
+                     const int column_number,
+                     const int * codes,
+                     const size_t n_codes,
+                     const dictl * dictionary,
+                     const int onehot)
+{
+    FILE * csv_fd = fopen(csv_path, "r");
+    if(csv_fd == NULL){
+        fprintf(stderr, "[CSVL - FAIL] File %s does not exist\n", csv_path);
+        return -1;
+    }
+
+    const int csv_file_ncols = csvl_ncols(csv_path);
+    if(column_number < 1 || column_number > csv_file_ncols || codes == NULL || n_codes == 0){
+        fprintf(stderr, "[CSVL - FAIL] Error processing %s, the selected column is not valid\n", csv_path);
+        fclose(csv_fd);
+        return -1;
+    }
+
+    // Creating the new CSV file:
+    char * temp_path = csvl_temp_path(csv_path);
+
+    FILE * temp_fd = fopen(temp_path, "w+");
+    if(temp_fd == NULL){
+        fprintf(stderr, "[CSVL - FAIL] Error can't write the changes %s\n", csv_path);
+        fclose(csv_fd);
+        free(temp_path);
+        return -1;
+    }
+
+    char temp_row[ROW_MAX_SIZE];
+    char * temp_piece;
+    const char * sep = ",";
+    int current_column_index = 0;
+    size_t row_counter = 0;
+
+    // The first row (column names) gets a "column=key" name for each one-hot column:
+    fgets(temp_row, ROW_MAX_SIZE, csv_fd);
+    if(!onehot){
+        fprintf(temp_fd, "%s", temp_row);
+    }
+    else{
+        current_column_index = 0;
+        temp_piece = strtok(temp_row, sep);
+        while(temp_piece != NULL){
+            ++current_column_index;
+
+            if(current_column_index == column_number){
+                for(int k = 0; k < dictionary->n_keys; ++k){
+                    fprintf(temp_fd, "%s\"", k > 0 ? "," : "");
+                    csvl_write_unquoted(temp_fd, temp_piece);
+                    fprintf(temp_fd, "=");
+                    csvl_write_unquoted(temp_fd, dictl_key(dictionary, k));
+                    fprintf(temp_fd, "\"");
+                }
+                fprintf(temp_fd, current_column_index == csv_file_ncols ? "\n" : ",");
+            }
+            else if(current_column_index == csv_file_ncols) fprintf(temp_fd, "%s", temp_piece);
+            else fprintf(temp_fd, "%s,", temp_piece);
+
+            temp_piece = strtok(NULL, sep);
+        }
+    }
+
+    while(fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL){
+        const int code = row_counter < n_codes ? codes[row_counter] : -1;
+
+        current_column_index = 0;
+        temp_piece = strtok(temp_row, sep);
+
+        // For each piece of the current row:
+        while(temp_piece != NULL){
+            ++current_column_index;
+
+            // If we must override this column:
+            if(current_column_index == column_number){
+                if(!onehot) fprintf(temp_fd, "%d", code);
+                for(int k = 0; onehot && k < dictionary->n_keys; ++k){
+                    fprintf(temp_fd, k > 0 ? ",%d" : "%d", code == k);
+                }
+                fprintf(temp_fd, current_column_index == csv_file_ncols ? "\n" : ",");
+            }
+
+            // If this column must not be ovverriden:
+            else if(current_column_index == csv_file_ncols) fprintf(temp_fd, "%s", temp_piece);
+            else fprintf(temp_fd, "%s,", temp_piece);
+
+            temp_piece = strtok(NULL, sep);
+        }
+        ++row_counter;
+    }
+
+    fclose(csv_fd);
+    fclose(temp_fd);
+
+    // Replacing the old CSV file with the new one, in a single rename:
+    if(rename(temp_path, csv_path) != 0){
+        remove(temp_path);
+        free(temp_path);
+        fprintf(stderr, "[CSVL - FAIL] Error can't complete the changes %s\n", csv_path);
+        return -1;
+    }
+
+    free(temp_path);
+    return 0;
+}
+
+// Writes value i of the buffer: a float (element_size 0) or an unsigned integer of element_size bytes:
+static void csvl_write_value(FILE * output_fd, const void * buffer, const size_t element_size, const size_t i, const char * end)
+{
+    if(element_size == 0) fprintf(output_fd, "%.6f%s", ((const float *) buffer)[i], end);
+    else if(element_size == sizeof(uint8_t)) fprintf(output_fd, "%u%s", ((const uint8_t *) buffer)[i], end);
+    else fprintf(output_fd, "%u%s", ((const uint16_t *) buffer)[i], end);
+}
+
+// Replaces a column with the values of the buffer, as csvl_write_fcolumn and csvl_write_ucolumn do:
+static int csvl_write_column(const char * csv_path,
+                             const void * buffer_to_write,
+                             const size_t element_size,
+                             const size_t buffer_dim,
+                             const int column_number_to_ovverride)
 {
     // Checking if the CSV file already exist:
     FILE * csv_fd = fopen(csv_path, "r");
@@ -242,23 +691,28 @@ int csvl_write_fcolumn(const char * csv_path,
     // Consistency Checks:
     if(buffer_to_write == NULL || buffer_dim == 0){
         fprintf(stderr, "[CSVL - FAIL] Error processing %s, the given buffer is not valid\n", csv_path);
+        fclose(csv_fd);
         return -1;
     }
-    if(buffer_dim > (csvl_nrows(csv_path) - 1)){
+    if((int64_t) buffer_dim > (csvl_nrows(csv_path) - 1)){
         fprintf(stderr, "[CSVL - FAIL] Error processing %s, the given buffer is not valid\n", csv_path);
+        fclose(csv_fd);
         return -1;
     }
     if(column_number_to_ovverride < 1 || column_number_to_ovverride > csv_file_ncols){
         fprintf(stderr, "[CSVL - FAIL] Error processing %s, the selected column is not valid\n", csv_path);
+        fclose(csv_fd);
         return -1;
     }
 
     // Creating the new CSV file:
-    char * temp_path = "./temp.csv";
+    char * temp_path = csvl_temp_path(csv_path);
 
     FILE * temp_fd = fopen(temp_path, "w+");
     if(temp_fd == NULL){
         fprintf(stderr, "[CSVL - FAIL] Error can't write the changes %s\n", csv_path);
+        free(temp_path);
+        fclose(csv_fd);
         return -1;
     }
 
@@ -268,7 +722,7 @@ int csvl_write_fcolumn(const char * csv_path,
     char * temp_piece;
     const char * sep = ",";
     int current_column_index = 0;
-    int row_counter = 0;
+    size_t row_counter = 0;
 
     // Skip the process of the first row, you have only to rewrite it: (column names)
     fgets(temp_row, ROW_MAX_SIZE, csv_fd);
@@ -286,9 +740,9 @@ int csvl_write_fcolumn(const char * csv_path,
             if(current_column_index == column_number_to_ovverride){
                 // If this is the last column:
                 if(current_column_index == csv_file_ncols){
-                    fprintf(temp_fd, "%.6f\n", buffer_to_write[row_counter]);
+                    csvl_write_value(temp_fd, buffer_to_write, element_size, row_counter, "\n");
                 }
-                else fprintf(temp_fd, "%.6f,", buffer_to_write[row_counter]);
+                else csvl_write_value(temp_fd, buffer_to_write, element_size, row_counter, ",");
             }
 
             // If this column must not be ovverriden:
@@ -305,23 +759,700 @@ int csvl_write_fcolumn(const char * csv_path,
         ++row_counter;
     }
 
-    // Swapping the old CSV file with new CSV file:
-    char * support_path = "./support.csv";
-    rename(csv_path, support_path);
+    fclose(csv_fd);
+    if(fclose(temp_fd) != 0){
+        remove(temp_path);
+        free(temp_path);
+        fprintf(stderr, "[CSVL - FAIL] Error can't write the changes %s\n", csv_path);
+        return -1;
+    }
 
+    // Replacing the old CSV file with the new one, in a single rename:
     if(rename(temp_path, csv_path) != 0){
-        rename(support_path, csv_path);
-
         remove(temp_path);
+        free(temp_path);
         fprintf(stderr, "[CSVL - FAIL] Error can't complete the changes %s\n", csv_path);
         return -1;
     }
 
-    remove(temp_path);
-    remove(support_path);
-
+    free(temp_path);
+    return 0;
+}
+
+int csvl_write_fcolumn(const char * csv_path,
+                       const float * buffer_to_write,
+                       const size_t buffer_dim,
+                       const int column_number_to_ovverride)
+{
+    return csvl_write_column(csv_path, buffer_to_write, 0, buffer_dim, column_number_to_ovverride);
+}
+
+int csvl_write_ucolumn(const char * csv_path,
+                       const void * buffer_to_write,
+                       const size_t element_size,
+                       const size_t buffer_dim,
+                       const int column_number_to_ovverride)
+{
+    if(element_size != sizeof(uint8_t) && element_size != sizeof(uint16_t)){
+        fprintf(stderr, "[CSVL - FAIL] Error processing %s, %zu bytes integers are not supported\n", csv_path, element_size);
+        return -1;
+    }
+    return csvl_write_column(csv_path, buffer_to_write, element_size, buffer_dim, column_number_to_ovverride);
+}
+
+int csvl_write_text(const char * csv_path,
+                    const char * rows,
+                    const size_t rows_size)
+{
+    // Checking if the CSV file already exist:
+    FILE * csv_fd = fopen(csv_path, "r");
+    if(csv_fd == NULL){
+        fprintf(stderr, "[CSVL - FAIL] File %s does not exist\n", csv_path);
+        return -1;
+    }
+
+    // Creating the new CSV file:
+    char * temp_path = csvl_temp_path(csv_path);
+
+    FILE * temp_fd = fopen(temp_path, "w+");
+    if(temp_fd == NULL){
+        fprintf(stderr, "[CSVL - FAIL] Error can't write the changes %s\n", csv_path);
+        fclose(csv_fd);
+        free(temp_path);
+        return -1;
+    }
+
+    // Rewriting the first row (column names), then every other row at once:
+    char temp_row[ROW_MAX_SIZE];
+    if(fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL) fprintf(temp_fd, "%s", temp_row);
     fclose(csv_fd);
-    fclose(temp_fd);
 
+    const int written = fwrite(rows, 1, rows_size, temp_fd) == rows_size;
+    if(fclose(temp_fd) != 0 || !written){
+        remove(temp_path);
+        free(temp_path);
+        fprintf(stderr, "[CSVL - FAIL] Error can't write the changes %s\n", csv_path);
+        return -1;
+    }
+
+    // Replacing the old CSV file with the new one, in a single rename:
+    if(rename(temp_path, csv_path) != 0){
+        remove(temp_path);
+        free(temp_path);
+        fprintf(stderr, "[CSVL - FAIL] Error can't complete the changes %s\n", csv_path);
+        return -1;
+    }
+
+    free(temp_path);
+    return 0;
+}
+
+int64_t csvl_load_frows(const char * csv_path,
+                        const uint64_t offset,
+                        const int * columns,
+                        const int n_columns,
+                        float ** buffers,
+                        uint64_t * end_offset)
+{
+    // Opening the CSV file at the given offset:
+    FILE * csv_fd = fopen(csv_path, "r");
+    if(csv_fd == NULL || fseeko(csv_fd, offset, SEEK_SET) != 0){
+        fprintf(stderr, "[CSVL - FAIL] Can't read %s\n", csv_path);
+        if(csv_fd != NULL) fclose(csv_fd);
+        return -1;
+    }
+
+    char temp_row[ROW_MAX_SIZE];
+    const char * sep = ",";
+    char * temp_piece;
+    int current_column_index = 0;
+    size_t rows_capacity = 1024;
+    size_t i = 0;
+    uint64_t position = offset;
+
+    for(int c = 0; c < n_columns; ++c){
+        buffers[c] = (float *) malloc(sizeof(float) * rows_capacity);
+    }
+
+    // Skipping the first row of the CSV file (is the one with the column name):
+    if(offset == 0 && fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL){
+        position += strlen(temp_row);
+    }
+
+    // Loading the complete rows, a row still being appended is left to the next run:
+    while(fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL){
+        const size_t row_size = strlen(temp_row);
+        if(row_size == 0 || temp_row[row_size - 1] != '\n') break;
+        position += row_size;
+
+        if(i == rows_capacity){
+            rows_capacity *= 2;
+            for(int c = 0; c < n_columns; ++c){
+                buffers[c] = (float *) realloc(buffers[c], sizeof(float) * rows_capacity);
+            }
+        }
+
+        current_column_index = 0;
+        temp_piece = strtok(temp_row, sep);
+        while(temp_piece != NULL){
+            ++current_column_index;
+            for(int c = 0; c < n_columns; ++c){
+                if(columns[c] == current_column_index) buffers[c][i] = atof(temp_piece);
+            }
+            temp_piece = strtok(NULL, sep);
+        }
+        ++i;
+    }
+
+    fclose(csv_fd);
+    * end_offset = position;
+
+    fprintf(stdout, "[CSVL - OK] Correctly loaded %zu rows of %d float columns from byte %llu of %s\n",
+            i, n_columns, (unsigned long long) offset, csv_path);
+
+    return i;
+}
+
+// Writes a row replacing the given columns with the values of row i of the buffers, as csvl_write_fcolumn does:
+static void csvl_write_row(FILE * output_fd,
+                           char * row,
+                           const int csv_file_ncols,
+                           const int * columns,
+                           const int n_columns,
+                           float * const * buffers,
+                           const size_t i)
+{
+    const char * sep = ",";
+    int current_column_index = 0;
+    char * save;
+    char * temp_piece = strtok_r(row, sep, &save);
+
+    // For each piece of the current row:
+    while(temp_piece != NULL){
+        ++current_column_index;
+
+        int c = 0;
+        while(c < n_columns && columns[c] != current_column_index) ++c;
+
+        // If we must override this column:
+        if(c < n_columns){
+            if(current_column_index == csv_file_ncols){
+                fprintf(output_fd, "%.6f\n", buffers[c][i]);
+            }
+            else fprintf(output_fd, "%.6f,", buffers[c][i]);
+        }
+
+        // If this column must not be ovverriden:
+        else{
+            if(current_column_index == csv_file_ncols){
+                fprintf(output_fd, "%s", temp_piece);
+            }
+            else fprintf(output_fd, "%s,", temp_piece);
+        }
+
+        temp_piece = strtok_r(NULL, sep, &save);
+    }
+}
+
+int64_t csvl_write_frows(const char * csv_path,
+                         FILE * output_fd,
+                         const uint64_t begin,
+                         const uint64_t end,
+                         const int * columns,
+                         const int n_columns,
+                         float * const * buffers,
+                         const uint64_t max_rows)
+{
+    // Opening the CSV file at the given offset:
+    FILE * csv_fd = fopen(csv_path, "r");
+    if(csv_fd == NULL || fseeko(csv_fd, begin, SEEK_SET) != 0){
+        fprintf(stderr, "[CSVL - FAIL] Can't read %s\n", csv_path);
+        if(csv_fd != NULL) fclose(csv_fd);
+        return -1;
+    }
+
+    const int csv_file_ncols = csvl_ncols(csv_path);
+    char temp_row[ROW_MAX_SIZE];
+    int64_t row_counter = 0;
+    uint64_t position = begin;
+
+    // Skip the process of the first row, you have only to rewrite it: (column names)
+    if(begin == 0 && fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL){
+        position += strlen(temp_row);
+        fprintf(output_fd, "%s", temp_row);
+    }
+
+    while(position < end && fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL){
+        // The buffers have no value for the rows after max_rows:
+        if((uint64_t) row_counter == max_rows){
+            fprintf(stderr, "[CSVL - FAIL] %s has more than the %llu rows to write\n", csv_path, (unsigned long long) max_rows);
+            fclose(csv_fd);
+            return -1;
+        }
+
+        position += strlen(temp_row);
+        csvl_write_row(output_fd, temp_row, csv_file_ncols, columns, n_columns, buffers, row_counter);
+        ++row_counter;
+    }
+
+    fclose(csv_fd);
+    if(ferror(output_fd)){
+        fprintf(stderr, "[CSVL - FAIL] Error can't write the rows of %s\n", csv_path);
+        return -1;
+    }
+
+    return row_counter;
+}
+
+// First byte of the first row beginning at or after the given offset (never inside the first row):
+static uint64_t csvl_row_boundary(FILE * csv_fd, const uint64_t header_size, const uint64_t file_size, const uint64_t offset)
+{
+    if(offset <= header_size) return header_size;
+    if(offset >= file_size) return file_size;
+
+    // A row begins at offset only if the previous byte ends a row:
+    uint64_t position = offset - 1;
+    int ch;
+    fseeko(csv_fd, position, SEEK_SET);
+    while((ch = fgetc(csv_fd)) != EOF){
+        ++position;
+        if(ch == '\n') return position;
+    }
+    return file_size;
+}
+
+int csvl_shard_range(const char * csv_path,
+                     const int shard,
+                     const int n_shards,
+                     uint64_t * begin,
+                     uint64_t * end)
+{
+    if(n_shards < 1 || shard < 0 || shard >= n_shards){
+        fprintf(stderr, "[CSVL - FAIL] Shard %d/%d is not valid\n", shard, n_shards);
+        return -1;
+    }
+
+    if(zipl_format(csv_path) != ZIPL_NONE){
+        fprintf(stderr, "[CSVL - FAIL] Can't split %s in shards, it is compressed\n", csv_path);
+        return -1;
+    }
+
+    // Opening the CSV file:
+    FILE * csv_fd = fopen(csv_path, "r");
+    if(csv_fd == NULL){
+        fprintf(stderr, "[CSVL - FAIL] Can't read %s\n", csv_path);
+        return -1;
+    }
+
+    char temp_row[ROW_MAX_SIZE];
+    struct stat csv_st;
+    fstat(fileno(csv_fd), &csv_st);
+
+    const uint64_t file_size = csv_st.st_size;
+    const uint64_t header_size = fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL ? strlen(temp_row) : 0;
+
+    // Splitting the bytes after the first row, then moving each bound to the next row:
+    const uint64_t body_size = file_size - header_size;
+    * begin = csvl_row_boundary(csv_fd, header_size, file_size, header_size + body_size * shard / n_shards);
+    * end = csvl_row_boundary(csv_fd, header_size, file_size, header_size + body_size * (shard + 1) / n_shards);
+
+    fclose(csv_fd);
     return 0;
 }
+
+csvl_stream * csvl_stream_from_header(const char * header,
+                                      const int * columns,
+                                      const int n_columns,
+                                      const int chunk_rows)
+{
+    if(strlen(header) >= ROW_MAX_SIZE) return NULL;
+
+    csvl_stream * stream = (csvl_stream *) calloc(1, sizeof(csvl_stream));
+    stream->end = UINT64_MAX;
+    stream->n_columns = n_columns;
+    stream->columns = (int *) malloc(sizeof(int) * (n_columns + 1));
+    memcpy(stream->columns, columns, sizeof(int) * n_columns);
+
+    stream->capacity = chunk_rows > 0 ? chunk_rows : CSVL_STREAM_ROWS;
+    stream->text_capacity = (size_t) stream->capacity * 128;
+    stream->text = (char *) malloc(stream->text_capacity);
+    stream->rows = (size_t *) malloc(sizeof(size_t) * stream->capacity);
+    stream->buffers = (float **) malloc(sizeof(float *) * (n_columns + 1));
+    for(int c = 0; c < n_columns; ++c){
+        stream->buffers[c] = (float *) malloc(sizeof(float) * stream->capacity);
+    }
+
+    // Keeping the row with the column names and counting the columns:
+    char temp_row[ROW_MAX_SIZE];
+    char * save;
+    strcpy(stream->header, header);
+    stream->position = strlen(header);
+
+    strcpy(temp_row, header);
+    for(char * temp_piece = strtok_r(temp_row, ",", &save); temp_piece != NULL; temp_piece = strtok_r(NULL, ",", &save)){
+        ++stream->csv_ncols;
+    }
+
+    return stream;
+}
+
+int csvl_stream_push(csvl_stream * stream, const char * row)
+{
+    char temp_row[ROW_MAX_SIZE];
+    const char * sep = ",";
+    char * temp_piece;
+    char * save;
+    int current_column_index = 0;
+    const size_t row_size = strlen(row);
+
+    if(stream->n_rows == stream->capacity || row_size >= ROW_MAX_SIZE) return -1;
+
+    // Keeping the text of the row, to write it back:
+    if(stream->text_size + row_size + 1 > stream->text_capacity){
+        stream->text_capacity = (stream->text_size + row_size + 1) * 2;
+        stream->text = (char *) realloc(stream->text, stream->text_capacity);
+    }
+    stream->rows[stream->n_rows] = stream->text_size;
+    memcpy(stream->text + stream->text_size, row, row_size + 1);
+    stream->text_size += row_size + 1;
+
+    // Parsing the streamed columns:
+    strcpy(temp_row, row);
+    temp_piece = strtok_r(temp_row, sep, &save);
+    while(temp_piece != NULL){
+        ++current_column_index;
+        for(int c = 0; c < stream->n_columns; ++c){
+            if(stream->columns[c] == current_column_index) stream->buffers[c][stream->n_rows] = atof(temp_piece);
+        }
+        temp_piece = strtok_r(NULL, sep, &save);
+    }
+
+    ++stream->n_rows;
+    return 0;
+}
+
+void csvl_stream_clear(csvl_stream * stream)
+{
+    stream->n_rows = 0;
+    stream->text_size = 0;
+}
+
+csvl_stream * csvl_stream_open(const char * csv_path,
+                               const uint64_t begin,
+                               const uint64_t end,
+                               const int * columns,
+                               const int n_columns,
+                               const int chunk_rows)
+{
+    // Opening the CSV file, decompressed on a thread if it is compressed:
+    zipl_file * csv_file = zipl_open_read(csv_path);
+    if(csv_file == NULL){
+        fprintf(stderr, "[CSVL - FAIL] Can't read %s\n", csv_path);
+        return NULL;
+    }
+    FILE * csv_fd = csv_file->fd;
+
+    // Reading the row with the column names:
+    char header[ROW_MAX_SIZE];
+    csvl_stream * stream = NULL;
+    if(fgets(header, ROW_MAX_SIZE, csv_fd) != NULL){
+        stream = csvl_stream_from_header(header, columns, n_columns, chunk_rows);
+    }
+    if(stream == NULL){
+        // An empty decompression is a corrupted or truncated file:
+        if(feof(csv_fd)) zipl_finish(csv_file);
+        fprintf(stderr, "[CSVL - FAIL] %s has no valid first row\n", csv_path);
+        zipl_close(csv_file);
+        return NULL;
+    }
+    stream->fd = csv_fd;
+    stream->file = csv_file;
+    stream->end = end;
+
+    // Moving to the first row of the range:
+    if(begin > stream->position){
+        if(csv_file->format != ZIPL_NONE || fseeko(csv_fd, begin, SEEK_SET) != 0){
+            fprintf(stderr, "[CSVL - FAIL] Can't seek %s\n", csv_path);
+            csvl_stream_close(stream);
+            return NULL;
+        }
+        stream->position = begin;
+    }
+
+    return stream;
+}
+
+int csvl_stream_read(csvl_stream * stream)
+{
+    char temp_row[ROW_MAX_SIZE];
+
+    csvl_stream_clear(stream);
+
+    while(stream->n_rows < stream->capacity && stream->position < stream->end &&
+          fgets(temp_row, ROW_MAX_SIZE, stream->fd) != NULL){
+        stream->position += strlen(temp_row);
+        csvl_stream_push(stream, temp_row);
+    }
+
+    // A compressed file ends when its decompression does, which may have failed:
+    if(stream->file != NULL && feof(stream->fd) && zipl_finish(stream->file) != 0) return -1;
+
+    return stream->n_rows;
+}
+
+int csvl_stream_write(const csvl_stream * stream, FILE * output_fd, float * const * buffers)
+{
+    char temp_row[ROW_MAX_SIZE];
+
+    for(int i = 0; i < stream->n_rows; ++i){
+        strcpy(temp_row, stream->text + stream->rows[i]);
+        csvl_write_row(output_fd, temp_row, stream->csv_ncols, stream->columns, stream->n_columns, buffers, i);
+    }
+
+    return ferror(output_fd) ? -1 : 0;
+}
+
+void csvl_stream_close(csvl_stream * stream)
+{
+    if(stream->file != NULL) zipl_close(stream->file);
+    for(int c = 0; c < stream->n_columns; ++c){
+        free(stream->buffers[c]);
+    }
+    free(stream->buffers);
+    free(stream->columns);
+    free(stream->rows);
+    free(stream->text);
+    free(stream);
+}
+
+static int64_t csvl_mtime_ns(const struct stat * st)
+{
+#ifdef __APPLE__
+    return (int64_t) st->st_mtimespec.tv_sec * 1000000000 + st->st_mtimespec.tv_nsec;
+#else
+    return (int64_t) st->st_mtim.tv_sec * 1000000000 + st->st_mtim.tv_nsec;
+#endif
+}
+
+// FNV-1a, updated with consecutive pieces of the same content:
+static uint64_t csvl_hash_update(uint64_t hash, const char * data, size_t size)
+{
+    for(size_t i = 0; i < size; ++i){
+        hash ^= (unsigned char) data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+#define CSVL_HASH_SEED 14695981039346656037ULL
+
+static uint64_t csvl_file_hash(const char * csv_path)
+{
+    FILE * csv_fd = fopen(csv_path, "r");
+    if(csv_fd == NULL) return 0;
+
+    uint64_t hash = CSVL_HASH_SEED;
+    char * block = (char *) malloc(MB);
+    size_t read_bytes;
+
+    while((read_bytes = fread(block, 1, MB, csv_fd)) > 0){
+        hash = csvl_hash_update(hash, block, read_bytes);
+    }
+
+    free(block);
+    fclose(csv_fd);
+    return hash;
+}
+
+static csvl_cache * csvl_cache_map(const char * cache_path)
+{
+    int cache_fd = open(cache_path, O_RDONLY);
+    if(cache_fd == -1) return NULL;
+
+    csvl_cache * cache = (csvl_cache *) malloc(sizeof(csvl_cache));
+
+    // Checking the header:
+    struct stat cache_st;
+    if(fstat(cache_fd, &cache_st) != 0 ||
+       read(cache_fd, &cache->header, sizeof(csvl_cache_header)) != sizeof(csvl_cache_header) ||
+       memcmp(cache->header.magic, CSVL_CACHE_MAGIC, sizeof(cache->header.magic)) != 0 ||
+       (uint64_t) cache_st.st_size != cache->header.columns_offset + cache->header.n_cols * cache->header.column_stride){
+        close(cache_fd);
+        free(cache);
+        return NULL;
+    }
+
+    // Private mapping, so that columns can be normalized in place:
+    cache->mapping_size = cache_st.st_size;
+    cache->mapping = mmap(NULL, cache->mapping_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, cache_fd, 0);
+    close(cache_fd);
+
+    if(cache->mapping == MAP_FAILED){
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+static int csvl_cache_build(const char * csv_path, const char * cache_path, const struct stat * csv_st)
+{
+    // Getting the shape of the CSV file:
+    const int64_t n_rows = csvl_nrows(csv_path) - 1;
+    const int n_cols = csvl_ncols(csv_path);
+    if(n_rows < 0 || n_cols <= 0) return -1;
+
+    csvl_cache_header header;
+    memcpy(header.magic, CSVL_CACHE_MAGIC, sizeof(header.magic));
+    header.source_size = csv_st->st_size;
+    header.source_mtime_ns = csvl_mtime_ns(csv_st);
+    header.n_rows = n_rows;
+    header.n_cols = n_cols;
+    header.columns_offset = CSVL_CACHE_ALIGN;
+    header.column_stride = ((n_rows * sizeof(float) + CSVL_CACHE_ALIGN - 1) / CSVL_CACHE_ALIGN) * CSVL_CACHE_ALIGN;
+
+    const size_t cache_size = header.columns_offset + header.n_cols * header.column_stride;
+
+    // The cache is written in a temporary file and renamed only when complete:
+    char * temp_path = csvl_temp_path(cache_path);
+
+    int cache_fd = open(temp_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(cache_fd == -1){
+        fprintf(stderr, "[CSVL - FAIL] Can't create %s\n", temp_path);
+        free(temp_path);
+        return -1;
+    }
+    if(ftruncate(cache_fd, cache_size) != 0){
+        fprintf(stderr, "[CSVL - FAIL] Can't allocate %s\n", temp_path);
+        close(cache_fd);
+        remove(temp_path);
+        free(temp_path);
+        return -1;
+    }
+    char * mapping = mmap(NULL, cache_size, PROT_READ | PROT_WRITE, MAP_SHARED, cache_fd, 0);
+    if(mapping == MAP_FAILED){
+        fprintf(stderr, "[CSVL - FAIL] Can't map %s\n", temp_path);
+        close(cache_fd);
+        remove(temp_path);
+        free(temp_path);
+        return -1;
+    }
+
+    // Parsing every column of the CSV file directly into the cache, hashing its content meanwhile:
+    FILE * csv_fd = fopen(csv_path, "r");
+    if(csv_fd == NULL){
+        fprintf(stderr, "[CSVL - FAIL] Can't read %s\n", csv_path);
+        munmap(mapping, cache_size);
+        close(cache_fd);
+        remove(temp_path);
+        free(temp_path);
+        return -1;
+    }
+
+    char temp_row[ROW_MAX_SIZE];
+    const char * sep = ",";
+    char * temp_piece;
+    uint64_t hash = CSVL_HASH_SEED;
+    int64_t row = 0;
+
+    // The first row has the column names:
+    if(fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL){
+        hash = csvl_hash_update(hash, temp_row, strlen(temp_row));
+    }
+
+    while(fgets(temp_row, ROW_MAX_SIZE, csv_fd) != NULL){
+        hash = csvl_hash_update(hash, temp_row, strlen(temp_row));
+        if(row >= n_rows) continue;
+
+        int column_index = 0;
+        temp_piece = strtok(temp_row, sep);
+        while(temp_piece != NULL && column_index < n_cols){
+            float * column = (float *) (mapping + header.columns_offset + column_index * header.column_stride);
+            column[row] = atof(temp_piece);
+
+            ++column_index;
+            temp_piece = strtok(NULL, sep);
+        }
+        ++row;
+    }
+    fclose(csv_fd);
+
+    header.source_hash = hash;
+    memcpy(mapping, &header, sizeof(header));
+
+    munmap(mapping, cache_size);
+    close(cache_fd);
+
+    if(rename(temp_path, cache_path) != 0){
+        fprintf(stderr, "[CSVL - FAIL] Can't complete %s\n", cache_path);
+        remove(temp_path);
+        free(temp_path);
+        return -1;
+    }
+
+    free(temp_path);
+    return 0;
+}
+
+csvl_cache * csvl_cache_open(const char * csv_path)
+{
+    struct stat csv_st;
+    if(stat(csv_path, &csv_st) != 0){
+        fprintf(stderr, "[CSVL - FAIL] Can't read %s\n", csv_path);
+        return NULL;
+    }
+
+    char * cache_path = (char *) malloc(strlen(csv_path) + strlen(CSVL_CACHE_SUFFIX) + 1);
+    strcpy(cache_path, csv_path);
+    strcat(cache_path, CSVL_CACHE_SUFFIX);
+
+    // Checking if there is a valid cache:
+    csvl_cache * cache = csvl_cache_map(cache_path);
+    if(cache != NULL && cache->header.source_size == (uint64_t) csv_st.st_size){
+        if(cache->header.source_mtime_ns == csvl_mtime_ns(&csv_st)){
+            fprintf(stdout, "[CSVL - LOG] Cache hit for %s\n", csv_path);
+            free(cache_path);
+            return cache;
+        }
+
+        // Same size but touched since the cache was written, comparing the content:
+        if(cache->header.source_hash == csvl_file_hash(csv_path)){
+            fprintf(stdout, "[CSVL - LOG] Cache hit for %s (content unchanged)\n", csv_path);
+
+            // Refreshing the modification time, so that the next hit does not need the hash:
+            int cache_fd = open(cache_path, O_WRONLY);
+            cache->header.source_mtime_ns = csvl_mtime_ns(&csv_st);
+            if(cache_fd == -1 || pwrite(cache_fd, &cache->header, sizeof(csvl_cache_header), 0) != (ssize_t) sizeof(csvl_cache_header)){
+                fprintf(stderr, "[CSVL - FAIL] Can't refresh the modification time in %s, the next runs will hash the file again\n", cache_path);
+            }
+            if(cache_fd != -1) close(cache_fd);
+
+            free(cache_path);
+            return cache;
+        }
+    }
+    if(cache != NULL) csvl_cache_close(cache);
+
+    // Parsing the CSV file and writing the cache:
+    fprintf(stdout, "[CSVL - LOG] Cache miss for %s, parsing the CSV file\n", csv_path);
+    if(csvl_cache_build(csv_path, cache_path, &csv_st) != 0){
+        free(cache_path);
+        return NULL;
+    }
+
+    cache = csvl_cache_map(cache_path);
+    free(cache_path);
+    return cache;
+}
+
+float * csvl_cache_column(csvl_cache * cache, const int column_number)
+{
+    if(column_number < 1 || (uint64_t) column_number > cache->header.n_cols) return NULL;
+
+    return (float *) (cache->mapping + cache->header.columns_offset + (column_number - 1) * cache->header.column_stride);
+}
+
+void csvl_cache_close(csvl_cache * cache)
+{
+    munmap(cache->mapping, cache->mapping_size);
+    free(cache);
+}
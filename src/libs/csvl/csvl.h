@@ -13,17 +13,94 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "../dictl/dictl.h"
+#include "../zipl/zipl.h"
 
 #define KB 1024
 #define MB 1024 * KB
 
 #define ROW_MAX_SIZE KB
 
+// Types of the columns, guessed from the first CSVL_TYPE_ROWS rows:
+#define CSVL_FLOAT 0
+#define CSVL_STRING 1
+#define CSVL_TYPE_ROWS 1024
+
+// Keys handed to the dictionary at once by each parser thread:
+#define CSVL_CODES_BATCH 256
+
+#define CSVL_CACHE_SUFFIX ".csvlc"
+#define CSVL_CACHE_MAGIC "CSVLC001"
+#define CSVL_CACHE_ALIGN (4 * KB)
+
+/*
+    Fixed header of the columnar binary cache: it is followed by one
+    CSVL_CACHE_ALIGN aligned float array for each column of the CSV file
+*/
+typedef struct {
+    char magic[8];
+    uint64_t source_size;
+    int64_t source_mtime_ns;
+    uint64_t source_hash;
+    uint64_t n_rows;
+    uint64_t n_cols;
+    uint64_t columns_offset;
+    uint64_t column_stride;
+} csvl_cache_header;
+
+typedef struct {
+    csvl_cache_header header;
+    char * mapping;
+    size_t mapping_size;
+} csvl_cache;
+
+// Default number of rows of each chunk of a stream:
+#define CSVL_STREAM_ROWS (64 * KB)
+
+/*
+    Chunked reader of the rows of a CSV file or pipe: each chunk keeps the text of its
+    rows and the parsed FLOAT columns, so that it can be written back with the columns
+    replaced without ever holding a whole column in memory. Streams share no state,
+    so different threads can use different streams at the same time
+*/
+typedef struct {
+    FILE * fd;
+    zipl_file * file;
+    int csv_ncols;
+    int n_columns;
+    int * columns;
+    uint64_t position;
+    uint64_t end;
+
+    // Current chunk: rows[i] is the offset of row i in text, buffers[c][i] its value in columns[c]
+    int capacity;
+    int n_rows;
+    char header[ROW_MAX_SIZE];
+    char * text;
+    size_t text_size;
+    size_t text_capacity;
+    size_t * rows;
+    float ** buffers;
+} csvl_stream;
+
+/*
+    This routine returns the pathname of a new temporary file next to the given one
+    (so that it can be renamed over it), unique across processes and threads.
+    The returned pathname must be freed.
+*/
+char * csvl_temp_path(const char * csv_path);
+
 /*
     This routine takes the pathname of a CSV file and returns
     its number of rows or -1 if something goes wrong.
 */
-int csvl_nrows (const char * csv_path);
+int64_t csvl_nrows (const char * csv_path);
 
 /*
     This routine takes the pathname of a CSV file and returns
@@ -31,6 +108,13 @@ int csvl_nrows (const char * csv_path);
 */
 int csvl_ncols (const char * csv_path);
 
+/*
+    This routine takes the pathname of a CSV file and returns the name of
+    the specified column (without quotes), read from the first row.
+    The returned string must be freed, the routine returns NULL if fails.
+*/
+char * csvl_column_name(const char * csv_path, const int column_number);
+
 /*
     This routine takes the pathname of a CSV file and print
     the content of the CSV file on the standard output.
@@ -70,7 +154,72 @@ int csvl_column_to_file (const char * csv_original_path,
 */
 float * csvl_load_fcolumn(const char * csv_pathname,
                           const int column_number,
-                          int * buffer_dim);
+                          size_t * buffer_dim);
+
+/*
+    This routine takes the pathname of a CSV file and load a specified FLOAT column
+    in the given buffer, which must be able to contain at least buffer_dim elements
+    (e.g. a mapped device buffer).
+    The routine returns the number of loaded elements, or -1 if fails.
+*/
+int64_t csvl_load_fcolumn_into(const char * csv_pathname,
+                               const int column_number,
+                               float * buffer,
+                               const size_t buffer_dim);
+
+/*
+    This routine takes the pathname of a CSV file and loads a specified column of keys
+    (e.g. a merchant or an account) as the ids given to them by the dictionary, which
+    adds the keys it does not know yet: the returned buffer has an id for each row.
+    The routine will also fill a pointer with the dimension of the returned buffer.
+    The routine returns NULL if fails, or the pointer to the ids if success.
+*/
+int * csvl_load_groups(const char * csv_pathname,
+                       const int column_number,
+                       dictl * groups,
+                       size_t * buffer_dim);
+
+/*
+    This routine takes the pathname of a CSV file and returns the size in bytes of its
+    longest row (the one with the column names included), or -1 if fails.
+*/
+int csvl_max_row_size(const char * csv_pathname);
+
+/*
+    This routine takes the pathname of a CSV file and guesses the type of each column from
+    its first CSVL_TYPE_ROWS rows: a column is CSVL_STRING if any of its non-empty values
+    is not a number (quoted numbers included), CSVL_FLOAT otherwise.
+    The routine will also fill a pointer with the number of columns.
+    The routine returns NULL if fails, or the array of the types if success.
+*/
+int * csvl_column_types(const char * csv_pathname,
+                        int * n_cols);
+
+/*
+    This routine takes the pathname of a CSV file and encodes a specified column of strings
+    as the codes given to its values by the dictionary: n_threads threads parse a byte range
+    of the rows each, adding the values to the dictionary together.
+    The routine will also fill a pointer with the dimension of the returned buffer.
+    The routine returns NULL if fails, or the pointer to the codes (one for each row) if success.
+*/
+int * csvl_load_codes(const char * csv_pathname,
+                      const int column_number,
+                      dictl * dictionary,
+                      const int n_threads,
+                      size_t * buffer_dim);
+
+/*
+    This routine takes the pathname of a CSV file and replaces a specified column with the
+    given codes: with onehot 0 each value becomes its code (label encoding), otherwise the
+    column becomes one 0/1 column for each key of the dictionary, named "column=key".
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int csvl_write_codes(const char * csv_pathname,
+                     const int column_number,
+                     const int * codes,
+                     const size_t n_codes,
+                     const dictl * dictionary,
+                     const int onehot);
 
 /*
     This routine takes the pathname of a CSV file and replace a specified column
@@ -79,5 +228,147 @@ float * csvl_load_fcolumn(const char * csv_pathname,
 */
 int csvl_write_fcolumn(const char * csv_path,
                        const float * buffer_to_write,
-                       const int buffer_dim,
+                       const size_t buffer_dim,
+                       const int column_number_to_ovverride);
+
+/*
+    This routine takes the pathname of a CSV file and replace a specified column
+    with a buffer of quantized values, unsigned integers of element_size bytes (1 or 2),
+    written as compact integers.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int csvl_write_ucolumn(const char * csv_path,
+                       const void * buffer_to_write,
+                       const size_t element_size,
+                       const size_t buffer_dim,
                        const int column_number_to_ovverride);
+
+/*
+    This routine takes the pathname of a CSV file and replaces all its rows, except the
+    first one with the column names, with the given text of rows_size bytes (e.g. rows
+    written by the OpenCL device), in a single write.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int csvl_write_text(const char * csv_path,
+                    const char * rows,
+                    const size_t rows_size);
+
+/*
+    This routine takes the pathname of a CSV file and loads the specified FLOAT columns of
+    the complete rows starting at byte offset (the first row, with the column names, is
+    skipped when offset is 0): buffers[i] is allocated and filled with column columns[i].
+    The routine fills end_offset with the byte following the last complete row and
+    returns the number of loaded rows, or -1 if fails.
+*/
+int64_t csvl_load_frows(const char * csv_path,
+                        const uint64_t offset,
+                        const int * columns,
+                        const int n_columns,
+                        float ** buffers,
+                        uint64_t * end_offset);
+
+/*
+    This routine takes the pathname of a CSV file and appends to the given output the rows
+    between the bytes begin and end, replacing the specified columns with the FLOAT given
+    buffers (the first row, with the column names, is copied as it is when begin is 0).
+    The buffers hold max_rows rows: the routine fails if the range has more rows than them.
+    The routine returns the number of written rows, or -1 if fails.
+*/
+int64_t csvl_write_frows(const char * csv_path,
+                         FILE * output_fd,
+                         const uint64_t begin,
+                         const uint64_t end,
+                         const int * columns,
+                         const int n_columns,
+                         float * const * buffers,
+                         const uint64_t max_rows);
+
+/*
+    This routine takes the pathname of a CSV file and splits its rows in n_shards byte ranges
+    of about the same size, aligned to the beginning of the rows (the first row, with the
+    column names, belongs to no shard): it fills begin and end with the range of the given shard.
+    Compressed files can't be split, as their ranges can't be reached without decompressing them.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int csvl_shard_range(const char * csv_path,
+                     const int shard,
+                     const int n_shards,
+                     uint64_t * begin,
+                     uint64_t * end);
+
+/*
+    This routine takes the pathname of a CSV file and opens a stream over its rows between
+    the bytes begin and end (end = UINT64_MAX for the whole file), parsing the specified
+    FLOAT columns in chunks of chunk_rows rows. The first row, with the column names,
+    is always read into the header and never returned as a row.
+    gzip and zstd files are decompressed on a thread while the chunks are parsed; being
+    read in order only, their ranges must begin at their first row.
+    The routine returns NULL if fails.
+*/
+csvl_stream * csvl_stream_open(const char * csv_path,
+                               const uint64_t begin,
+                               const uint64_t end,
+                               const int * columns,
+                               const int n_columns,
+                               const int chunk_rows);
+
+/*
+    This routine opens a stream without a file, given the row with the column names:
+    its chunks are filled by csvl_stream_push (e.g. with rows read from a pipe).
+    The routine returns NULL if fails.
+*/
+csvl_stream * csvl_stream_from_header(const char * header,
+                                      const int * columns,
+                                      const int n_columns,
+                                      const int chunk_rows);
+
+/*
+    This routine appends a row (with its '\n') to the current chunk of the stream,
+    parsing the streamed columns.
+    The routine returns 0 if everything is OK, -1 if the chunk is full.
+*/
+int csvl_stream_push(csvl_stream * stream, const char * row);
+
+/*
+    This routine empties the current chunk of the stream.
+*/
+void csvl_stream_clear(csvl_stream * stream);
+
+/*
+    This routine reads the next chunk of rows of the stream.
+    The routine returns the number of read rows, 0 at the end of the stream, -1 if the
+    stream is a compressed file found corrupted or truncated at its end.
+*/
+int csvl_stream_read(csvl_stream * stream);
+
+/*
+    This routine writes the rows of the current chunk to the given output, replacing the
+    streamed columns with the FLOAT given buffers (buffers[c][i] for row i of columns[c]).
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int csvl_stream_write(const csvl_stream * stream, FILE * output_fd, float * const * buffers);
+
+/*
+    This routine closes the stream and frees it.
+*/
+void csvl_stream_close(csvl_stream * stream);
+
+/*
+    This routine takes the pathname of a CSV file and returns its columnar binary cache
+    (stored alongside it as csv_pathname + CSVL_CACHE_SUFFIX) mapped in memory.
+    If the cache does not exist or does not match the CSV file (size, modification time
+    and content hash), the CSV file is parsed once and the cache is written.
+    The routine returns NULL if fails.
+*/
+csvl_cache * csvl_cache_open(const char * csv_pathname);
+
+/*
+    This routine returns the FLOAT column of a cache (page-aligned, with header.n_rows
+    elements). The mapping is private: changing the column does not change the cache.
+*/
+float * csvl_cache_column(csvl_cache * cache, const int column_number);
+
+/*
+    This routine unmaps the cache and frees it.
+*/
+void csvl_cache_close(csvl_cache * cache);
@@ -0,0 +1,289 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    csvnorm.c
+    Embeddable C library for normalizing many CSV files with a warm OpenCL
+    context: platform, device, context, program and buffers are set up once
+*/
+
+#include "./csvnorm.h"
+
+csvnorm_t * csvnorm_open(const char * kernels_pathname, int n_slots)
+{
+    cl_int err;
+
+    csvnorm_t * h = (csvnorm_t *) calloc(1, sizeof(csvnorm_t));
+    if(h == NULL) return NULL;
+
+    const char * const env = getenv("CSVL_CHUNK_ROWS");
+    h->chunk_rows = (env && atoi(env) > 0) ? atoi(env) : CSVNORM_CHUNK_ROWS;
+    h->n_slots = n_slots > 0 ? n_slots : CSVNORM_SLOTS;
+
+    pthread_mutex_init(&h->lock, NULL);
+    pthread_cond_init(&h->slot_free, NULL);
+
+    // Every slot holds a whole chunk of a column:
+    h->slots = (csvnorm_slot *) calloc(h->n_slots, sizeof(csvnorm_slot));
+    if(h->slots == NULL){
+        csvnorm_close(h);
+        return NULL;
+    }
+
+    // An OpenCL failure comes back here, so that the caller gets NULL instead of an exit:
+    jmp_buf recovery;
+    jmp_buf * const outer_recovery = ocl_recovery;
+    if(setjmp(recovery) != 0){
+        ocl_recovery = outer_recovery;
+        fprintf(stderr, "[CSVNORM - FAIL] Can't set up the OpenCL resources of the handle\n");
+        csvnorm_close(h);
+        return NULL;
+    }
+    ocl_recovery = &recovery;
+
+    // Wrapped OpenCL boilerplate, done once for every file:
+    h->platform = select_platform();
+    h->device = select_device(h->platform);
+    h->context = create_context(h->platform, h->device);
+
+    const kernel_variant variant = kernel_variant_for(h->device, h->chunk_rows);
+    h->program = kernel_program(kernels_pathname, h->context, h->device, &variant);
+
+    for(int s = 0; s < h->n_slots; ++s){
+        csvnorm_slot * slot = &h->slots[s];
+        slot->queue = create_queue(h->context, h->device);
+
+        slot->max_min_kernel = clCreateKernel(h->program, MAX_MIN_FIND_KERNEL_NAME, &err);
+        ocl_check(err, "[CSVNORM - FAIL] Can't create the kernel ", MAX_MIN_FIND_KERNEL_NAME);
+        slot->normalize_kernel = clCreateKernel(h->program, NORMALIZE_KERNEL_NAME, &err);
+        ocl_check(err, "[CSVNORM - FAIL] Can't create the kernel ", NORMALIZE_KERNEL_NAME);
+
+        slot->device_buffer = clCreateBuffer(h->context, CL_MEM_READ_WRITE, sizeof(float) * h->chunk_rows, NULL, &err);
+        ocl_check(err, "[CSVNORM - FAIL] Can't create the device buffer of a slot");
+        metricl_track_buffer(slot->device_buffer);
+        slot->support_buffer = clCreateBuffer(h->context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY,
+                                              sizeof(float) * N_WORK_GROUPS * 2, NULL, &err);
+        ocl_check(err, "[CSVNORM - FAIL] Can't create the support buffer of a slot");
+        metricl_track_buffer(slot->support_buffer);
+    }
+
+    ocl_recovery = outer_recovery;
+    return h;
+}
+
+static csvnorm_slot * csvnorm_acquire(csvnorm_t * h)
+{
+    pthread_mutex_lock(&h->lock);
+    while(1){
+        for(int s = 0; s < h->n_slots; ++s){
+            if(!h->slots[s].busy){
+                h->slots[s].busy = 1;
+                pthread_mutex_unlock(&h->lock);
+                return &h->slots[s];
+            }
+        }
+        pthread_cond_wait(&h->slot_free, &h->lock);
+    }
+}
+
+static void csvnorm_release(csvnorm_t * h, csvnorm_slot * slot, size_t bytes_copied)
+{
+    pthread_mutex_lock(&h->lock);
+    slot->busy = 0;
+    h->bytes_copied += bytes_copied;
+    pthread_cond_signal(&h->slot_free);
+    pthread_mutex_unlock(&h->lock);
+}
+
+// Reduces (reduce) and normalizes in place (normalize) the columns of a chunk on a free slot,
+// merging the max and min of the chunk into maxs and mins before normalizing with them;
+// the routine returns -1 if the device fails, 0 otherwise:
+static int csvnorm_chunk(csvnorm_t * h, float ** buffers, int n_columns, int n_rows,
+                         float * maxs, float * mins, int reduce, int normalize)
+{
+    cl_int err;
+    cl_event max_min_find_event[2], normalize_event;
+    float max_min[2];
+    size_t bytes_copied = 0;
+    const size_t memsize = sizeof(float) * n_rows;
+
+    csvnorm_slot * slot = csvnorm_acquire(h);
+
+    // An OpenCL failure comes back here: the commands already queued are waited for, then the slot is given back:
+    jmp_buf recovery;
+    jmp_buf * const outer_recovery = ocl_recovery;
+    if(setjmp(recovery) != 0){
+        ocl_recovery = outer_recovery;
+        clFinish(slot->queue);
+        csvnorm_release(h, slot, 0);
+        return -1;
+    }
+    ocl_recovery = &recovery;
+
+    for(int c = 0; c < n_columns; ++c){
+        err = clEnqueueWriteBuffer(slot->queue, slot->device_buffer, CL_FALSE, 0, memsize, buffers[c], 0, NULL, NULL);
+        ocl_check(err, "[CSVNORM - FAIL] Can't copy a chunk to the device buffer");
+        bytes_copied += memsize;
+
+        if(reduce){
+            // Reducing the chunk to N_WORK_GROUPS * 2 elements, and then to only two elements:
+            max_min_find_event[0] = launch_max_min_find(slot->max_min_kernel, slot->queue, NULL,
+                                                        slot->support_buffer, slot->device_buffer, n_rows,
+                                                        N_WORK_ITEMS_PER_WORK_GROUP, N_WORK_GROUPS);
+            max_min_find_event[1] = launch_max_min_find(slot->max_min_kernel, slot->queue, max_min_find_event[0],
+                                                        slot->support_buffer, slot->support_buffer, N_WORK_GROUPS * 2,
+                                                        N_WORK_ITEMS_PER_WORK_GROUP, 1);
+
+            err = clEnqueueReadBuffer(slot->queue, slot->support_buffer, CL_TRUE, 0, sizeof(max_min), max_min,
+                                      1, max_min_find_event + 1, NULL);
+            ocl_check(err, "[CSVNORM - FAIL] Can't read the max and min values from device");
+            clReleaseEvent(max_min_find_event[0]);
+            clReleaseEvent(max_min_find_event[1]);
+            bytes_copied += sizeof(max_min);
+
+            if(max_min[0] > maxs[c]) maxs[c] = max_min[0];
+            if(max_min[1] < mins[c]) mins[c] = max_min[1];
+        }
+
+        if(normalize){
+            normalize_event = launch_normalize(slot->normalize_kernel, slot->queue, h->device,
+                                               slot->device_buffer, n_rows, maxs[c], mins[c]);
+
+            err = clEnqueueReadBuffer(slot->queue, slot->device_buffer, CL_TRUE, 0, memsize, buffers[c], 1, &normalize_event, NULL);
+            ocl_check(err, "[CSVNORM - FAIL] Can't read the normalized chunk from device");
+            clReleaseEvent(normalize_event);
+            bytes_copied += memsize;
+        }
+    }
+
+    ocl_recovery = outer_recovery;
+    csvnorm_release(h, slot, bytes_copied);
+    return 0;
+}
+
+long csvnorm_process(csvnorm_t * h,
+                     const char * csv_pathname,
+                     const char * output_pathname,
+                     const int * columns,
+                     const int n_columns)
+{
+    int n_rows;
+    long total_rows = 0;
+    uint64_t input_bytes = 0;
+    int * numeric_columns = NULL;
+    int n_numeric = n_columns;
+
+    // Every numeric column, string ones are left as they are:
+    if(n_columns <= 0){
+        int csv_ncols;
+        int * types = csvl_column_types(csv_pathname, &csv_ncols);
+        if(types != NULL){
+            numeric_columns = (int *) malloc(sizeof(int) * (csv_ncols + 1));
+            n_numeric = 0;
+            for(int i = 0; i < csv_ncols; ++i){
+                if(types[i] != CSVL_STRING) numeric_columns[n_numeric++] = i + 1;
+            }
+            columns = numeric_columns;
+            free(types);
+        }
+    }
+
+    csvl_stream * stream = columns == NULL ? NULL : csvl_stream_open(csv_pathname, 0, UINT64_MAX, columns, n_numeric, h->chunk_rows);
+
+    float * maxs = (float *) malloc(sizeof(float) * (n_numeric + 1));
+    float * mins = (float *) malloc(sizeof(float) * (n_numeric + 1));
+    for(int c = 0; c < n_numeric; ++c){
+        maxs[c] = -FLT_MAX;
+        mins[c] = FLT_MAX;
+    }
+
+    // Writing aside, next to the output:
+    const char * target_pathname = output_pathname != NULL ? output_pathname : csv_pathname;
+    char * temp_pathname = csvl_temp_path(target_pathname);
+
+    // Compressed on a thread if the target ends in .gz or .zst:
+    zipl_file * output_file = stream == NULL ? NULL : zipl_open_write(temp_pathname, zipl_format_of_name(target_pathname));
+    FILE * output_fd = output_file == NULL ? NULL : output_file->fd;
+    int result = output_fd == NULL ? -1 : 0;
+    if(result == 0 && fprintf(output_fd, "%s", stream->header) < 0) result = -1;
+
+    n_rows = result == 0 ? csvl_stream_read(stream) : 0;
+    if(n_rows == -1) result = -1;
+    if(result == 0 && n_rows < stream->capacity){
+        // Small files fit in the first chunk, which is reduced and normalized with a single copy:
+        if(n_rows > 0 && csvnorm_chunk(h, stream->buffers, n_numeric, n_rows, maxs, mins, 1, 1) != 0) result = -1;
+        if(result == 0) result = csvl_stream_write(stream, output_fd, stream->buffers);
+        total_rows = n_rows;
+        input_bytes = stream->position;
+    }
+    else if(result == 0){
+        // Bigger files are read twice: max and min of every chunk first, then the normalization:
+        do{
+            if(csvnorm_chunk(h, stream->buffers, n_numeric, n_rows, maxs, mins, 1, 0) != 0) result = -1;
+        } while(result == 0 && (n_rows = csvl_stream_read(stream)) > 0);
+        if(n_rows == -1) result = -1;
+        input_bytes = stream->position;
+
+        csvl_stream_close(stream);
+        stream = result == 0 ? csvl_stream_open(csv_pathname, 0, UINT64_MAX, columns, n_numeric, h->chunk_rows) : NULL;
+        if(stream == NULL) result = -1;
+
+        while(result == 0 && (n_rows = csvl_stream_read(stream)) > 0){
+            if(csvnorm_chunk(h, stream->buffers, n_numeric, n_rows, maxs, mins, 0, 1) != 0) result = -1;
+            else result = csvl_stream_write(stream, output_fd, stream->buffers);
+            total_rows += n_rows;
+        }
+        if(n_rows == -1) result = -1;
+    }
+
+    if(output_file != NULL && zipl_close(output_file) != 0) result = -1;
+    if(result == 0 && rename(temp_pathname, target_pathname) != 0) result = -1;
+    if(result == -1){
+        fprintf(stderr, "[CSVNORM - FAIL] Can't normalize %s into %s\n", csv_pathname, target_pathname);
+        if(output_fd != NULL) remove(temp_pathname);
+    }
+
+    pthread_mutex_lock(&h->lock);
+    if(result == 0){
+        ++h->n_files;
+        h->n_rows += total_rows;
+    }
+    else ++h->n_failed;
+    pthread_mutex_unlock(&h->lock);
+
+    if(result == 0){
+        metricl_add(METRICL_FILES, 1);
+        metricl_add(METRICL_ROWS, total_rows);
+        metricl_add(METRICL_VALUES, (uint64_t) total_rows * n_numeric);
+        metricl_add(METRICL_INPUT_BYTES, input_bytes);
+    }
+
+    if(stream != NULL) csvl_stream_close(stream);
+    free(numeric_columns);
+    free(temp_pathname);
+    free(maxs);
+    free(mins);
+    return result == 0 ? total_rows : -1;
+}
+
+void csvnorm_close(csvnorm_t * h)
+{
+    // A handle whose set up failed has only part of its objects:
+    for(int s = 0; h->slots != NULL && s < h->n_slots; ++s){
+        csvnorm_slot * slot = &h->slots[s];
+        if(slot->device_buffer != NULL) clReleaseMemObject(slot->device_buffer);
+        if(slot->support_buffer != NULL) clReleaseMemObject(slot->support_buffer);
+        if(slot->max_min_kernel != NULL) clReleaseKernel(slot->max_min_kernel);
+        if(slot->normalize_kernel != NULL) clReleaseKernel(slot->normalize_kernel);
+        if(slot->queue != NULL) clReleaseCommandQueue(slot->queue);
+    }
+    if(h->program != NULL) clReleaseProgram(h->program);
+    if(h->context != NULL) clReleaseContext(h->context);
+
+    pthread_mutex_destroy(&h->lock);
+    pthread_cond_destroy(&h->slot_free);
+    free(h->slots);
+    free(h);
+}
@@ -0,0 +1,91 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    csvnorm.h
+    Embeddable C library for normalizing many CSV files with a warm OpenCL
+    context: platform, device, context, program and buffers are set up once
+*/
+
+#pragma once
+
+#include <pthread.h>
+#include <float.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "../csvl/csvl.h"
+#include "../kernel_launchers/kernel_launchers.h"
+#include "../metricl/metricl.h"
+
+// Default number of slots, i.e. of files on the device at the same time:
+#define CSVNORM_SLOTS 4
+
+// Rows of each chunk of a file: smaller files are parsed, normalized and written in one pass:
+#define CSVNORM_CHUNK_ROWS (64 * KB)
+
+/*
+    Device resources used by one file at a time: its own queue, kernels and buffers,
+    so that files on different slots never share an OpenCL object that is not thread-safe
+*/
+typedef struct {
+    cl_command_queue queue;
+    cl_kernel max_min_kernel;
+    cl_kernel normalize_kernel;
+    cl_mem device_buffer;
+    cl_mem support_buffer;
+    int busy;
+} csvnorm_slot;
+
+typedef struct {
+    cl_platform_id platform;
+    cl_device_id device;
+    cl_context context;
+    cl_program program;
+    int chunk_rows;
+
+    // Pool of slots, a thread waits on slot_free when every slot is busy:
+    int n_slots;
+    csvnorm_slot * slots;
+    pthread_mutex_t lock;
+    pthread_cond_t slot_free;
+
+    // Statistics since csvnorm_open, guarded by lock:
+    uint64_t n_files;
+    uint64_t n_failed;
+    uint64_t n_rows;
+    size_t bytes_copied;
+} csvnorm_t;
+
+/*
+    This routine selects the platform and the device (OCL_PLATFORM and OCL_DEVICE), creates
+    the context, compiles the kernels of the given pathname once and sets up n_slots slots
+    (CSVNORM_SLOTS if not positive), each with its queue, kernels and device buffers.
+    Chunks have CSVL_CHUNK_ROWS rows if set, CSVNORM_CHUNK_ROWS otherwise.
+    The routine returns NULL if fails, an OpenCL failure included: it never exits.
+*/
+csvnorm_t * csvnorm_open(const char * kernels_pathname, int n_slots);
+
+/*
+    This routine normalizes the given FLOAT columns of a CSV file (every numeric column if
+    n_columns is 0) into output_pathname, or in place if it is NULL: the file is written
+    aside and renamed, so that it is never left half written. Files of at most chunk_rows
+    rows are read once, bigger ones twice (max and min first, then the normalization).
+    The routine can be called by any number of threads at once: parsing and writing run
+    on the calling thread, the device work of up to n_slots files runs at the same time.
+    The routine returns the number of normalized rows, -1 if fails (a failure of the device
+    included, the slot being given back): the file is then counted in n_failed.
+*/
+long csvnorm_process(csvnorm_t * h,
+                     const char * csv_pathname,
+                     const char * output_pathname,
+                     const int * columns,
+                     const int n_columns);
+
+/*
+    This routine releases every OpenCL resource of the handle and frees it; no call
+    to csvnorm_process must be running.
+*/
+void csvnorm_close(csvnorm_t * h);
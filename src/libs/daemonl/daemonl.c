@@ -0,0 +1,431 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    daemonl.c
+    Drivers of a warm csvnorm handle: the daemon, which normalizes the files of the jobs read
+    from a stream or from a Unix socket, and the batch, which normalizes a list of files
+*/
+
+#include "./daemonl.h"
+
+char * daemonl_pathname(const char * root, const char * pathname)
+{
+    if(root == NULL || pathname[0] == '/') return strdup(pathname);
+
+    char * result = malloc(strlen(root) + strlen(pathname) + 2);
+    sprintf(result, "%s/%s", root, pathname);
+    return result;
+}
+
+/*
+    Daemon: a warm handle normalizes the files of the jobs read from a stream or from the connections to a Unix socket
+*/
+typedef struct {
+    csvnorm_t * handle;
+    const char * root;
+    FILE * input_fd;
+    FILE * output_fd;
+
+    // Locks of the input and of the output when they are shared by several workers (NULL instead):
+    pthread_mutex_t * input_lock;
+    pthread_mutex_t * output_lock;
+} daemonl_worker;
+
+static int daemon_quit = 0;
+static int daemon_listen_fd = -1;
+static int daemon_connections = 0;
+static pthread_mutex_t daemon_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t daemon_idle = PTHREAD_COND_INITIALIZER;
+
+static void daemon_stop()
+{
+    pthread_mutex_lock(&daemon_lock);
+    __atomic_store_n(&daemon_quit, 1, __ATOMIC_RELAXED);
+    if(daemon_listen_fd != -1) shutdown(daemon_listen_fd, SHUT_RDWR);
+    pthread_mutex_unlock(&daemon_lock);
+}
+
+// Runs the job of a line and writes its reply, "OK csv_pathname rows ms" or "FAIL csv_pathname reason":
+// the routine returns 0 if the job is done, -1 if it fails and 1 if the line is empty.
+static int daemon_job(csvnorm_t * h, const char * root, char * line, char * reply)
+{
+    struct timespec start, end;
+    char * save;
+    const char * sep = " \t\r\n";
+    int * columns = (int *) malloc(sizeof(int) * (strlen(line) / 2 + 1));
+    int n_columns = 0;
+
+    char * csv_arg = strtok_r(line, sep, &save);
+    if(csv_arg == NULL){
+        free(columns);
+        return 1;
+    }
+
+    char * output_arg = NULL;
+    for(char * arg = strtok_r(NULL, sep, &save); arg != NULL; arg = strtok_r(NULL, sep, &save)){
+        if(strcmp(arg, "--output") == 0 && output_arg == NULL){
+            output_arg = strtok_r(NULL, sep, &save);
+            if(output_arg == NULL) break;
+        }
+        else if(strcmp(arg, "ALL") == 0){
+            n_columns = 0;
+        }
+        else if(atoi(arg) >= 1){
+            columns[n_columns++] = atoi(arg);
+        }
+        else{
+            snprintf(reply, DAEMONL_REPLY_SIZE, "FAIL %s column %s is not valid", csv_arg, arg);
+
+            // Counted as the jobs csvnorm_process fails:
+            pthread_mutex_lock(&h->lock);
+            ++h->n_failed;
+            pthread_mutex_unlock(&h->lock);
+            free(columns);
+            return -1;
+        }
+    }
+
+    char * csv_pathname = daemonl_pathname(root, csv_arg);
+    char * output_pathname = output_arg != NULL ? daemonl_pathname(root, output_arg) : NULL;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    const long n_rows = csvnorm_process(h, csv_pathname, output_pathname, columns, n_columns);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if(n_rows == -1) snprintf(reply, DAEMONL_REPLY_SIZE, "FAIL %s can't be normalized", csv_arg);
+    else{
+        snprintf(reply, DAEMONL_REPLY_SIZE, "OK %s %ld %.3f", csv_arg, n_rows,
+                 (end.tv_sec - start.tv_sec) * 1.0e3 + (end.tv_nsec - start.tv_nsec) * 1.0e-6);
+    }
+
+    free(csv_pathname);
+    free(output_pathname);
+    free(columns);
+    return n_rows == -1 ? -1 : 0;
+}
+
+// Runs the jobs of the input of a worker until its end, or until a "quit" line:
+static void * daemon_serve(void * arg)
+{
+    daemonl_worker * worker = (daemonl_worker *) arg;
+    char reply[DAEMONL_REPLY_SIZE];
+    char * line = NULL;
+    size_t line_size = 0;
+
+    while(1){
+        if(worker->input_lock != NULL) pthread_mutex_lock(worker->input_lock);
+        const ssize_t n_read = __atomic_load_n(&daemon_quit, __ATOMIC_RELAXED) ? -1 : getline(&line, &line_size, worker->input_fd);
+        if(worker->input_lock != NULL) pthread_mutex_unlock(worker->input_lock);
+        if(n_read == -1) break;
+
+        if(strncmp(line, "quit", 4) == 0 && line[4 + strspn(line + 4, " \t\r\n")] == '\0'){
+            daemon_stop();
+            break;
+        }
+        if(daemon_job(worker->handle, worker->root, line, reply) == 1) continue;
+
+        if(worker->output_lock != NULL) pthread_mutex_lock(worker->output_lock);
+        fprintf(worker->output_fd, "%s\n", reply);
+        fflush(worker->output_fd);
+        if(worker->output_lock != NULL) pthread_mutex_unlock(worker->output_lock);
+    }
+
+    free(line);
+    return NULL;
+}
+
+// Serves a connection to the socket, with one worker, until the client closes it:
+static void * daemon_connection(void * arg)
+{
+    daemonl_worker * worker = (daemonl_worker *) arg;
+    daemon_serve(worker);
+
+    fclose(worker->input_fd);
+    fclose(worker->output_fd);
+    free(worker);
+
+    pthread_mutex_lock(&daemon_lock);
+    --daemon_connections;
+    pthread_cond_signal(&daemon_idle);
+    pthread_mutex_unlock(&daemon_lock);
+    return NULL;
+}
+
+static int daemon_socket(csvnorm_t * h, const char * root, const char * socket_pathname)
+{
+    struct sockaddr_un address;
+    pthread_t thread;
+
+    if(strlen(socket_pathname) >= sizeof(address.sun_path)){
+        fprintf(stderr, "[DAEMONL - FAIL] The socket pathname %s is too long\n", socket_pathname);
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_pathname);
+
+    // The socket of a previous daemon is replaced:
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    remove(socket_pathname);
+    if(listen_fd == -1 || bind(listen_fd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(listen_fd, SOMAXCONN) != 0){
+        fprintf(stderr, "[DAEMONL - FAIL] Can't listen on %s\n", socket_pathname);
+        if(listen_fd != -1) close(listen_fd);
+        return -1;
+    }
+    pthread_mutex_lock(&daemon_lock);
+    daemon_listen_fd = listen_fd;
+    pthread_mutex_unlock(&daemon_lock);
+    fprintf(stdout, "[LOG] Daemon listening on %s\n", socket_pathname);
+
+    // Every connection is served by its own thread, until a "quit" line:
+    while(!__atomic_load_n(&daemon_quit, __ATOMIC_RELAXED)){
+        const int connection_fd = accept(listen_fd, NULL, NULL);
+        if(connection_fd == -1){
+            if(errno == EINTR) continue;
+            break;
+        }
+
+        daemonl_worker * worker = (daemonl_worker *) malloc(sizeof(daemonl_worker));
+        worker->handle = h;
+        worker->root = root;
+        worker->input_fd = fdopen(connection_fd, "r");
+        worker->output_fd = fdopen(dup(connection_fd), "w");
+        worker->input_lock = worker->output_lock = NULL;
+
+        pthread_mutex_lock(&daemon_lock);
+        ++daemon_connections;
+        pthread_mutex_unlock(&daemon_lock);
+        if(pthread_create(&thread, NULL, daemon_connection, worker) != 0) daemon_connection(worker);
+        else pthread_detach(thread);
+    }
+
+    // Waiting for the open connections to be closed by their clients:
+    pthread_mutex_lock(&daemon_lock);
+    while(daemon_connections > 0) pthread_cond_wait(&daemon_idle, &daemon_lock);
+    daemon_listen_fd = -1;
+    pthread_mutex_unlock(&daemon_lock);
+
+    close(listen_fd);
+    remove(socket_pathname);
+    return 0;
+}
+
+int daemonl_run(FILE * input_fd,
+                FILE * output_fd,
+                const char * socket_pathname,
+                const daemonl_options * options,
+                const char * kernels_pathname,
+                size_t * bytes_copied)
+{
+    struct timespec start, end;
+
+    if(options->n_slots < 1 || options->n_threads < 1){
+        fprintf(stderr, "[DAEMONL - FAIL] The daemon needs at least one slot and one thread\n");
+        return -1;
+    }
+
+    // Everything but the data is set up once:
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    csvnorm_t * h = csvnorm_open(kernels_pathname, options->n_slots);
+    if(h == NULL) return -1;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    fprintf(stdout, "[LOG] Daemon ready in %.3f ms: %d slots of %d rows\n",
+            (end.tv_sec - start.tv_sec) * 1.0e3 + (end.tv_nsec - start.tv_nsec) * 1.0e-6, h->n_slots, h->chunk_rows);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int result = 0;
+    if(socket_pathname != NULL){
+        result = daemon_socket(h, options->root, socket_pathname);
+    }
+    else{
+        // Workers share the input and the output, so that files are parsed while others are on the device:
+        pthread_mutex_t input_lock = PTHREAD_MUTEX_INITIALIZER, output_lock = PTHREAD_MUTEX_INITIALIZER;
+        daemonl_worker worker = {h, options->root, input_fd, output_fd, &input_lock, &output_lock};
+        pthread_t * threads = (pthread_t *) malloc(sizeof(pthread_t) * options->n_threads);
+
+        int n_started = 0;
+        while(n_started < options->n_threads && pthread_create(&threads[n_started], NULL, daemon_serve, &worker) == 0) ++n_started;
+        if(n_started == 0) daemon_serve(&worker);
+        for(int t = 0; t < n_started; ++t) pthread_join(threads[t], NULL);
+        free(threads);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    const double elapsed_s = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1.0e-9;
+    fprintf(stdout, "[LOG] Daemon: %llu files normalized (%llu failed), %llu rows in %.3f s: %.1f files/s, %.0f rows/s\n",
+            (unsigned long long) h->n_files, (unsigned long long) h->n_failed, (unsigned long long) h->n_rows, elapsed_s,
+            elapsed_s > 0 ? h->n_files / elapsed_s : 0, elapsed_s > 0 ? h->n_rows / elapsed_s : 0);
+    fprintf(stdout, "[LOG] Bytes copied between host and device: %zu\n", h->bytes_copied);
+
+    * bytes_copied += h->bytes_copied;
+    csvnorm_close(h);
+    return result;
+}
+
+/*
+    Batch: the given files are normalized by host threads sharing a warm handle, each one taking
+    the next file of the batch, so that the parsing of a file overlaps the device work of the others
+*/
+typedef struct {
+    csvnorm_t * handle;
+    char ** csv_pathnames;
+    char ** output_pathnames;
+    int n_files;
+    int next_file;
+    const int * columns;
+    int n_columns;
+
+    // Rows normalized of each file, -1 if it failed:
+    long * rows;
+} daemonl_batch_state;
+
+static void * batch_worker(void * arg)
+{
+    daemonl_batch_state * batch = (daemonl_batch_state *) arg;
+    int f;
+
+    while((f = __atomic_fetch_add(&batch->next_file, 1, __ATOMIC_RELAXED)) < batch->n_files){
+        batch->rows[f] = csvnorm_process(batch->handle, batch->csv_pathnames[f], batch->output_pathnames[f],
+                                         batch->columns, batch->n_columns);
+    }
+    return NULL;
+}
+
+int daemonl_batch_add(const char * root, const char * arg, char *** pathnames, int * n_pathnames, int * pathnames_size)
+{
+    glob_t matches;
+    char * pathname = daemonl_pathname(root, arg);
+    const int pattern = strpbrk(arg, "*?[") != NULL;
+
+    if(pattern && glob(pathname, 0, NULL, &matches) != 0){
+        fprintf(stdout, "[DAEMONL - FAIL] No file matches %s\n", arg);
+        free(pathname);
+        return -1;
+    }
+
+    const size_t n_new = pattern ? matches.gl_pathc : 1;
+    while(* n_pathnames + n_new > (size_t) * pathnames_size){
+        * pathnames_size = * pathnames_size == 0 ? 64 : * pathnames_size * 2;
+        * pathnames = (char **) realloc(* pathnames, sizeof(char *) * (* pathnames_size));
+    }
+    for(size_t i = 0; i < n_new; ++i){
+        (* pathnames)[(* n_pathnames)++] = pattern ? strdup(matches.gl_pathv[i]) : pathname;
+    }
+
+    if(pattern){
+        globfree(&matches);
+        free(pathname);
+    }
+    return 0;
+}
+
+static int compare_pathnames(const void * a, const void * b)
+{
+    return strcmp(* (char * const *) a, * (char * const *) b);
+}
+
+static void free_pathnames(char ** pathnames, const int n_pathnames)
+{
+    for(int f = 0; f < n_pathnames; ++f) free(pathnames[f]);
+    free(pathnames);
+}
+
+int daemonl_batch(char ** csv_pathnames,
+                  const int n_files,
+                  const char * output_dir,
+                  const char * output_pathname,
+                  const int * columns,
+                  const int n_columns,
+                  const daemonl_options * options,
+                  const char * kernels_pathname,
+                  size_t * bytes_copied)
+{
+    struct timespec start, end;
+
+    if(options->n_slots < 1 || options->n_threads < 1){
+        fprintf(stdout, "[DAEMONL - FAIL] The batch needs at least one slot and one thread\n");
+        return -1;
+    }
+    if(n_files == 0){
+        fprintf(stdout, "[DAEMONL - FAIL] The batch has no files\n");
+        return -1;
+    }
+    if(output_pathname != NULL && n_files != 1){
+        fprintf(stdout, "[DAEMONL - FAIL] --output takes a single file, --output-dir is for %d files\n", n_files);
+        return -1;
+    }
+
+    // Outputs are chosen up front, and two files can't be written to the same one:
+    char ** output_pathnames = (char **) calloc(n_files, sizeof(char *));
+    if(output_dir != NULL){
+        mkdir(output_dir, 0755);
+        for(int f = 0; f < n_files; ++f){
+            const char * name = strrchr(csv_pathnames[f], '/');
+            name = name != NULL ? name + 1 : csv_pathnames[f];
+            output_pathnames[f] = malloc(strlen(output_dir) + strlen(name) + 2);
+            sprintf(output_pathnames[f], "%s/%s", output_dir, name);
+        }
+
+        char ** sorted = (char **) malloc(sizeof(char *) * n_files);
+        memcpy(sorted, output_pathnames, sizeof(char *) * n_files);
+        qsort(sorted, n_files, sizeof(char *), compare_pathnames);
+        for(int f = 1; f < n_files; ++f){
+            if(strcmp(sorted[f - 1], sorted[f]) == 0){
+                fprintf(stdout, "[DAEMONL - FAIL] Two files of the batch would be written to %s\n", sorted[f]);
+                free(sorted);
+                free_pathnames(output_pathnames, n_files);
+                return -1;
+            }
+        }
+        free(sorted);
+    }
+    else if(output_pathname != NULL){
+        output_pathnames[0] = strdup(output_pathname);
+    }
+
+    int n_threads = options->n_threads;
+    fprintf(stdout, "[LOG] START batch normalization of %d files with %d threads and %d slots\n", n_files, n_threads, options->n_slots);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    csvnorm_t * h = csvnorm_open(kernels_pathname, options->n_slots);
+    if(h == NULL){
+        free_pathnames(output_pathnames, n_files);
+        return -1;
+    }
+    const uint64_t input_bytes = metricl_value(METRICL_INPUT_BYTES);
+
+    daemonl_batch_state batch = {h, csv_pathnames, output_pathnames, n_files, 0, columns, n_columns, (long *) malloc(sizeof(long) * n_files)};
+    if(n_threads > n_files) n_threads = n_files;
+    pthread_t * threads = (pthread_t *) malloc(sizeof(pthread_t) * n_threads);
+
+    int n_started = 0;
+    while(n_started < n_threads && pthread_create(&threads[n_started], NULL, batch_worker, &batch) == 0) ++n_started;
+    if(n_started == 0) batch_worker(&batch);
+    for(int t = 0; t < n_started; ++t) pthread_join(threads[t], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    int n_failed = 0;
+    for(int f = 0; f < n_files; ++f){
+        if(batch.rows[f] == -1){
+            fprintf(stdout, "[LOG] Failed: %s\n", csv_pathnames[f]);
+            ++n_failed;
+        }
+    }
+
+    const double elapsed_s = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1.0e-9;
+    const double mb = (metricl_value(METRICL_INPUT_BYTES) - input_bytes) / 1.0e6;
+    fprintf(stdout, "[LOG] Bytes copied between host and device: %zu\n", h->bytes_copied);
+    fprintf(stdout, "[LOG] END batch normalization: %llu files (%d failed), %llu rows, %.1f MB in %.3f s: %.1f files/s, %.0f rows/s, %.1f MB/s\n",
+            (unsigned long long) h->n_files, n_failed, (unsigned long long) h->n_rows, mb, elapsed_s,
+            h->n_files / elapsed_s, h->n_rows / elapsed_s, mb / elapsed_s);
+
+    * bytes_copied += h->bytes_copied;
+    csvnorm_close(h);
+    free_pathnames(output_pathnames, n_files);
+    free(batch.rows);
+    free(threads);
+    return n_failed == 0 ? 0 : -1;
+}
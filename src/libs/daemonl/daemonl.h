@@ -0,0 +1,80 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    daemonl.h
+    Drivers of a warm csvnorm handle: the daemon, which normalizes the files of the jobs read
+    from a stream or from a Unix socket, and the batch, which normalizes a list of files
+*/
+
+#pragma once
+
+#include <errno.h>
+#include <glob.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+
+#include "../csvnorm/csvnorm.h"
+
+// Longest reply to a job, "OK csv_pathname rows ms" or "FAIL csv_pathname reason":
+#define DAEMONL_REPLY_SIZE 4160
+
+typedef struct {
+    // Slots of the handle and host threads running the files:
+    int n_slots;
+    int n_threads;
+
+    // Directory the relative pathnames of the jobs and of the batch are resolved against (NULL for the current one):
+    const char * root;
+} daemonl_options;
+
+/*
+    This routine takes a pathname given by the user and returns it resolved against the given
+    root directory (as it is when it is absolute or the root is NULL), in a new string.
+*/
+char * daemonl_pathname(const char * root, const char * pathname);
+
+/*
+    This routine opens a handle with the kernels of the given pathname and runs the jobs, one per
+    line, "csv_pathname [--output pathname] [col_index1 ... col_indexN | ALL]": read from input_fd by
+    n_threads workers, or from the connections to socket_pathname (each one served by its own thread)
+    when it is not NULL. Each job gets a reply, on output_fd or on its connection. A "quit" line stops
+    the daemon once the other connections are closed. The throughput is logged at the end, and the bytes
+    copied between host and device are added to bytes_copied.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int daemonl_run(FILE * input_fd,
+                FILE * output_fd,
+                const char * socket_pathname,
+                const daemonl_options * options,
+                const char * kernels_pathname,
+                size_t * bytes_copied);
+
+/*
+    This routine appends a pathname given by the user to the files of a batch, or every file
+    matching it when it is a glob pattern; pathnames and its sizes are grown as needed.
+    The routine returns 0 if everything is OK, -1 if no file matches the pattern.
+*/
+int daemonl_batch_add(const char * root, const char * arg, char *** pathnames, int * n_pathnames, int * pathnames_size);
+
+/*
+    This routine normalizes the given FLOAT columns (every numeric column if n_columns is 0) of
+    every file of a batch with one handle shared by n_threads host threads, each one taking the next
+    file, so that the parsing of a file overlaps the device work of the others. Each file is written
+    to output_dir with its name, to output_pathname (a single file) or in place when both are NULL;
+    two files written to the same output are refused. The throughput is logged at the end, and the
+    bytes copied between host and device are added to bytes_copied.
+    The routine returns 0 if every file is normalized, -1 instead.
+*/
+int daemonl_batch(char ** csv_pathnames,
+                  const int n_files,
+                  const char * output_dir,
+                  const char * output_pathname,
+                  const int * columns,
+                  const int n_columns,
+                  const daemonl_options * options,
+                  const char * kernels_pathname,
+                  size_t * bytes_copied);
@@ -0,0 +1,301 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    dictl.c
+    C library for mapping the string keys of a CSV column (e.g. merchants
+    or accounts) to dense integer ids with a concurrent open addressing hash table
+*/
+
+#include "./dictl.h"
+
+// FNV-1a hash of the key:
+static uint64_t dictl_hash(const char * key, const size_t key_size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for(size_t i = 0; i < key_size; ++i){
+        hash ^= (unsigned char) key[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int dictl_same_key(const char * other, const char * key, const size_t key_size)
+{
+    return strncmp(other, key, key_size) == 0 && other[key_size] == '\0';
+}
+
+// More than half of the slots are used (the table must grow):
+static int dictl_full(dictl * dict)
+{
+    return (uint64_t) __atomic_load_n(&dict->n_keys, __ATOMIC_ACQUIRE) * 2 > __atomic_load_n(&dict->n_slots, __ATOMIC_ACQUIRE);
+}
+
+// Taking the read lock, after any thread waiting to grow the table:
+static void dictl_read_lock(dictl * dict)
+{
+    while(1){
+        while(__atomic_load_n(&dict->growing, __ATOMIC_ACQUIRE) > 0) sched_yield();
+
+        pthread_rwlock_rdlock(&dict->lock);
+        if(__atomic_load_n(&dict->growing, __ATOMIC_ACQUIRE) == 0) return;
+        pthread_rwlock_unlock(&dict->lock);
+    }
+}
+
+// Doubling the slots under the write lock, and adding back every key with its hash:
+static void dictl_grow(dictl * dict)
+{
+    __atomic_add_fetch(&dict->growing, 1, __ATOMIC_ACQ_REL);
+    pthread_rwlock_wrlock(&dict->lock);
+
+    // Another thread may have grown the table in the meantime:
+    while((uint64_t) dict->n_keys * 2 > dict->n_slots){
+        uint64_t * old_hashes = dict->hashes;
+        int32_t * old_slots = dict->slots;
+        const uint64_t old_n_slots = dict->n_slots;
+
+        __atomic_store_n(&dict->n_slots, old_n_slots * 2, __ATOMIC_RELEASE);
+        dict->hashes = (uint64_t *) malloc(sizeof(uint64_t) * dict->n_slots);
+        dict->slots = (int32_t *) calloc(dict->n_slots, sizeof(int32_t));
+        dict->keys = (char **) realloc(dict->keys, sizeof(char *) * dict->n_slots);
+
+        for(uint64_t i = 0; i < old_n_slots; ++i){
+            if(old_slots[i] == 0) continue;
+
+            uint64_t slot = old_hashes[i] & (dict->n_slots - 1);
+            while(dict->slots[slot] != 0) slot = (slot + 1) & (dict->n_slots - 1);
+
+            dict->hashes[slot] = old_hashes[i];
+            dict->slots[slot] = old_slots[i];
+        }
+
+        free(old_hashes);
+        free(old_slots);
+    }
+
+    pthread_rwlock_unlock(&dict->lock);
+    __atomic_sub_fetch(&dict->growing, 1, __ATOMIC_ACQ_REL);
+}
+
+// Finding or adding a key, with the read lock held:
+static int dictl_insert(dictl * dict, const char * key, const size_t key_size, const uint64_t hash)
+{
+    const uint64_t mask = dict->n_slots - 1;
+    uint64_t slot = hash & mask;
+
+    while(1){
+        int32_t id = __atomic_load_n(&dict->slots[slot], __ATOMIC_ACQUIRE);
+
+        if(id == 0){
+            // Taking the free slot, or looking at it again if another thread took it first:
+            if(!__atomic_compare_exchange_n(&dict->slots[slot], &id, DICTL_BUSY, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) continue;
+
+            const int32_t new_id = __atomic_fetch_add(&dict->n_keys, 1, __ATOMIC_ACQ_REL);
+            char * new_key = (char *) malloc(key_size + 1);
+            memcpy(new_key, key, key_size);
+            new_key[key_size] = '\0';
+
+            dict->keys[new_id] = new_key;
+            dict->hashes[slot] = hash;
+
+            // Publishing the id, after the key and its hash:
+            __atomic_store_n(&dict->slots[slot], new_id + 1, __ATOMIC_RELEASE);
+            return new_id;
+        }
+
+        // Waiting for the id of a key being added by another thread:
+        if(id == DICTL_BUSY) continue;
+
+        if(dict->hashes[slot] == hash && dictl_same_key(dict->keys[id - 1], key, key_size)) return id - 1;
+        slot = (slot + 1) & mask;
+    }
+}
+
+dictl * dictl_create()
+{
+    dictl * dict = (dictl *) calloc(1, sizeof(dictl));
+
+    dict->n_slots = DICTL_INITIAL_SLOTS;
+    dict->hashes = (uint64_t *) malloc(sizeof(uint64_t) * dict->n_slots);
+    dict->slots = (int32_t *) calloc(dict->n_slots, sizeof(int32_t));
+
+    // At most half of the slots (plus one key for each thread) are used, so keys never overflows:
+    dict->keys = (char **) malloc(sizeof(char *) * dict->n_slots);
+    pthread_rwlock_init(&dict->lock, NULL);
+
+    return dict;
+}
+
+int dictl_id(dictl * dict, const char * key, const size_t key_size)
+{
+    int id;
+    dictl_ids(dict, (char * const *) &key, &key_size, 1, &id);
+    return id;
+}
+
+void dictl_ids(dictl * dict, char * const * keys, const size_t * key_sizes, const int n, int * ids)
+{
+    dictl_read_lock(dict);
+
+    for(int i = 0; i < n; ++i){
+        ids[i] = dictl_insert(dict, keys[i], key_sizes[i], dictl_hash(keys[i], key_sizes[i]));
+
+        // Leaving the table to the threads that grow it:
+        if(dictl_full(dict) || __atomic_load_n(&dict->growing, __ATOMIC_ACQUIRE) > 0){
+            pthread_rwlock_unlock(&dict->lock);
+            if(dictl_full(dict)) dictl_grow(dict);
+            dictl_read_lock(dict);
+        }
+    }
+
+    pthread_rwlock_unlock(&dict->lock);
+}
+
+int dictl_find(const dictl * dict, const char * key, const size_t key_size)
+{
+    const uint64_t hash = dictl_hash(key, key_size);
+    uint64_t slot = hash & (dict->n_slots - 1);
+
+    while(dict->slots[slot] != 0){
+        const int32_t id = dict->slots[slot];
+        if(dict->hashes[slot] == hash && dictl_same_key(dict->keys[id - 1], key, key_size)) return id - 1;
+        slot = (slot + 1) & (dict->n_slots - 1);
+    }
+
+    return -1;
+}
+
+const char * dictl_key(const dictl * dict, const int id)
+{
+    if(id < 0 || id >= dict->n_keys) return NULL;
+    return dict->keys[id];
+}
+
+// Key with the id it had before sorting:
+typedef struct {
+    char * key;
+    int id;
+} dictl_entry;
+
+static int dictl_compare_entries(const void * a, const void * b)
+{
+    return strcmp(((const dictl_entry *) a)->key, ((const dictl_entry *) b)->key);
+}
+
+void dictl_sort(dictl * dict, const int first_id, int * remap)
+{
+    for(int i = 0; i < dict->n_keys; ++i) remap[i] = i;
+    if(first_id >= dict->n_keys) return;
+
+    // Sorting the new keys, and giving them their new ids:
+    const int n_new = dict->n_keys - first_id;
+    dictl_entry * entries = (dictl_entry *) malloc(sizeof(dictl_entry) * n_new);
+    for(int i = 0; i < n_new; ++i){
+        entries[i].key = dict->keys[first_id + i];
+        entries[i].id = first_id + i;
+    }
+    qsort(entries, n_new, sizeof(dictl_entry), dictl_compare_entries);
+
+    for(int i = 0; i < n_new; ++i){
+        dict->keys[first_id + i] = entries[i].key;
+        remap[entries[i].id] = first_id + i;
+    }
+    free(entries);
+
+    // Updating the slots with the new ids:
+    for(uint64_t i = 0; i < dict->n_slots; ++i){
+        if(dict->slots[i] > 0) dict->slots[i] = remap[dict->slots[i] - 1] + 1;
+    }
+}
+
+int dictl_save(const char * pathname, const dictl * dict)
+{
+    char * temp_path = (char *) malloc(strlen(pathname) + 5);
+    sprintf(temp_path, "%s.tmp", pathname);
+
+    FILE * dict_fd = fopen(temp_path, "wb");
+    if(dict_fd == NULL){
+        fprintf(stderr, "[DICTL - FAIL] Can't create %s\n", temp_path);
+        free(temp_path);
+        return -1;
+    }
+
+    dictl_header header;
+    memcpy(header.magic, DICTL_MAGIC, sizeof(header.magic));
+    header.n_keys = dict->n_keys;
+    header.keys_size = 0;
+    for(int i = 0; i < dict->n_keys; ++i) header.keys_size += strlen(dict->keys[i]) + 1;
+
+    int result = 0;
+    if(fwrite(&header, sizeof(header), 1, dict_fd) != 1) result = -1;
+    for(int i = 0; i < dict->n_keys && result == 0; ++i){
+        if(fwrite(dict->keys[i], 1, strlen(dict->keys[i]) + 1, dict_fd) != strlen(dict->keys[i]) + 1) result = -1;
+    }
+    if(fclose(dict_fd) != 0) result = -1;
+
+    // Replacing the previous file only once the new one is complete:
+    if(result == 0 && rename(temp_path, pathname) != 0) result = -1;
+    if(result != 0){
+        fprintf(stderr, "[DICTL - FAIL] Can't write %s\n", pathname);
+        remove(temp_path);
+    }
+
+    free(temp_path);
+    return result;
+}
+
+dictl * dictl_load(const char * pathname)
+{
+    FILE * dict_fd = fopen(pathname, "rb");
+    if(dict_fd == NULL) return NULL;
+
+    // Reading and checking the header:
+    dictl_header header;
+    if(fread(&header, sizeof(header), 1, dict_fd) != 1 || memcmp(header.magic, DICTL_MAGIC, sizeof(header.magic)) != 0 ||
+       header.n_keys > INT32_MAX || header.keys_size < header.n_keys){
+        fprintf(stderr, "[DICTL - FAIL] %s is not a dictionary file\n", pathname);
+        fclose(dict_fd);
+        return NULL;
+    }
+
+    char * keys = (char *) malloc(header.keys_size + 1);
+    if(fread(keys, 1, header.keys_size, dict_fd) != header.keys_size || (header.keys_size > 0 && keys[header.keys_size - 1] != '\0')){
+        fprintf(stderr, "[DICTL - FAIL] %s is truncated\n", pathname);
+        fclose(dict_fd);
+        free(keys);
+        return NULL;
+    }
+    fclose(dict_fd);
+
+    // Adding the keys in id order gives each of them its stored id:
+    dictl * dict = dictl_create();
+    size_t offset = 0;
+    for(uint64_t i = 0; i < header.n_keys; ++i){
+        const size_t key_size = strlen(keys + offset);
+        dictl_id(dict, keys + offset, key_size);
+        offset += key_size + 1;
+    }
+
+    free(keys);
+
+    if((uint64_t) dict->n_keys != header.n_keys){
+        fprintf(stderr, "[DICTL - FAIL] %s has duplicated keys\n", pathname);
+        dictl_free(dict);
+        return NULL;
+    }
+
+    return dict;
+}
+
+void dictl_free(dictl * dict)
+{
+    for(int i = 0; i < dict->n_keys; ++i) free(dict->keys[i]);
+    pthread_rwlock_destroy(&dict->lock);
+    free(dict->hashes);
+    free(dict->slots);
+    free(dict->keys);
+    free(dict);
+}
@@ -0,0 +1,113 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    dictl.h
+    C library for mapping the string keys of a CSV column (e.g. merchants
+    or accounts) to dense integer ids with a concurrent open addressing hash table
+*/
+
+#pragma once
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+
+// Initial slots of the table (a power of 2), doubled when half of them are used:
+#define DICTL_INITIAL_SLOTS 1024
+
+// Slot taken by a key whose id is being published:
+#define DICTL_BUSY -1
+
+#define DICTL_MAGIC "CSVLDC01"
+#define DICTL_SUFFIX ".csvld"
+
+/*
+    Hash table with linear probing: each slot keeps the hash of a key and its id + 1
+    (0 for an empty slot), while keys[id] is the NUL terminated key of each id, so that
+    the ids are dense and the keys can be read in id order.
+    Many threads can add keys together: a free slot is taken with a compare and swap,
+    while the table only grows (doubling its slots) under the write lock.
+*/
+typedef struct {
+    uint64_t * hashes;
+    int32_t * slots;
+    uint64_t n_slots;
+
+    char ** keys;
+    int32_t n_keys;
+
+    // Read lock to add keys, write lock to grow, and threads waiting to grow:
+    pthread_rwlock_t lock;
+    int32_t growing;
+} dictl;
+
+/*
+    Fixed header of a dictionary file: it is followed by the n_keys NUL terminated
+    keys in id order (keys_size bytes)
+*/
+typedef struct {
+    char magic[8];
+    uint64_t n_keys;
+    uint64_t keys_size;
+} dictl_header;
+
+/*
+    This routine creates an empty dictionary.
+*/
+dictl * dictl_create();
+
+/*
+    This routine returns the id of the given key (key_size bytes, not NUL terminated),
+    adding the key with the next id if it is not in the dictionary yet.
+    Many threads can call it on the same dictionary.
+*/
+int dictl_id(dictl * dict, const char * key, const size_t key_size);
+
+/*
+    This routine fills ids with the ids of n keys, as dictl_id does, holding the
+    read lock of the table once for the whole batch.
+    Many threads can call it on the same dictionary.
+*/
+void dictl_ids(dictl * dict, char * const * keys, const size_t * key_sizes, const int n, int * ids);
+
+/*
+    This routine returns the id of the given key, -1 if it is not in the dictionary.
+    It must not be called while other threads add keys.
+*/
+int dictl_find(const dictl * dict, const char * key, const size_t key_size);
+
+/*
+    This routine returns the NUL terminated key of the given id.
+*/
+const char * dictl_key(const dictl * dict, const int id);
+
+/*
+    This routine gives the keys added since first_id new ids in sorted order, so that
+    they do not depend on the order in which the threads added them: remap (n_keys
+    elements) is filled with the new id of each old id.
+    It must not be called while other threads add keys.
+*/
+void dictl_sort(dictl * dict, const int first_id, int * remap);
+
+/*
+    This routine writes the keys in id order to a temporary file and renames it.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int dictl_save(const char * pathname, const dictl * dict);
+
+/*
+    This routine reads a dictionary file, with the same id for every key.
+    The routine returns NULL if the file does not exist or is not valid.
+*/
+dictl * dictl_load(const char * pathname);
+
+/*
+    This routine frees the dictionary.
+*/
+void dictl_free(dictl * dict);
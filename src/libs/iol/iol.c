@@ -0,0 +1,520 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    iol.c
+    C library for reading and writing files in large blocks kept in flight
+    ahead of the parser (reads) and behind the formatter (writes), with
+    io_uring or with pread and pwrite, behind a stdio stream
+*/
+
+// fopencookie:
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "iol.h"
+
+#ifdef __linux__
+
+/*
+    A block of a file: reads fill it from offset for size bytes, of which used are
+    already given to the stream; writes fill used bytes and write them at offset
+*/
+typedef struct {
+    char * data;
+    uint64_t offset;
+    size_t size;
+    size_t used;
+    int64_t result;
+    int pending;
+} iol_block;
+
+typedef struct {
+    int fd;
+    int writing;
+    size_t block_size;
+
+    // Bytes given to (reads) or taken from (writes) the stream, errno of the first failed write:
+    uint64_t position;
+    int error;
+
+    // io_uring, with a block for each request in flight:
+    int ring_fd;
+    int depth;
+    int fixed;
+    iol_block * blocks;
+    int n_pending;
+    unsigned n_queued;
+    void * sq_ring;
+    void * cq_ring;
+    struct io_uring_sqe * sqes;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    unsigned * sq_head;
+    unsigned * sq_tail;
+    unsigned * sq_mask;
+    unsigned * sq_array;
+    unsigned * cq_head;
+    unsigned * cq_tail;
+    unsigned * cq_mask;
+    struct io_uring_cqe * cqes;
+
+    // Reads: blocks head ... head + n_ahead - 1 cover the file up to next_offset, up to ahead of them
+    // are in flight at once (doubling up to depth, so that a file read only at its beginning costs one block).
+    // Writes: next_offset is where the current block goes
+    uint64_t file_size;
+    uint64_t next_offset;
+    int head;
+    int n_ahead;
+    int ahead;
+    int current;
+} iol_file;
+
+static int backend = IOL_STDIO;
+static pthread_once_t backend_once = PTHREAD_ONCE_INIT;
+
+static int env_int(const char * name, const int default_value, const int min_value)
+{
+    const char * const env = getenv(name);
+    return (env != NULL && atoi(env) >= min_value) ? atoi(env) : default_value;
+}
+
+static void choose_backend()
+{
+    const char * const env = getenv("CSVL_IO");
+    if(env == NULL) return;
+
+    if(strcmp(env, "pread") == 0) backend = IOL_PREAD;
+    else if(strcmp(env, "uring") == 0){
+        // io_uring may be missing, or denied (e.g. by seccomp in containers):
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        const int ring_fd = syscall(__NR_io_uring_setup, 1, &params);
+        if(ring_fd >= 0){
+            close(ring_fd);
+            backend = IOL_URING;
+        }
+        else{
+            fprintf(stderr, "[LOG] io_uring is not available (%s), files are read and written with pread and pwrite\n", strerror(errno));
+            backend = IOL_PREAD;
+        }
+    }
+}
+
+int iol_backend()
+{
+    pthread_once(&backend_once, choose_backend);
+    return backend;
+}
+
+static ssize_t pread_full(const int fd, char * data, const size_t size, const uint64_t offset)
+{
+    size_t done = 0;
+    while(done < size){
+        const ssize_t n = pread(fd, data + done, size - done, offset + done);
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0) return -1;
+        if(n == 0) break;
+        done += n;
+    }
+    return done;
+}
+
+static int pwrite_full(const int fd, const char * data, const size_t size, const uint64_t offset)
+{
+    size_t done = 0;
+    while(done < size){
+        const ssize_t n = pwrite(fd, data + done, size - done, offset + done);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return -1;
+        done += n;
+    }
+    return 0;
+}
+
+static int ring_enter(iol_file * f, const unsigned min_complete)
+{
+    int n;
+    do{
+        n = syscall(__NR_io_uring_enter, f->ring_fd, f->n_queued, min_complete,
+                    min_complete > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while(n < 0 && errno == EINTR);
+
+    if(n < 0) return -1;
+    f->n_queued -= (unsigned) n < f->n_queued ? (unsigned) n : f->n_queued;
+    return 0;
+}
+
+static void ring_queue(iol_file * f, const int b, const int fixed_opcode, const int opcode,
+                       char * data, const size_t size, const uint64_t offset)
+{
+    const unsigned tail = *f->sq_tail;
+    const unsigned index = tail & *f->sq_mask;
+    struct io_uring_sqe * sqe = &f->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = f->fixed ? fixed_opcode : opcode;
+    sqe->fd = f->fd;
+    sqe->addr = (uint64_t) (uintptr_t) data;
+    sqe->len = size;
+    sqe->off = offset;
+    sqe->buf_index = b;
+    sqe->user_data = b;
+    f->sq_array[index] = index;
+    __atomic_store_n(f->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    f->blocks[b].pending = 1;
+    ++f->n_pending;
+    ++f->n_queued;
+}
+
+static void ring_reap(iol_file * f)
+{
+    unsigned head = *f->cq_head;
+
+    while(head != __atomic_load_n(f->cq_tail, __ATOMIC_ACQUIRE)){
+        const struct io_uring_cqe * cqe = &f->cqes[head & *f->cq_mask];
+        iol_block * block = &f->blocks[cqe->user_data];
+        block->result = cqe->res;
+        block->pending = 0;
+        --f->n_pending;
+        ++head;
+
+        // The rest of a short write is written right away, the first failure is kept for fclose:
+        if(f->writing && block->result >= 0 && (size_t) block->result < block->size){
+            if(pwrite_full(f->fd, block->data + block->result, block->size - block->result, block->offset + block->result) != 0){
+                block->result = -errno;
+            }
+        }
+        if(f->writing && block->result < 0 && f->error == 0) f->error = -block->result;
+    }
+    __atomic_store_n(f->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static int block_wait(iol_file * f, iol_block * block)
+{
+    ring_reap(f);
+    while(block->pending){
+        if(ring_enter(f, 1) != 0) return -1;
+        ring_reap(f);
+    }
+    return 0;
+}
+
+static int ring_drain(iol_file * f)
+{
+    ring_reap(f);
+    while(f->n_pending > 0){
+        if(ring_enter(f, 1) != 0) return -1;
+        ring_reap(f);
+    }
+    return 0;
+}
+
+static void ring_teardown(iol_file * f)
+{
+    if(f->sqes != NULL && f->sqes != MAP_FAILED) munmap(f->sqes, f->sqes_size);
+    if(f->cq_ring != NULL && f->cq_ring != MAP_FAILED && f->cq_ring != f->sq_ring) munmap(f->cq_ring, f->cq_ring_size);
+    if(f->sq_ring != NULL && f->sq_ring != MAP_FAILED) munmap(f->sq_ring, f->sq_ring_size);
+    close(f->ring_fd);
+}
+
+static int ring_setup(iol_file * f)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    f->ring_fd = syscall(__NR_io_uring_setup, f->depth, &params);
+    if(f->ring_fd < 0) return -1;
+
+    // Mapping the submission and completion rings, a single mapping on kernels from 5.4:
+    f->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    f->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const int single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if(single_mmap){
+        if(f->cq_ring_size > f->sq_ring_size) f->sq_ring_size = f->cq_ring_size;
+        f->cq_ring_size = f->sq_ring_size;
+    }
+    f->sq_ring = mmap(NULL, f->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, f->ring_fd, IORING_OFF_SQ_RING);
+    f->cq_ring = single_mmap ? f->sq_ring :
+                 mmap(NULL, f->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, f->ring_fd, IORING_OFF_CQ_RING);
+    f->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    f->sqes = mmap(NULL, f->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, f->ring_fd, IORING_OFF_SQES);
+    if(f->sq_ring == MAP_FAILED || f->cq_ring == MAP_FAILED || f->sqes == MAP_FAILED){
+        ring_teardown(f);
+        return -1;
+    }
+
+    f->sq_head = (unsigned *) ((char *) f->sq_ring + params.sq_off.head);
+    f->sq_tail = (unsigned *) ((char *) f->sq_ring + params.sq_off.tail);
+    f->sq_mask = (unsigned *) ((char *) f->sq_ring + params.sq_off.ring_mask);
+    f->sq_array = (unsigned *) ((char *) f->sq_ring + params.sq_off.array);
+    f->cq_head = (unsigned *) ((char *) f->cq_ring + params.cq_off.head);
+    f->cq_tail = (unsigned *) ((char *) f->cq_ring + params.cq_off.tail);
+    f->cq_mask = (unsigned *) ((char *) f->cq_ring + params.cq_off.ring_mask);
+    f->cqes = (struct io_uring_cqe *) ((char *) f->cq_ring + params.cq_off.cqes);
+
+    // Registering the pool, so that its pages are not pinned again at every request
+    // (plain requests are used where registering fails, e.g. over RLIMIT_MEMLOCK):
+    struct iovec * iovecs = (struct iovec *) malloc(sizeof(struct iovec) * f->depth);
+    for(int b = 0; b < f->depth; ++b){
+        iovecs[b].iov_base = f->blocks[b].data;
+        iovecs[b].iov_len = f->block_size;
+    }
+    f->fixed = syscall(__NR_io_uring_register, f->ring_fd, IORING_REGISTER_BUFFERS, iovecs, f->depth) == 0;
+    free(iovecs);
+    return 0;
+}
+
+static void read_ahead(iol_file * f)
+{
+    // The size is taken again at the end, for files still growing:
+    if(f->n_ahead == 0 && f->next_offset >= f->file_size){
+        struct stat st;
+        if(fstat(f->fd, &st) == 0) f->file_size = st.st_size;
+    }
+
+    while(f->n_ahead < f->ahead && f->next_offset < f->file_size){
+        const int b = (f->head + f->n_ahead) % f->depth;
+        iol_block * block = &f->blocks[b];
+        block->offset = f->next_offset;
+        block->size = f->file_size - f->next_offset < f->block_size ? f->file_size - f->next_offset : f->block_size;
+        block->used = 0;
+        ring_queue(f, b, IORING_OP_READ_FIXED, IORING_OP_READ, block->data, block->size, block->offset);
+        f->next_offset += block->size;
+        ++f->n_ahead;
+    }
+
+    // A failed submission is retried by the next wait:
+    if(f->n_queued > 0) ring_enter(f, 0);
+}
+
+static ssize_t uring_read(void * cookie, char * data, size_t size)
+{
+    iol_file * f = (iol_file *) cookie;
+
+    if(f->n_ahead == 0) read_ahead(f);
+    if(f->n_ahead == 0) return 0;
+
+    iol_block * block = &f->blocks[f->head];
+    if(block_wait(f, block) != 0) return -1;
+    if(block->result < 0){
+        errno = (int) -block->result;
+        return -1;
+    }
+
+    // The rest of a short read is read right away (less of it if the file was truncated meanwhile):
+    if((size_t) block->result < block->size){
+        const ssize_t n = pread_full(f->fd, block->data + block->result, block->size - block->result, block->offset + block->result);
+        if(n < 0) return -1;
+        block->size = block->result + n;
+        block->result = block->size;
+    }
+
+    const size_t n = size < block->size - block->used ? size : block->size - block->used;
+    memcpy(data, block->data + block->used, n);
+    block->used += n;
+    f->position += n;
+
+    // The block is reused for the next one of the file, with one more in flight:
+    if(block->used == block->size){
+        f->head = (f->head + 1) % f->depth;
+        --f->n_ahead;
+        f->ahead = f->ahead * 2 < f->depth ? f->ahead * 2 : f->depth;
+        read_ahead(f);
+    }
+    return n;
+}
+
+static int write_current(iol_file * f)
+{
+    iol_block * block = &f->blocks[f->current];
+    block->offset = f->next_offset;
+    block->size = block->used;
+    ring_queue(f, f->current, IORING_OP_WRITE_FIXED, IORING_OP_WRITE, block->data, block->size, block->offset);
+    f->next_offset += block->size;
+    return ring_enter(f, 0);
+}
+
+static ssize_t uring_write(void * cookie, const char * data, size_t size)
+{
+    iol_file * f = (iol_file *) cookie;
+    size_t done = 0;
+
+    while(done < size){
+        iol_block * block = &f->blocks[f->current];
+        const size_t n = size - done < f->block_size - block->used ? size - done : f->block_size - block->used;
+        memcpy(block->data + block->used, data + done, n);
+        block->used += n;
+        done += n;
+
+        // A full block is written while the next one is filled, once its previous write is done:
+        if(block->used == f->block_size){
+            if(write_current(f) != 0) f->error = errno;
+            f->current = (f->current + 1) % f->depth;
+            if(block_wait(f, &f->blocks[f->current]) != 0 && f->error == 0) f->error = errno;
+            f->blocks[f->current].used = 0;
+        }
+    }
+    f->position += size;
+
+    if(f->error != 0){
+        errno = f->error;
+        return 0;
+    }
+    return size;
+}
+
+static int iol_seek(void * cookie, off64_t * offset, int whence)
+{
+    iol_file * f = (iol_file *) cookie;
+    int64_t position = *offset;
+
+    if(whence == SEEK_CUR) position += f->position;
+    else if(whence == SEEK_END){
+        struct stat st;
+        if(fstat(f->fd, &st) != 0) return -1;
+        position += st.st_size;
+    }
+
+    // Streams are written in order only:
+    if(position < 0 || (f->writing && (uint64_t) position != f->position)){
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Dropping the reads ahead, which start again from the new position:
+    if(!f->writing && (uint64_t) position != f->position){
+        if(f->ring_fd >= 0 && ring_drain(f) != 0) return -1;
+        f->n_ahead = 0;
+        f->next_offset = position;
+        f->ahead = 1;
+        f->position = position;
+    }
+
+    * offset = position;
+    return 0;
+}
+
+static void iol_free(iol_file * f)
+{
+    for(int b = 0; b < f->depth; ++b) free(f->blocks[b].data);
+    free(f->blocks);
+    free(f);
+}
+
+static int uring_close(void * cookie)
+{
+    iol_file * f = (iol_file *) cookie;
+    int result = 0;
+
+    if(f->writing && f->blocks[f->current].used > 0 && write_current(f) != 0 && f->error == 0) f->error = errno;
+    if(ring_drain(f) != 0 && f->writing && f->error == 0) f->error = errno;
+    if(f->writing && f->error != 0) result = -1;
+
+    ring_teardown(f);
+    if(close(f->fd) != 0) result = -1;
+    iol_free(f);
+    return result;
+}
+
+static ssize_t pread_read(void * cookie, char * data, size_t size)
+{
+    iol_file * f = (iol_file *) cookie;
+    const ssize_t n = pread_full(f->fd, data, size, f->position);
+    if(n > 0) f->position += n;
+    return n;
+}
+
+static ssize_t pread_write(void * cookie, const char * data, size_t size)
+{
+    iol_file * f = (iol_file *) cookie;
+    if(pwrite_full(f->fd, data, size, f->position) != 0) return 0;
+    f->position += size;
+    return size;
+}
+
+static int pread_close(void * cookie)
+{
+    iol_file * f = (iol_file *) cookie;
+    const int result = close(f->fd) == 0 ? 0 : -1;
+    iol_free(f);
+    return result;
+}
+
+FILE * iol_fopen(const char * pathname, const char * mode)
+{
+    const int writing = strcmp(mode, "w") == 0;
+    if(iol_backend() == IOL_STDIO || (!writing && strcmp(mode, "r") != 0)) return fopen(pathname, mode);
+
+    const int fd = open(pathname, writing ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY, 0644);
+    if(fd < 0) return NULL;
+
+    // Pipes and devices are left to stdio:
+    struct stat st;
+    if(fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)){
+        close(fd);
+        return fopen(pathname, mode);
+    }
+
+    iol_file * f = (iol_file *) calloc(1, sizeof(iol_file));
+    f->fd = fd;
+    f->writing = writing;
+    f->file_size = st.st_size;
+    f->block_size = env_int("CSVL_IO_BLOCK", IOL_BLOCK_SIZE, 4096);
+    f->ahead = 1;
+    f->ring_fd = -1;
+
+    int file_backend = iol_backend();
+    if(file_backend == IOL_URING){
+        f->depth = env_int("CSVL_IO_DEPTH", IOL_DEPTH, 1);
+        f->blocks = (iol_block *) calloc(f->depth, sizeof(iol_block));
+        for(int b = 0; b < f->depth; ++b){
+            if(posix_memalign((void **) &f->blocks[b].data, 4096, f->block_size) != 0) f->blocks[b].data = NULL;
+            if(f->blocks[b].data == NULL) file_backend = IOL_PREAD;
+        }
+
+        // Rings are limited by RLIMIT_MEMLOCK on older kernels, those files are read with pread:
+        if(file_backend == IOL_URING && ring_setup(f) != 0){
+            f->ring_fd = -1;
+            file_backend = IOL_PREAD;
+        }
+    }
+
+    cookie_io_functions_t functions;
+    if(file_backend == IOL_URING){
+        functions = (cookie_io_functions_t) { uring_read, uring_write, iol_seek, uring_close };
+    }
+    else{
+        functions = (cookie_io_functions_t) { pread_read, pread_write, iol_seek, pread_close };
+    }
+
+    FILE * stream = fopencookie(f, mode, functions);
+    if(stream == NULL){
+        if(f->ring_fd >= 0) ring_teardown(f);
+        close(fd);
+        iol_free(f);
+        return NULL;
+    }
+
+    // The stream hands whole blocks to the backend:
+    setvbuf(stream, NULL, _IOFBF, f->block_size);
+    return stream;
+}
+
+#else
+
+int iol_backend()
+{
+    return IOL_STDIO;
+}
+
+FILE * iol_fopen(const char * pathname, const char * mode)
+{
+    return fopen(pathname, mode);
+}
+
+#endif
@@ -0,0 +1,56 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    iol.h
+    C library for reading and writing files in large blocks kept in flight
+    ahead of the parser (reads) and behind the formatter (writes), with
+    io_uring or with pread and pwrite, behind a stdio stream
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+
+// Backends, chosen by CSVL_IO ("uring", "pread", anything else for stdio):
+#define IOL_STDIO 0
+#define IOL_PREAD 1
+#define IOL_URING 2
+
+// Default blocks in flight (CSVL_IO_DEPTH) and their size (CSVL_IO_BLOCK):
+#define IOL_DEPTH 8
+#define IOL_BLOCK_SIZE (256 * 1024)
+
+/*
+    This routine returns the backend chosen by CSVL_IO for the files opened from now on:
+    IOL_URING falls back to IOL_PREAD where io_uring is not available.
+*/
+int iol_backend();
+
+/*
+    This routine opens a file for reading (mode "r") or writing (mode "w"), as fopen does:
+    with IOL_URING up to CSVL_IO_DEPTH reads of CSVL_IO_BLOCK bytes are kept in flight ahead
+    of the reads of the stream, and the written blocks are written asynchronously from a
+    fixed pool of registered buffers; with IOL_PREAD every read and write is a single pread
+    or pwrite of a block. Other files than regular ones, and IOL_STDIO, are opened by fopen.
+    The stream is closed by fclose, which returns EOF if any write failed.
+    The routine returns NULL if fails.
+*/
+FILE * iol_fopen(const char * pathname, const char * mode);
@@ -0,0 +1,432 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    jobl.c
+    C library for journaling the normalization of a CSV file into a separate
+    one, so that a run stopped halfway (a crash, a kill, a failed OpenCL call)
+    can be resumed from its last durable checkpoint
+*/
+
+#include "jobl.h"
+
+static char * job_path(const jobl_job * job, const char * name)
+{
+    char * pathname = (char *) malloc(strlen(job->directory) + strlen(name) + 2);
+    sprintf(pathname, "%s/%s", job->directory, name);
+    return pathname;
+}
+
+static char * column_path(const jobl_job * job, const int index)
+{
+    char name[32];
+    sprintf(name, "column-%d.f32", job->columns[index]);
+    return job_path(job, name);
+}
+
+static int write_all(const int fd, const void * data, size_t size)
+{
+    const char * bytes = (const char *) data;
+    while(size > 0){
+        const ssize_t n = write(fd, bytes, size);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return -1;
+        bytes += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static int sync_directory(const char * pathname)
+{
+    const int fd = open(pathname, O_RDONLY | O_DIRECTORY);
+    if(fd < 0) return -1;
+    const int result = fsync(fd);
+    close(fd);
+    return result;
+}
+
+// Syncing the directory holding pathname, so that a file created or renamed there survives a crash:
+static int sync_parent(const char * pathname)
+{
+    char * parent = strdup(pathname);
+    char * slash = strrchr(parent, '/');
+    if(slash == parent) slash[1] = '\0';
+    else if(slash != NULL) * slash = '\0';
+    else strcpy(parent, ".");
+
+    const int result = sync_directory(parent);
+    free(parent);
+    return result;
+}
+
+static uint32_t header_crc(const jobl_header * header, const int32_t * columns)
+{
+    jobl_header copy = * header;
+    copy.crc = 0;
+    uLong crc = crc32(0L, (const Bytef *) &copy, sizeof(copy));
+    return (uint32_t) crc32(crc, (const Bytef *) columns, sizeof(int32_t) * header->n_columns);
+}
+
+static uint32_t record_crc(const jobl_record * record)
+{
+    jobl_record copy = * record;
+    copy.crc = 0;
+    return (uint32_t) crc32(0L, (const Bytef *) &copy, sizeof(copy));
+}
+
+static int append_record(jobl_job * job, jobl_record * record)
+{
+    record->crc = record_crc(record);
+    if(write_all(job->fd, record, sizeof(jobl_record)) != 0 || fdatasync(job->fd) != 0){
+        fprintf(stderr, "[JOBL - FAIL] Can't write the journal of %s\n", job->directory);
+        return -1;
+    }
+    return 0;
+}
+
+// Removing every file of the directory of the job, and the directory:
+static void remove_directory(const char * directory)
+{
+    DIR * dir = opendir(directory);
+    if(dir == NULL) return;
+
+    struct dirent * entry;
+    while((entry = readdir(dir)) != NULL){
+        if(strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+        char * pathname = (char *) malloc(strlen(directory) + strlen(entry->d_name) + 2);
+        sprintf(pathname, "%s/%s", directory, entry->d_name);
+        remove(pathname);
+        free(pathname);
+    }
+    closedir(dir);
+    rmdir(directory);
+}
+
+/*
+    Replaying the journal of a previous run: the header must match the CSV file and the
+    columns of this run, the records are applied up to the first torn one, which is cut off.
+    Returns 0 if the journal was replayed, -1 if the job must start from scratch.
+*/
+static int replay(jobl_job * job, const char * journal_pathname)
+{
+    jobl_header header;
+    jobl_record record;
+
+    job->fd = open(journal_pathname, O_RDWR);
+    if(job->fd < 0) return -1;
+
+    const uint64_t n_columns = job->header.n_columns;
+    int32_t * columns = (int32_t *) malloc(sizeof(int32_t) * (n_columns + 1));
+    int valid = read(job->fd, &header, sizeof(header)) == sizeof(header) &&
+                memcmp(header.magic, JOBL_MAGIC, 8) == 0 && header.n_columns == n_columns &&
+                read(job->fd, columns, sizeof(int32_t) * n_columns) == (ssize_t) (sizeof(int32_t) * n_columns) &&
+                header.crc == header_crc(&header, columns) &&
+                header.input_size == job->header.input_size && header.input_mtime_ns == job->header.input_mtime_ns &&
+                header.n_chunks == job->header.n_chunks;
+    for(uint64_t i = 0; valid && i < n_columns; ++i) valid = columns[i] == job->columns[i];
+    free(columns);
+
+    if(!valid){
+        close(job->fd);
+        job->fd = -1;
+        return -1;
+    }
+
+    off_t good = sizeof(header) + sizeof(int32_t) * n_columns;
+    while(read(job->fd, &record, sizeof(record)) == sizeof(record) && record.crc == record_crc(&record)){
+        const int index = record.index;
+        const int column_record = record.type == JOBL_STATS || record.type == JOBL_COLUMN;
+        if(column_record && (index < 0 || (uint64_t) index >= n_columns)) break;
+
+        if(record.type == JOBL_STATS){
+            job->stats_done[index] = 1;
+            job->max[index] = record.max;
+            job->min[index] = record.min;
+        }
+        else if(record.type == JOBL_COLUMN){
+            job->column_done[index] = 1;
+            job->column_rows[index] = record.rows;
+        }
+        else if(record.type == JOBL_OUTPUT){
+            job->output_chunks = index;
+            job->output_rows = record.rows;
+            job->output_bytes = record.bytes;
+        }
+        else if(record.type == JOBL_DONE){
+            job->done = 1;
+        }
+        else break;
+
+        good += sizeof(record);
+    }
+
+    // The next records are appended right after the last whole one:
+    if(ftruncate(job->fd, good) != 0 || lseek(job->fd, good, SEEK_SET) != good){
+        close(job->fd);
+        job->fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+// Creating the journal of a new job, durable with its directory:
+static int create(jobl_job * job, const char * journal_pathname)
+{
+    int32_t * columns = (int32_t *) malloc(sizeof(int32_t) * (job->header.n_columns + 1));
+    for(uint64_t i = 0; i < job->header.n_columns; ++i) columns[i] = job->columns[i];
+    job->header.crc = header_crc(&job->header, columns);
+
+    job->fd = open(journal_pathname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int result = job->fd < 0 ? -1 : 0;
+    if(result == 0) result = write_all(job->fd, &job->header, sizeof(job->header));
+    if(result == 0) result = write_all(job->fd, columns, sizeof(int32_t) * job->header.n_columns);
+    if(result == 0) result = fdatasync(job->fd);
+    if(result == 0) result = sync_directory(job->directory);
+    if(result == 0) result = sync_parent(job->directory);
+
+    free(columns);
+    return result;
+}
+
+jobl_job * jobl_open(const char * output_pathname, const char * csv_pathname, const int * columns, const int n_columns, const int resume)
+{
+    struct stat input_st, st;
+    if(stat(csv_pathname, &input_st) != 0){
+        fprintf(stderr, "[JOBL - FAIL] Can't read %s\n", csv_pathname);
+        return NULL;
+    }
+
+    jobl_job * job = (jobl_job *) calloc(1, sizeof(jobl_job));
+    job->directory = (char *) malloc(strlen(output_pathname) + strlen(JOBL_SUFFIX) + 1);
+    sprintf(job->directory, "%s%s", output_pathname, JOBL_SUFFIX);
+    job->fd = -1;
+
+    memcpy(job->header.magic, JOBL_MAGIC, 8);
+    job->header.input_size = input_st.st_size;
+    job->header.input_mtime_ns = (int64_t) input_st.st_mtim.tv_sec * 1000000000 + input_st.st_mtim.tv_nsec;
+    job->header.n_columns = n_columns;
+    const char * const chunk_env = getenv("CSVL_JOB_CHUNK");
+    const uint64_t chunk_size = (chunk_env && atoll(chunk_env) > 0) ? (uint64_t) atoll(chunk_env) : JOBL_OUTPUT_CHUNK;
+    job->header.n_chunks = (input_st.st_size + chunk_size - 1) / chunk_size;
+    if(job->header.n_chunks == 0) job->header.n_chunks = 1;
+
+    job->columns = (int *) malloc(sizeof(int) * n_columns);
+    memcpy(job->columns, columns, sizeof(int) * n_columns);
+    job->stats_done = (int *) calloc(n_columns, sizeof(int));
+    job->max = (float *) calloc(n_columns, sizeof(float));
+    job->min = (float *) calloc(n_columns, sizeof(float));
+    job->column_done = (int *) calloc(n_columns, sizeof(int));
+    job->column_rows = (uint64_t *) calloc(n_columns, sizeof(uint64_t));
+    job->mapped = (float **) calloc(n_columns, sizeof(float *));
+    job->mapped_size = (size_t *) calloc(n_columns, sizeof(size_t));
+
+    char * journal_pathname = job_path(job, JOBL_JOURNAL_NAME);
+    int replayed = resume && replay(job, journal_pathname) == 0;
+
+    if(replayed){
+        // A column is only done if its file is whole:
+        for(int i = 0; i < n_columns; ++i){
+            char * pathname = column_path(job, i);
+            if(job->column_done[i] && (stat(pathname, &st) != 0 || (uint64_t) st.st_size != job->column_rows[i] * sizeof(float))){
+                job->column_done[i] = 0;
+            }
+            free(pathname);
+        }
+
+        // Renamed, but stopped before recording it:
+        char * partial_pathname = job_path(job, JOBL_PARTIAL_NAME);
+        if(!job->done && job->output_chunks == job->header.n_chunks && stat(partial_pathname, &st) != 0 &&
+           stat(output_pathname, &st) == 0 && (uint64_t) st.st_size == job->output_bytes){
+            job->done = 1;
+        }
+        free(partial_pathname);
+    }
+    else{
+        if(resume) fprintf(stdout, "[LOG] No journal of this run for %s, starting from scratch\n", output_pathname);
+
+        // Nothing of a previous job is kept:
+        remove_directory(job->directory);
+        memset(job->stats_done, 0, sizeof(int) * n_columns);
+        memset(job->column_done, 0, sizeof(int) * n_columns);
+        job->output_chunks = job->output_rows = job->output_bytes = 0;
+        job->done = 0;
+
+        if((mkdir(job->directory, 0755) != 0 && errno != EEXIST) || create(job, journal_pathname) != 0){
+            fprintf(stderr, "[JOBL - FAIL] Can't create the journal %s\n", journal_pathname);
+            free(journal_pathname);
+            jobl_close(job);
+            return NULL;
+        }
+    }
+
+    free(journal_pathname);
+    return job;
+}
+
+int jobl_save_stats(jobl_job * job, const int index, const float max, const float min)
+{
+    jobl_record record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOBL_STATS;
+    record.index = index;
+    record.max = max;
+    record.min = min;
+
+    if(append_record(job, &record) != 0) return -1;
+    job->stats_done[index] = 1;
+    job->max[index] = max;
+    job->min[index] = min;
+    return 0;
+}
+
+int jobl_save_column(jobl_job * job, const int index, const float * buffer, const size_t n_rows)
+{
+    char * pathname = column_path(job, index);
+    char * temp_pathname = (char *) malloc(strlen(pathname) + 5);
+    sprintf(temp_pathname, "%s.tmp", pathname);
+
+    // Written aside and renamed, so that the file of a column is either whole or missing:
+    const int fd = open(temp_pathname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int result = fd < 0 ? -1 : write_all(fd, buffer, sizeof(float) * n_rows);
+    if(result == 0) result = fdatasync(fd);
+    if(fd >= 0 && close(fd) != 0) result = -1;
+    if(result == 0) result = rename(temp_pathname, pathname);
+    if(result == 0) result = sync_directory(job->directory);
+
+    if(result != 0){
+        fprintf(stderr, "[JOBL - FAIL] Can't write %s\n", pathname);
+        remove(temp_pathname);
+    }
+    free(temp_pathname);
+    free(pathname);
+    if(result != 0) return -1;
+
+    jobl_record record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOBL_COLUMN;
+    record.index = index;
+    record.rows = n_rows;
+
+    if(append_record(job, &record) != 0) return -1;
+    job->column_done[index] = 1;
+    job->column_rows[index] = n_rows;
+    return 0;
+}
+
+float * jobl_load_column(jobl_job * job, const int index, size_t * n_rows)
+{
+    struct stat st;
+    char * pathname = column_path(job, index);
+
+    const int fd = open(pathname, O_RDONLY);
+    void * data = MAP_FAILED;
+    if(fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0){
+        data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if(fd >= 0) close(fd);
+
+    if(data == MAP_FAILED){
+        fprintf(stderr, "[JOBL - FAIL] Can't read %s\n", pathname);
+        free(pathname);
+        return NULL;
+    }
+    free(pathname);
+
+    // Read once, from the first row to the last one:
+    madvise(data, st.st_size, MADV_SEQUENTIAL);
+    job->mapped[index] = (float *) data;
+    job->mapped_size[index] = st.st_size;
+    * n_rows = st.st_size / sizeof(float);
+    return (float *) data;
+}
+
+FILE * jobl_open_output(jobl_job * job)
+{
+    char * pathname = job_path(job, JOBL_PARTIAL_NAME);
+
+    // The bytes after the last checkpoint are written again:
+    const int fd = open(pathname, O_RDWR | O_CREAT, 0644);
+    FILE * output_fd = NULL;
+    if(fd >= 0 && ftruncate(fd, job->output_bytes) == 0 && lseek(fd, job->output_bytes, SEEK_SET) == (off_t) job->output_bytes){
+        output_fd = fdopen(fd, "w");
+    }
+
+    if(output_fd == NULL){
+        fprintf(stderr, "[JOBL - FAIL] Can't write %s\n", pathname);
+        if(fd >= 0) close(fd);
+    }
+    free(pathname);
+    return output_fd;
+}
+
+int jobl_save_output(jobl_job * job, FILE * output_fd, const uint64_t n_chunks, const uint64_t n_rows)
+{
+    if(fflush(output_fd) != 0 || fdatasync(fileno(output_fd)) != 0){
+        fprintf(stderr, "[JOBL - FAIL] Can't write the output of %s\n", job->directory);
+        return -1;
+    }
+
+    const off_t bytes = ftello(output_fd);
+    if(n_chunks == 1 && sync_directory(job->directory) != 0) return -1;
+
+    jobl_record record;
+    memset(&record, 0, sizeof(record));
+    record.type = JOBL_OUTPUT;
+    record.index = (int32_t) n_chunks;
+    record.rows = n_rows;
+    record.bytes = bytes;
+
+    if(append_record(job, &record) != 0) return -1;
+    job->output_chunks = n_chunks;
+    job->output_rows = n_rows;
+    job->output_bytes = bytes;
+    return 0;
+}
+
+int jobl_finish(jobl_job * job, const char * output_pathname)
+{
+    if(!job->done){
+        char * partial_pathname = job_path(job, JOBL_PARTIAL_NAME);
+        int result = rename(partial_pathname, output_pathname);
+        if(result == 0) result = sync_parent(output_pathname);
+        if(result != 0) fprintf(stderr, "[JOBL - FAIL] Can't rename %s to %s\n", partial_pathname, output_pathname);
+        free(partial_pathname);
+        if(result != 0) return -1;
+
+        jobl_record record;
+        memset(&record, 0, sizeof(record));
+        record.type = JOBL_DONE;
+        if(append_record(job, &record) != 0) return -1;
+        job->done = 1;
+    }
+
+    // The output is complete: nothing of the job is needed anymore:
+    for(uint64_t i = 0; i < job->header.n_columns; ++i){
+        if(job->mapped[i] != NULL) munmap(job->mapped[i], job->mapped_size[i]);
+        job->mapped[i] = NULL;
+    }
+    remove_directory(job->directory);
+    return 0;
+}
+
+void jobl_close(jobl_job * job)
+{
+    if(job->fd >= 0) close(job->fd);
+    for(uint64_t i = 0; i < job->header.n_columns; ++i){
+        if(job->mapped[i] != NULL) munmap(job->mapped[i], job->mapped_size[i]);
+    }
+
+    free(job->directory);
+    free(job->columns);
+    free(job->stats_done);
+    free(job->max);
+    free(job->min);
+    free(job->column_done);
+    free(job->column_rows);
+    free(job->mapped);
+    free(job->mapped_size);
+    free(job);
+}
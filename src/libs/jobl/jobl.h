@@ -0,0 +1,152 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    jobl.h
+    C library for journaling the normalization of a CSV file into a separate
+    one, so that a run stopped halfway (a crash, a kill, a failed OpenCL call)
+    can be resumed from its last durable checkpoint
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <zlib.h>
+
+#define JOBL_MAGIC "CSVLJB01"
+
+// Directory of a job, next to its output, with the journal, the normalized columns and the partial output:
+#define JOBL_SUFFIX ".job"
+#define JOBL_JOURNAL_NAME "journal"
+#define JOBL_PARTIAL_NAME "output.partial"
+
+// Bytes of the CSV file written to the output between two checkpoints (CSVL_JOB_CHUNK bytes if set):
+#define JOBL_OUTPUT_CHUNK (64 * 1024 * 1024)
+
+// Records of the journal:
+#define JOBL_STATS 1    // max and min of a column
+#define JOBL_COLUMN 2   // normalized column, durable in its own file
+#define JOBL_OUTPUT 3   // chunks of the output, durable in the partial output
+#define JOBL_DONE 4     // output renamed to its pathname
+
+/*
+    Fixed header of a journal, followed by n_columns int32 column numbers: the job is
+    about the CSV file of the given size and modification time, and those columns
+*/
+typedef struct {
+    char magic[8];
+    uint64_t input_size;
+    int64_t input_mtime_ns;
+    uint64_t n_columns;
+    uint64_t n_chunks;
+    uint32_t reserved;
+    uint32_t crc;
+} jobl_header;
+
+/*
+    Record appended to the journal once the step it describes is durable: index is the
+    index of the column (JOBL_STATS, JOBL_COLUMN) or the chunks of the output written so
+    far (JOBL_OUTPUT), rows the rows of the column or of the output, bytes the bytes of
+    the output. A record whose crc does not match (a write torn by a crash) ends the journal.
+*/
+typedef struct {
+    uint32_t type;
+    int32_t index;
+    uint64_t rows;
+    uint64_t bytes;
+    float max;
+    float min;
+    uint32_t reserved;
+    uint32_t crc;
+} jobl_record;
+
+/*
+    A job, with the state replayed from its journal
+*/
+typedef struct {
+    char * directory;
+    int fd;
+    jobl_header header;
+    int * columns;
+
+    int * stats_done;
+    float * max;
+    float * min;
+    int * column_done;
+    uint64_t * column_rows;
+
+    uint64_t output_chunks;
+    uint64_t output_rows;
+    uint64_t output_bytes;
+    int done;
+
+    // Normalized columns mapped by jobl_load_column:
+    float ** mapped;
+    size_t * mapped_size;
+} jobl_job;
+
+/*
+    This routine opens the job normalizing the given columns of a CSV file into output_pathname.
+    With resume, the journal of a previous run is replayed, if it is about the same CSV file (same
+    size and modification time) and the same columns: the steps it records are not done again.
+    Otherwise, the job starts from scratch and any previous job of the output is removed.
+    The routine returns NULL if fails.
+*/
+jobl_job * jobl_open(const char * output_pathname, const char * csv_pathname, const int * columns, const int n_columns, const int resume);
+
+/*
+    This routine records the max and min of column index of the job.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int jobl_save_stats(jobl_job * job, const int index, const float max, const float min);
+
+/*
+    This routine writes the normalized column index of the job to its own file (written
+    aside, synced and renamed), then records it.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int jobl_save_column(jobl_job * job, const int index, const float * buffer, const size_t n_rows);
+
+/*
+    This routine maps the normalized column index of the job, filling n_rows with its rows.
+    The column stays mapped until the job is closed.
+    The routine returns NULL if fails.
+*/
+float * jobl_load_column(jobl_job * job, const int index, size_t * n_rows);
+
+/*
+    This routine opens the partial output of the job, truncated to the bytes of the last
+    checkpoint of the output and positioned at its end.
+    The routine returns NULL if fails.
+*/
+FILE * jobl_open_output(jobl_job * job);
+
+/*
+    This routine syncs the partial output and records that its first n_chunks chunks,
+    n_rows rows, are written.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int jobl_save_output(jobl_job * job, FILE * output_fd, const uint64_t n_chunks, const uint64_t n_rows);
+
+/*
+    This routine renames the complete partial output to output_pathname, records it, and
+    removes the directory of the job.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int jobl_finish(jobl_job * job, const char * output_pathname);
+
+/*
+    This routine closes the job and frees it (its files stay on disk until jobl_finish).
+*/
+void jobl_close(jobl_job * job);
@@ -10,8 +10,196 @@
 
 #include "./kernel_launchers.h"
 
+/*
+    Binary of a program compiled by kernel_program, for the source file as it was when
+    compiled (size and modification time) and the given build options
+*/
+typedef struct {
+    cl_device_id device;
+    char * pathname;
+    off_t source_size;
+    time_t source_mtime;
+    char options[KERNEL_OPTIONS_SIZE];
+    unsigned char * binary;
+    size_t binary_size;
+} kernel_binary;
+
+// Variant of every program returned by kernel_program, looked up by the launchers:
+typedef struct {
+    cl_program program;
+    kernel_variant variant;
+} kernel_program_variant;
+
+static kernel_binary binaries[KERNEL_PROGRAM_CACHE_SIZE];
+static int n_binaries = 0;
+static kernel_program_variant program_variants[KERNEL_PROGRAM_CACHE_SIZE];
+static int next_program_variant = 0;
+static pthread_mutex_t program_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Positive value of an environment variable, fallback when it is not set:
+static int env_positive(const char * name, const int fallback)
+{
+    const char * const env = getenv(name);
+    return (env && atoi(env) > 0) ? atoi(env) : fallback;
+}
+
+kernel_variant kernel_variant_for(cl_device_id d, cl_ulong max_elements)
+{
+    kernel_variant v = { 0, 0, 0, 1, 1, KERNEL_NAN_KEEP };
+
+    const char * const index64_env = getenv("CSVL_INDEX64");
+    v.index64 = max_elements > KERNEL_INDEX32_MAX || (index64_env && strcmp(index64_env, "1") == 0);
+    v.fp64 = device_fp64(d) ? 1 : 0;
+
+    // The NaN policy changes the results, so it holds for the generic kernels too:
+    const char * const nan_env = getenv("CSVL_NAN");
+    if(nan_env && strcmp(nan_env, "zero") == 0) v.nan_policy = KERNEL_NAN_ZERO;
+    if(nan_env && strcmp(nan_env, "none") == 0) v.nan_policy = KERNEL_NAN_NONE;
+
+    const char * const kernels_env = getenv("CSVL_KERNELS");
+    if(kernels_env && strcmp(kernels_env, "generic") == 0) return v;
+
+    // The host program launches the reductions with N_WORK_ITEMS_PER_WORK_GROUP WorkItems, where the device allows them:
+    size_t max_work_items = 0;
+    if(clGetDeviceInfo(d, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(max_work_items), &max_work_items, NULL) == CL_SUCCESS &&
+       max_work_items >= N_WORK_ITEMS_PER_WORK_GROUP){
+        v.local_size = N_WORK_ITEMS_PER_WORK_GROUP;
+    }
+
+    v.unroll = env_positive("CSVL_UNROLL", KERNEL_UNROLL);
+    if(v.unroll > KERNEL_MAX_UNROLL) v.unroll = KERNEL_MAX_UNROLL;
+
+    // The widest OpenCL vector type not wider than the one asked:
+    const int width = env_positive("CSVL_VECTOR_WIDTH", KERNEL_VECTOR_WIDTH);
+    while(v.vector_width * 2 <= width && v.vector_width < 16) v.vector_width *= 2;
+
+    return v;
+}
+
+void kernel_variant_options(const kernel_variant * v, char * options, size_t size)
+{
+    snprintf(options, size, "%s%s", v->index64 ? KERNEL_BUILD_OPTIONS_INDEX64 : KERNEL_BUILD_OPTIONS,
+             v->fp64 ? KERNEL_BUILD_OPTIONS_FP64 : "");
+
+    // The generic variant has the options of the kernels before their specializations:
+    size_t length = strlen(options);
+    if(v->local_size > 0) length += snprintf(options + length, size - length, " -D CSVL_LOCAL_SIZE=%d", v->local_size);
+    if(length < size && v->unroll > 1) length += snprintf(options + length, size - length, " -D CSVL_UNROLL=%d", v->unroll);
+    if(length < size && v->vector_width > 1) length += snprintf(options + length, size - length, " -D CSVL_VECTOR_WIDTH=%d", v->vector_width);
+    if(length < size && v->nan_policy == KERNEL_NAN_ZERO) length += snprintf(options + length, size - length, " -D CSVL_NAN_ZERO");
+    if(length < size && v->nan_policy == KERNEL_NAN_NONE) snprintf(options + length, size - length, " -D CSVL_FINITE -cl-finite-math-only");
+}
+
+// Program built from a binary of the cache, NULL if the device refuses it:
+static cl_program program_from_binary(const kernel_binary * b, cl_context c, cl_device_id d)
+{
+    cl_int err, status;
+    const unsigned char * binary = b->binary;
+
+    cl_program prog = clCreateProgramWithBinary(c, 1, &d, &b->binary_size, &binary, &status, &err);
+    if(err != CL_SUCCESS || status != CL_SUCCESS) return NULL;
+
+    if(clBuildProgram(prog, 1, &d, b->options, NULL, NULL) != CL_SUCCESS){
+        clReleaseProgram(prog);
+        return NULL;
+    }
+    printf("\n[OK] Loading kernels binary: %s (%s)", b->pathname, b->options);
+    return prog;
+}
+
+// Keeping the binary of a program just compiled, while the cache has room for it:
+static void keep_binary(cl_program prog, const char * pathname, const struct stat * st, cl_device_id d, const char * options)
+{
+    size_t binary_size = 0;
+    if(n_binaries == KERNEL_PROGRAM_CACHE_SIZE) return;
+    if(clGetProgramInfo(prog, CL_PROGRAM_BINARY_SIZES, sizeof(binary_size), &binary_size, NULL) != CL_SUCCESS || binary_size == 0) return;
+
+    unsigned char * binary = (unsigned char *) malloc(binary_size);
+    if(binary == NULL) return;
+    if(clGetProgramInfo(prog, CL_PROGRAM_BINARIES, sizeof(binary), &binary, NULL) != CL_SUCCESS){
+        free(binary);
+        return;
+    }
+
+    kernel_binary * b = &binaries[n_binaries++];
+    b->device = d;
+    b->pathname = strdup(pathname);
+    b->source_size = st->st_size;
+    b->source_mtime = st->st_mtime;
+    snprintf(b->options, sizeof(b->options), "%s", options);
+    b->binary = binary;
+    b->binary_size = binary_size;
+}
+
+cl_program kernel_program(const char * pathname, cl_context c, cl_device_id d, const kernel_variant * v)
+{
+    char options[KERNEL_OPTIONS_SIZE];
+    struct stat st;
+    cl_program prog = NULL;
+
+    kernel_variant_options(v, options, sizeof(options));
+    if(stat(pathname, &st) != 0) memset(&st, 0, sizeof(st));
+
+    // Compiling under the lock, so that the threads asking for the same program compile it once:
+    pthread_mutex_lock(&program_cache_lock);
+
+    // A failure going back to the recovery point of the thread must not leave the lock held:
+    jmp_buf recovery;
+    jmp_buf * const outer_recovery = ocl_recovery;
+    if(outer_recovery != NULL){
+        if(setjmp(recovery) != 0){
+            ocl_recovery = outer_recovery;
+            pthread_mutex_unlock(&program_cache_lock);
+            ocl_fail();
+        }
+        ocl_recovery = &recovery;
+    }
+    for(int i = 0; i < n_binaries && prog == NULL; ++i){
+        const kernel_binary * b = &binaries[i];
+        if(b->device == d && b->source_size == st.st_size && b->source_mtime == st.st_mtime &&
+           strcmp(b->pathname, pathname) == 0 && strcmp(b->options, options) == 0){
+            prog = program_from_binary(b, c, d);
+        }
+    }
+
+    if(prog != NULL) metricl_add(METRICL_PROGRAM_CACHE_HITS, 1);
+    else{
+        prog = create_program_with_options(pathname, c, d, options);
+        metricl_add(METRICL_PROGRAM_BUILDS, 1);
+        keep_binary(prog, pathname, &st, d, options);
+    }
+
+    // A program released and created again at the same address replaces its old variant:
+    int slot = next_program_variant;
+    for(int i = 0; i < KERNEL_PROGRAM_CACHE_SIZE; ++i){
+        if(program_variants[i].program == prog) slot = i;
+    }
+    if(slot == next_program_variant) next_program_variant = (next_program_variant + 1) % KERNEL_PROGRAM_CACHE_SIZE;
+    program_variants[slot].program = prog;
+    program_variants[slot].variant = * v;
+
+    ocl_recovery = outer_recovery;
+    pthread_mutex_unlock(&program_cache_lock);
+    return prog;
+}
+
+kernel_variant kernel_variant_of(cl_kernel k)
+{
+    kernel_variant v = { 0, 0, 0, 1, 1, KERNEL_NAN_KEEP };
+    cl_program prog;
+
+    if(clGetKernelInfo(k, CL_KERNEL_PROGRAM, sizeof(prog), &prog, NULL) != CL_SUCCESS) return v;
+
+    pthread_mutex_lock(&program_cache_lock);
+    for(int i = 0; i < KERNEL_PROGRAM_CACHE_SIZE; ++i){
+        if(program_variants[i].program == prog) v = program_variants[i].variant;
+    }
+    pthread_mutex_unlock(&program_cache_lock);
+    return v;
+}
+
 cl_event launch_normalize(cl_kernel k, cl_command_queue q, cl_device_id d,
-                          cl_mem buffer_to_normalize, cl_int n_elements,
+                          cl_mem buffer_to_normalize, cl_ulong n_elements,
                           cl_float max, cl_float min)
 {
     cl_int err;
@@ -23,7 +211,9 @@ cl_event launch_normalize(cl_kernel k, cl_command_queue q, cl_device_id d,
                                    sizeof(gws_preferred_multiple), &gws_preferred_multiple, NULL);
     ocl_check(err, "[FAIL] Can't get preferred gws multiple");
 
-    const size_t gws[] = { round_mul_up(n_elements, gws_preferred_multiple) };
+    // One WorkItem for every vector_width elements:
+    const int vector_width = kernel_variant_of(k).vector_width;
+    const size_t gws[] = { round_mul_up((n_elements + vector_width - 1) / vector_width, gws_preferred_multiple) };
 
     // Argument passing to the kernel:
     cl_uint i = 0;
@@ -38,6 +228,7 @@ cl_event launch_normalize(cl_kernel k, cl_command_queue q, cl_device_id d,
 
     err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, NULL, 0, NULL, &normalize_event);
     ocl_check(err, "[FAIL] Can't enqueue normalize kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
 
     // Waiting for all work items to complete:
     err = clFinish(q);
@@ -46,8 +237,120 @@ cl_event launch_normalize(cl_kernel k, cl_command_queue q, cl_device_id d,
     return normalize_event;
 }
 
+cl_event launch_normalize_quantized(cl_kernel k, cl_command_queue q, cl_device_id d, cl_event to_wait,
+                                    cl_mem output_buffer, cl_mem buffer_to_normalize, cl_ulong n_elements,
+                                    cl_float max, cl_float min)
+{
+    cl_int err;
+    cl_event normalize_event;
+
+    // Getting the preferred gws multiple:
+    size_t gws_preferred_multiple;
+    err = clGetKernelWorkGroupInfo(k, d, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+                                   sizeof(gws_preferred_multiple), &gws_preferred_multiple, NULL);
+    ocl_check(err, "[FAIL] Can't get preferred gws multiple");
+
+    const size_t gws[] = { round_mul_up(n_elements, gws_preferred_multiple) };
+
+    // Argument passing to the kernel:
+    cl_uint i = 0;
+    err = clSetKernelArg(k, i++, sizeof(output_buffer), &output_buffer);
+    ocl_check(err, "Can't set normalize_quantized arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(buffer_to_normalize), &buffer_to_normalize);
+    ocl_check(err, "Can't set normalize_quantized arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_elements), &n_elements);
+    ocl_check(err, "Can't set normalize_quantized arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(max), &max);
+    ocl_check(err, "Can't set normalize_quantized arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(min), &min);
+    ocl_check(err, "Can't set normalize_quantized arg", i-1);
+
+    if(to_wait == NULL)
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, NULL, 0, NULL, &normalize_event);
+    else
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, NULL, 1, &to_wait, &normalize_event);
+    ocl_check(err, "[FAIL] Can't enqueue normalize_quantized kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
+
+    return normalize_event;
+}
+
+cl_event launch_normalize_bounds(cl_kernel k, cl_command_queue q, cl_device_id d, cl_event to_wait,
+                                 cl_mem buffer_to_normalize, cl_mem max_buffer, cl_mem min_buffer,
+                                 cl_ulong n_elements)
+{
+    cl_int err;
+    cl_event normalize_event;
+
+    // Getting the preferred gws multiple:
+    size_t gws_preferred_multiple;
+    err = clGetKernelWorkGroupInfo(k, d, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+                                   sizeof(gws_preferred_multiple), &gws_preferred_multiple, NULL);
+    ocl_check(err, "[FAIL] Can't get preferred gws multiple");
+
+    const size_t gws[] = { round_mul_up(n_elements, gws_preferred_multiple) };
+
+    // Argument passing to the kernel:
+    cl_uint i = 0;
+    err = clSetKernelArg(k, i++, sizeof(buffer_to_normalize), &buffer_to_normalize);
+    ocl_check(err, "Can't set normalize_bounds arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(max_buffer), &max_buffer);
+    ocl_check(err, "Can't set normalize_bounds arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(min_buffer), &min_buffer);
+    ocl_check(err, "Can't set normalize_bounds arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_elements), &n_elements);
+    ocl_check(err, "Can't set normalize_bounds arg", i-1);
+
+    if(to_wait == NULL)
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, NULL, 0, NULL, &normalize_event);
+    else
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, NULL, 1, &to_wait, &normalize_event);
+    ocl_check(err, "[FAIL] Can't enqueue normalize_bounds kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
+
+    return normalize_event;
+}
+
+cl_event launch_normalize_groups(cl_kernel k, cl_command_queue q, cl_device_id d, cl_event to_wait,
+                                 cl_mem buffer_to_normalize, cl_mem max_buffer, cl_mem min_buffer,
+                                 cl_mem group_buffer, cl_ulong n_elements)
+{
+    cl_int err;
+    cl_event normalize_event;
+
+    // Getting the preferred gws multiple:
+    size_t gws_preferred_multiple;
+    err = clGetKernelWorkGroupInfo(k, d, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+                                   sizeof(gws_preferred_multiple), &gws_preferred_multiple, NULL);
+    ocl_check(err, "[FAIL] Can't get preferred gws multiple");
+
+    const size_t gws[] = { round_mul_up(n_elements, gws_preferred_multiple) };
+
+    // Argument passing to the kernel:
+    cl_uint i = 0;
+    err = clSetKernelArg(k, i++, sizeof(buffer_to_normalize), &buffer_to_normalize);
+    ocl_check(err, "Can't set normalize_groups arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(max_buffer), &max_buffer);
+    ocl_check(err, "Can't set normalize_groups arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(min_buffer), &min_buffer);
+    ocl_check(err, "Can't set normalize_groups arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(group_buffer), &group_buffer);
+    ocl_check(err, "Can't set normalize_groups arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_elements), &n_elements);
+    ocl_check(err, "Can't set normalize_groups arg", i-1);
+
+    if(to_wait == NULL)
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, NULL, 0, NULL, &normalize_event);
+    else
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, NULL, 1, &to_wait, &normalize_event);
+    ocl_check(err, "[FAIL] Can't enqueue normalize_groups kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
+
+    return normalize_event;
+}
+
 cl_event launch_max_min_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
-                             cl_mem output_buffer, cl_mem input_buffer, cl_int n_elements,
+                             cl_mem output_buffer, cl_mem input_buffer, cl_ulong n_elements,
                              cl_int n_work_items, cl_int n_work_groups)
 {
     const size_t gws[] = { n_work_groups * n_work_items };
@@ -74,6 +377,7 @@ cl_event launch_max_min_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
         err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 1, &to_wait, &max_min_find_event);
 
     ocl_check(err, "[FAIL] Can't enqueue max_min_find kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
 
     // Waiting for all work items to complete: 
     err = clFinish(q);
@@ -82,8 +386,44 @@ cl_event launch_max_min_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
     return max_min_find_event;
 }
 
+cl_event launch_group_max_min_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                                   cl_mem max_buffer, cl_mem min_buffer, cl_mem input_buffer,
+                                   cl_mem group_buffer, cl_ulong n_elements,
+                                   cl_int n_work_items, cl_int n_work_groups)
+{
+    const size_t gws[] = { n_work_groups * n_work_items };
+    const size_t lws[] = { n_work_items };
+
+    cl_event group_max_min_find_event;
+    cl_int err;
+
+    // Argument passing to the kernel:
+    cl_uint i = 0;
+    err = clSetKernelArg(k, i++, sizeof(max_buffer), &max_buffer);
+    ocl_check(err, "Can't set group_max_min_find arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(min_buffer), &min_buffer);
+    ocl_check(err, "Can't set group_max_min_find arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(input_buffer), &input_buffer);
+    ocl_check(err, "Can't set group_max_min_find arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(group_buffer), &group_buffer);
+    ocl_check(err, "Can't set group_max_min_find arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_elements), &n_elements);
+    ocl_check(err, "Can't set group_max_min_find arg", i-1);
+
+    // Waiting for the given event:
+    if(to_wait == NULL)
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 0, NULL, &group_max_min_find_event);
+    else
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 1, &to_wait, &group_max_min_find_event);
+
+    ocl_check(err, "[FAIL] Can't enqueue group_max_min_find kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
+
+    return group_max_min_find_event;
+}
+
 cl_event launch_max_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
-                         cl_mem output_buffer, cl_mem input_buffer, cl_int n_elements,
+                         cl_mem output_buffer, cl_mem input_buffer, cl_ulong n_elements,
                          cl_int n_work_items, cl_int n_work_groups)
 {
     const size_t gws[] = { n_work_groups * n_work_items };
@@ -110,6 +450,7 @@ cl_event launch_max_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
         err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 1, &to_wait, &max_find_event);
 
     ocl_check(err, "[FAIL] Can't enqueue max_find kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
 
     // Waiting for all work items to complete:
     err = clFinish(q);
@@ -119,7 +460,7 @@ cl_event launch_max_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
 }
 
 cl_event launch_min_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
-                         cl_mem output_buffer, cl_mem input_buffer, cl_int n_elements,
+                         cl_mem output_buffer, cl_mem input_buffer, cl_ulong n_elements,
                          cl_int n_work_items, cl_int n_work_groups)
 {
     const size_t gws[] = { n_work_groups * n_work_items };
@@ -145,6 +486,7 @@ cl_event launch_min_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
         err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 1, &to_wait, &min_find_event);
 
     ocl_check(err, "[FAIL] Can't enqueue max_find kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
 
     // Waiting for all work items to complete:
     err = clFinish(q);
@@ -152,3 +494,249 @@ cl_event launch_min_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
 
     return min_find_event;
 }
+
+cl_event launch_count_rows(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                           cl_mem counts_buffer, cl_mem text_buffer, cl_ulong text_size, cl_ulong segment,
+                           cl_int n_work_items, cl_int n_work_groups)
+{
+    const size_t gws[] = { n_work_groups * n_work_items };
+    const size_t lws[] = { n_work_items };
+
+    cl_event count_rows_event;
+    cl_int err;
+
+    // Argument passing to the kernel:
+    cl_uint i = 0;
+    err = clSetKernelArg(k, i++, sizeof(counts_buffer), &counts_buffer);
+    ocl_check(err, "Can't set count_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(text_buffer), &text_buffer);
+    ocl_check(err, "Can't set count_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(text_size), &text_size);
+    ocl_check(err, "Can't set count_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(segment), &segment);
+    ocl_check(err, "Can't set count_rows arg", i-1);
+
+    // Waiting for the given event:
+    if(to_wait == NULL)
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 0, NULL, &count_rows_event);
+    else
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 1, &to_wait, &count_rows_event);
+
+    ocl_check(err, "[FAIL] Can't enqueue count_rows kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
+
+    return count_rows_event;
+}
+
+cl_event launch_scan_counts(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                            cl_mem counts_buffer, cl_uint n_counts, cl_int n_work_items)
+{
+    // A single WorkGroup scans every count:
+    const size_t gws[] = { n_work_items };
+    const size_t lws[] = { n_work_items };
+
+    cl_event scan_counts_event;
+    cl_int err;
+
+    // Argument passing to the kernel:
+    cl_uint i = 0;
+    err = clSetKernelArg(k, i++, sizeof(counts_buffer), &counts_buffer);
+    ocl_check(err, "Can't set scan_counts arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(cl_ulong) * lws[0], NULL);
+    ocl_check(err, "Can't set scan_counts arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_counts), &n_counts);
+    ocl_check(err, "Can't set scan_counts arg", i-1);
+
+    // Waiting for the given event:
+    if(to_wait == NULL)
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 0, NULL, &scan_counts_event);
+    else
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 1, &to_wait, &scan_counts_event);
+
+    ocl_check(err, "[FAIL] Can't enqueue scan_counts kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
+
+    return scan_counts_event;
+}
+
+cl_event launch_find_rows(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                          cl_mem row_starts_buffer, cl_mem text_buffer, cl_mem counts_buffer,
+                          cl_ulong text_size, cl_ulong segment,
+                          cl_int n_work_items, cl_int n_work_groups)
+{
+    const size_t gws[] = { n_work_groups * n_work_items };
+    const size_t lws[] = { n_work_items };
+
+    cl_event find_rows_event;
+    cl_int err;
+
+    // Argument passing to the kernel:
+    cl_uint i = 0;
+    err = clSetKernelArg(k, i++, sizeof(row_starts_buffer), &row_starts_buffer);
+    ocl_check(err, "Can't set find_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(text_buffer), &text_buffer);
+    ocl_check(err, "Can't set find_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(counts_buffer), &counts_buffer);
+    ocl_check(err, "Can't set find_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(text_size), &text_size);
+    ocl_check(err, "Can't set find_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(segment), &segment);
+    ocl_check(err, "Can't set find_rows arg", i-1);
+
+    // Waiting for the given event:
+    if(to_wait == NULL)
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 0, NULL, &find_rows_event);
+    else
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 1, &to_wait, &find_rows_event);
+
+    ocl_check(err, "[FAIL] Can't enqueue find_rows kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
+
+    return find_rows_event;
+}
+
+cl_event launch_parse_fields(cl_kernel k, cl_command_queue q, cl_device_id d, cl_event to_wait,
+                             cl_mem matrix_buffer, cl_mem text_buffer, cl_mem row_starts_buffer,
+                             cl_mem slots_buffer, cl_int n_slots, cl_ulong n_rows, cl_ulong stride)
+{
+    cl_int err;
+    cl_event parse_fields_event;
+
+    // Getting the preferred gws multiple:
+    size_t gws_preferred_multiple;
+    err = clGetKernelWorkGroupInfo(k, d, CL_KERNEL_PREFERRED_WORK_GROUP_SIZE_MULTIPLE,
+                                   sizeof(gws_preferred_multiple), &gws_preferred_multiple, NULL);
+    ocl_check(err, "[FAIL] Can't get preferred gws multiple");
+
+    const size_t gws[] = { round_mul_up(n_rows, gws_preferred_multiple) };
+
+    // Argument passing to the kernel:
+    cl_uint i = 0;
+    err = clSetKernelArg(k, i++, sizeof(matrix_buffer), &matrix_buffer);
+    ocl_check(err, "Can't set parse_fields arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(text_buffer), &text_buffer);
+    ocl_check(err, "Can't set parse_fields arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(row_starts_buffer), &row_starts_buffer);
+    ocl_check(err, "Can't set parse_fields arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(slots_buffer), &slots_buffer);
+    ocl_check(err, "Can't set parse_fields arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_slots), &n_slots);
+    ocl_check(err, "Can't set parse_fields arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_rows), &n_rows);
+    ocl_check(err, "Can't set parse_fields arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(stride), &stride);
+    ocl_check(err, "Can't set parse_fields arg", i-1);
+
+    if(to_wait == NULL)
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, NULL, 0, NULL, &parse_fields_event);
+    else
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, NULL, 1, &to_wait, &parse_fields_event);
+    ocl_check(err, "[FAIL] Can't enqueue parse_fields kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
+
+    return parse_fields_event;
+}
+
+cl_event launch_format_lengths(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                               cl_mem lengths_buffer, cl_mem unformattable_buffer, cl_mem text_buffer,
+                               cl_mem row_starts_buffer, cl_mem matrix_buffer, cl_mem slots_buffer,
+                               cl_int n_slots, cl_int n_cols, cl_uint row_max_size,
+                               cl_ulong n_rows, cl_ulong stride, cl_ulong segment,
+                               cl_int n_work_items, cl_int n_work_groups)
+{
+    const size_t gws[] = { n_work_groups * n_work_items };
+    const size_t lws[] = { n_work_items };
+
+    cl_event format_lengths_event;
+    cl_int err;
+
+    // Argument passing to the kernel:
+    cl_uint i = 0;
+    err = clSetKernelArg(k, i++, sizeof(lengths_buffer), &lengths_buffer);
+    ocl_check(err, "Can't set format_lengths arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(unformattable_buffer), &unformattable_buffer);
+    ocl_check(err, "Can't set format_lengths arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(text_buffer), &text_buffer);
+    ocl_check(err, "Can't set format_lengths arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(row_starts_buffer), &row_starts_buffer);
+    ocl_check(err, "Can't set format_lengths arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(matrix_buffer), &matrix_buffer);
+    ocl_check(err, "Can't set format_lengths arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(slots_buffer), &slots_buffer);
+    ocl_check(err, "Can't set format_lengths arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_slots), &n_slots);
+    ocl_check(err, "Can't set format_lengths arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_cols), &n_cols);
+    ocl_check(err, "Can't set format_lengths arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(row_max_size), &row_max_size);
+    ocl_check(err, "Can't set format_lengths arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_rows), &n_rows);
+    ocl_check(err, "Can't set format_lengths arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(stride), &stride);
+    ocl_check(err, "Can't set format_lengths arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(segment), &segment);
+    ocl_check(err, "Can't set format_lengths arg", i-1);
+
+    // Waiting for the given event:
+    if(to_wait == NULL)
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 0, NULL, &format_lengths_event);
+    else
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 1, &to_wait, &format_lengths_event);
+
+    ocl_check(err, "[FAIL] Can't enqueue format_lengths kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
+
+    return format_lengths_event;
+}
+
+cl_event launch_format_rows(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                            cl_mem output_buffer, cl_mem offsets_buffer, cl_mem text_buffer,
+                            cl_mem row_starts_buffer, cl_mem matrix_buffer, cl_mem slots_buffer,
+                            cl_int n_slots, cl_int n_cols, cl_uint row_max_size,
+                            cl_ulong n_rows, cl_ulong stride, cl_ulong segment,
+                            cl_int n_work_items, cl_int n_work_groups)
+{
+    const size_t gws[] = { n_work_groups * n_work_items };
+    const size_t lws[] = { n_work_items };
+
+    cl_event format_rows_event;
+    cl_int err;
+
+    // Argument passing to the kernel:
+    cl_uint i = 0;
+    err = clSetKernelArg(k, i++, sizeof(output_buffer), &output_buffer);
+    ocl_check(err, "Can't set format_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(offsets_buffer), &offsets_buffer);
+    ocl_check(err, "Can't set format_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(text_buffer), &text_buffer);
+    ocl_check(err, "Can't set format_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(row_starts_buffer), &row_starts_buffer);
+    ocl_check(err, "Can't set format_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(matrix_buffer), &matrix_buffer);
+    ocl_check(err, "Can't set format_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(slots_buffer), &slots_buffer);
+    ocl_check(err, "Can't set format_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_slots), &n_slots);
+    ocl_check(err, "Can't set format_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_cols), &n_cols);
+    ocl_check(err, "Can't set format_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(row_max_size), &row_max_size);
+    ocl_check(err, "Can't set format_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(n_rows), &n_rows);
+    ocl_check(err, "Can't set format_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(stride), &stride);
+    ocl_check(err, "Can't set format_rows arg", i-1);
+    err = clSetKernelArg(k, i++, sizeof(segment), &segment);
+    ocl_check(err, "Can't set format_rows arg", i-1);
+
+    // Waiting for the given event:
+    if(to_wait == NULL)
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 0, NULL, &format_rows_event);
+    else
+        err = clEnqueueNDRangeKernel(q, k, 1, NULL, gws, lws, 1, &to_wait, &format_rows_event);
+
+    ocl_check(err, "[FAIL] Can't enqueue format_rows kernel");
+    metricl_add(METRICL_KERNEL_LAUNCHES, 1);
+
+    return format_rows_event;
+}
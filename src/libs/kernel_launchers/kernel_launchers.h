@@ -10,25 +10,159 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
 #include "../ocl_wrapper/ocl_wrapper.h"
+#include "../metricl/metricl.h"
 
 #define NORMALIZE_KERNEL_NAME "normal"
+#define NORMALIZE_BOUNDS_KERNEL_NAME "normal_bounds"
+#define NORMALIZE_GROUPS_KERNEL_NAME "normal_groups"
+#define NORMALIZE_U8_KERNEL_NAME "normal_u8"
+#define NORMALIZE_U16_KERNEL_NAME "normal_u16"
+#define NORMALIZE_F16_KERNEL_NAME "normal_f16"
 #define MAX_MIN_FIND_KERNEL_NAME "max_min_find"
+#define GROUP_MAX_MIN_FIND_KERNEL_NAME "group_max_min_find"
 #define MAX_FIND_KERNEL_NAME "max_find"
 #define MIN_FIND_KERNEL_NAME "min_find"
+#define COUNT_ROWS_KERNEL_NAME "count_rows"
+#define SCAN_COUNTS_KERNEL_NAME "scan_counts"
+#define FIND_ROWS_KERNEL_NAME "find_rows"
+#define PARSE_FIELDS_KERNEL_NAME "parse_fields"
+#define FORMAT_LENGTHS_KERNEL_NAME "format_lengths"
+#define FORMAT_ROWS_KERNEL_NAME "format_rows"
+
+#define N_WORK_GROUPS 32
+#define N_WORK_ITEMS_PER_WORK_GROUP 512
+
+// Largest buffer of the 32 bits index kernels (global ids and strided indexes stay below 2^31):
+#define KERNEL_INDEX32_MAX ((cl_ulong) INT32_MAX - (1 << 24))
+
+#define KERNEL_BUILD_OPTIONS "-I."
+#define KERNEL_BUILD_OPTIONS_INDEX64 "-I. -D CSVL_INDEX64"
+
+// Added to the build options on the devices with double precision (see parse_value):
+#define KERNEL_BUILD_OPTIONS_FP64 " -D CSVL_FP64"
+
+// Specializations of the kernels (CSVL_UNROLL and CSVL_VECTOR_WIDTH override the defaults):
+#define KERNEL_UNROLL 4
+#define KERNEL_MAX_UNROLL 16
+#define KERNEL_VECTOR_WIDTH 4
+
+// NaN policies of normal, chosen by CSVL_NAN ("keep", "zero" or "none"):
+#define KERNEL_NAN_KEEP 0
+#define KERNEL_NAN_ZERO 1
+#define KERNEL_NAN_NONE 2
+
+// Binaries kept by kernel_program, one for each device, source file and build options:
+#define KERNEL_PROGRAM_CACHE_SIZE 32
+#define KERNEL_OPTIONS_SIZE 256
+
+/*
+    Compile-time specialization of the kernels (see kernels.ocl): local_size is the number
+    of WorkItems of the WorkGroups of the reductions (0 for any number), unroll the elements
+    read by each WorkItem per iteration of the reductions and vector_width the ones
+    normalized by each WorkItem of normal (1, 2, 4, 8 or 16)
+*/
+typedef struct {
+    int index64;
+    int fp64;
+    int local_size;
+    int unroll;
+    int vector_width;
+    int nan_policy;
+} kernel_variant;
+
+/*
+    This routine returns the variant of the kernels for the device d and buffers of at most
+    max_elements elements: the 32 bits index specialization when they fit in it, the 64 bits
+    one otherwise (or when the CSVL_INDEX64 environment variable is 1), specialized for the
+    launches of the host program (N_WORK_ITEMS_PER_WORK_GROUP WorkItems per WorkGroup) and
+    for CSVL_UNROLL, CSVL_VECTOR_WIDTH and CSVL_NAN, unless CSVL_KERNELS is "generic".
+*/
+kernel_variant kernel_variant_for(cl_device_id d, cl_ulong max_elements);
+
+/*
+    This routine writes the build options of the variant v to options, of the given size.
+*/
+void kernel_variant_options(const kernel_variant * v, char * options, size_t size);
+
+/*
+    This routine returns the program of the kernels of the given file built for the variant v
+    on the device d: the first time the source is compiled, and its binary kept in memory
+    (keyed by device, file and build options), so that the next contexts on the device
+    (e.g. the handles of the library) build the program from the binary instead.
+    The caller releases the program with clReleaseProgram.
+*/
+cl_program kernel_program(const char * pathname, cl_context c, cl_device_id d, const kernel_variant * v);
+
+/*
+    This routine returns the variant of the program of the kernel k, the generic one with
+    32 bits indexes for the programs not built by kernel_program.
+*/
+kernel_variant kernel_variant_of(cl_kernel k);
 
 cl_event launch_normalize(cl_kernel k, cl_command_queue q, cl_device_id d,
-                          cl_mem buffer_to_normalize, cl_int n_elements,
+                          cl_mem buffer_to_normalize, cl_ulong n_elements,
                           float max, float min);
 
+cl_event launch_normalize_quantized(cl_kernel k, cl_command_queue q, cl_device_id d, cl_event to_wait,
+                                    cl_mem output_buffer, cl_mem buffer_to_normalize, cl_ulong n_elements,
+                                    float max, float min);
+
+cl_event launch_normalize_bounds(cl_kernel k, cl_command_queue q, cl_device_id d, cl_event to_wait,
+                                 cl_mem buffer_to_normalize, cl_mem max_buffer, cl_mem min_buffer,
+                                 cl_ulong n_elements);
+
+cl_event launch_normalize_groups(cl_kernel k, cl_command_queue q, cl_device_id d, cl_event to_wait,
+                                 cl_mem buffer_to_normalize, cl_mem max_buffer, cl_mem min_buffer,
+                                 cl_mem group_buffer, cl_ulong n_elements);
+
 cl_event launch_max_min_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
-                             cl_mem output_buffer, cl_mem input_buffer, cl_int n_elements,
+                             cl_mem output_buffer, cl_mem input_buffer, cl_ulong n_elements,
                              cl_int n_work_items, cl_int n_work_groups);
 
+cl_event launch_group_max_min_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                                   cl_mem max_buffer, cl_mem min_buffer, cl_mem input_buffer,
+                                   cl_mem group_buffer, cl_ulong n_elements,
+                                   cl_int n_work_items, cl_int n_work_groups);
+
 cl_event launch_max_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
-                         cl_mem output_buffer, cl_mem input_buffer, cl_int n_elements,
+                         cl_mem output_buffer, cl_mem input_buffer, cl_ulong n_elements,
                          cl_int n_work_items, cl_int n_work_groups);
 
 cl_event launch_min_find(cl_kernel k, cl_command_queue q, cl_event to_wait,
-                         cl_mem output_buffer, cl_mem input_buffer, cl_int n_elements,
+                         cl_mem output_buffer, cl_mem input_buffer, cl_ulong n_elements,
                          cl_int n_work_items, cl_int n_work_groups);
+
+cl_event launch_count_rows(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                           cl_mem counts_buffer, cl_mem text_buffer, cl_ulong text_size, cl_ulong segment,
+                           cl_int n_work_items, cl_int n_work_groups);
+
+cl_event launch_scan_counts(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                            cl_mem counts_buffer, cl_uint n_counts, cl_int n_work_items);
+
+cl_event launch_find_rows(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                          cl_mem row_starts_buffer, cl_mem text_buffer, cl_mem counts_buffer,
+                          cl_ulong text_size, cl_ulong segment,
+                          cl_int n_work_items, cl_int n_work_groups);
+
+cl_event launch_parse_fields(cl_kernel k, cl_command_queue q, cl_device_id d, cl_event to_wait,
+                             cl_mem matrix_buffer, cl_mem text_buffer, cl_mem row_starts_buffer,
+                             cl_mem slots_buffer, cl_int n_slots, cl_ulong n_rows, cl_ulong stride);
+
+cl_event launch_format_lengths(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                               cl_mem lengths_buffer, cl_mem unformattable_buffer, cl_mem text_buffer,
+                               cl_mem row_starts_buffer, cl_mem matrix_buffer, cl_mem slots_buffer,
+                               cl_int n_slots, cl_int n_cols, cl_uint row_max_size,
+                               cl_ulong n_rows, cl_ulong stride, cl_ulong segment,
+                               cl_int n_work_items, cl_int n_work_groups);
+
+cl_event launch_format_rows(cl_kernel k, cl_command_queue q, cl_event to_wait,
+                            cl_mem output_buffer, cl_mem offsets_buffer, cl_mem text_buffer,
+                            cl_mem row_starts_buffer, cl_mem matrix_buffer, cl_mem slots_buffer,
+                            cl_int n_slots, cl_int n_cols, cl_uint row_max_size,
+                            cl_ulong n_rows, cl_ulong stride, cl_ulong segment,
+                            cl_int n_work_items, cl_int n_work_groups);
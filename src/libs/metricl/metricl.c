@@ -0,0 +1,239 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    metricl.c
+    C library for exporting the metrics of a run (counters, gauges and the
+    histograms of the stages) as a Prometheus text file or as JSON
+*/
+
+#include "metricl.h"
+
+// Names and help of the counters, in the Prometheus text file and in JSON:
+static const char * counter_names[METRICL_N_COUNTERS] = {
+    "files", "rows", "values", "input_bytes", "device_bytes", "kernel_launches", "cache_hits", "cache_misses",
+    "program_builds", "program_cache_hits"
+};
+static const char * counter_helps[METRICL_N_COUNTERS] = {
+    "Files normalized.",
+    "Rows normalized.",
+    "Values normalized.",
+    "Bytes of the input files.",
+    "Bytes copied between host and device.",
+    "Kernels launched.",
+    "Files whose columns were read from the columnar cache.",
+    "Files parsed without the columnar cache.",
+    "Programs of the kernels compiled.",
+    "Programs of the kernels taken from the in-memory cache."
+};
+
+static uint64_t counters[METRICL_N_COUNTERS] = { 0 };
+
+// Device memory allocated by the tracked buffers, and its peak:
+static uint64_t device_allocated = 0, device_peak = 0;
+
+static int started = 0;
+static char * metrics_pathname = NULL;
+static void (* collect_metrics)() = NULL;
+
+// Periodic writes:
+static double write_interval_s = 0;
+static int stopping = 0;
+static pthread_t writer_thread;
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_cond = PTHREAD_COND_INITIALIZER;
+
+void metricl_add(const int counter, const uint64_t value)
+{
+    if(counter >= 0 && counter < METRICL_N_COUNTERS) __atomic_fetch_add(&counters[counter], value, __ATOMIC_RELAXED);
+}
+
+void metricl_set(const int counter, const uint64_t value)
+{
+    if(counter >= 0 && counter < METRICL_N_COUNTERS) __atomic_store_n(&counters[counter], value, __ATOMIC_RELAXED);
+}
+
+uint64_t metricl_value(const int counter)
+{
+    if(counter < 0 || counter >= METRICL_N_COUNTERS) return 0;
+    return __atomic_load_n(&counters[counter], __ATOMIC_RELAXED);
+}
+
+static void CL_CALLBACK release_buffer(cl_mem buffer, void * size)
+{
+    // Only the size given with the callback is needed:
+    (void) buffer;
+    __atomic_fetch_sub(&device_allocated, (uint64_t) (uintptr_t) size, __ATOMIC_RELAXED);
+}
+
+void metricl_track_buffer(cl_mem buffer)
+{
+    size_t size;
+    if(!started || buffer == NULL) return;
+    if(clGetMemObjectInfo(buffer, CL_MEM_SIZE, sizeof(size), &size, NULL) != CL_SUCCESS) return;
+    if(clSetMemObjectDestructorCallback(buffer, release_buffer, (void *) (uintptr_t) size) != CL_SUCCESS) return;
+
+    const uint64_t allocated = __atomic_add_fetch(&device_allocated, size, __ATOMIC_RELAXED);
+    uint64_t peak = __atomic_load_n(&device_peak, __ATOMIC_RELAXED);
+    while(allocated > peak && !__atomic_compare_exchange_n(&device_peak, &peak, allocated, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+static uint64_t peak_rss_bytes()
+{
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return (uint64_t) usage.ru_maxrss * 1024;
+#endif
+}
+
+static void write_prometheus(FILE * fd)
+{
+    for(int c = 0; c < METRICL_N_COUNTERS; ++c){
+        fprintf(fd, "# HELP " METRICL_PREFIX "%s_total %s\n", counter_names[c], counter_helps[c]);
+        fprintf(fd, "# TYPE " METRICL_PREFIX "%s_total counter\n", counter_names[c]);
+        fprintf(fd, METRICL_PREFIX "%s_total %llu\n", counter_names[c], (unsigned long long) metricl_value(c));
+    }
+
+    fprintf(fd, "# HELP " METRICL_PREFIX "peak_rss_bytes Peak resident memory of the process.\n");
+    fprintf(fd, "# TYPE " METRICL_PREFIX "peak_rss_bytes gauge\n");
+    fprintf(fd, METRICL_PREFIX "peak_rss_bytes %llu\n", (unsigned long long) peak_rss_bytes());
+    fprintf(fd, "# HELP " METRICL_PREFIX "peak_device_bytes Peak device memory allocated by the buffers of the run.\n");
+    fprintf(fd, "# TYPE " METRICL_PREFIX "peak_device_bytes gauge\n");
+    fprintf(fd, METRICL_PREFIX "peak_device_bytes %llu\n", (unsigned long long) __atomic_load_n(&device_peak, __ATOMIC_RELAXED));
+
+    // Prometheus buckets are cumulative, and in seconds:
+    fprintf(fd, "# HELP " METRICL_PREFIX "stage_duration_seconds Durations of the stages of the run.\n");
+    fprintf(fd, "# TYPE " METRICL_PREFIX "stage_duration_seconds histogram\n");
+    for(int s = 0; s < STAGEL_N_STAGES; ++s){
+        uint64_t count = 0;
+        for(int b = 0; b < STAGEL_N_BUCKETS; ++b){
+            count += stagel_count(s, b);
+            if(b < STAGEL_N_BUCKETS - 1){
+                fprintf(fd, METRICL_PREFIX "stage_duration_seconds_bucket{stage=\"%s\",le=\"%g\"} %llu\n",
+                        stagel_name(s), stagel_bucket_ms(b) * 1.0e-3, (unsigned long long) count);
+            }
+            else{
+                fprintf(fd, METRICL_PREFIX "stage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %llu\n",
+                        stagel_name(s), (unsigned long long) count);
+            }
+        }
+        fprintf(fd, METRICL_PREFIX "stage_duration_seconds_sum{stage=\"%s\"} %.9f\n", stagel_name(s), stagel_ms(s) * 1.0e-3);
+        fprintf(fd, METRICL_PREFIX "stage_duration_seconds_count{stage=\"%s\"} %llu\n", stagel_name(s), (unsigned long long) count);
+    }
+}
+
+static void write_json(FILE * fd)
+{
+    fprintf(fd, "{\n  \"counters\": {");
+    for(int c = 0; c < METRICL_N_COUNTERS; ++c){
+        fprintf(fd, "%s\"%s\": %llu", c == 0 ? "" : ", ", counter_names[c], (unsigned long long) metricl_value(c));
+    }
+    fprintf(fd, "},\n  \"gauges\": {\"peak_rss_bytes\": %llu, \"peak_device_bytes\": %llu},\n  \"stages\": {\n",
+            (unsigned long long) peak_rss_bytes(), (unsigned long long) __atomic_load_n(&device_peak, __ATOMIC_RELAXED));
+
+    // Buckets are the same as in stagel: not cumulative, and in milliseconds (null for the last one):
+    for(int s = 0; s < STAGEL_N_STAGES; ++s){
+        uint64_t count = 0;
+        fprintf(fd, "    \"%s\": {\"sum_ms\": %.6f, \"buckets\": [", stagel_name(s), stagel_ms(s));
+        for(int b = 0; b < STAGEL_N_BUCKETS; ++b){
+            count += stagel_count(s, b);
+            if(b < STAGEL_N_BUCKETS - 1) fprintf(fd, "{\"le_ms\": %g, \"count\": %llu}, ", stagel_bucket_ms(b), (unsigned long long) stagel_count(s, b));
+            else fprintf(fd, "{\"le_ms\": null, \"count\": %llu}", (unsigned long long) stagel_count(s, b));
+        }
+        fprintf(fd, "], \"count\": %llu}%s\n", (unsigned long long) count, s == STAGEL_N_STAGES - 1 ? "" : ",");
+    }
+    fprintf(fd, "  }\n}\n");
+}
+
+int metricl_write(const char * pathname)
+{
+    char * temp_pathname = malloc(strlen(pathname) + 8);
+    sprintf(temp_pathname, "%s.tmp", pathname);
+
+    FILE * fd = fopen(temp_pathname, "w");
+    if(fd == NULL){
+        fprintf(stderr, "[METRICL - FAIL] Can't write %s\n", temp_pathname);
+        free(temp_pathname);
+        return -1;
+    }
+
+    const size_t length = strlen(pathname);
+    if(length >= 5 && strcmp(pathname + length - 5, ".json") == 0) write_json(fd);
+    else write_prometheus(fd);
+
+    int result = fclose(fd) == 0 ? 0 : -1;
+    if(result == 0) result = rename(temp_pathname, pathname) == 0 ? 0 : -1;
+    if(result != 0){
+        fprintf(stderr, "[METRICL - FAIL] Can't write %s\n", pathname);
+        remove(temp_pathname);
+    }
+
+    free(temp_pathname);
+    return result;
+}
+
+static int collect_and_write()
+{
+    if(collect_metrics != NULL) collect_metrics();
+    return metricl_write(metrics_pathname);
+}
+
+static void * periodic_writes(void * arg)
+{
+    (void) arg;
+    pthread_mutex_lock(&writer_lock);
+    while(!stopping){
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += (time_t) write_interval_s;
+        deadline.tv_nsec += (long) ((write_interval_s - (time_t) write_interval_s) * 1.0e9);
+        if(deadline.tv_nsec >= 1000000000L){
+            deadline.tv_nsec -= 1000000000L;
+            ++deadline.tv_sec;
+        }
+
+        if(pthread_cond_timedwait(&writer_cond, &writer_lock, &deadline) != 0 && !stopping) collect_and_write();
+    }
+    pthread_mutex_unlock(&writer_lock);
+    return NULL;
+}
+
+int metricl_start(const char * pathname, const double interval_s, void (* collect)())
+{
+    metrics_pathname = strdup(pathname);
+    if(metrics_pathname == NULL) return -1;
+
+    collect_metrics = collect;
+    write_interval_s = interval_s;
+    started = 1;
+
+    if(interval_s > 0 && pthread_create(&writer_thread, NULL, periodic_writes, NULL) != 0){
+        fprintf(stderr, "[METRICL - FAIL] Can't start the periodic writes of %s\n", pathname);
+        write_interval_s = 0;
+    }
+    return 0;
+}
+
+int metricl_stop()
+{
+    if(!started) return 0;
+
+    if(write_interval_s > 0){
+        pthread_mutex_lock(&writer_lock);
+        stopping = 1;
+        pthread_cond_signal(&writer_cond);
+        pthread_mutex_unlock(&writer_lock);
+        pthread_join(writer_thread, NULL);
+    }
+
+    const int result = collect_and_write();
+    started = 0;
+    free(metrics_pathname);
+    metrics_pathname = NULL;
+    return result;
+}
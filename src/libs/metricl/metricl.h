@@ -0,0 +1,79 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    metricl.h
+    C library for exporting the metrics of a run (counters, gauges and the
+    histograms of the stages) as a Prometheus text file or as JSON
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/resource.h>
+
+#include "../ocl_wrapper/ocl_wrapper.h"
+#include "../stagel/stagel.h"
+
+// Counters of a run:
+#define METRICL_FILES 0
+#define METRICL_ROWS 1
+#define METRICL_VALUES 2
+#define METRICL_INPUT_BYTES 3
+#define METRICL_DEVICE_BYTES 4
+#define METRICL_KERNEL_LAUNCHES 5
+#define METRICL_CACHE_HITS 6
+#define METRICL_CACHE_MISSES 7
+#define METRICL_PROGRAM_BUILDS 8
+#define METRICL_PROGRAM_CACHE_HITS 9
+#define METRICL_N_COUNTERS 10
+
+// Prefix of the Prometheus metrics:
+#define METRICL_PREFIX "csvnorm_"
+
+/*
+    This routine adds value to a counter, with a single relaxed atomic
+    operation, so that it can be called on hot paths and by any thread.
+*/
+void metricl_add(const int counter, const uint64_t value);
+
+/*
+    This routine sets a counter kept elsewhere (e.g. the bytes copied by the run).
+*/
+void metricl_set(const int counter, const uint64_t value);
+
+/*
+    This routine returns the value of a counter.
+*/
+uint64_t metricl_value(const int counter);
+
+/*
+    This routine accounts a device buffer to the device memory allocated by the run, until
+    it is released, so that its peak can be exported. It does nothing until metricl_start.
+*/
+void metricl_track_buffer(cl_mem buffer);
+
+/*
+    This routine writes the metrics to the given pathname, as JSON if it ends with ".json"
+    and as a Prometheus text file otherwise. The file is written aside and renamed, so that
+    a collector never reads it half written.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int metricl_write(const char * pathname);
+
+/*
+    This routine starts exporting the metrics to the given pathname: collect (if not NULL)
+    is called before every write to set the counters kept elsewhere, and when interval_s
+    is positive the metrics are also written every interval_s seconds by a thread.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int metricl_start(const char * pathname, const double interval_s, void (* collect)());
+
+/*
+    This routine stops the periodic writes and writes the metrics a last time.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int metricl_stop();
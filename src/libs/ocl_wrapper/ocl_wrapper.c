@@ -27,6 +27,13 @@ cl_int fill_buff(char * buff_to_fill, const char * file_pathname){
     return 0;
 }
 
+__thread jmp_buf * ocl_recovery = NULL;
+
+void ocl_fail(void){
+    if(ocl_recovery != NULL) longjmp(* ocl_recovery, 1);
+    exit(1);
+}
+
 void ocl_check(cl_int err, const char *msg, ...){
     if (err != CL_SUCCESS){
         char msg_buf[BUFSIZE + 1];
@@ -36,7 +43,7 @@ void ocl_check(cl_int err, const char *msg, ...){
         va_end(ap);
         msg_buf[BUFSIZE] = '\0';
         fprintf(stderr, "%s - error %d\n", msg_buf, err);
-        exit(1);
+        ocl_fail();
     }
 }
 
@@ -73,8 +80,9 @@ cl_platform_id select_platform(){
     ocl_check(err, "[ERROR] Getting platform IDs");
 
     if (nump >= nplats){
-        fprintf(stderr, "[ERROR] No platform number %u", nump);
-        exit(1);
+        fprintf(stderr, "[ERROR] No platform number %u\n", nump);
+        free(plats);
+        ocl_fail();
     }
 
     cl_platform_id choice = plats[nump];
@@ -110,8 +118,9 @@ cl_device_id select_device(cl_platform_id p){
     ocl_check(err, "devices #2");
 
     if(numd >= ndevs){
-        fprintf(stderr, "[ERROR] No device number %u", numd);
-        exit(1);
+        fprintf(stderr, "[ERROR] No device number %u\n", numd);
+        free(devs);
+        ocl_fail();
     }
 
     cl_device_id choice = devs[numd];
@@ -125,6 +134,133 @@ cl_device_id select_device(cl_platform_id p){
     return choice;
 }
 
+cl_uint select_devices(cl_platform_id ** plats, cl_device_id ** devs){
+    printf("\n---------------- OpenCL Wrapper ------------------\n");
+
+    cl_uint nplats, ndevs, nselected = 0, capacity = 0;
+    cl_int err;
+    cl_platform_id * all_plats;
+    cl_device_id * plat_devs;
+
+    const char * const env = getenv("OCL_DEVICES");
+    const int use_all = (env == NULL || env[0] == '\0' || strcmp(env, "all") == 0);
+
+    err = clGetPlatformIDs(0, NULL, &nplats);
+    ocl_check(err, "[ERROR] Counting platforms");
+
+    all_plats = (cl_platform_id *) malloc(nplats * sizeof(*all_plats));
+    err = clGetPlatformIDs(nplats, all_plats, NULL);
+    ocl_check(err, "[ERROR] Getting platform IDs");
+
+    * plats = NULL;
+    * devs = NULL;
+
+    for(cl_uint p = 0; p < nplats; ++p){
+        err = clGetDeviceIDs(all_plats[p], CL_DEVICE_TYPE_ALL, 0, NULL, &ndevs);
+        if(err == CL_DEVICE_NOT_FOUND) continue;
+        ocl_check(err, "[ERROR] Counting devices of platform %u", p);
+
+        plat_devs = (cl_device_id *) malloc(ndevs * sizeof(*plat_devs));
+        err = clGetDeviceIDs(all_plats[p], CL_DEVICE_TYPE_ALL, ndevs, plat_devs, NULL);
+        ocl_check(err, "[ERROR] Getting device IDs of platform %u", p);
+
+        for(cl_uint d = 0; d < ndevs; ++d){
+            // Checking if this pair has been requested:
+            if(!use_all){
+                char pair[32];
+                const char * found = env;
+                const size_t pair_len = snprintf(pair, sizeof(pair), "%u:%u", p, d);
+                int requested = 0;
+
+                while((found = strstr(found, pair)) != NULL){
+                    const int starts = (found == env || found[-1] == ',');
+                    const int ends = (found[pair_len] == ',' || found[pair_len] == '\0');
+                    if(starts && ends){
+                        requested = 1;
+                        break;
+                    }
+                    found += pair_len;
+                }
+                if(!requested) continue;
+            }
+
+            // Skipping devices that can't be used right now:
+            cl_bool available = CL_FALSE;
+            err = clGetDeviceInfo(plat_devs[d], CL_DEVICE_AVAILABLE, sizeof(available), &available, NULL);
+            ocl_check(err, "[ERROR] Device availability");
+            if(!available) continue;
+
+            if(nselected == capacity){
+                capacity = capacity == 0 ? 4 : capacity * 2;
+                * plats = (cl_platform_id *) realloc(* plats, capacity * sizeof(**plats));
+                * devs = (cl_device_id *) realloc(* devs, capacity * sizeof(**devs));
+            }
+            (* plats)[nselected] = all_plats[p];
+            (* devs)[nselected] = plat_devs[d];
+            ++nselected;
+
+            char buffer[BUFSIZE];
+            err = clGetDeviceInfo(plat_devs[d], CL_DEVICE_NAME, BUFSIZE, buffer, NULL);
+            ocl_check(err, "[ERROR] Device name");
+
+            printf("[OK] Selected device:     %u:%u - %s\n", p, d, buffer);
+        }
+        free(plat_devs);
+    }
+    free(all_plats);
+
+    if(nselected == 0){
+        fprintf(stderr, "[ERROR] No usable device for OCL_DEVICES=%s\n", use_all ? "all" : env);
+        ocl_fail();
+    }
+    printf("[OK] Number of devices:   %u\n", nselected);
+
+    return nselected;
+}
+
+cl_uint device_speed_hint(cl_device_id d){
+    cl_int err;
+    cl_uint compute_units, clock_mhz;
+
+    err = clGetDeviceInfo(d, CL_DEVICE_MAX_COMPUTE_UNITS, sizeof(compute_units), &compute_units, NULL);
+    ocl_check(err, "[ERROR] Device compute units");
+    err = clGetDeviceInfo(d, CL_DEVICE_MAX_CLOCK_FREQUENCY, sizeof(clock_mhz), &clock_mhz, NULL);
+    ocl_check(err, "[ERROR] Device clock frequency");
+
+    if(clock_mhz == 0) clock_mhz = 1;
+    return compute_units * clock_mhz;
+}
+
+cl_bool device_unified_memory(cl_device_id d){
+    cl_int err;
+    cl_bool unified = CL_FALSE;
+    cl_device_type type;
+
+    err = clGetDeviceInfo(d, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, NULL);
+    ocl_check(err, "[ERROR] Device unified memory");
+    err = clGetDeviceInfo(d, CL_DEVICE_TYPE, sizeof(type), &type, NULL);
+    ocl_check(err, "[ERROR] Device type");
+
+    return (unified || (type & CL_DEVICE_TYPE_CPU)) ? CL_TRUE : CL_FALSE;
+}
+
+cl_bool device_fp64(cl_device_id d){
+    cl_int err;
+    size_t extensions_size;
+
+    err = clGetDeviceInfo(d, CL_DEVICE_EXTENSIONS, 0, NULL, &extensions_size);
+    ocl_check(err, "[ERROR] Device extensions size");
+
+    char * extensions = (char *) malloc(extensions_size + 1);
+    err = clGetDeviceInfo(d, CL_DEVICE_EXTENSIONS, extensions_size, extensions, NULL);
+    ocl_check(err, "[ERROR] Device extensions");
+    extensions[extensions_size] = '\0';
+
+    const cl_bool fp64 = strstr(extensions, "cl_khr_fp64") != NULL ? CL_TRUE : CL_FALSE;
+    free(extensions);
+    return fp64;
+}
+
 cl_context create_context(cl_platform_id p, cl_device_id d){
     cl_int err;
     cl_context_properties ctx_prop[] = {
@@ -146,27 +282,43 @@ cl_command_queue create_queue(cl_context ctx, cl_device_id d){
 }
 
 cl_program create_program(const char * const fname, cl_context ctx, cl_device_id dev){
+    return create_program_with_options(fname, ctx, dev, "-I.");
+}
+
+cl_program create_program_with_options(const char * const fname, cl_context ctx, cl_device_id dev, const char * options){
     cl_int err, errlog;
     cl_program prg;
 
-    char src_buf[BUFSIZE + 1];
     char *log_buf = NULL;
     size_t logsize;
-    const char* buf_ptr = src_buf;
     time_t now = time(NULL);
 
-    memset(src_buf, 0, BUFSIZE);
+    // The source buffer fits the whole file, whatever its size:
+    FILE * src_file = fopen(fname, "r");
+    if(src_file == NULL){
+        fprintf(stderr, "[ERROR] Can't open file %s\n", fname);
+        ocl_fail();
+    }
+    fseek(src_file, 0, SEEK_END);
+    const long src_size = ftell(src_file);
+    fclose(src_file);
+
+    char * src_buf = (char *) malloc(src_size + 1);
+    const char* buf_ptr = src_buf;
+
     err = fill_buff(src_buf, fname);
     if(err == -1){
-        fprintf(stderr, "[ERROR] Can't open file %s", fname);
-        exit(1);
+        fprintf(stderr, "[ERROR] Can't open file %s\n", fname);
+        free(src_buf);
+        ocl_fail();
     }
-    printf("\n[OK] Compiling kernels file: %s", fname);
+    printf("\n[OK] Compiling kernels file: %s (%s)", fname, options);
 
     prg = clCreateProgramWithSource(ctx, 1, &buf_ptr, NULL, &err);
     ocl_check(err, "[ERROR] Create program");
+    free(src_buf);
 
-    err = clBuildProgram(prg, 1, &dev, "-I.", NULL, NULL);
+    err = clBuildProgram(prg, 1, &dev, options, NULL, NULL);
     errlog = clGetProgramBuildInfo(prg, dev, CL_PROGRAM_BUILD_LOG,0, NULL, &logsize);
     ocl_check(errlog, "[ERROR] Get program build log size");
 
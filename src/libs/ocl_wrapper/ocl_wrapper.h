@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <setjmp.h>
 
 #define CL_TARGET_OPENCL_VERSION 120
 #define BUFSIZE 16384
@@ -32,9 +33,20 @@
 */
 cl_int fill_buff(char * buff_to_fill, const char * file_pathname);
 
+/*
+    Recovery point of the calling thread, NULL by default: when set, a failure jumps
+    back to it instead of exiting, so that a library returns an error to its caller
+*/
+extern __thread jmp_buf * ocl_recovery;
+
+/*
+    Fail the calling thread: back to its recovery point if set, exiting otherwise
+*/
+void ocl_fail(void);
+
 /*
     Check an OpenCL status, printing the messagge if it is an error
-    and exiting in case of failure
+    and failing (ocl_fail) in case of failure
 */
 void ocl_check(cl_int err, const char *msg, ...);
 
@@ -62,6 +74,31 @@ cl_platform_id select_platform();
 */
 cl_device_id select_device(cl_platform_id p);
 
+/*
+    Fill 'plats' and 'devs' with every available device of every platform, or only
+    with the platform:device pairs listed in the OCL_DEVICES environment variable
+    (e.g. "0:0,0:1,1:0", or "all" for every device).
+    Return the number of selected devices
+*/
+cl_uint select_devices(cl_platform_id ** plats, cl_device_id ** devs);
+
+/*
+    Rough throughput hint of a device (compute units x clock frequency),
+    used for weighting the work given to each device
+*/
+cl_uint device_speed_hint(cl_device_id d);
+
+/*
+    Return CL_TRUE if the device shares its memory with the host
+    (CPU and integrated devices), so that mapping a buffer does not copy it
+*/
+cl_bool device_unified_memory(cl_device_id d);
+
+/*
+    Return CL_TRUE if the device supports double precision (cl_khr_fp64)
+*/
+cl_bool device_fp64(cl_device_id d);
+
 /*
     Create a one-device context
 */
@@ -78,6 +115,12 @@ cl_command_queue create_queue(cl_context ctx, cl_device_id d);
 */
 cl_program create_program(const char * const fname, cl_context ctx, cl_device_id dev);
 
+/*
+    Compile the device part of the program as create_program does, with the
+    given build options (e.g. "-I. -D NAME" for a specialization of the kernels)
+*/
+cl_program create_program_with_options(const char * const fname, cl_context ctx, cl_device_id dev, const char * options);
+
 /*
     Runtime of an event, in nanoseconds.
     Note that if NS is the runtimen of an event in nanoseconds and NB is the number of
@@ -0,0 +1,303 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    scheduler.c
+    Multi-device scheduler that spreads the normalization work
+    over every selected OpenCL device using work-stealing queues
+*/
+
+#include "./scheduler.h"
+
+#define SCHED_MAX_MIN 0
+#define SCHED_NORMALIZE 1
+
+sched_t * sched_create(const char * kernels_pathname)
+{
+    cl_int err;
+    cl_platform_id * plats;
+    cl_device_id * devs;
+
+    sched_t * s = (sched_t *) malloc(sizeof(sched_t));
+    s->n_workers = select_devices(&plats, &devs);
+    s->workers = (sched_worker *) calloc(s->n_workers, sizeof(sched_worker));
+
+    const char * const env = getenv("OCL_CHUNK_ELEMENTS");
+    s->chunk_elements = SCHED_CHUNK_ELEMENTS;
+    if(env && env[0] != '\0' && atoi(env) > 0){
+        s->chunk_elements = atoi(env);
+    }
+
+    // Opening every device with its own context, queue and program:
+    for(int i = 0; i < s->n_workers; ++i){
+        sched_worker * w = &s->workers[i];
+
+        w->platform = plats[i];
+        w->device = devs[i];
+        w->context = create_context(w->platform, w->device);
+        w->queue = create_queue(w->context, w->device);
+        const kernel_variant variant = kernel_variant_for(w->device, s->chunk_elements);
+        w->program = kernel_program(kernels_pathname, w->context, w->device, &variant);
+        w->speed = device_speed_hint(w->device);
+
+        w->max_min_kernel = clCreateKernel(w->program, MAX_MIN_FIND_KERNEL_NAME, &err);
+        ocl_check(err, "[FAIL] Can't create the kernel %s", MAX_MIN_FIND_KERNEL_NAME);
+        w->normalize_kernel = clCreateKernel(w->program, NORMALIZE_KERNEL_NAME, &err);
+        ocl_check(err, "[FAIL] Can't create the kernel %s", NORMALIZE_KERNEL_NAME);
+
+        // Device buffers are reused by every task executed on this device:
+        w->device_buffer = clCreateBuffer(w->context, CL_MEM_READ_WRITE, s->chunk_elements * sizeof(float), NULL, &err);
+        ocl_check(err, "[FAIL] Can't create the device buffer - scheduler");
+        w->support_buffer = clCreateBuffer(w->context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY,
+                                           N_WORK_GROUPS * 2 * sizeof(float), NULL, &err);
+        ocl_check(err, "[FAIL] Can't create the support buffer - scheduler");
+        metricl_track_buffer(w->device_buffer);
+        metricl_track_buffer(w->support_buffer);
+
+        pthread_mutex_init(&w->lock, NULL);
+    }
+
+    free(plats);
+    free(devs);
+
+    return s;
+}
+
+static int pop_task(sched_worker * w)
+{
+    int task = -1;
+
+    pthread_mutex_lock(&w->lock);
+    if(w->head < w->tail){
+        task = w->deque[w->head++];
+    }
+    pthread_mutex_unlock(&w->lock);
+
+    return task;
+}
+
+static int steal_task(sched_t * s, sched_worker * thief)
+{
+    while(1){
+        // Choosing as victim the worker with the most remaining tasks:
+        sched_worker * victim = NULL;
+        int victim_remaining = 0;
+
+        for(int i = 0; i < s->n_workers; ++i){
+            sched_worker * w = &s->workers[i];
+            if(w == thief) continue;
+
+            pthread_mutex_lock(&w->lock);
+            const int remaining = w->tail - w->head;
+            pthread_mutex_unlock(&w->lock);
+
+            if(remaining > victim_remaining){
+                victim = w;
+                victim_remaining = remaining;
+            }
+        }
+        if(victim == NULL) return -1;
+
+        // Stealing from the tail, the victim may have emptied its deque meanwhile:
+        int task = -1;
+        pthread_mutex_lock(&victim->lock);
+        if(victim->head < victim->tail){
+            task = victim->deque[--victim->tail];
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if(task != -1) return task;
+    }
+}
+
+static void execute_task(sched_t * s, sched_worker * w, sched_task * t)
+{
+    cl_int err;
+    cl_event events[2];
+    float * chunk = s->columns[t->column].host_buffer + t->offset;
+    const size_t chunk_memsize = t->n_elements * sizeof(float);
+
+    // Uploading the chunk:
+    err = clEnqueueWriteBuffer(w->queue, w->device_buffer, CL_TRUE, 0, chunk_memsize, chunk, 0, NULL, NULL);
+    ocl_check(err, "[FAIL] Can't write the chunk to device - scheduler");
+    w->bytes_copied += chunk_memsize;
+
+    if(s->operation == SCHED_MAX_MIN){
+        float partial_max_min[2];
+
+        // Reducing the chunk to N_WORK_GROUPS * 2 elements and then to two elements:
+        events[0] = launch_max_min_find(w->max_min_kernel, w->queue, NULL,
+                                        w->support_buffer, w->device_buffer, t->n_elements,
+                                        N_WORK_ITEMS_PER_WORK_GROUP, N_WORK_GROUPS);
+        events[1] = launch_max_min_find(w->max_min_kernel, w->queue, events[0],
+                                        w->support_buffer, w->support_buffer, N_WORK_GROUPS * 2,
+                                        N_WORK_ITEMS_PER_WORK_GROUP, 1);
+
+        err = clEnqueueReadBuffer(w->queue, w->support_buffer, CL_TRUE, 0, sizeof(partial_max_min), partial_max_min, 1, events + 1, NULL);
+        ocl_check(err, "[FAIL] Can't read the partial max and min - scheduler");
+
+        t->max = partial_max_min[0];
+        t->min = partial_max_min[1];
+
+        clReleaseEvent(events[0]);
+        clReleaseEvent(events[1]);
+    }
+    else{
+        const sched_column * c = &s->columns[t->column];
+
+        events[0] = launch_normalize(w->normalize_kernel, w->queue, w->device, w->device_buffer, t->n_elements, c->max, c->min);
+
+        err = clEnqueueReadBuffer(w->queue, w->device_buffer, CL_TRUE, 0, chunk_memsize, chunk, 1, events, NULL);
+        ocl_check(err, "[FAIL] Can't read the normalized chunk - scheduler");
+        w->bytes_copied += chunk_memsize;
+
+        clReleaseEvent(events[0]);
+    }
+}
+
+static void * worker_main(void * arg)
+{
+    sched_worker * w = (sched_worker *) arg;
+    sched_t * s = w->owner;
+    int task;
+
+    // Draining the own deque first, then helping the slower devices:
+    while(1){
+        task = pop_task(w);
+        if(task == -1){
+            task = steal_task(s, w);
+            if(task == -1) break;
+            ++w->stolen_tasks;
+        }
+
+        execute_task(s, w, &s->tasks[task]);
+
+        ++w->executed_tasks;
+        w->executed_elements += s->tasks[task].n_elements;
+    }
+
+    return NULL;
+}
+
+static void sched_run(sched_t * s, sched_column * columns, int n_columns, int operation, int log)
+{
+    // Splitting every column in row-chunk tasks:
+    s->operation = operation;
+    s->columns = columns;
+    s->n_tasks = 0;
+    for(int c = 0; c < n_columns; ++c){
+        s->n_tasks += (columns[c].n_elements + s->chunk_elements - 1) / s->chunk_elements;
+    }
+    s->tasks = (sched_task *) malloc(s->n_tasks * sizeof(sched_task));
+
+    int t = 0;
+    for(int c = 0; c < n_columns; ++c){
+        for(size_t offset = 0; offset < columns[c].n_elements; offset += s->chunk_elements){
+            s->tasks[t].column = c;
+            s->tasks[t].offset = offset;
+            s->tasks[t].n_elements = columns[c].n_elements - offset > (size_t) s->chunk_elements ? (size_t) s->chunk_elements : columns[c].n_elements - offset;
+            ++t;
+        }
+    }
+
+    // Seeding the deques proportionally to the speed of each device:
+    unsigned long total_speed = 0;
+    for(int i = 0; i < s->n_workers; ++i) total_speed += s->workers[i].speed;
+
+    int next_task = 0;
+    unsigned long seeded_speed = 0;
+    for(int i = 0; i < s->n_workers; ++i){
+        sched_worker * w = &s->workers[i];
+        seeded_speed += w->speed;
+
+        const int last_task = (i == s->n_workers - 1) ? s->n_tasks : (int)((s->n_tasks * seeded_speed) / total_speed);
+
+        w->owner = s;
+        w->deque = (int *) malloc((s->n_tasks + 1) * sizeof(int));
+        w->head = 0;
+        w->tail = 0;
+        while(next_task < last_task){
+            w->deque[w->tail++] = next_task++;
+        }
+        w->executed_tasks = 0;
+        w->stolen_tasks = 0;
+        w->executed_elements = 0;
+    }
+
+    // One host thread for each device:
+    pthread_t * threads = (pthread_t *) malloc(s->n_workers * sizeof(pthread_t));
+    for(int i = 0; i < s->n_workers; ++i){
+        pthread_create(&threads[i], NULL, worker_main, &s->workers[i]);
+    }
+    for(int i = 0; i < s->n_workers; ++i){
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    if(log == 1){
+        for(int i = 0; i < s->n_workers; ++i){
+            sched_worker * w = &s->workers[i];
+            fprintf(stdout, "[LOG] Scheduler %s:  device %d, %d tasks (%d stolen), %ld elements\n",
+                    operation == SCHED_MAX_MIN ? "max & min" : "normalize", i, w->executed_tasks, w->stolen_tasks, w->executed_elements);
+        }
+    }
+
+    for(int i = 0; i < s->n_workers; ++i){
+        free(s->workers[i].deque);
+        s->workers[i].deque = NULL;
+    }
+}
+
+void sched_max_min(sched_t * s, sched_column * columns, int n_columns, int log)
+{
+    sched_run(s, columns, n_columns, SCHED_MAX_MIN, log);
+
+    // Merging the partial max and min of every chunk:
+    for(int c = 0; c < n_columns; ++c){
+        columns[c].max = -FLT_MAX;
+        columns[c].min = FLT_MAX;
+    }
+    for(int t = 0; t < s->n_tasks; ++t){
+        sched_column * c = &columns[s->tasks[t].column];
+        if(c->max < s->tasks[t].max) c->max = s->tasks[t].max;
+        if(c->min > s->tasks[t].min) c->min = s->tasks[t].min;
+    }
+
+    if(log == 1){
+        for(int c = 0; c < n_columns; ++c){
+            fprintf(stdout, "[LOG] Getting Max & Min: %zu elements || Max: %f Min: %f\n", columns[c].n_elements, columns[c].max, columns[c].min);
+        }
+    }
+
+    free(s->tasks);
+    s->tasks = NULL;
+}
+
+void sched_normalize(sched_t * s, sched_column * columns, int n_columns, int log)
+{
+    sched_run(s, columns, n_columns, SCHED_NORMALIZE, log);
+
+    free(s->tasks);
+    s->tasks = NULL;
+}
+
+void sched_release(sched_t * s)
+{
+    for(int i = 0; i < s->n_workers; ++i){
+        sched_worker * w = &s->workers[i];
+
+        clReleaseMemObject(w->device_buffer);
+        clReleaseMemObject(w->support_buffer);
+        clReleaseKernel(w->max_min_kernel);
+        clReleaseKernel(w->normalize_kernel);
+        clReleaseProgram(w->program);
+        clReleaseCommandQueue(w->queue);
+        clReleaseContext(w->context);
+        pthread_mutex_destroy(&w->lock);
+    }
+
+    free(s->workers);
+    free(s);
+}
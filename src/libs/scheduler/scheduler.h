@@ -0,0 +1,109 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    scheduler.h
+    Multi-device scheduler that spreads the normalization work
+    over every selected OpenCL device using work-stealing queues
+*/
+
+#pragma once
+
+#include <pthread.h>
+#include <float.h>
+
+#include "../kernel_launchers/kernel_launchers.h"
+
+// Default number of elements of a row-chunk task (overridable with OCL_CHUNK_ELEMENTS):
+#define SCHED_CHUNK_ELEMENTS (1 << 20)
+
+/*
+    A column to process: the host buffer is normalized in place,
+    max and min are filled by sched_max_min
+*/
+typedef struct {
+    float * host_buffer;
+    size_t n_elements;
+    float max;
+    float min;
+} sched_column;
+
+/*
+    A unit of work: a chunk of rows of one column
+*/
+typedef struct {
+    int column;
+    size_t offset;
+    int n_elements;
+    float max;
+    float min;
+} sched_task;
+
+typedef struct sched_s sched_t;
+
+/*
+    One OpenCL device with its own context, queue, program and task deque
+*/
+typedef struct {
+    sched_t * owner;
+    cl_platform_id platform;
+    cl_device_id device;
+    cl_context context;
+    cl_command_queue queue;
+    cl_program program;
+    cl_kernel max_min_kernel;
+    cl_kernel normalize_kernel;
+    cl_mem device_buffer;
+    cl_mem support_buffer;
+    cl_uint speed;
+
+    // Deque of task indexes, the owner pops from the head and thieves steal from the tail:
+    int * deque;
+    int head;
+    int tail;
+    pthread_mutex_t lock;
+
+    // Statistics of the last run:
+    int executed_tasks;
+    int stolen_tasks;
+    long executed_elements;
+
+    // Bytes copied between host and device since the creation of the scheduler:
+    size_t bytes_copied;
+} sched_worker;
+
+struct sched_s {
+    int n_workers;
+    sched_worker * workers;
+    int chunk_elements;
+
+    // State of the current run:
+    int operation;
+    sched_column * columns;
+    sched_task * tasks;
+    int n_tasks;
+};
+
+/*
+    Open a context, a queue and the kernels on every device selected
+    by OCL_DEVICES (every available device if not specified)
+*/
+sched_t * sched_create(const char * kernels_pathname);
+
+/*
+    Find max and min of every given column; the partial results of each
+    row-chunk are merged across the devices
+*/
+void sched_max_min(sched_t * s, sched_column * columns, int n_columns, int log);
+
+/*
+    Normalize in place every given column using its max and min
+*/
+void sched_normalize(sched_t * s, sched_column * columns, int n_columns, int log);
+
+/*
+    Release every OpenCL resource owned by the scheduler
+*/
+void sched_release(sched_t * s);
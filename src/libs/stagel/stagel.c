@@ -0,0 +1,81 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    stagel.c
+    C library for accounting the time spent by a run in each of its
+    stages, from the parsing of the CSV file to the writing of the output
+*/
+
+#include "stagel.h"
+
+static const char * stage_names[STAGEL_N_STAGES] = {
+    "parse", "h2d", "reduce", "normalize", "d2h", "format", "write"
+};
+
+static double stage_ms[STAGEL_N_STAGES] = { 0 };
+
+static const double bucket_ms[STAGEL_N_BUCKETS - 1] = {
+    0.1, 0.5, 1, 5, 10, 50, 100, 500, 1000, 5000, 10000
+};
+static uint64_t bucket_counts[STAGEL_N_STAGES][STAGEL_N_BUCKETS] = { { 0 } };
+
+const char * stagel_name(const int stage)
+{
+    if(stage < 0 || stage >= STAGEL_N_STAGES) return NULL;
+    return stage_names[stage];
+}
+
+void stagel_add(const int stage, const double ms)
+{
+    if(stage < 0 || stage >= STAGEL_N_STAGES) return;
+    stage_ms[stage] += ms;
+
+    int b = 0;
+    while(b < STAGEL_N_BUCKETS - 1 && ms > bucket_ms[b]) ++b;
+    ++bucket_counts[stage][b];
+}
+
+void stagel_add_since(const int stage, const struct timespec start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    stagel_add(stage, (end.tv_sec - start.tv_sec) * 1.0e3 + (end.tv_nsec - start.tv_nsec) * 1.0e-6);
+}
+
+double stagel_ms(const int stage)
+{
+    if(stage < 0 || stage >= STAGEL_N_STAGES) return 0;
+    return stage_ms[stage];
+}
+
+double stagel_bucket_ms(const int bucket)
+{
+    if(bucket < 0 || bucket >= STAGEL_N_BUCKETS) return NAN;
+    return bucket < STAGEL_N_BUCKETS - 1 ? bucket_ms[bucket] : INFINITY;
+}
+
+uint64_t stagel_count(const int stage, const int bucket)
+{
+    if(stage < 0 || stage >= STAGEL_N_STAGES || bucket < 0 || bucket >= STAGEL_N_BUCKETS) return 0;
+    return bucket_counts[stage][bucket];
+}
+
+int stagel_write(const char * pathname, const double total_ms)
+{
+    FILE * fd = fopen(pathname, "w");
+    if(fd == NULL){
+        fprintf(stderr, "[STAGEL - FAIL] Can't write %s\n", pathname);
+        return -1;
+    }
+
+    fprintf(fd, "{");
+    for(int s = 0; s < STAGEL_N_STAGES; ++s){
+        fprintf(fd, "\"%s\": %.6f, ", stage_names[s], stage_ms[s]);
+    }
+    fprintf(fd, "\"total\": %.6f}\n", total_ms);
+
+    return fclose(fd) == 0 ? 0 : -1;
+}
@@ -0,0 +1,71 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    stagel.h
+    C library for accounting the time spent by a run in each of its
+    stages, from the parsing of the CSV file to the writing of the output
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+// Stages of a normalization:
+#define STAGEL_PARSE 0
+#define STAGEL_H2D 1
+#define STAGEL_REDUCE 2
+#define STAGEL_NORMALIZE 3
+#define STAGEL_D2H 4
+#define STAGEL_FORMAT 5
+#define STAGEL_WRITE 6
+#define STAGEL_N_STAGES 7
+
+// Histogram of the durations added to each stage: bucket b counts the ones up to
+// stagel_bucket_ms(b) milliseconds, the last bucket every other one:
+#define STAGEL_N_BUCKETS 12
+
+/*
+    This routine returns the name of a stage (e.g. "parse"), or NULL if it does not exist.
+*/
+const char * stagel_name(const int stage);
+
+/*
+    This routine adds ms milliseconds to the time spent in a stage.
+*/
+void stagel_add(const int stage, const double ms);
+
+/*
+    This routine adds to the time spent in a stage the milliseconds elapsed since start
+    (taken with clock_gettime on CLOCK_MONOTONIC).
+*/
+void stagel_add_since(const int stage, const struct timespec start);
+
+/*
+    This routine returns the milliseconds spent in a stage so far.
+*/
+double stagel_ms(const int stage);
+
+/*
+    This routine returns the upper bound in milliseconds of a bucket of the histograms
+    (INFINITY for the last one).
+*/
+double stagel_bucket_ms(const int bucket);
+
+/*
+    This routine returns how many durations added to a stage so far fall in a bucket
+    (not cumulative: each duration is counted only in the first bucket it fits in).
+*/
+uint64_t stagel_count(const int stage, const int bucket);
+
+/*
+    This routine writes to the given pathname the milliseconds spent in each stage and
+    the total wall time of the run, as a JSON object: {"parse": 12.5, ..., "total": 40.1}.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int stagel_write(const char * pathname, const double total_ms);
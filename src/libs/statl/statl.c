@@ -0,0 +1,229 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    statl.c
+    C library for storing the per-column statistics of a normalization
+    (max, min, rows) and the state of the incremental runs
+*/
+
+#include "./statl.h"
+
+/*
+    Header of each segment of a raw copy file: it is followed
+    by n_columns float arrays of n_rows elements
+*/
+typedef struct {
+    char magic[8];
+    uint64_t n_columns;
+    uint64_t n_rows;
+} statl_raw_segment;
+
+statl_stats * statl_create(const int * columns, const int n_columns)
+{
+    statl_stats * stats = (statl_stats *) calloc(1, sizeof(statl_stats));
+    memcpy(stats->header.magic, STATL_MAGIC, sizeof(stats->header.magic));
+    stats->header.n_columns = n_columns;
+    stats->columns = (statl_column *) calloc(n_columns, sizeof(statl_column));
+
+    for(int i = 0; i < n_columns; ++i){
+        stats->columns[i].column = columns[i];
+        stats->columns[i].max = -FLT_MAX;
+        stats->columns[i].min = FLT_MAX;
+    }
+
+    return stats;
+}
+
+statl_stats * statl_load(const char * pathname)
+{
+    FILE * stats_fd = fopen(pathname, "rb");
+    if(stats_fd == NULL) return NULL;
+
+    statl_stats * stats = (statl_stats *) calloc(1, sizeof(statl_stats));
+
+    // Reading and checking the header:
+    if(fread(&stats->header, sizeof(statl_header), 1, stats_fd) != 1 ||
+       memcmp(stats->header.magic, STATL_MAGIC, sizeof(stats->header.magic)) != 0 ||
+       stats->header.n_columns == 0 || stats->header.n_columns > (1 << 20)){
+        fprintf(stderr, "[STATL - FAIL] %s is not a statistics file\n", pathname);
+        fclose(stats_fd);
+        free(stats);
+        return NULL;
+    }
+
+    // Reading the columns:
+    stats->columns = (statl_column *) malloc(sizeof(statl_column) * stats->header.n_columns);
+    if(fread(stats->columns, sizeof(statl_column), stats->header.n_columns, stats_fd) != stats->header.n_columns){
+        fprintf(stderr, "[STATL - FAIL] %s is truncated\n", pathname);
+        fclose(stats_fd);
+        statl_free(stats);
+        return NULL;
+    }
+
+    fclose(stats_fd);
+    return stats;
+}
+
+int statl_save(const char * pathname, const statl_stats * stats)
+{
+    char * temp_path = (char *) malloc(strlen(pathname) + 5);
+    sprintf(temp_path, "%s.tmp", pathname);
+
+    FILE * stats_fd = fopen(temp_path, "wb");
+    if(stats_fd == NULL){
+        fprintf(stderr, "[STATL - FAIL] Can't create %s\n", temp_path);
+        free(temp_path);
+        return -1;
+    }
+
+    int result = 0;
+    if(fwrite(&stats->header, sizeof(statl_header), 1, stats_fd) != 1) result = -1;
+    if(fwrite(stats->columns, sizeof(statl_column), stats->header.n_columns, stats_fd) != stats->header.n_columns) result = -1;
+    if(fclose(stats_fd) != 0) result = -1;
+
+    // Replacing the previous file only once the new one is complete:
+    if(result == 0 && rename(temp_path, pathname) != 0) result = -1;
+    if(result != 0){
+        fprintf(stderr, "[STATL - FAIL] Can't write %s\n", pathname);
+        remove(temp_path);
+    }
+
+    free(temp_path);
+    return result;
+}
+
+void statl_free(statl_stats * stats)
+{
+    free(stats->columns);
+    free(stats);
+}
+
+int statl_find(const statl_stats * stats, const int column)
+{
+    for(uint64_t i = 0; i < stats->header.n_columns; ++i){
+        if(stats->columns[i].column == column) return (int) i;
+    }
+    return -1;
+}
+
+int statl_same_columns(const statl_stats * stats, const int * columns, const int n_columns)
+{
+    if(stats->header.n_columns != (uint64_t) n_columns) return 0;
+
+    for(int i = 0; i < n_columns; ++i){
+        if(stats->columns[i].column != columns[i]) return 0;
+    }
+    return 1;
+}
+
+int statl_update(statl_column * column, const float max, const float min, const int64_t count)
+{
+    int changed = 0;
+
+    if(count <= 0) return 0;
+    if(column->max < max){
+        column->max = max;
+        changed = 1;
+    }
+    if(column->min > min){
+        column->min = min;
+        changed = 1;
+    }
+    column->count += count;
+
+    return changed;
+}
+
+int statl_merge(statl_stats * stats, const statl_stats * other)
+{
+    if(stats->header.n_columns != other->header.n_columns){
+        fprintf(stderr, "[STATL - FAIL] Can't merge statistics of %llu and %llu columns\n",
+                (unsigned long long) stats->header.n_columns, (unsigned long long) other->header.n_columns);
+        return -1;
+    }
+
+    for(uint64_t i = 0; i < stats->header.n_columns; ++i){
+        if(stats->columns[i].column != other->columns[i].column){
+            fprintf(stderr, "[STATL - FAIL] Can't merge statistics of column %d with column %d\n",
+                    stats->columns[i].column, other->columns[i].column);
+            return -1;
+        }
+        statl_update(&stats->columns[i], other->columns[i].max, other->columns[i].min, other->columns[i].count);
+    }
+    stats->header.source_rows += other->header.source_rows;
+
+    return 0;
+}
+
+int statl_raw_append(const char * pathname, float * const * buffers, const int n_columns, const size_t n_rows)
+{
+    FILE * raw_fd = fopen(pathname, "ab");
+    if(raw_fd == NULL){
+        fprintf(stderr, "[STATL - FAIL] Can't write %s\n", pathname);
+        return -1;
+    }
+
+    statl_raw_segment segment;
+    memcpy(segment.magic, STATL_RAW_MAGIC, sizeof(segment.magic));
+    segment.n_columns = n_columns;
+    segment.n_rows = n_rows;
+
+    int result = 0;
+    if(fwrite(&segment, sizeof(segment), 1, raw_fd) != 1) result = -1;
+    for(int i = 0; i < n_columns && result == 0; ++i){
+        if(fwrite(buffers[i], sizeof(float), n_rows, raw_fd) != n_rows) result = -1;
+    }
+    if(fclose(raw_fd) != 0) result = -1;
+
+    if(result != 0) fprintf(stderr, "[STATL - FAIL] Can't append to %s\n", pathname);
+    return result;
+}
+
+int64_t statl_raw_load(const char * pathname, float ** buffers, const int n_columns, const size_t extra_rows)
+{
+    FILE * raw_fd = fopen(pathname, "rb");
+    if(raw_fd == NULL){
+        fprintf(stderr, "[STATL - FAIL] Can't read %s\n", pathname);
+        return -1;
+    }
+
+    statl_raw_segment segment;
+    int64_t n_rows = 0;
+
+    // Counting the rows of every segment:
+    while(fread(&segment, sizeof(segment), 1, raw_fd) == 1){
+        if(memcmp(segment.magic, STATL_RAW_MAGIC, sizeof(segment.magic)) != 0 || segment.n_columns != (uint64_t) n_columns ||
+           fseek(raw_fd, segment.n_rows * n_columns * sizeof(float), SEEK_CUR) != 0){
+            fprintf(stderr, "[STATL - FAIL] %s is not a valid raw copy\n", pathname);
+            fclose(raw_fd);
+            return -1;
+        }
+        n_rows += segment.n_rows;
+    }
+
+    for(int i = 0; i < n_columns; ++i){
+        buffers[i] = (float *) malloc(sizeof(float) * (n_rows + extra_rows + 1));
+    }
+
+    // Gathering the segments of each column:
+    int64_t loaded = 0;
+    rewind(raw_fd);
+    while(fread(&segment, sizeof(segment), 1, raw_fd) == 1){
+        for(int i = 0; i < n_columns; ++i){
+            if(fread(buffers[i] + loaded, sizeof(float), segment.n_rows, raw_fd) != segment.n_rows){
+                fprintf(stderr, "[STATL - FAIL] %s is truncated\n", pathname);
+                for(int j = 0; j < n_columns; ++j) free(buffers[j]);
+                fclose(raw_fd);
+                return -1;
+            }
+        }
+        loaded += segment.n_rows;
+    }
+
+    fclose(raw_fd);
+    fprintf(stdout, "[STATL - OK] Correctly loaded %lld rows of %d columns from %s\n", (long long) loaded, n_columns, pathname);
+    return loaded;
+}
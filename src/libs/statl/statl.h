@@ -0,0 +1,115 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    statl.h
+    C library for storing the per-column statistics of a normalization
+    (max, min, rows) and the state of the incremental runs
+*/
+
+#pragma once
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <sys/stat.h>
+
+#define STATL_MAGIC "CSVLST01"
+#define STATL_RAW_MAGIC "CSVLSR01"
+
+#define STATL_STATE_SUFFIX ".csvls"
+#define STATL_RAW_SUFFIX ".csvlr"
+
+/*
+    Statistics of one column: an empty column has max -FLT_MAX and min FLT_MAX
+*/
+typedef struct {
+    int32_t column;
+    int32_t reserved;
+    int64_t count;
+    float max;
+    float min;
+} statl_column;
+
+/*
+    Fixed header of a statistics file, followed by n_columns statl_column.
+    The source fields describe the part of the CSV file already processed
+    by the incremental runs, and the normalized output written for it.
+*/
+typedef struct {
+    char magic[8];
+    uint64_t n_columns;
+    uint64_t source_offset;
+    uint64_t source_rows;
+    uint64_t output_size;
+    uint64_t reserved[3];
+} statl_header;
+
+typedef struct {
+    statl_header header;
+    statl_column * columns;
+} statl_stats;
+
+/*
+    This routine creates empty statistics for the given columns.
+*/
+statl_stats * statl_create(const int * columns, const int n_columns);
+
+/*
+    This routine reads a statistics file.
+    The routine returns NULL if the file does not exist or is not valid.
+*/
+statl_stats * statl_load(const char * pathname);
+
+/*
+    This routine writes the statistics to a temporary file and renames it,
+    so that the previous file is never left half written.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int statl_save(const char * pathname, const statl_stats * stats);
+
+/*
+    This routine frees the statistics.
+*/
+void statl_free(statl_stats * stats);
+
+/*
+    This routine returns the index of the statistics of the given column, -1 if missing.
+*/
+int statl_find(const statl_stats * stats, const int column);
+
+/*
+    This routine returns 1 if the statistics are about exactly the given columns, 0 instead.
+*/
+int statl_same_columns(const statl_stats * stats, const int * columns, const int n_columns);
+
+/*
+    This routine merges max, min and rows of a chunk into the statistics of a column.
+    The routine returns 1 if max or min changed, 0 instead.
+*/
+int statl_update(statl_column * column, const float max, const float min, const int64_t count);
+
+/*
+    This routine merges the statistics of another part of the same columns (e.g. another
+    shard of the file) into the given statistics: merging is associative and commutative.
+    The routine returns 0 if everything is OK, -1 if the columns do not match.
+*/
+int statl_merge(statl_stats * stats, const statl_stats * other);
+
+/*
+    This routine appends n_rows rows of the given columns to a raw copy file, as a
+    segment of n_columns float arrays, creating the file if needed.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int statl_raw_append(const char * pathname, float * const * buffers, const int n_columns, const size_t n_rows);
+
+/*
+    This routine loads every segment of a raw copy file: buffers[i] is allocated and
+    filled with the rows of column i, followed by room for extra_rows more rows.
+    The routine returns the number of loaded rows, or -1 if fails.
+*/
+int64_t statl_raw_load(const char * pathname, float ** buffers, const int n_columns, const size_t extra_rows);
@@ -0,0 +1,434 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    streaml.c
+    Low-latency normalization of the CSV rows read from a pipe, in
+    micro-batches, with fixed statistics or a sliding-window max and min
+*/
+
+#include "./streaml.h"
+
+/*
+    State of a streaming run: the current micro-batch, the bounds of its
+    elements (row-major, n_columns for each row) and the device buffers
+*/
+typedef struct {
+    const streaml_options * options;
+    csvl_stream * batch;
+    FILE * output_fd;
+
+    double * arrivals;
+    float * values;
+    float * maxs;
+    float * mins;
+
+    // Sliding windows:
+    streaml_deque * max_deques;
+    streaml_deque * min_deques;
+    int64_t next_index;
+
+    // OpenCL device, unused by the host backend:
+    cl_context context;
+    cl_command_queue queue;
+    cl_program program;
+    cl_kernel kernel;
+    cl_device_id device;
+    cl_mem values_buffer;
+    cl_mem maxs_buffer;
+    cl_mem mins_buffer;
+
+    // Statistics:
+    int64_t n_rows;
+    int64_t n_batches;
+    int64_t * latency_counts;
+    double max_latency;
+} streaml_state;
+
+static double streaml_now_us()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1.0e6 + now.tv_nsec * 1.0e-3;
+}
+
+static void streaml_deque_init(streaml_deque * deque, int window)
+{
+    deque->capacity = window + 1;
+    deque->indexes = (int64_t *) malloc(sizeof(int64_t) * deque->capacity);
+    deque->values = (float *) malloc(sizeof(float) * deque->capacity);
+    deque->head = 0;
+    deque->size = 0;
+}
+
+static void streaml_deque_free(streaml_deque * deque)
+{
+    free(deque->indexes);
+    free(deque->values);
+}
+
+// Pushes the value of row index and returns the max (is_max) or the min of the last window rows:
+static float streaml_deque_push(streaml_deque * deque, int64_t index, float value, int window, int is_max)
+{
+    // Dropping from the back the values that can no longer be the max (min):
+    while(deque->size > 0){
+        const int back = (deque->head + deque->size - 1) % deque->capacity;
+        if(is_max ? deque->values[back] > value : deque->values[back] < value) break;
+        --deque->size;
+    }
+
+    const int tail = (deque->head + deque->size) % deque->capacity;
+    deque->indexes[tail] = index;
+    deque->values[tail] = value;
+    ++deque->size;
+
+    // Dropping from the front the rows out of the window:
+    while(deque->indexes[deque->head] <= index - window){
+        deque->head = (deque->head + 1) % deque->capacity;
+        --deque->size;
+    }
+
+    return deque->values[deque->head];
+}
+
+static void streaml_open_device(streaml_state * s, const char * kernels_pathname)
+{
+    cl_int err;
+    const int n_columns = s->batch->n_columns;
+    const size_t memsize = (size_t) s->options->batch_rows * n_columns * sizeof(float);
+
+    // Wrapped OpenCL boilerplate:
+    cl_platform_id p = select_platform();
+    s->device = select_device(p);
+    s->context = create_context(p, s->device);
+    s->queue = create_queue(s->context, s->device);
+    const kernel_variant variant = kernel_variant_for(s->device, (cl_ulong) s->options->batch_rows * n_columns);
+    s->program = kernel_program(kernels_pathname, s->context, s->device, &variant);
+
+    s->kernel = clCreateKernel(s->program, NORMALIZE_BOUNDS_KERNEL_NAME, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel %s", NORMALIZE_BOUNDS_KERNEL_NAME);
+
+    // Buffers of a whole micro-batch, created once:
+    s->values_buffer = clCreateBuffer(s->context, CL_MEM_READ_WRITE, memsize, NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the values buffer - streaming");
+    s->maxs_buffer = clCreateBuffer(s->context, CL_MEM_READ_ONLY, memsize, NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the max buffer - streaming");
+    s->mins_buffer = clCreateBuffer(s->context, CL_MEM_READ_ONLY, memsize, NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the min buffer - streaming");
+    metricl_track_buffer(s->values_buffer);
+    metricl_track_buffer(s->maxs_buffer);
+    metricl_track_buffer(s->mins_buffer);
+
+    // Fixed statistics are the same for every micro-batch, so they are uploaded only once:
+    if(s->options->window == 0){
+        err = clEnqueueWriteBuffer(s->queue, s->maxs_buffer, CL_FALSE, 0, memsize, s->maxs, 0, NULL, NULL);
+        ocl_check(err, "[FAIL] Can't write the max buffer - streaming");
+        err = clEnqueueWriteBuffer(s->queue, s->mins_buffer, CL_TRUE, 0, memsize, s->mins, 0, NULL, NULL);
+        ocl_check(err, "[FAIL] Can't write the min buffer - streaming");
+    }
+}
+
+static void streaml_normalize_device(streaml_state * s, int n_elements)
+{
+    cl_int err;
+    cl_event write_event, normalize_event;
+    const size_t memsize = n_elements * sizeof(float);
+
+    if(s->options->window != 0){
+        err = clEnqueueWriteBuffer(s->queue, s->maxs_buffer, CL_FALSE, 0, memsize, s->maxs, 0, NULL, NULL);
+        ocl_check(err, "[FAIL] Can't write the max buffer - streaming");
+        err = clEnqueueWriteBuffer(s->queue, s->mins_buffer, CL_FALSE, 0, memsize, s->mins, 0, NULL, NULL);
+        ocl_check(err, "[FAIL] Can't write the min buffer - streaming");
+    }
+
+    // In-order queue: upload, normalize and read back the micro-batch with a single wait:
+    err = clEnqueueWriteBuffer(s->queue, s->values_buffer, CL_FALSE, 0, memsize, s->values, 0, NULL, &write_event);
+    ocl_check(err, "[FAIL] Can't write the values buffer - streaming");
+
+    normalize_event = launch_normalize_bounds(s->kernel, s->queue, s->device, write_event,
+                                              s->values_buffer, s->maxs_buffer, s->mins_buffer, n_elements);
+
+    err = clEnqueueReadBuffer(s->queue, s->values_buffer, CL_TRUE, 0, memsize, s->values, 1, &normalize_event, NULL);
+    ocl_check(err, "[FAIL] Can't read the normalized values - streaming");
+
+    clReleaseEvent(write_event);
+    clReleaseEvent(normalize_event);
+}
+
+static int streaml_flush(streaml_state * s)
+{
+    csvl_stream * batch = s->batch;
+    const int n_columns = batch->n_columns;
+    const int n_rows = batch->n_rows;
+
+    if(n_rows == 0) return 0;
+
+    // Packing the micro-batch row-major, with the bounds of the sliding windows:
+    for(int i = 0; i < n_rows; ++i){
+        for(int c = 0; c < n_columns; ++c){
+            const float value = batch->buffers[c][i];
+            s->values[i * n_columns + c] = value;
+
+            if(s->options->window != 0){
+                s->maxs[i * n_columns + c] = streaml_deque_push(&s->max_deques[c], s->next_index, value, s->options->window, 1);
+                s->mins[i * n_columns + c] = streaml_deque_push(&s->min_deques[c], s->next_index, value, s->options->window, 0);
+            }
+        }
+        ++s->next_index;
+    }
+
+    if(s->options->use_cpu){
+        for(int k = 0; k < n_rows * n_columns; ++k){
+            s->values[k] = s->maxs[k] > s->mins[k] ? (s->values[k] - s->mins[k]) / (s->maxs[k] - s->mins[k]) : 0.0f;
+        }
+    }
+    else{
+        streaml_normalize_device(s, n_rows * n_columns);
+    }
+
+    // Unpacking and writing the normalized rows:
+    for(int i = 0; i < n_rows; ++i){
+        for(int c = 0; c < n_columns; ++c){
+            batch->buffers[c][i] = s->values[i * n_columns + c];
+        }
+    }
+
+    if(csvl_stream_write(batch, s->output_fd, batch->buffers) == -1 || fflush(s->output_fd) != 0) return -1;
+
+    // Latency of each row, from its arrival to its normalized output:
+    const double now = streaml_now_us();
+    for(int i = 0; i < n_rows; ++i){
+        const double latency = now - s->arrivals[i];
+        int bucket = latency > 1 ? (int) ceil(log(latency) / log(STREAML_LATENCY_GROWTH)) : 0;
+        if(bucket >= STREAML_LATENCY_BUCKETS) bucket = STREAML_LATENCY_BUCKETS - 1;
+
+        ++s->latency_counts[bucket];
+        if(s->max_latency < latency) s->max_latency = latency;
+    }
+
+    s->n_rows += n_rows;
+    ++s->n_batches;
+    metricl_add(METRICL_ROWS, n_rows);
+    metricl_add(METRICL_VALUES, (uint64_t) n_rows * n_columns);
+    csvl_stream_clear(batch);
+    return 0;
+}
+
+// Latency of the given rank, as the upper bound of its bucket:
+static double streaml_latency(const streaml_state * s, int64_t rank)
+{
+    int64_t seen = 0;
+    for(int b = 0; b < STREAML_LATENCY_BUCKETS; ++b){
+        seen += s->latency_counts[b];
+        if(seen > rank){
+            const double latency = b > 0 ? pow(STREAML_LATENCY_GROWTH, b) : 1;
+            return latency < s->max_latency ? latency : s->max_latency;
+        }
+    }
+    return s->max_latency;
+}
+
+static void streaml_report(streaml_state * s, double elapsed_us)
+{
+    if(s->n_rows == 0){
+        fprintf(stderr, "[LOG] Streaming: no rows\n");
+        return;
+    }
+
+    fprintf(stderr, "[LOG] Streaming: %lld rows in %lld micro-batches (%.1f rows each), %.0f rows/s\n",
+            (long long) s->n_rows, (long long) s->n_batches, (double) s->n_rows / s->n_batches, s->n_rows / (elapsed_us * 1.0e-6));
+    fprintf(stderr, "[LOG] Row latency:       p50 %.1f us, p99 %.1f us, max %.1f us\n",
+            streaml_latency(s, (s->n_rows - 1) / 2), streaml_latency(s, (int64_t) ((s->n_rows - 1) * 0.99)), s->max_latency);
+}
+
+int streaml_run(int input_fd,
+                FILE * output_fd,
+                const int * columns,
+                const int n_columns,
+                const statl_stats * stats,
+                const streaml_options * options,
+                const char * kernels_pathname)
+{
+    size_t capacity = STREAML_READ_SIZE;
+    size_t filled = 0;
+    char * input = (char *) malloc(capacity + 2);
+    char temp_row[ROW_MAX_SIZE];
+    int eof = 0;
+    int result = 0;
+
+    streaml_state s;
+    memset(&s, 0, sizeof(s));
+    s.options = options;
+    s.output_fd = output_fd;
+
+    // Reading the row with the column names:
+    char * newline = NULL;
+    while(newline == NULL && !eof){
+        const ssize_t n = read(input_fd, input + filled, capacity - filled);
+        if(n <= 0) eof = 1;
+        else filled += n;
+        input[filled] = '\0';
+        newline = strchr(input, '\n');
+        if(newline == NULL && filled == capacity) eof = 1;
+    }
+    if(newline == NULL || newline - input + 1 >= ROW_MAX_SIZE){
+        fprintf(stderr, "[FAIL] The input has no valid first row\n");
+        free(input);
+        return -1;
+    }
+
+    memcpy(temp_row, input, newline - input + 1);
+    temp_row[newline - input + 1] = '\0';
+    filled -= newline - input + 1;
+    memmove(input, newline + 1, filled);
+
+    s.batch = csvl_stream_from_header(temp_row, columns, n_columns, options->batch_rows);
+    s.latency_counts = (int64_t *) calloc(STREAML_LATENCY_BUCKETS, sizeof(int64_t));
+    fprintf(output_fd, "%s", temp_row);
+    fflush(output_fd);
+
+    // Micro-batch buffers, the bounds are filled once with the fixed statistics:
+    const size_t n_elements = (size_t) options->batch_rows * n_columns;
+    s.arrivals = (double *) malloc(sizeof(double) * options->batch_rows);
+    s.values = (float *) malloc(sizeof(float) * n_elements);
+    s.maxs = (float *) malloc(sizeof(float) * n_elements);
+    s.mins = (float *) malloc(sizeof(float) * n_elements);
+
+    if(options->window == 0){
+        for(size_t k = 0; k < n_elements; ++k){
+            const statl_column * column = &stats->columns[statl_find(stats, columns[k % n_columns])];
+            s.maxs[k] = column->max;
+            s.mins[k] = column->min;
+        }
+    }
+    else{
+        s.max_deques = (streaml_deque *) malloc(sizeof(streaml_deque) * n_columns);
+        s.min_deques = (streaml_deque *) malloc(sizeof(streaml_deque) * n_columns);
+        for(int c = 0; c < n_columns; ++c){
+            streaml_deque_init(&s.max_deques[c], options->window);
+            streaml_deque_init(&s.min_deques[c], options->window);
+        }
+    }
+
+    if(!options->use_cpu) streaml_open_device(&s, kernels_pathname);
+
+    fprintf(stderr, "[LOG] START streaming normalization: %d columns, micro-batches of %d rows or %ld us, %s\n",
+            n_columns, options->batch_rows, options->batch_timeout_us,
+            options->window == 0 ? "fixed statistics" : "sliding window");
+
+    const double start = streaml_now_us();
+    double last_read = start;
+    double deadline = 0;
+
+    while(result == 0){
+        // Moving the complete rows of the input into the micro-batch:
+        size_t consumed = 0;
+        input[filled] = '\0';
+        while((newline = memchr(input + consumed, '\n', filled - consumed)) != NULL && result == 0){
+            const size_t row_size = newline - (input + consumed) + 1;
+
+            // Rows are parsed in a buffer of ROW_MAX_SIZE bytes, a longer one would be lost:
+            if(row_size >= ROW_MAX_SIZE){
+                fprintf(stderr, "[FAIL] A row of %zu bytes is longer than ROW_MAX_SIZE (%d)\n", row_size, ROW_MAX_SIZE);
+                result = -1;
+                break;
+            }
+
+            memcpy(temp_row, input + consumed, row_size);
+            temp_row[row_size] = '\0';
+
+            if(s.batch->n_rows == 0) deadline = last_read + options->batch_timeout_us;
+            s.arrivals[s.batch->n_rows] = last_read;
+            csvl_stream_push(s.batch, temp_row);
+
+            if(s.batch->n_rows == options->batch_rows) result = streaml_flush(&s);
+            consumed += row_size;
+        }
+        filled -= consumed;
+        memmove(input, input + consumed, filled);
+
+        if(eof || result != 0) break;
+
+        // Waiting for more input, but not beyond the deadline of the pending micro-batch:
+        fd_set input_set;
+        FD_ZERO(&input_set);
+        FD_SET(input_fd, &input_set);
+
+        struct timeval timeout, * wait = NULL;
+        if(s.batch->n_rows > 0){
+            const double remaining = deadline - streaml_now_us();
+            if(remaining <= 0){
+                result = streaml_flush(&s);
+                continue;
+            }
+            timeout.tv_sec = (long) remaining / 1000000;
+            timeout.tv_usec = (long) remaining % 1000000;
+            wait = &timeout;
+        }
+
+        const int ready = select(input_fd + 1, &input_set, NULL, NULL, wait);
+        if(ready == 0){
+            result = streaml_flush(&s);
+            continue;
+        }
+        if(ready < 0){
+            // Only a signal is waited out again:
+            if(errno == EINTR) continue;
+            fprintf(stderr, "[FAIL] Can't wait for the input: %s\n", strerror(errno));
+            result = -1;
+            break;
+        }
+
+        // Growing the input buffer for rows longer than the free space:
+        if(filled == capacity){
+            capacity *= 2;
+            input = (char *) realloc(input, capacity + 2);
+        }
+
+        const ssize_t n = read(input_fd, input + filled, capacity - filled);
+        last_read = streaml_now_us();
+        if(n <= 0){
+            // A last row without its '\n' is still a row:
+            eof = 1;
+            if(filled > 0){
+                input[filled++] = '\n';
+            }
+        }
+        else filled += n;
+    }
+
+    if(result == 0) result = streaml_flush(&s);
+    if(result != 0) fprintf(stderr, "[FAIL] Can't write the normalized rows\n");
+
+    streaml_report(&s, streaml_now_us() - start);
+
+    // Releasing everything:
+    if(!options->use_cpu){
+        clReleaseMemObject(s.values_buffer);
+        clReleaseMemObject(s.maxs_buffer);
+        clReleaseMemObject(s.mins_buffer);
+        clReleaseKernel(s.kernel);
+        clReleaseProgram(s.program);
+        clReleaseCommandQueue(s.queue);
+        clReleaseContext(s.context);
+    }
+    if(options->window != 0){
+        for(int c = 0; c < n_columns; ++c){
+            streaml_deque_free(&s.max_deques[c]);
+            streaml_deque_free(&s.min_deques[c]);
+        }
+        free(s.max_deques);
+        free(s.min_deques);
+    }
+    csvl_stream_close(s.batch);
+    free(s.arrivals);
+    free(s.values);
+    free(s.maxs);
+    free(s.mins);
+    free(s.latency_counts);
+    free(input);
+
+    return result;
+}
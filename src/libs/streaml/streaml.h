@@ -0,0 +1,72 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    streaml.h
+    Low-latency normalization of the CSV rows read from a pipe, in
+    micro-batches, with fixed statistics or a sliding-window max and min
+*/
+
+#pragma once
+
+#include <sys/select.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+
+#include "../csvl/csvl.h"
+#include "../statl/statl.h"
+#include "../kernel_launchers/kernel_launchers.h"
+
+// Default size and timeout of a micro-batch:
+#define STREAML_BATCH_ROWS 256
+#define STREAML_BATCH_TIMEOUT_US 100
+
+#define STREAML_READ_SIZE (64 * KB)
+
+// Latency histogram, in constant memory whatever the number of rows: bucket b > 0 counts
+// the latencies up to STREAML_LATENCY_GROWTH^b microseconds (1% apart, up to about 700 s):
+#define STREAML_LATENCY_BUCKETS 2048
+#define STREAML_LATENCY_GROWTH 1.01
+
+typedef struct {
+    int batch_rows;
+    long batch_timeout_us;
+
+    // Rows of the sliding window, 0 to normalize with the given statistics:
+    int window;
+
+    // 1 to normalize the micro-batches on the host instead of the OpenCL device:
+    int use_cpu;
+} streaml_options;
+
+/*
+    Monotonic deque of the sliding window of one column: the values from the
+    front to the back are decreasing (max deque) or increasing (min deque)
+*/
+typedef struct {
+    int64_t * indexes;
+    float * values;
+    int capacity;
+    int head;
+    int size;
+} streaml_deque;
+
+/*
+    This routine reads CSV rows from input_fd (the first one with the column names) until
+    the end of the input, and writes them to output_fd with the given columns normalized.
+    Rows are gathered in micro-batches, sent as soon as they have batch_rows rows or their
+    first row has been waiting for batch_timeout_us microseconds; every row is normalized
+    with the statistics of its column (stats) or with the max and min of the last
+    window rows, kept with monotonic deques. Latency percentiles are logged at the end.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int streaml_run(int input_fd,
+                FILE * output_fd,
+                const int * columns,
+                const int n_columns,
+                const statl_stats * stats,
+                const streaml_options * options,
+                const char * kernels_pathname);
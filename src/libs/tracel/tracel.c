@@ -0,0 +1,205 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    tracel.c
+    C library for tracing a run as a timeline of host spans and OpenCL commands,
+    written in the Chrome trace format (opened by Perfetto or chrome://tracing)
+*/
+
+#include "tracel.h"
+
+// A host span (only start and end are used) or an OpenCL command, in host nanoseconds:
+typedef struct {
+    char name[TRACEL_NAME_SIZE];
+    int tid;
+    cl_ulong queued, submit, start, end;
+} tracel_record;
+
+static int enabled = 0;
+static char * trace_pathname = NULL;
+static tracel_record * records = NULL;
+static size_t n_records = 0, records_size = 0;
+static pthread_mutex_t records_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Host time of the beginning of the trace, and offset from device to host timestamps:
+static cl_ulong origin_ns = 0;
+static int64_t device_offset_ns = 0;
+
+// Host threads are numbered in the order they trace their first span:
+static __thread int thread_id = 0;
+static int n_threads = 0;
+
+static cl_ulong timespec_ns(const struct timespec t)
+{
+    return (cl_ulong) t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static cl_ulong now_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespec_ns(now);
+}
+
+// Appending a record, the lock must be held:
+static tracel_record * new_record(const char * name, int tid)
+{
+    if(n_records == records_size){
+        const size_t size = records_size == 0 ? 1024 : records_size * 2;
+        tracel_record * bigger = (tracel_record *) realloc(records, sizeof(tracel_record) * size);
+        if(bigger == NULL) return NULL;
+        records = bigger;
+        records_size = size;
+    }
+
+    tracel_record * record = &records[n_records++];
+    snprintf(record->name, TRACEL_NAME_SIZE, "%s", name);
+    record->tid = tid;
+    return record;
+}
+
+int tracel_open(const char * pathname)
+{
+    trace_pathname = strdup(pathname);
+    if(trace_pathname == NULL) return -1;
+
+    origin_ns = now_ns();
+    enabled = 1;
+    return 0;
+}
+
+int tracel_enabled()
+{
+    return enabled;
+}
+
+void tracel_span(const char * name, const struct timespec start, const struct timespec end)
+{
+    if(!enabled) return;
+
+    pthread_mutex_lock(&records_lock);
+    if(thread_id == 0) thread_id = TRACEL_HOST_TID + n_threads++;
+
+    tracel_record * record = new_record(name, thread_id);
+    if(record != NULL){
+        record->start = timespec_ns(start);
+        record->end = timespec_ns(end);
+    }
+    pthread_mutex_unlock(&records_lock);
+}
+
+void tracel_span_since(const char * name, const struct timespec start)
+{
+    if(!enabled) return;
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    tracel_span(name, start, end);
+}
+
+void tracel_calibrate(cl_command_queue q)
+{
+    if(!enabled) return;
+
+    cl_event marker;
+    cl_ulong queued;
+
+    // The marker is queued on the device right when the host enqueues it:
+    const cl_ulong host_ns = now_ns();
+    cl_int err = clEnqueueMarkerWithWaitList(q, 0, NULL, &marker);
+    if(err != CL_SUCCESS) return;
+
+    err = clWaitForEvents(1, &marker);
+    if(err == CL_SUCCESS) err = clGetEventProfilingInfo(marker, CL_PROFILING_COMMAND_QUEUED, sizeof(queued), &queued, NULL);
+    if(err == CL_SUCCESS) device_offset_ns = (int64_t) (host_ns - queued);
+    clReleaseEvent(marker);
+}
+
+void tracel_event(const char * name, cl_event event)
+{
+    if(!enabled || event == NULL) return;
+
+    cl_ulong times[4];
+    const cl_profiling_info infos[4] = {
+        CL_PROFILING_COMMAND_QUEUED, CL_PROFILING_COMMAND_SUBMIT, CL_PROFILING_COMMAND_START, CL_PROFILING_COMMAND_END
+    };
+    for(int i = 0; i < 4; ++i){
+        if(clGetEventProfilingInfo(event, infos[i], sizeof(cl_ulong), &times[i], NULL) != CL_SUCCESS) return;
+        times[i] += device_offset_ns;
+    }
+
+    pthread_mutex_lock(&records_lock);
+    tracel_record * record = new_record(name, TRACEL_DEVICE_TID);
+    if(record != NULL){
+        record->queued = times[0];
+        record->submit = times[1];
+        record->start = times[2];
+        record->end = times[3];
+    }
+    pthread_mutex_unlock(&records_lock);
+}
+
+// Microseconds since the beginning of the trace (spans begun before it, e.g. at the start of the run, are negative):
+static double trace_us(cl_ulong ns)
+{
+    return ((int64_t) (ns - origin_ns)) * 1.0e-3;
+}
+
+int tracel_close()
+{
+    if(!enabled) return 0;
+    enabled = 0;
+
+    FILE * fd = fopen(trace_pathname, "w");
+    if(fd == NULL){
+        fprintf(stderr, "[TRACEL - FAIL] Can't write %s\n", trace_pathname);
+        return -1;
+    }
+
+    // Names of the process and of its threads:
+    fprintf(fd, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    fprintf(fd, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": \"main\"}},\n");
+    fprintf(fd, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"device\"}},\n", TRACEL_DEVICE_TID);
+    fprintf(fd, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"queue\"}}", TRACEL_QUEUE_TID);
+    for(int t = 0; t < n_threads; ++t){
+        fprintf(fd, ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"host %d\"}}",
+                TRACEL_HOST_TID + t, t);
+    }
+
+    for(size_t r = 0; r < n_records; ++r){
+        const tracel_record * record = &records[r];
+
+        // Host spans and executions of commands are complete events on their thread:
+        fprintf(fd, ",\n{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+                record->name, record->tid == TRACEL_DEVICE_TID ? "device" : "host", record->tid,
+                trace_us(record->start), (record->end - record->start) * 1.0e-3);
+        if(record->tid != TRACEL_DEVICE_TID){
+            fprintf(fd, "}");
+            continue;
+        }
+        fprintf(fd, ", \"args\": {\"queued_us\": %.3f, \"submit_us\": %.3f, \"wait_us\": %.3f}}",
+                trace_us(record->queued), trace_us(record->submit), (record->start - record->queued) * 1.0e-3);
+
+        // Waits in the queue are async events, since the ones of commands enqueued together overlap:
+        fprintf(fd, ",\n{\"name\": \"%s\", \"cat\": \"queue\", \"ph\": \"b\", \"id\": %zu, \"pid\": 1, \"tid\": %d, \"ts\": %.3f}",
+                record->name, r, TRACEL_QUEUE_TID, trace_us(record->queued));
+        fprintf(fd, ",\n{\"name\": \"submitted\", \"cat\": \"queue\", \"ph\": \"b\", \"id\": %zu, \"pid\": 1, \"tid\": %d, \"ts\": %.3f}",
+                r, TRACEL_QUEUE_TID, trace_us(record->submit));
+        fprintf(fd, ",\n{\"name\": \"submitted\", \"cat\": \"queue\", \"ph\": \"e\", \"id\": %zu, \"pid\": 1, \"tid\": %d, \"ts\": %.3f}",
+                r, TRACEL_QUEUE_TID, trace_us(record->start));
+        fprintf(fd, ",\n{\"name\": \"%s\", \"cat\": \"queue\", \"ph\": \"e\", \"id\": %zu, \"pid\": 1, \"tid\": %d, \"ts\": %.3f}",
+                record->name, r, TRACEL_QUEUE_TID, trace_us(record->start));
+    }
+    fprintf(fd, "\n]}\n");
+
+    free(records);
+    records = NULL;
+    n_records = records_size = 0;
+    free(trace_pathname);
+    trace_pathname = NULL;
+
+    return fclose(fd) == 0 ? 0 : -1;
+}
@@ -0,0 +1,71 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    tracel.h
+    C library for tracing a run as a timeline of host spans and OpenCL commands,
+    written in the Chrome trace format (opened by Perfetto or chrome://tracing)
+*/
+
+#pragma once
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include "../ocl_wrapper/ocl_wrapper.h"
+
+// Names longer than this are truncated:
+#define TRACEL_NAME_SIZE 32
+
+// Threads of the timeline (host threads are numbered from TRACEL_HOST_TID):
+#define TRACEL_DEVICE_TID 1
+#define TRACEL_QUEUE_TID 2
+#define TRACEL_HOST_TID 3
+
+/*
+    This routine starts tracing the run: spans and commands are kept in memory
+    until tracel_close writes them to the given pathname.
+    Until it is called every other routine returns at once, so tracing costs
+    nothing when disabled.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int tracel_open(const char * pathname);
+
+/*
+    This routine returns 1 if the run is traced, 0 instead.
+*/
+int tracel_enabled();
+
+/*
+    This routine adds to the timeline a host span from start to end
+    (taken with clock_gettime on CLOCK_MONOTONIC), on the thread that calls it.
+*/
+void tracel_span(const char * name, const struct timespec start, const struct timespec end);
+
+/*
+    This routine adds to the timeline a host span from start to now.
+*/
+void tracel_span_since(const char * name, const struct timespec start);
+
+/*
+    This routine maps the timestamps of the device of a queue onto the host clock:
+    a marker is enqueued and the time it was queued at on the device is paired with
+    the host time it was enqueued at. Without it device timestamps are taken as host ones.
+*/
+void tracel_calibrate(cl_command_queue q);
+
+/*
+    This routine adds to the timeline a completed OpenCL command (of a queue with
+    profiling enabled): its execution, from START to END, and its wait in the queue,
+    from QUEUED to SUBMIT and from SUBMIT to START.
+*/
+void tracel_event(const char * name, cl_event event);
+
+/*
+    This routine writes the timeline to the pathname given to tracel_open, as a Chrome
+    trace JSON object, and stops tracing.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int tracel_close();
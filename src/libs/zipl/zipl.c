@@ -0,0 +1,333 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    zipl.c
+    C library for reading and writing gzip and zstd compressed files as plain
+    text, with the (de)compression running on its own thread
+*/
+
+// F_SETPIPE_SZ:
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "zipl.h"
+
+int zipl_format(const char * pathname)
+{
+    unsigned char magic[4] = { 0 };
+
+    FILE * fd = fopen(pathname, "rb");
+    if(fd == NULL) return ZIPL_NONE;
+    const size_t n = fread(magic, 1, sizeof(magic), fd);
+    fclose(fd);
+
+    if(n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) return ZIPL_GZIP;
+    if(n == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) return ZIPL_ZSTD;
+    return ZIPL_NONE;
+}
+
+int zipl_format_of_name(const char * pathname)
+{
+    const size_t length = strlen(pathname);
+    if(length > 3 && strcmp(pathname + length - 3, ".gz") == 0) return ZIPL_GZIP;
+    if(length > 4 && strcmp(pathname + length - 4, ".zst") == 0) return ZIPL_ZSTD;
+    return ZIPL_NONE;
+}
+
+static int write_all(const int fd, const char * data, size_t size)
+{
+    while(size > 0){
+        const ssize_t n = write(fd, data, size);
+        if(n < 0 && errno == EINTR) continue;
+        if(n <= 0) return -1;
+        data += n;
+        size -= n;
+    }
+    return 0;
+}
+
+static ssize_t read_some(const int fd, char * data, const size_t size)
+{
+    ssize_t n;
+    do{
+        n = read(fd, data, size);
+    } while(n < 0 && errno == EINTR);
+    return n;
+}
+
+// A reader that stops before the end closes the pipe: the thread gets EPIPE instead of the signal:
+static void block_sigpipe()
+{
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+}
+
+static void * decompress_file(void * arg)
+{
+    zipl_file * z = (zipl_file *) arg;
+    int result = 0;
+
+    block_sigpipe();
+
+    if(z->format == ZIPL_GZIP){
+        char * out = (char *) malloc(ZIPL_BLOCK_SIZE);
+        int n = 0;
+
+        // gzread goes on through concatenated members, as gzip -d does:
+        gzFile gz = gzdopen(z->file_fd, "rb");
+        if(gz == NULL || out == NULL) result = -1;
+        else gzbuffer(gz, ZIPL_BLOCK_SIZE);
+
+        while(result == 0 && (n = gzread(gz, out, ZIPL_BLOCK_SIZE)) > 0) result = write_all(z->pipe_fd, out, n);
+        if(n < 0) result = -1;
+
+        // A truncated member is only seen by gzread as the end of the file:
+        int errnum = Z_OK;
+        if(result == 0 && gz != NULL) gzerror(gz, &errnum);
+        if(errnum != Z_OK && errnum != Z_STREAM_END) result = -1;
+
+        if(gz != NULL) gzclose(gz);
+        else close(z->file_fd);
+        free(out);
+    }
+    else{
+        // Given a whole frame, zstd flushes all of it before taking its last byte, so every input is drained:
+        const size_t out_size = ZSTD_DStreamOutSize() > ZIPL_BLOCK_SIZE ? ZSTD_DStreamOutSize() : ZIPL_BLOCK_SIZE;
+        char * in = (char *) malloc(ZIPL_BLOCK_SIZE);
+        char * out = (char *) malloc(out_size);
+        ZSTD_DCtx * dctx = ZSTD_createDCtx();
+        size_t last = 0;
+        ssize_t n_in = 0;
+
+        if(in == NULL || out == NULL || dctx == NULL) result = -1;
+        while(result == 0 && (n_in = read_some(z->file_fd, in, ZIPL_BLOCK_SIZE)) > 0){
+            ZSTD_inBuffer input = { in, (size_t) n_in, 0 };
+            while(result == 0 && input.pos < input.size){
+                ZSTD_outBuffer output = { out, out_size, 0 };
+                last = ZSTD_decompressStream(dctx, &output, &input);
+                if(ZSTD_isError(last)) result = -1;
+                else result = write_all(z->pipe_fd, out, output.pos);
+            }
+        }
+
+        // Not 0 at the end of the input, when the last frame is truncated:
+        if(n_in < 0 || last != 0) result = -1;
+
+        ZSTD_freeDCtx(dctx);
+        close(z->file_fd);
+        free(in);
+        free(out);
+    }
+
+    // End of the file for the reader:
+    close(z->pipe_fd);
+    z->result = result;
+    return NULL;
+}
+
+static void * compress_file(void * arg)
+{
+    zipl_file * z = (zipl_file *) arg;
+    int result = 0;
+    ssize_t n;
+    char * in = (char *) malloc(ZIPL_BLOCK_SIZE);
+    if(in == NULL) result = -1;
+
+    if(z->format == ZIPL_GZIP){
+        char mode[8];
+        sprintf(mode, "wb%d", ZIPL_GZIP_LEVEL);
+        gzFile gz = gzdopen(z->file_fd, mode);
+        if(gz == NULL) result = -1;
+        else gzbuffer(gz, ZIPL_BLOCK_SIZE);
+
+        // After a failure the pipe is still drained, so that the writer never waits on a full one:
+        while((n = read_some(z->pipe_fd, in, in != NULL ? ZIPL_BLOCK_SIZE : 0)) > 0){
+            if(result == 0 && gzwrite(gz, in, (unsigned) n) != n) result = -1;
+        }
+        if(n < 0) result = -1;
+
+        if(gz != NULL){
+            if(gzclose(gz) != Z_OK) result = -1;
+        }
+        else close(z->file_fd);
+    }
+    else{
+        const size_t out_size = ZSTD_CStreamOutSize();
+        char * out = (char *) malloc(out_size);
+        ZSTD_CCtx * cctx = ZSTD_createCCtx();
+        if(out == NULL || cctx == NULL) result = -1;
+
+        // Workers compress the blocks of the frame while this thread reads the next ones:
+        const char * const env = getenv("CSVL_ZSTD_THREADS");
+        const int n_workers = env != NULL ? atoi(env) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+        if(result == 0){
+            ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, ZIPL_ZSTD_LEVEL);
+            if(n_workers > 1) ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, n_workers);
+        }
+
+        while((n = read_some(z->pipe_fd, in, in != NULL ? ZIPL_BLOCK_SIZE : 0)) > 0){
+            ZSTD_inBuffer input = { in, (size_t) n, 0 };
+            while(result == 0 && input.pos < input.size){
+                ZSTD_outBuffer output = { out, out_size, 0 };
+                const size_t code = ZSTD_compressStream2(cctx, &output, &input, ZSTD_e_continue);
+                if(ZSTD_isError(code)) result = -1;
+                else result = write_all(z->file_fd, out, output.pos);
+            }
+        }
+        if(n < 0) result = -1;
+
+        // Flushing the workers and closing the frame:
+        size_t remaining = 1;
+        while(result == 0 && remaining != 0){
+            ZSTD_inBuffer input = { NULL, 0, 0 };
+            ZSTD_outBuffer output = { out, out_size, 0 };
+            remaining = ZSTD_compressStream2(cctx, &output, &input, ZSTD_e_end);
+            if(ZSTD_isError(remaining)) result = -1;
+            else result = write_all(z->file_fd, out, output.pos);
+        }
+
+        if(close(z->file_fd) != 0) result = -1;
+        ZSTD_freeCCtx(cctx);
+        free(out);
+    }
+
+    close(z->pipe_fd);
+    free(in);
+    z->result = result;
+    return NULL;
+}
+
+static void zipl_free(zipl_file * z)
+{
+    free(z->pathname);
+    free(z);
+}
+
+/*
+    Setting up the pipe between fd and the thread, read_end telling which end fd is,
+    and starting the thread on routine.
+*/
+static int zipl_start(zipl_file * z, const int read_end, void * (* routine)(void *))
+{
+    int fds[2];
+    if(pipe(fds) != 0) return -1;
+
+#ifdef F_SETPIPE_SZ
+    // Bigger than the default 64 KB, so that neither side waits on every block of the other one:
+    fcntl(fds[1], F_SETPIPE_SZ, ZIPL_RING_SIZE);
+#endif
+
+    z->pipe_fd = read_end ? fds[1] : fds[0];
+    z->fd = fdopen(read_end ? fds[0] : fds[1], read_end ? "r" : "w");
+    if(z->fd == NULL){
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+    setvbuf(z->fd, NULL, _IOFBF, ZIPL_BLOCK_SIZE);
+
+    if(pthread_create(&z->thread, NULL, routine, z) != 0){
+        fclose(z->fd);
+        close(z->pipe_fd);
+        return -1;
+    }
+    return 0;
+}
+
+zipl_file * zipl_open_read(const char * pathname)
+{
+    zipl_file * z = (zipl_file *) calloc(1, sizeof(zipl_file));
+    if(z == NULL) return NULL;
+    z->pathname = strdup(pathname);
+    z->format = zipl_format(pathname);
+    z->joined = 1;
+
+    if(z->format == ZIPL_NONE){
+        z->fd = iol_fopen(pathname, "r");
+        if(z->fd != NULL) return z;
+        zipl_free(z);
+        return NULL;
+    }
+
+    z->file_fd = open(pathname, O_RDONLY);
+    if(z->file_fd < 0){
+        zipl_free(z);
+        return NULL;
+    }
+    if(zipl_start(z, 1, decompress_file) != 0){
+        fprintf(stderr, "[ZIPL - FAIL] Can't start the decompression of %s\n", pathname);
+        close(z->file_fd);
+        zipl_free(z);
+        return NULL;
+    }
+    z->joined = 0;
+    return z;
+}
+
+zipl_file * zipl_open_write(const char * pathname, const int format)
+{
+    zipl_file * z = (zipl_file *) calloc(1, sizeof(zipl_file));
+    if(z == NULL) return NULL;
+    z->pathname = strdup(pathname);
+    z->format = format;
+    z->writing = 1;
+    z->joined = 1;
+
+    if(format == ZIPL_NONE){
+        z->fd = iol_fopen(pathname, "w");
+        if(z->fd != NULL) return z;
+        zipl_free(z);
+        return NULL;
+    }
+
+    z->file_fd = open(pathname, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(z->file_fd < 0){
+        zipl_free(z);
+        return NULL;
+    }
+    if(zipl_start(z, 0, compress_file) != 0){
+        fprintf(stderr, "[ZIPL - FAIL] Can't start the compression of %s\n", pathname);
+        close(z->file_fd);
+        zipl_free(z);
+        return NULL;
+    }
+    z->joined = 0;
+    return z;
+}
+
+int zipl_finish(zipl_file * z)
+{
+    if(!z->joined){
+        pthread_join(z->thread, NULL);
+        z->joined = 1;
+        if(z->result != 0) fprintf(stderr, "[ZIPL - FAIL] %s is corrupted or truncated\n", z->pathname);
+    }
+    return z->result;
+}
+
+int zipl_close(zipl_file * z)
+{
+    int result = 0;
+
+    if(z->writing){
+        // Closing the pipe ends the input of the compression, which is done once the thread is:
+        if(fclose(z->fd) != 0) result = -1;
+        if(!z->joined) pthread_join(z->thread, NULL);
+        if(z->result != 0) result = -1;
+        if(result != 0) fprintf(stderr, "[ZIPL - FAIL] Can't write %s\n", z->pathname);
+    }
+    else{
+        // A decompression still running stops on the closed pipe:
+        fclose(z->fd);
+        if(!z->joined) pthread_join(z->thread, NULL);
+    }
+
+    zipl_free(z);
+    return result;
+}
@@ -0,0 +1,100 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    zipl.h
+    C library for reading and writing gzip and zstd compressed files as plain
+    text, with the (de)compression running on its own thread
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#include "../iol/iol.h"
+
+// Formats, given by the first bytes of a file (reading) or by its suffix (writing):
+#define ZIPL_NONE 0
+#define ZIPL_GZIP 1
+#define ZIPL_ZSTD 2
+
+// Capacity of the pipe between the (de)compression thread and the parser or the writer:
+#define ZIPL_RING_SIZE (1 << 20)
+
+// Bytes read and written at once by the (de)compression thread:
+#define ZIPL_BLOCK_SIZE (256 * 1024)
+
+#define ZIPL_GZIP_LEVEL 6
+#define ZIPL_ZSTD_LEVEL 3
+
+/*
+    A file read or written as plain text through fd: when it is compressed, fd is one end
+    of a pipe (the bounded ring buffer) and a thread (de)compresses the other end
+*/
+typedef struct {
+    FILE * fd;
+    int format;
+    int writing;
+
+    // Compressed file and end of the pipe of the thread:
+    int file_fd;
+    int pipe_fd;
+    pthread_t thread;
+    int joined;
+    int result;
+
+    char * pathname;
+} zipl_file;
+
+/*
+    This routine returns the format of the file of the given pathname from its first bytes,
+    ZIPL_NONE if it is not compressed (or can't be read).
+*/
+int zipl_format(const char * pathname);
+
+/*
+    This routine returns the format of a file to write from the suffix of its pathname
+    (".gz" or ".zst"), ZIPL_NONE for any other one.
+*/
+int zipl_format_of_name(const char * pathname);
+
+/*
+    This routine opens a file to read it as plain text: compressed files are decompressed
+    by a thread while fd is read, which never runs more than ZIPL_RING_SIZE bytes ahead;
+    other ones are read by the backend of iol.
+    The routine returns NULL if fails.
+*/
+zipl_file * zipl_open_read(const char * pathname);
+
+/*
+    This routine creates a file to write it as plain text through fd, compressed in the given
+    format by a thread; zstd frames are compressed by CSVL_ZSTD_THREADS workers (one per
+    core by default). Files not compressed are written by the backend of iol.
+    The routine returns NULL if fails.
+*/
+zipl_file * zipl_open_write(const char * pathname, const int format);
+
+/*
+    This routine waits for the decompression of a file read to its end (fd at EOF).
+    The routine returns 0 if the whole file was decompressed, -1 if it is corrupted or truncated.
+*/
+int zipl_finish(zipl_file * z);
+
+/*
+    This routine closes the file and frees it: a file read can be closed before its end, a
+    file written is complete (compressed and on disk) once the routine returns.
+    The routine returns 0 if everything is OK, -1 instead.
+*/
+int zipl_close(zipl_file * z);
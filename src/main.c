@@ -10,70 +10,338 @@
 
 #include "libs/csvl/csvl.h"
 #include "libs/kernel_launchers/kernel_launchers.h"
+#include "libs/scheduler/scheduler.h"
+#include "libs/binl/binl.h"
+#include "libs/arrowl/arrowl.h"
+#include "libs/statl/statl.h"
+#include "libs/streaml/streaml.h"
+#include "libs/stagel/stagel.h"
+#include "libs/tracel/tracel.h"
+#include "libs/metricl/metricl.h"
+#include "libs/csvnorm/csvnorm.h"
+#include "libs/jobl/jobl.h"
+#include "libs/daemonl/daemonl.h"
+
+#define KERNELS_PATHNAME "../src/kernels/kernels.ocl"
+
+// Bytes copied between host and device during the run:
+size_t bytes_copied = 0;
+
+// Time spent in each stage of the run, written at exit to the JSON file given by CSVL_STAGES:
+struct timespec run_start;
+char * stages_pathname = NULL;
+
+void write_stages()
+{
+    struct timespec run_end;
+    clock_gettime(CLOCK_MONOTONIC, &run_end);
+    stagel_write(stages_pathname, (run_end.tv_sec - run_start.tv_sec) * 1.0e3 + (run_end.tv_nsec - run_start.tv_nsec) * 1.0e-6);
+}
+
+// Timeline of the run, written at exit to the Chrome trace file given by CSVL_TRACE:
+void write_trace()
+{
+    tracel_span_since("run", run_start);
+    tracel_close();
+}
 
-#define N_WORK_GROUPS 32
-#define N_WORK_ITEMS_PER_WORK_GROUP 512
+// Metrics of the run, exported to the file given by CSVL_METRICS (every CSVL_METRICS_INTERVAL seconds too, if given):
+void collect_metrics()
+{
+    metricl_set(METRICL_DEVICE_BYTES, bytes_copied);
+}
 
-float * normalize(float * host_buffer, int host_buffer_elements, float max, float min, int log,
-                  cl_program ocl_program, cl_context ocl_context, cl_command_queue ocl_queue, cl_device_id ocl_device)
+void write_metrics()
+{
+    metricl_stop();
+}
+
+// Rows of the normalized file, the longest column written so far:
+size_t file_rows = 0;
+
+void account_rows(size_t n_rows)
+{
+    if(n_rows <= file_rows) return;
+    metricl_add(METRICL_ROWS, n_rows - file_rows);
+    file_rows = n_rows;
+}
+
+// Accounting the time since start to a stage, and tracing it as a span of the host:
+void stage_since(const int stage, const struct timespec start)
+{
+    stagel_add_since(stage, start);
+    tracel_span_since(stagel_name(stage), start);
+}
+
+// Binary output of the run (NULL when the CSV file is normalized in place):
+binl_writer * output_writer = NULL;
+double write_ms = 0;
+
+// Elements of the normalized columns: float32, or quantized by --quantize:
+int output_element = BINL_FLOAT32;
+
+// Arrow output of a CSV file: the normalized columns are collected and written in record batches when closed:
+arrowl_writer * arrow_writer = NULL;
+const int * arrow_column_numbers = NULL;
+float ** arrow_columns = NULL;
+int arrow_n_columns = 0;
+size_t arrow_n_rows = 0;
+
+int collect_arrow_column(const float * buffer, size_t n_elements, int column)
+{
+    for(int i = 0; i < arrow_n_columns; ++i){
+        if(arrow_column_numbers[i] == column && n_elements == arrow_n_rows){
+            arrow_columns[i] = (float *) malloc(sizeof(float) * n_elements);
+            memcpy(arrow_columns[i], buffer, sizeof(float) * n_elements);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Pathnames given by the user are relative to the root of the project, while main runs in bin:
+char * user_pathname(const char * pathname)
+{
+    char * result = malloc(strlen(pathname) + 4);
+    strcpy(result, pathname[0] == '/' ? "" : "../");
+    strcat(result, pathname);
+    return result;
+}
+
+int stream_chunk_rows()
+{
+    const char * const env = getenv("CSVL_CHUNK_ROWS");
+    return (env && atoi(env) > 0) ? atoi(env) : CSVL_STREAM_ROWS;
+}
+
+// Kernels specialized for the device and for buffers of at most max_elements elements:
+cl_program create_kernels(cl_context c, cl_device_id d, size_t max_elements)
+{
+    struct timespec start;
+    const kernel_variant variant = kernel_variant_for(d, max_elements);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    cl_program prog = kernel_program(KERNELS_PATHNAME, c, d, &variant);
+    tracel_span_since("compile", start);
+    return prog;
+}
+
+int write_column(const char * csv_pathname, const void * buffer, size_t n_elements, int column)
+{
+    struct timespec start, end;
+    int result;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if(arrow_writer != NULL){
+        result = collect_arrow_column(buffer, n_elements, column);
+    }
+    else if(output_writer != NULL){
+        result = binl_write_column(output_writer, buffer, column);
+    }
+    else if(output_element != BINL_FLOAT32){
+        result = csvl_write_ucolumn(csv_pathname, buffer, binl_element_size(output_element), n_elements, column);
+    }
+    else{
+        result = csvl_write_fcolumn(csv_pathname, buffer, n_elements, column);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    // CSV values are formatted while they are written, both are accounted to the write stage:
+    const double ms = (end.tv_sec - start.tv_sec) * 1.0e3 + (end.tv_nsec - start.tv_nsec) * 1.0e-6;
+    stagel_add(STAGEL_WRITE, ms);
+    metricl_add(METRICL_VALUES, n_elements);
+    account_rows(n_elements);
+    tracel_span(stagel_name(STAGEL_WRITE), start, end);
+    write_ms += ms;
+    return result;
+}
+
+int close_arrow_output()
+{
+    struct timespec start, end;
+    int result = 0;
+    void ** batch_columns = (void **) malloc(sizeof(void *) * arrow_n_columns);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(size_t offset = 0; offset < arrow_n_rows && result == 0; offset += ARROWL_BATCH_ROWS){
+        const int length = arrow_n_rows - offset < ARROWL_BATCH_ROWS ? (int) (arrow_n_rows - offset) : ARROWL_BATCH_ROWS;
+        for(int i = 0; i < arrow_n_columns; ++i){
+            if(arrow_columns[i] == NULL) result = -1;
+            else batch_columns[i] = arrow_columns[i] + offset;
+        }
+        if(result == 0) result = arrowl_write_batch(arrow_writer, length, batch_columns, NULL, NULL);
+    }
+
+    const size_t written_bytes = arrow_writer->position;
+    if(arrowl_writer_close(arrow_writer) != 0) result = -1;
+    arrow_writer = NULL;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    write_ms += (end.tv_sec - start.tv_sec) * 1.0e3 + (end.tv_nsec - start.tv_nsec) * 1.0e-6;
+    stagel_add(STAGEL_WRITE, (end.tv_sec - start.tv_sec) * 1.0e3 + (end.tv_nsec - start.tv_nsec) * 1.0e-6);
+    tracel_span(stagel_name(STAGEL_WRITE), start, end);
+
+    for(int i = 0; i < arrow_n_columns; ++i) free(arrow_columns[i]);
+    free(arrow_columns);
+    free(batch_columns);
+
+    fprintf(stdout, "[LOG] Writing:           %.5f ms, %zu bytes (Arrow)\n", write_ms, written_bytes);
+    return result;
+}
+
+int close_output()
+{
+    if(arrow_writer != NULL) return close_arrow_output();
+
+    if(output_writer == NULL){
+        fprintf(stdout, "[LOG] Writing:           %.5f ms (CSV in place)\n", write_ms);
+        return 0;
+    }
+
+    const size_t written_bytes = output_writer->written_bytes;
+    const int result = binl_close(output_writer);
+    output_writer = NULL;
+
+    fprintf(stdout, "[LOG] Writing:           %.5f ms, %zu bytes\n", write_ms, written_bytes);
+    return result;
+}
+
+cl_event normalize_device(cl_mem device_buffer, size_t n_elements, float max, float min, int log,
+                          cl_program ocl_program, cl_command_queue ocl_queue, cl_device_id ocl_device)
 {
     cl_int err;
-    cl_event normalize_event, read_event;
-    float * normalized_buffer = malloc(sizeof(float) * host_buffer_elements);
+    cl_event normalize_event;
 
     // Creating the OpenCL kernel:
     cl_kernel temp_k = clCreateKernel(ocl_program, NORMALIZE_KERNEL_NAME, &err);
     ocl_check(err, "[FAIL] Can't create the kernel ", NORMALIZE_KERNEL_NAME);
 
+    // Normalizing the device buffer:
+    normalize_event = launch_normalize(temp_k, ocl_queue, ocl_device, device_buffer, n_elements, max, min);
+    stagel_add(STAGEL_NORMALIZE, runtime_ms(normalize_event));
+    tracel_event(NORMALIZE_KERNEL_NAME, normalize_event);
+
+    if(log == 1){
+        // Times and bandwidths check:
+        const double normalize_ms = runtime_ms(normalize_event);
+        const double normalize_gbs = (n_elements * sizeof(float) * 2)/1.0e6/normalize_ms;
+
+        fprintf(stdout, "[LOG] Normalize:         %zu elements, %.5f ms, %.5f GB/s\n", n_elements, normalize_ms, normalize_gbs);
+    }
+
+    clReleaseKernel(temp_k);
+
+    return normalize_event;
+}
+
+float * normalize(float * host_buffer, size_t host_buffer_elements, float max, float min, int log,
+                  cl_program ocl_program, cl_context ocl_context, cl_command_queue ocl_queue, cl_device_id ocl_device)
+{
+    cl_int err;
+    cl_event normalize_event, read_event;
+    struct timespec start;
+    float * normalized_buffer = malloc(sizeof(float) * host_buffer_elements);
+
     // Creating the device buffer from the host buffer:
     cl_mem device_buffer = NULL;
     const size_t db_memsize = host_buffer_elements * sizeof(float);
     cl_mem_flags db_flags = CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR | CL_MEM_HOST_READ_ONLY;
 
+    clock_gettime(CLOCK_MONOTONIC, &start);
     device_buffer = clCreateBuffer(ocl_context, db_flags, db_memsize, host_buffer, &err);
     ocl_check(err, "[FAIL] Can't create the device buffer - normalize");
+    metricl_track_buffer(device_buffer);
+    stage_since(STAGEL_H2D, start);
+    bytes_copied += db_memsize;
 
     // Normalizing the device buffer:
-    normalize_event = launch_normalize(temp_k, ocl_queue, ocl_device, device_buffer, host_buffer_elements, max, min);
+    normalize_event = normalize_device(device_buffer, host_buffer_elements, max, min, log, ocl_program, ocl_queue, ocl_device);
 
     // Reading data from device:
+    clock_gettime(CLOCK_MONOTONIC, &start);
     err = clEnqueueReadBuffer(ocl_queue, device_buffer, CL_TRUE, 0, db_memsize, normalized_buffer, 1, &normalize_event, &read_event);
     ocl_check(err, "[FAIL] Can't read the normalized buffer from device");
+    stage_since(STAGEL_D2H, start);
+    tracel_event("read", read_event);
+    bytes_copied += db_memsize;
+
+    clReleaseMemObject(device_buffer);
+
+    return normalized_buffer;
+}
+
+void * normalize_quantized(float * host_buffer, size_t host_buffer_elements, float max, float min, int element, int log,
+                          cl_program ocl_program, cl_context ocl_context, cl_command_queue ocl_queue, cl_device_id ocl_device)
+{
+    cl_int err;
+    cl_event normalize_event, read_event;
+    struct timespec start;
+    const char * kernel_name = element == BINL_UINT8 ? NORMALIZE_U8_KERNEL_NAME :
+                               element == BINL_UINT16 ? NORMALIZE_U16_KERNEL_NAME : NORMALIZE_F16_KERNEL_NAME;
+
+    // Creating the input device buffer from the host buffer, and the smaller quantized one:
+    const size_t ib_memsize = host_buffer_elements * sizeof(float);
+    const size_t qb_memsize = host_buffer_elements * binl_element_size(element);
+    void * quantized_buffer = malloc(qb_memsize);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    cl_mem input_buffer = clCreateBuffer(ocl_context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR | CL_MEM_HOST_NO_ACCESS,
+                                         ib_memsize, host_buffer, &err);
+    ocl_check(err, "[FAIL] Can't create the input buffer - normalize_quantized");
+    metricl_track_buffer(input_buffer);
+    stage_since(STAGEL_H2D, start);
+    bytes_copied += ib_memsize;
+
+    cl_mem device_buffer = clCreateBuffer(ocl_context, CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY, qb_memsize, NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the quantized buffer - normalize_quantized");
+    metricl_track_buffer(device_buffer);
+
+    // Normalizing and quantizing the device buffer:
+    cl_kernel temp_k = clCreateKernel(ocl_program, kernel_name, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel ", kernel_name);
+
+    normalize_event = launch_normalize_quantized(temp_k, ocl_queue, ocl_device, NULL, device_buffer, input_buffer,
+                                                 host_buffer_elements, max, min);
+
+    // Reading only the quantized data from device:
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    err = clEnqueueReadBuffer(ocl_queue, device_buffer, CL_TRUE, 0, qb_memsize, quantized_buffer, 1, &normalize_event, &read_event);
+    ocl_check(err, "[FAIL] Can't read the quantized buffer from device");
+    stage_since(STAGEL_D2H, start);
+    stagel_add(STAGEL_NORMALIZE, runtime_ms(normalize_event));
+    tracel_event(kernel_name, normalize_event);
+    tracel_event("read", read_event);
+    bytes_copied += qb_memsize;
 
     if(log == 1){
         // Times and bandwidths check:
         const double normalize_ms = runtime_ms(normalize_event);
-        const double normalize_gbs = (host_buffer_elements * sizeof(float) * 2)/1.0e6/normalize_ms;
+        const double normalize_gbs = (ib_memsize + qb_memsize)/1.0e6/normalize_ms;
+
+        char label[32];
+        snprintf(label, sizeof(label), "Normalize %s:", kernel_name + strlen(NORMALIZE_KERNEL_NAME) + 1);
 
-        fprintf(stdout, "[LOG] Normalize:         %d elements, %.5f ms, %.5f GB/s\n", host_buffer_elements, normalize_ms, normalize_gbs);
+        fprintf(stdout, "[LOG] %-18s %zu elements, %.5f ms, %.5f GB/s, %zu bytes read back\n",
+                label, host_buffer_elements, normalize_ms, normalize_gbs, qb_memsize);
     }
 
-    clReleaseMemObject(device_buffer);
     clReleaseKernel(temp_k);
+    clReleaseMemObject(input_buffer);
+    clReleaseMemObject(device_buffer);
 
-    return normalized_buffer;
+    return quantized_buffer;
 }
 
-float * get_max_min(float * host_buffer, int host_buffer_elements, int log,
-                    cl_program ocl_program, cl_context ocl_context, cl_command_queue ocl_queue)
+void get_max_min_device(cl_mem device_buffer, size_t n_elements, float * max_min, int log,
+                        cl_program ocl_program, cl_context ocl_context, cl_command_queue ocl_queue)
 {
     cl_int err;
     cl_event max_min_find_event[2], read_event;
     float temp_max_min[2];
-    float * return_buffer = malloc(sizeof(float) * 2);
 
     // Creating the OpenCL kernel:
     cl_kernel temp_k = clCreateKernel(ocl_program, MAX_MIN_FIND_KERNEL_NAME, &err);
     ocl_check(err, "[FAIL] Can't create the kernel ", MAX_MIN_FIND_KERNEL_NAME);
 
-    // Copying the host buffer to a device buffer:
-    cl_mem device_buffer = NULL;
-    const size_t db_memsize = host_buffer_elements * sizeof(float);
-    cl_mem_flags db_flags = CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR | CL_MEM_HOST_READ_ONLY;
-
-    device_buffer = clCreateBuffer(ocl_context, db_flags, db_memsize, host_buffer, &err);
-    ocl_check(err, "[FAIL] Can't copy host buffer to device buffer - getting max and min");
-
     // Creating the support buffer:
     cl_mem support_buffer = NULL;
     const size_t sb_memsize = N_WORK_GROUPS * 2 * sizeof(float);
@@ -81,10 +349,11 @@ float * get_max_min(float * host_buffer, int host_buffer_elements, int log,
 
     support_buffer = clCreateBuffer(ocl_context, sb_flags, sb_memsize, NULL, &err);
     ocl_check(err, "[FAIL] Can't create the support_buffer - getting max and min");
+    metricl_track_buffer(support_buffer);
 
     // Reducing the original device buffer to N_WORK_GROUPS * 2 elements:
     max_min_find_event[0] = launch_max_min_find(temp_k, ocl_queue, NULL,
-                                                support_buffer, device_buffer, host_buffer_elements, 
+                                                support_buffer, device_buffer, n_elements, 
                                                 N_WORK_ITEMS_PER_WORK_GROUP, N_WORK_GROUPS);
 
     // Reducing the support buffer of N_WORK_GROUPS * 2 elements to only two element:
@@ -95,11 +364,15 @@ float * get_max_min(float * host_buffer, int host_buffer_elements, int log,
     // Reading data from device:
     err = clEnqueueReadBuffer(ocl_queue, support_buffer, CL_TRUE, 0, sizeof(temp_max_min), &temp_max_min, 1, max_min_find_event+1, &read_event);
     ocl_check(err, "[FAIL] Can't read the max and min values from device");
+    stagel_add(STAGEL_REDUCE, total_runtime_ms(max_min_find_event[0], max_min_find_event[1]));
+    tracel_event(MAX_MIN_FIND_KERNEL_NAME, max_min_find_event[0]);
+    tracel_event(MAX_MIN_FIND_KERNEL_NAME, max_min_find_event[1]);
+    tracel_event("read", read_event);
 
     if(log == 1){
         // Times and bandwidths check:
         const double first_step_ms = runtime_ms(max_min_find_event[0]);
-        const double first_step_gbs = (host_buffer_elements * sizeof(float) + N_WORK_GROUPS * 2 * sizeof(float))/1.0e6/first_step_ms;
+        const double first_step_gbs = (n_elements * sizeof(float) + N_WORK_GROUPS * 2 * sizeof(float))/1.0e6/first_step_ms;
 
         const double second_step_ms = runtime_ms(max_min_find_event[1]);
         const double second_step_gbs = (N_WORK_GROUPS * 2 * sizeof(float) + sizeof(float))/1.0e6/second_step_ms;
@@ -107,21 +380,88 @@ float * get_max_min(float * host_buffer, int host_buffer_elements, int log,
         const double total_ms = total_runtime_ms(max_min_find_event[0], max_min_find_event[1]);
         const double total_gbs = (first_step_gbs + second_step_gbs) / 2;
 
-        fprintf(stdout, "[LOG] Getting Max & Min: %d elements, %.5f ms, %.5f GB/s || Max: %f Min: %f ||  Reduce 0: %.5f ms, %.5f GB/s - Reduce 1: %.5f ms, %.5f GB/s\n",
-                host_buffer_elements, total_ms, total_gbs, temp_max_min[0], temp_max_min[1], first_step_ms, first_step_gbs, second_step_ms, second_step_gbs);
+        fprintf(stdout, "[LOG] Getting Max & Min: %zu elements, %.5f ms, %.5f GB/s || Max: %f Min: %f ||  Reduce 0: %.5f ms, %.5f GB/s - Reduce 1: %.5f ms, %.5f GB/s\n",
+                n_elements, total_ms, total_gbs, temp_max_min[0], temp_max_min[1], first_step_ms, first_step_gbs, second_step_ms, second_step_gbs);
     }
 
-    clReleaseMemObject(device_buffer);
     clReleaseMemObject(support_buffer);
     clReleaseKernel(temp_k);
 
-    return_buffer[0] = temp_max_min[0];
-    return_buffer[1] = temp_max_min[1];
+    max_min[0] = temp_max_min[0];
+    max_min[1] = temp_max_min[1];
+}
+
+float * get_max_min(float * host_buffer, size_t host_buffer_elements, int log,
+                    cl_program ocl_program, cl_context ocl_context, cl_command_queue ocl_queue)
+{
+    cl_int err;
+    struct timespec start;
+    float * return_buffer = malloc(sizeof(float) * 2);
+
+    // Copying the host buffer to a device buffer:
+    cl_mem device_buffer = NULL;
+    const size_t db_memsize = host_buffer_elements * sizeof(float);
+    cl_mem_flags db_flags = CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR | CL_MEM_HOST_READ_ONLY;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    device_buffer = clCreateBuffer(ocl_context, db_flags, db_memsize, host_buffer, &err);
+    ocl_check(err, "[FAIL] Can't copy host buffer to device buffer - getting max and min");
+    metricl_track_buffer(device_buffer);
+    stage_since(STAGEL_H2D, start);
+    bytes_copied += db_memsize;
+
+    get_max_min_device(device_buffer, host_buffer_elements, return_buffer, log, ocl_program, ocl_context, ocl_queue);
+
+    clReleaseMemObject(device_buffer);
 
     return return_buffer;
 }
 
-float get_max(float * host_buffer, int host_buffer_elements, int log,
+// Writes the column of the device buffer to disk straight from the mapped buffer, once to_wait is complete:
+int write_mapped(cl_mem device_buffer, cl_event to_wait, const char * csv_pathname, int column, size_t n_elements,
+                 cl_command_queue ocl_queue)
+{
+    cl_int err;
+    struct timespec start;
+    float * mapped;
+    const size_t db_memsize = n_elements * sizeof(float);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    mapped = clEnqueueMapBuffer(ocl_queue, device_buffer, CL_TRUE, CL_MAP_READ,
+                                0, db_memsize, to_wait != NULL, to_wait != NULL ? &to_wait : NULL, NULL, &err);
+    ocl_check(err, "[FAIL] Can't map the device buffer for reading - zero copy");
+    stage_since(STAGEL_D2H, start);
+
+    fprintf(stdout, "[LOG] Writing changes to disk ...\n");
+    const int result = write_column(csv_pathname, mapped, n_elements, column);
+
+    err = clEnqueueUnmapMemObject(ocl_queue, device_buffer, mapped, 0, NULL, NULL);
+    ocl_check(err, "[FAIL] Can't unmap the device buffer - zero copy");
+    err = clFinish(ocl_queue);
+    ocl_check(err, "[FAIL] Can't complete command queue - zero copy");
+
+    return result;
+}
+
+int normalize_mapped(cl_mem device_buffer, const char * csv_pathname, int column, size_t n_elements, int log,
+                     cl_program ocl_program, cl_context ocl_context, cl_command_queue ocl_queue, cl_device_id ocl_device)
+{
+    cl_event normalize_event;
+    float max_min[2];
+
+    // Reducing and normalizing the buffer in place:
+    get_max_min_device(device_buffer, n_elements, max_min, log, ocl_program, ocl_context, ocl_queue);
+    normalize_event = normalize_device(device_buffer, n_elements, max_min[0], max_min[1], log, ocl_program, ocl_queue, ocl_device);
+
+    // Writing data to disk straight from the mapped result:
+    const int result = write_mapped(device_buffer, normalize_event, csv_pathname, column, n_elements, ocl_queue);
+
+    clReleaseMemObject(device_buffer);
+
+    return result;
+}
+
+float get_max(float * host_buffer, size_t host_buffer_elements, int log,
               cl_program ocl_program, cl_context ocl_context, cl_command_queue ocl_queue)
 {
     cl_int err;
@@ -139,6 +479,8 @@ float get_max(float * host_buffer, int host_buffer_elements, int log,
 
     device_buffer = clCreateBuffer(ocl_context, db_flags, db_memsize, host_buffer, &err);
     ocl_check(err, "[FAIL] Can't copy host buffer to device buffer - getting max");
+    metricl_track_buffer(device_buffer);
+    bytes_copied += db_memsize;
 
     // Creating the support buffer:
     cl_mem support_buffer = NULL;
@@ -147,6 +489,7 @@ float get_max(float * host_buffer, int host_buffer_elements, int log,
 
     support_buffer = clCreateBuffer(ocl_context, sb_flags, sb_memsize, NULL, &err);
     ocl_check(err, "[FAIL] Can't create the support_buffer - getting max");
+    metricl_track_buffer(support_buffer);
 
     // Reducing the original device buffer to N_WORK_GROUPS elements:
     max_find_event[0] = launch_max_find(temp_k, ocl_queue, NULL,
@@ -161,6 +504,9 @@ float get_max(float * host_buffer, int host_buffer_elements, int log,
     // Reading data from device:
     err = clEnqueueReadBuffer(ocl_queue, support_buffer, CL_TRUE, 0, sizeof(temp_max), &temp_max, 1, max_find_event+1, &read_event);
     ocl_check(err, "[FAIL] Can't read the max value from device");
+    tracel_event(MAX_FIND_KERNEL_NAME, max_find_event[0]);
+    tracel_event(MAX_FIND_KERNEL_NAME, max_find_event[1]);
+    tracel_event("read", read_event);
 
     if(log == 1){
         // Times and bandwidths check:
@@ -173,7 +519,7 @@ float get_max(float * host_buffer, int host_buffer_elements, int log,
         const double total_ms = total_runtime_ms(max_find_event[0], max_find_event[1]);
         const double total_gbs = (first_step_gbs + second_step_gbs) / 2;
 
-        fprintf(stdout, "[LOG] Getting Max: %d elements, %.5f ms, %.5f GB/s || Max: %f || Reduce 0: %.5f ms, %.5f GB/s - Reduce 1: %.5f ms, %.5f GB/s\n",
+        fprintf(stdout, "[LOG] Getting Max: %zu elements, %.5f ms, %.5f GB/s || Max: %f || Reduce 0: %.5f ms, %.5f GB/s - Reduce 1: %.5f ms, %.5f GB/s\n",
                 host_buffer_elements, total_ms, total_gbs, temp_max, first_step_ms, first_step_gbs, second_step_ms, second_step_gbs);
     }
 
@@ -184,7 +530,7 @@ float get_max(float * host_buffer, int host_buffer_elements, int log,
     return temp_max;
 }
 
-float get_min(float * host_buffer, int host_buffer_elements, int log,
+float get_min(float * host_buffer, size_t host_buffer_elements, int log,
               cl_program ocl_program, cl_context ocl_context, cl_command_queue ocl_queue)
 {
     cl_int err;
@@ -202,6 +548,8 @@ float get_min(float * host_buffer, int host_buffer_elements, int log,
 
     device_buffer = clCreateBuffer(ocl_context, db_flags, db_memsize, host_buffer, &err);
     ocl_check(err, "[FAIL] Can't copy host buffer to device buffer - getting min");
+    metricl_track_buffer(device_buffer);
+    bytes_copied += db_memsize;
 
     // Creating the support buffer:
     cl_mem support_buffer = NULL;
@@ -210,6 +558,7 @@ float get_min(float * host_buffer, int host_buffer_elements, int log,
 
     support_buffer = clCreateBuffer(ocl_context, sb_flags, sb_memsize, NULL, &err);
     ocl_check(err, "[FAIL] Can't create the support_buffer - getting min");
+    metricl_track_buffer(support_buffer);
 
     // Reducing the original device buffer to N_WORK_GROUPS elements:
     min_find_event[0] = launch_min_find(temp_k, ocl_queue, NULL,
@@ -224,6 +573,9 @@ float get_min(float * host_buffer, int host_buffer_elements, int log,
     // Reading data from device:
     err = clEnqueueReadBuffer(ocl_queue, support_buffer, CL_TRUE, 0, sizeof(temp_min), &temp_min, 1, min_find_event+1, &read_event);
     ocl_check(err, "[FAIL] Can't read the min value from device");
+    tracel_event(MIN_FIND_KERNEL_NAME, min_find_event[0]);
+    tracel_event(MIN_FIND_KERNEL_NAME, min_find_event[1]);
+    tracel_event("read", read_event);
 
     if(log == 1){
         // Times and bandwidths check:
@@ -236,7 +588,7 @@ float get_min(float * host_buffer, int host_buffer_elements, int log,
         const double total_ms = total_runtime_ms(min_find_event[0], min_find_event[1]);
         const double total_gbs = (first_step_gbs + second_step_gbs) / 2;
 
-        fprintf(stdout, "[LOG] Getting Min: %d elements, %.5f ms, %.5f GB/s || Min: %f || Reduce 0: %.5f ms, %.5f GB/s - Reduce 1: %.5f ms, %.5f GB/s\n",
+        fprintf(stdout, "[LOG] Getting Min: %zu elements, %.5f ms, %.5f GB/s || Min: %f || Reduce 0: %.5f ms, %.5f GB/s - Reduce 1: %.5f ms, %.5f GB/s\n",
                 host_buffer_elements, total_ms, total_gbs, temp_min, first_step_ms, first_step_gbs, second_step_ms, second_step_gbs);
     }
 
@@ -247,93 +599,2217 @@ float get_min(float * host_buffer, int host_buffer_elements, int log,
     return temp_min;
 }
 
-int main(int argc, char *argv[]){
-    printf("--------------------------------------------------\n");
-    printf("              PARALLEL NORMALIZATION              \n");
-    printf("--------------------------------------------------\n");
+int normalize_zero_copy(const char * csv_pathname, int column, csvl_cache * cache, int log,
+                        cl_program ocl_program, cl_context ocl_context, cl_command_queue ocl_queue, cl_device_id ocl_device)
+{
+    cl_int err;
+    float * mapped;
+    cl_mem device_buffer = NULL;
 
-    if(argc < 3){
-        fprintf(stdout, "[FAIL] Example of use: %s csv_pathname_to_normalize col_index1 col_index2 ... col_indexN \n", argv[0]);
-        fprintf(stdout, "                       %s csv_pathname_to_normalize ALL\n", argv[0]);
-        return -1;
+    if(cache != NULL){
+        // Handing the page-aligned cached column straight to the device:
+        const size_t n_elements = cache->header.n_rows;
+        float * cached_column = csvl_cache_column(cache, column);
+        if(cached_column == NULL || n_elements == 0) return -1;
+
+        device_buffer = clCreateBuffer(ocl_context, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR,
+                                       n_elements * sizeof(float), cached_column, &err);
+        ocl_check(err, "[FAIL] Can't create the device buffer from the cache - zero copy");
+        metricl_track_buffer(device_buffer);
+
+        // A device with its own memory still gets the column migrated by the driver:
+        if(!device_unified_memory(ocl_device)) bytes_copied += n_elements * sizeof(float);
+        return normalize_mapped(device_buffer, csv_pathname, column, n_elements, log, ocl_program, ocl_context, ocl_queue, ocl_device);
     }
 
-    int err;
+    const int64_t n_rows = csvl_nrows(csv_pathname);
+    if(n_rows <= 1) return -1;
+    const size_t n_elements = n_rows - 1;
 
-    // Building the pathname:
-    char * suffix = "../";
-    char * temp_pathname = argv[1];
+    // Allocating a host-accessible (page-aligned) device buffer:
+    const size_t db_memsize = n_elements * sizeof(float);
+    cl_mem_flags db_flags = CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR;
 
-    char * csv_pathname = malloc(strlen(suffix) + strlen(temp_pathname) + 1);
-    strcpy(csv_pathname, suffix);
-    strcat(csv_pathname, temp_pathname);
-    csv_pathname = realpath(csv_pathname, NULL);
+    device_buffer = clCreateBuffer(ocl_context, db_flags, db_memsize, NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the device buffer - zero copy");
+    metricl_track_buffer(device_buffer);
 
-    // Consistency Check:
-    FILE * fd = fopen(csv_pathname, "r"); 
-    if(fd == NULL){
-        fprintf(stdout, "[FAIL] Given file does not exist\n");
+    // Parsing the column directly into the mapped device buffer:
+    mapped = clEnqueueMapBuffer(ocl_queue, device_buffer, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION,
+                                0, db_memsize, 0, NULL, NULL, &err);
+    ocl_check(err, "[FAIL] Can't map the device buffer for writing - zero copy");
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    const int64_t loaded = csvl_load_fcolumn_into(csv_pathname, column, mapped, n_elements);
+    stage_since(STAGEL_PARSE, start);
+
+    err = clEnqueueUnmapMemObject(ocl_queue, device_buffer, mapped, 0, NULL, NULL);
+    ocl_check(err, "[FAIL] Can't unmap the device buffer - zero copy");
+    if(loaded != (int64_t) n_elements){
+        clReleaseMemObject(device_buffer);
         return -1;
     }
-    fclose(fd);
 
-    // Creating the array with the columns to normalize:
-    int * cols_array;
-    int cols_array_dim;
+    if(!device_unified_memory(ocl_device)) bytes_copied += db_memsize;
+    return normalize_mapped(device_buffer, csv_pathname, column, n_elements, log, ocl_program, ocl_context, ocl_queue, ocl_device);
+}
 
-    if(strcmp("ALL", argv[2]) == 0){
-        cols_array_dim = csvl_ncols(csv_pathname);
-        cols_array_dim -= 1;
-        cols_array = (int *) malloc(sizeof(int) * cols_array_dim);
+float * load_column(const char * csv_pathname, int column, csvl_cache * cache, size_t * n_elements)
+{
+    // Columns of the cache are already parsed and mapped in memory:
+    if(cache != NULL){
+        * n_elements = cache->header.n_rows;
+        return csvl_cache_column(cache, column);
+    }
 
-        for(int i = 0; i<cols_array_dim; ++i){
-            cols_array[i] = i+1;
-        }
+    return csvl_load_fcolumn(csv_pathname, column, n_elements);
+}
+
+// Bytes of each host write of the rows uploaded to the device, two of them in flight:
+#define DEVICE_PARSE_CHUNK (16 * MB)
+
+cl_mem upload_rows(const char * csv_pathname, size_t * text_size, char ** mapping, size_t * mapping_size,
+                   cl_context ocl_context, cl_command_queue ocl_queue, cl_device_id ocl_device)
+{
+    cl_int err;
+    cl_mem text_buffer;
+    struct stat csv_st;
+    char header[ROW_MAX_SIZE];
+    char last_byte;
+
+    const int csv_fd = open(csv_pathname, O_RDONLY);
+    if(csv_fd == -1 || fstat(csv_fd, &csv_st) != 0){
+        fprintf(stderr, "[FAIL] Can't read %s\n", csv_pathname);
+        if(csv_fd != -1) close(csv_fd);
+        return NULL;
     }
-    else{
-        cols_array_dim = argc - 2;
-        cols_array = (int *) malloc(sizeof(int) * cols_array_dim);
 
-        int current = 0;
-        for(int i = 0; i<cols_array_dim; ++i){
-            cols_array[i] = atoi(argv[i+2]);
+    // The rows start after the one with the column names:
+    const ssize_t header_read = pread(csv_fd, header, sizeof(header), 0);
+    const char * header_end = header_read > 0 ? memchr(header, '\n', header_read) : NULL;
+    const size_t header_size = header_end == NULL ? 0 : header_end - header + 1;
+    if(header_size == 0 || (size_t) csv_st.st_size <= header_size || pread(csv_fd, &last_byte, 1, csv_st.st_size - 1) != 1){
+        close(csv_fd);
+        return NULL;
+    }
+
+    // Every row must end with '\n', one is added after the last row otherwise:
+    const size_t rows_size = csv_st.st_size - header_size;
+    * text_size = rows_size + (last_byte != '\n');
+    * mapping = NULL;
+
+    // Handing the mapped file straight to the device when it shares the memory with the host:
+    const char * const zero_copy_env = getenv("OCL_ZERO_COPY");
+    const int zero_copy = zero_copy_env && zero_copy_env[0] != '\0' ? atoi(zero_copy_env) : device_unified_memory(ocl_device) == CL_TRUE;
+
+    if(zero_copy && last_byte == '\n'){
+        * mapping_size = csv_st.st_size;
+        * mapping = mmap(NULL, * mapping_size, PROT_READ, MAP_PRIVATE, csv_fd, 0);
+        close(csv_fd);
+        if(* mapping == MAP_FAILED) return NULL;
+        madvise(* mapping, * mapping_size, MADV_SEQUENTIAL);
+
+        text_buffer = clCreateBuffer(ocl_context, CL_MEM_READ_ONLY | CL_MEM_USE_HOST_PTR, * text_size, * mapping + header_size, &err);
+        ocl_check(err, "[FAIL] Can't create the text buffer from the mapped file - device parsing");
+        metricl_track_buffer(text_buffer);
+        return text_buffer;
+    }
+
+    text_buffer = clCreateBuffer(ocl_context, CL_MEM_READ_ONLY | CL_MEM_HOST_WRITE_ONLY, * text_size, NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the text buffer - device parsing");
+    metricl_track_buffer(text_buffer);
+
+    // Uploading the rows in large chunks: the next chunk is read while the previous one is written:
+    char * chunks[2] = { malloc(DEVICE_PARSE_CHUNK), malloc(DEVICE_PARSE_CHUNK) };
+    cl_event write_events[2] = { NULL, NULL };
+    size_t offset = 0;
+
+    for(int k = 0; offset < rows_size; k = 1 - k){
+        const size_t chunk_size = rows_size - offset < DEVICE_PARSE_CHUNK ? rows_size - offset : DEVICE_PARSE_CHUNK;
+
+        if(write_events[k] != NULL){
+            clWaitForEvents(1, &write_events[k]);
+            clReleaseEvent(write_events[k]);
         }
+        if(pread(csv_fd, chunks[k], chunk_size, header_size + offset) != (ssize_t) chunk_size){
+            fprintf(stderr, "[FAIL] Can't read %s\n", csv_pathname);
+            exit(1);
+        }
+
+        err = clEnqueueWriteBuffer(ocl_queue, text_buffer, CL_FALSE, offset, chunk_size, chunks[k], 0, NULL, &write_events[k]);
+        ocl_check(err, "[FAIL] Can't write the rows to the text buffer - device parsing");
+        offset += chunk_size;
+    }
+    if(last_byte != '\n'){
+        err = clEnqueueWriteBuffer(ocl_queue, text_buffer, CL_FALSE, rows_size, 1, "\n", 0, NULL, NULL);
+        ocl_check(err, "[FAIL] Can't write the last newline to the text buffer - device parsing");
     }
 
-    // Wrapped OpenCL boilerplate:
-    cl_platform_id p = select_platform();
-    cl_device_id d = select_device(p);
-    cl_context c = create_context(p, d);
-    cl_command_queue q = create_queue(c, d);
-    cl_program prog = create_program("../src/kernels/kernels.ocl", c, d);
+    err = clFinish(ocl_queue);
+    ocl_check(err, "[FAIL] Can't complete command queue - device parsing");
+    for(int k = 0; k < 2; ++k){
+        if(write_events[k] != NULL) clReleaseEvent(write_events[k]);
+        free(chunks[k]);
+    }
 
-    int n_elements;
-    float * host_buffer;
-    float temp_max, temp_min;
-    float * temp_max_min;
+    close(csv_fd);
+    bytes_copied += * text_size;
+    return text_buffer;
+}
+
+/*
+    Writes the rows of the CSV file formatted by the device, with the columns that have a slot
+    replaced by their normalized values in the matrix, and the other fields copied from the
+    text. The routine returns 1 if some rows can't be formatted on the device (they are then
+    written by the host as usual), 0 if everything is OK and -1 instead.
+*/
+int write_device_rows(const char * csv_pathname, cl_mem text_buffer, cl_mem row_starts_buffer, cl_mem counts_buffer,
+                      cl_mem matrix_buffer, cl_mem slots_buffer, const int * slots, int n_slots,
+                      cl_ulong n_rows, cl_ulong stride, cl_ulong max_alloc, int log,
+                      cl_program ocl_program, cl_context ocl_context, cl_command_queue ocl_queue, cl_device_id ocl_device)
+{
+    cl_int err;
+    cl_event format_lengths_event, scan_lengths_event, format_rows_event, read_event;
+    struct timespec start, end;
+    cl_ulong output_size;
+    cl_int unformattable = 0;
+
+    const int n_cols = csvl_ncols(csv_pathname);
+    if(n_cols < 1) return 1;
+
+    cl_kernel lengths_k = clCreateKernel(ocl_program, FORMAT_LENGTHS_KERNEL_NAME, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel ", FORMAT_LENGTHS_KERNEL_NAME);
+    cl_kernel scan_k = clCreateKernel(ocl_program, SCAN_COUNTS_KERNEL_NAME, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel ", SCAN_COUNTS_KERNEL_NAME);
+    cl_kernel rows_k = clCreateKernel(ocl_program, FORMAT_ROWS_KERNEL_NAME, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel ", FORMAT_ROWS_KERNEL_NAME);
+
+    cl_mem unformattable_buffer = clCreateBuffer(ocl_context, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR | CL_MEM_HOST_READ_ONLY,
+                                                 sizeof(unformattable), &unformattable, &err);
+    ocl_check(err, "[FAIL] Can't create the unformattable buffer - device formatting");
+    metricl_track_buffer(unformattable_buffer);
+
+    // Summing the lengths of the rows of each segment, and scanning them (in the buffer of the counts of the rows):
+    const cl_uint n_segments = N_WORK_GROUPS * N_WORK_ITEMS_PER_WORK_GROUP;
+    const cl_ulong segment = (n_rows + n_segments - 1) / n_segments;
+
+    format_lengths_event = launch_format_lengths(lengths_k, ocl_queue, NULL, counts_buffer, unformattable_buffer, text_buffer,
+                                                 row_starts_buffer, matrix_buffer, slots_buffer, n_slots, n_cols, ROW_MAX_SIZE,
+                                                 n_rows, stride, segment, N_WORK_ITEMS_PER_WORK_GROUP, N_WORK_GROUPS);
+    scan_lengths_event = launch_scan_counts(scan_k, ocl_queue, format_lengths_event, counts_buffer, n_segments, N_WORK_ITEMS_PER_WORK_GROUP);
+
+    // Only the size of the output is read back, with the rows which can't be formatted:
+    err = clEnqueueReadBuffer(ocl_queue, unformattable_buffer, CL_FALSE, 0, sizeof(unformattable), &unformattable, 1, &format_lengths_event, NULL);
+    ocl_check(err, "[FAIL] Can't read the unformattable rows from device");
+    err = clEnqueueReadBuffer(ocl_queue, counts_buffer, CL_TRUE, n_segments * sizeof(cl_ulong), sizeof(output_size), &output_size, 1, &scan_lengths_event, &read_event);
+    ocl_check(err, "[FAIL] Can't read the size of the output from device");
+    clReleaseMemObject(unformattable_buffer);
+
+    if(unformattable || output_size == 0 || output_size >= max_alloc){
+        fprintf(stdout, "[LOG] Some rows of %s can't be formatted on the device, they are written by the host\n", csv_pathname);
+        clReleaseKernel(lengths_k);
+        clReleaseKernel(scan_k);
+        clReleaseKernel(rows_k);
+        return 1;
+    }
 
-    fprintf(stdout, "[LOG] START normalization of %s\n", csv_pathname);
+    // Writing every row to the output buffer, read back at once (mapped, on unified memory devices):
+    const int unified = device_unified_memory(ocl_device);
+    cl_mem_flags ob_flags = CL_MEM_WRITE_ONLY | CL_MEM_HOST_READ_ONLY | (unified ? CL_MEM_ALLOC_HOST_PTR : 0);
+
+    cl_mem output_buffer = clCreateBuffer(ocl_context, ob_flags, output_size, NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the output buffer - device formatting");
+    metricl_track_buffer(output_buffer);
+
+    format_rows_event = launch_format_rows(rows_k, ocl_queue, scan_lengths_event, output_buffer, counts_buffer, text_buffer,
+                                           row_starts_buffer, matrix_buffer, slots_buffer, n_slots, n_cols, ROW_MAX_SIZE,
+                                           n_rows, stride, segment, N_WORK_ITEMS_PER_WORK_GROUP, N_WORK_GROUPS);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    char * mapped = clEnqueueMapBuffer(ocl_queue, output_buffer, CL_TRUE, CL_MAP_READ,
+                                       0, output_size, 1, &format_rows_event, NULL, &err);
+    ocl_check(err, "[FAIL] Can't map the output buffer for reading - device formatting");
+    stage_since(STAGEL_D2H, start);
+    stagel_add(STAGEL_FORMAT, total_runtime_ms(format_lengths_event, format_rows_event));
+    tracel_event(FORMAT_LENGTHS_KERNEL_NAME, format_lengths_event);
+    tracel_event(SCAN_COUNTS_KERNEL_NAME, scan_lengths_event);
+    tracel_event("read", read_event);
+    tracel_event(FORMAT_ROWS_KERNEL_NAME, format_rows_event);
+    if(!unified) bytes_copied += output_size;
 
-    for(int i=0; i<cols_array_dim; ++i)
-    {
+    if(log == 1){
+        // Times and bandwidths check:
+        const double lengths_ms = runtime_ms(format_lengths_event);
+        const double scan_ms = runtime_ms(scan_lengths_event);
+        const double format_ms = runtime_ms(format_rows_event);
+
+        fprintf(stdout, "[LOG] Device formatting: %llu rows, %llu bytes || Lengths: %.5f ms - Scan: %.5f ms - Format: %.5f ms, %.5f GB/s\n",
+                (unsigned long long) n_rows, (unsigned long long) output_size, lengths_ms, scan_ms, format_ms, output_size/1.0e6/format_ms);
+    }
+
+    // The host writes the last row without '\n' when the file does not end with one, and its last field is not replaced:
+    char last_byte = '\n';
+    const int csv_fd = open(csv_pathname, O_RDONLY);
+    struct stat csv_st;
+    if(csv_fd != -1 && fstat(csv_fd, &csv_st) == 0 && csv_st.st_size > 0) pread(csv_fd, &last_byte, 1, csv_st.st_size - 1);
+    if(csv_fd != -1) close(csv_fd);
+    if(last_byte != '\n' && (n_cols > n_slots || slots[n_cols - 1] < 0)) --output_size;
+
+    fprintf(stdout, "[LOG] Writing changes to disk ...\n");
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    const int result = csvl_write_text(csv_pathname, mapped, output_size);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    write_ms += (end.tv_sec - start.tv_sec) * 1.0e3 + (end.tv_nsec - start.tv_nsec) * 1.0e-6;
+    stagel_add(STAGEL_WRITE, (end.tv_sec - start.tv_sec) * 1.0e3 + (end.tv_nsec - start.tv_nsec) * 1.0e-6);
+    tracel_span(stagel_name(STAGEL_WRITE), start, end);
+
+    int n_replaced = 0;
+    for(int c = 0; c < n_slots; ++c) n_replaced += slots[c] >= 0;
+    metricl_add(METRICL_VALUES, n_rows * n_replaced);
+    account_rows(n_rows);
+
+    err = clEnqueueUnmapMemObject(ocl_queue, output_buffer, mapped, 0, NULL, NULL);
+    ocl_check(err, "[FAIL] Can't unmap the output buffer - device formatting");
+    err = clFinish(ocl_queue);
+    ocl_check(err, "[FAIL] Can't complete command queue - device formatting");
+
+    clReleaseMemObject(output_buffer);
+    clReleaseKernel(lengths_k);
+    clReleaseKernel(scan_k);
+    clReleaseKernel(rows_k);
+    return result;
+}
+
+int normalize_device_parse(const char * csv_pathname, const int * cols_array, int cols_array_dim, int log,
+                           cl_program ocl_program, cl_context ocl_context, cl_command_queue ocl_queue, cl_device_id ocl_device)
+{
+    cl_int err;
+    cl_event count_rows_event, scan_counts_event, find_rows_event, parse_fields_event, read_event;
+    struct timespec start, end;
+    size_t text_size, mapping_size;
+    char * mapping;
+    cl_ulong n_rows, max_alloc;
+    cl_uint align_bits;
+
+    err = clGetDeviceInfo(ocl_device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, NULL);
+    ocl_check(err, "[FAIL] Can't get the max allocation size - device parsing");
+    err = clGetDeviceInfo(ocl_device, CL_DEVICE_MEM_BASE_ADDR_ALIGN, sizeof(align_bits), &align_bits, NULL);
+    ocl_check(err, "[FAIL] Can't get the base address alignment - device parsing");
+
+    // The whole text must fit in a single device buffer, the host parses it otherwise:
+    struct stat csv_st;
+    if(stat(csv_pathname, &csv_st) != 0 || (cl_ulong) csv_st.st_size >= max_alloc){
+        fprintf(stdout, "[LOG] %s does not fit in a device buffer, it is parsed on the host\n", csv_pathname);
+        return 1;
+    }
+
+    // Slot of each column of the file in the matrix (-1 for the columns which are not parsed):
+    int n_slots = 0, n_parsed = 0;
+    for(int i = 0; i < cols_array_dim; ++i){
+        if(n_slots < cols_array[i]) n_slots = cols_array[i];
+    }
+    int * slots = (int *) malloc(sizeof(int) * n_slots);
+    for(int c = 0; c < n_slots; ++c) slots[c] = -1;
+    for(int i = 0; i < cols_array_dim; ++i){
+        if(cols_array[i] >= 1 && slots[cols_array[i] - 1] == -1) slots[cols_array[i] - 1] = n_parsed++;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    cl_mem text_buffer = upload_rows(csv_pathname, &text_size, &mapping, &mapping_size, ocl_context, ocl_queue, ocl_device);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if(text_buffer == NULL){
+        fprintf(stderr, "[FAIL] %s has no rows to parse\n", csv_pathname);
+        free(slots);
+        return -1;
+    }
+    const double upload_ms = (end.tv_sec - start.tv_sec) * 1.0e3 + (end.tv_nsec - start.tv_nsec) * 1.0e-6;
+    stagel_add(STAGEL_H2D, upload_ms);
+    tracel_span(stagel_name(STAGEL_H2D), start, end);
+
+    cl_kernel count_k = clCreateKernel(ocl_program, COUNT_ROWS_KERNEL_NAME, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel ", COUNT_ROWS_KERNEL_NAME);
+    cl_kernel scan_k = clCreateKernel(ocl_program, SCAN_COUNTS_KERNEL_NAME, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel ", SCAN_COUNTS_KERNEL_NAME);
+    cl_kernel find_k = clCreateKernel(ocl_program, FIND_ROWS_KERNEL_NAME, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel ", FIND_ROWS_KERNEL_NAME);
+    cl_kernel parse_k = clCreateKernel(ocl_program, PARSE_FIELDS_KERNEL_NAME, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel ", PARSE_FIELDS_KERNEL_NAME);
+
+    // Counting the rows of each segment of the text, and scanning the counts:
+    const cl_uint n_segments = N_WORK_GROUPS * N_WORK_ITEMS_PER_WORK_GROUP;
+    const cl_ulong segment = (text_size + n_segments - 1) / n_segments;
+
+    cl_mem counts_buffer = clCreateBuffer(ocl_context, CL_MEM_READ_WRITE | CL_MEM_HOST_READ_ONLY, (n_segments + 1) * sizeof(cl_ulong), NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the counts buffer - device parsing");
+    metricl_track_buffer(counts_buffer);
+
+    count_rows_event = launch_count_rows(count_k, ocl_queue, NULL, counts_buffer, text_buffer, text_size, segment,
+                                         N_WORK_ITEMS_PER_WORK_GROUP, N_WORK_GROUPS);
+    scan_counts_event = launch_scan_counts(scan_k, ocl_queue, count_rows_event, counts_buffer, n_segments, N_WORK_ITEMS_PER_WORK_GROUP);
+
+    // Only the number of rows is read back, to size the buffers of the rows:
+    err = clEnqueueReadBuffer(ocl_queue, counts_buffer, CL_TRUE, n_segments * sizeof(cl_ulong), sizeof(n_rows), &n_rows, 1, &scan_counts_event, &read_event);
+    ocl_check(err, "[FAIL] Can't read the number of rows from device");
+
+    // Columns padded to the base address alignment, so that each of them is a sub-buffer of the matrix:
+    const size_t align_elements = align_bits / 8 / sizeof(float) > 0 ? align_bits / 8 / sizeof(float) : 1;
+    const cl_ulong stride = round_mul_up(n_rows, align_elements);
+    if(n_rows == 0 || n_parsed == 0 || stride * n_parsed * sizeof(float) >= max_alloc || (n_rows + 1) * sizeof(cl_ulong) >= max_alloc){
+        fprintf(stdout, "[LOG] The columns of %s do not fit in a device buffer, they are parsed on the host\n", csv_pathname);
+        clReleaseMemObject(text_buffer);
+        clReleaseMemObject(counts_buffer);
+        if(mapping != NULL) munmap(mapping, mapping_size);
+        free(slots);
+        return 1;
+    }
+
+    cl_mem row_starts_buffer = clCreateBuffer(ocl_context, CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS, (n_rows + 1) * sizeof(cl_ulong), NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the row starts buffer - device parsing");
+    metricl_track_buffer(row_starts_buffer);
+    cl_mem slots_buffer = clCreateBuffer(ocl_context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR | CL_MEM_HOST_NO_ACCESS, n_slots * sizeof(cl_int), slots, &err);
+    ocl_check(err, "[FAIL] Can't create the slots buffer - device parsing");
+    metricl_track_buffer(slots_buffer);
+    cl_mem matrix_buffer = clCreateBuffer(ocl_context, CL_MEM_READ_WRITE, stride * n_parsed * sizeof(float), NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the matrix buffer - device parsing");
+    metricl_track_buffer(matrix_buffer);
+
+    // Finding every row, and parsing the selected fields into the column-major matrix:
+    find_rows_event = launch_find_rows(find_k, ocl_queue, scan_counts_event, row_starts_buffer, text_buffer, counts_buffer,
+                                       text_size, segment, N_WORK_ITEMS_PER_WORK_GROUP, N_WORK_GROUPS);
+    parse_fields_event = launch_parse_fields(parse_k, ocl_queue, ocl_device, find_rows_event, matrix_buffer, text_buffer,
+                                             row_starts_buffer, slots_buffer, n_slots, n_rows, stride);
+
+    err = clFinish(ocl_queue);
+    ocl_check(err, "[FAIL] Can't complete command queue - device parsing");
+    stagel_add(STAGEL_PARSE, total_runtime_ms(count_rows_event, parse_fields_event));
+    tracel_event(COUNT_ROWS_KERNEL_NAME, count_rows_event);
+    tracel_event(SCAN_COUNTS_KERNEL_NAME, scan_counts_event);
+    tracel_event("read", read_event);
+    tracel_event(FIND_ROWS_KERNEL_NAME, find_rows_event);
+    tracel_event(PARSE_FIELDS_KERNEL_NAME, parse_fields_event);
+
+    if(log == 1){
+        // Times and bandwidths check:
+        const double scan_ms = total_runtime_ms(count_rows_event, scan_counts_event);
+        const double find_ms = runtime_ms(find_rows_event);
+        const double parse_ms = runtime_ms(parse_fields_event);
+        const double parse_gbs = (text_size + n_rows * (sizeof(cl_ulong) + n_parsed * sizeof(float)))/1.0e6/parse_ms;
+
+        fprintf(stdout, "[LOG] Device parsing:    %llu rows, %d columns, %zu bytes || Upload: %.5f ms, %.5f GB/s (%s) - Scan: %.5f ms - Find rows: %.5f ms - Parse: %.5f ms, %.5f GB/s\n",
+                (unsigned long long) n_rows, n_parsed, text_size, upload_ms, text_size/1.0e6/upload_ms, mapping != NULL ? "zero-copy" : "copy",
+                scan_ms, find_ms, parse_ms, parse_gbs);
+    }
+
+    // CSV files normalized in place are formatted on the device too, unless OCL_DEVICE_FORMAT=0:
+    const char * const device_format_env = getenv("OCL_DEVICE_FORMAT");
+    const int device_format = output_writer == NULL && arrow_writer == NULL && !(device_format_env && strcmp(device_format_env, "0") == 0);
+
+    // The text is not needed anymore, only the matrix stays on the device (with the text, to format the rows):
+    if(!device_format){
+        clReleaseMemObject(text_buffer);
+        clReleaseMemObject(counts_buffer);
+        clReleaseMemObject(row_starts_buffer);
+        clReleaseMemObject(slots_buffer);
+        if(mapping != NULL) munmap(mapping, mapping_size);
+    }
+
+    int result = 0;
+    for(int i = 0; i < cols_array_dim && result == 0; ++i){
         fprintf(stdout, "\n");
+        if(cols_array[i] < 1){
+            fprintf(stderr, "[FAIL] Column %d is not valid\n", cols_array[i]);
+            result = -1;
+            break;
+        }
 
-        // Loading data from disk:
-        host_buffer = csvl_load_fcolumn(csv_pathname, cols_array[i], &n_elements);
-        if(host_buffer == NULL){
+        // Reducing and normalizing the column where it was parsed, in its sub-buffer of the matrix:
+        const cl_buffer_region region = { slots[cols_array[i] - 1] * stride * sizeof(float), n_rows * sizeof(float) };
+        cl_mem column_buffer = clCreateSubBuffer(matrix_buffer, CL_MEM_READ_WRITE, CL_BUFFER_CREATE_TYPE_REGION, &region, &err);
+        ocl_check(err, "[FAIL] Can't create the sub-buffer of column %d - device parsing", cols_array[i]);
+
+        if(device_format){
+            float max_min[2];
+            get_max_min_device(column_buffer, n_rows, max_min, log, ocl_program, ocl_context, ocl_queue);
+            clReleaseEvent(normalize_device(column_buffer, n_rows, max_min[0], max_min[1], log, ocl_program, ocl_queue, ocl_device));
+            clReleaseMemObject(column_buffer);
+            continue;
+        }
+
+        if(!device_unified_memory(ocl_device)) bytes_copied += region.size;
+        result = normalize_mapped(column_buffer, csv_pathname, cols_array[i], n_rows, log, ocl_program, ocl_context, ocl_queue, ocl_device);
+        if(result == -1) fprintf(stderr, "[FAIL] Can't write changes to disk for column %d\n", cols_array[i]);
+    }
+
+    if(device_format && result == 0){
+        fprintf(stdout, "\n");
+        result = write_device_rows(csv_pathname, text_buffer, row_starts_buffer, counts_buffer, matrix_buffer, slots_buffer,
+                                   slots, n_slots, n_rows, stride, max_alloc, log, ocl_program, ocl_context, ocl_queue, ocl_device);
+
+        // Rows that can't be formatted on the device are written by the host, one normalized column after the other:
+        for(int i = 0; i < cols_array_dim && result == 1; ++i){
+            const cl_buffer_region region = { slots[cols_array[i] - 1] * stride * sizeof(float), n_rows * sizeof(float) };
+            cl_mem column_buffer = clCreateSubBuffer(matrix_buffer, CL_MEM_READ_ONLY, CL_BUFFER_CREATE_TYPE_REGION, &region, &err);
+            ocl_check(err, "[FAIL] Can't create the sub-buffer of column %d - device parsing", cols_array[i]);
+
+            if(!device_unified_memory(ocl_device)) bytes_copied += region.size;
+            if(write_mapped(column_buffer, NULL, csv_pathname, cols_array[i], n_rows, ocl_queue) == -1){
+                fprintf(stderr, "[FAIL] Can't write changes to disk for column %d\n", cols_array[i]);
+                result = -1;
+            }
+            clReleaseMemObject(column_buffer);
+        }
+        if(result == 1) result = 0;
+    }
+    if(device_format){
+        clReleaseMemObject(text_buffer);
+        clReleaseMemObject(counts_buffer);
+        clReleaseMemObject(row_starts_buffer);
+        clReleaseMemObject(slots_buffer);
+        if(mapping != NULL) munmap(mapping, mapping_size);
+    }
+
+    free(slots);
+    clReleaseMemObject(matrix_buffer);
+    clReleaseKernel(count_k);
+    clReleaseKernel(scan_k);
+    clReleaseKernel(find_k);
+    clReleaseKernel(parse_k);
+    return result;
+}
+
+int normalize_multi_device(const char * csv_pathname, const int * cols_array, int cols_array_dim, csvl_cache * cache)
+{
+    int err;
+    sched_t * s = sched_create(KERNELS_PATHNAME);
+    sched_column * columns = (sched_column *) malloc(sizeof(sched_column) * cols_array_dim);
+
+    fprintf(stdout, "[LOG] START normalization of %s on %d devices\n", csv_pathname, s->n_workers);
+
+    // Loading every column, so that the devices can work on all of them together:
+    for(int i = 0; i < cols_array_dim; ++i){
+        columns[i].host_buffer = load_column(csv_pathname, cols_array[i], cache, &columns[i].n_elements);
+        if(columns[i].host_buffer == NULL){
             fprintf(stderr, "[FAIL] Can't load from disk column %d\n", cols_array[i]);
             fprintf(stderr, "[LOG] Exiting ...\n");
             return -1;
         }
+    }
 
-        // Normalizing Data using the GPU:
-        temp_max_min = get_max_min(host_buffer, n_elements, 1, prog, c, q);
+    // Normalizing Data using every device:
+    sched_max_min(s, columns, cols_array_dim, 1);
+    sched_normalize(s, columns, cols_array_dim, 1);
+
+    // Writing data to disk:
+    for(int i = 0; i < cols_array_dim; ++i){
+        fprintf(stdout, "[LOG] Writing changes to disk ...\n");
+        err = write_column(csv_pathname, columns[i].host_buffer, columns[i].n_elements, cols_array[i]);
+        if(err == -1){
+            fprintf(stderr, "[FAIL] Can't write changes to disk for column %d\n", cols_array[i]);
+            fprintf(stderr, "[LOG] Exiting ...\n");
+            return -1;
+        }
+        if(cache == NULL) free(columns[i].host_buffer);
+    }
+
+    if(close_output() == -1) return -1;
+    for(int i = 0; i < s->n_workers; ++i) bytes_copied += s->workers[i].bytes_copied;
+    fprintf(stdout, "\n[LOG] Bytes copied between host and device: %zu\n", bytes_copied);
+    fprintf(stdout, "[LOG] END normalization of %s\n", csv_pathname);
+
+    free(columns);
+    if(cache != NULL) csvl_cache_close(cache);
+    sched_release(s);
+    return 0;
+}
+
+static int compare_columns(const void * a, const void * b)
+{
+    return * (const int *) a - * (const int *) b;
+}
+
+int encode_columns(const char * csv_pathname, const int * encode_array, int encode_array_dim,
+                   int * cols_array, int cols_array_dim, int * group_column, int onehot, const char * dictionary_prefix)
+{
+    struct timespec start, end;
+    struct stat csv_stat;
+
+    // Parser threads filling each dictionary together (CSVL_THREADS, every online CPU by default):
+    const char * const threads_env = getenv("CSVL_THREADS");
+    const int n_threads = (threads_env && atoi(threads_env) > 0) ? atoi(threads_env) : (int) sysconf(_SC_NPROCESSORS_ONLN);
+
+    int * columns = (int *) malloc(sizeof(int) * encode_array_dim);
+    memcpy(columns, encode_array, sizeof(int) * encode_array_dim);
+    qsort(columns, encode_array_dim, sizeof(int), compare_columns);
+
+    dictl ** dictionaries = (dictl **) malloc(sizeof(dictl *) * encode_array_dim);
+    int ** codes = (int **) malloc(sizeof(int *) * encode_array_dim);
+    size_t * n_codes = (size_t *) malloc(sizeof(size_t) * encode_array_dim);
+    size_t onehot_size = 0;
+
+    fprintf(stdout, "[LOG] START %s encoding of %d columns of %s\n", onehot ? "one-hot" : "label", encode_array_dim, csv_pathname);
+
+    for(int i = 0; i < encode_array_dim; ++i){
+        // The codes of the previous runs are kept, new values are added after them:
+        char * dictionary_pathname = malloc(strlen(dictionary_prefix) + 32);
+        sprintf(dictionary_pathname, "%s.%d%s", dictionary_prefix, columns[i], DICTL_SUFFIX);
+
+        dictionaries[i] = dictl_load(dictionary_pathname);
+        if(dictionaries[i] == NULL) dictionaries[i] = dictl_create();
+        const int first_id = dictionaries[i]->n_keys;
+
+        fprintf(stdout, "\n");
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        codes[i] = csvl_load_codes(csv_pathname, columns[i], dictionaries[i], n_threads, &n_codes[i]);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        if(codes[i] == NULL || n_codes[i] == 0){
+            fprintf(stderr, "[FAIL] Can't encode column %d\n", columns[i]);
+            fprintf(stderr, "[LOG] Exiting ...\n");
+            return -1;
+        }
+
+        // Giving the new values their codes in sorted order, so that they do not depend on the threads:
+        int * remap = (int *) malloc(sizeof(int) * (dictionaries[i]->n_keys + 1));
+        dictl_sort(dictionaries[i], first_id, remap);
+        for(size_t r = 0; r < n_codes[i]; ++r) codes[i][r] = remap[codes[i][r]];
+        free(remap);
+
+        const double build_ms = (end.tv_sec - start.tv_sec) * 1.0e3 + (end.tv_nsec - start.tv_nsec) * 1.0e-6;
+        const double build_mbs = stat(csv_pathname, &csv_stat) == 0 ? csv_stat.st_size / 1.0e3 / build_ms : 0;
+
+        fprintf(stdout, "[LOG] Dictionary:        %zu values, %d keys (%d new), %.5f ms, %.2f Mvalues/s, %.2f MB/s\n",
+                n_codes[i], dictionaries[i]->n_keys, dictionaries[i]->n_keys - first_id, build_ms, n_codes[i] / 1.0e3 / build_ms, build_mbs);
+
+        if(dictl_save(dictionary_pathname, dictionaries[i]) == -1) return -1;
+        free(dictionary_pathname);
+
+        // Bytes added to the rows by the one-hot columns (at most the ones of their names):
+        char * name = csvl_column_name(csv_pathname, columns[i]);
+        for(int k = 0; onehot && k < dictionaries[i]->n_keys; ++k){
+            onehot_size += strlen(name) + strlen(dictl_key(dictionaries[i], k)) + 4;
+        }
+        free(name);
+    }
+
+    // Rows are never longer than ROW_MAX_SIZE, checked before any change to the file:
+    if(onehot && csvl_max_row_size(csv_pathname) + onehot_size >= ROW_MAX_SIZE){
+        fprintf(stderr, "[FAIL] One-hot columns need rows longer than %d bytes, label encoding can be used instead\n", ROW_MAX_SIZE);
+        fprintf(stderr, "[LOG] Exiting ...\n");
+        return -1;
+    }
+
+    // From the last column to the first, so that the one-hot columns do not move the ones still to encode:
+    fprintf(stdout, "\n");
+    for(int i = encode_array_dim - 1; i >= 0; --i){
+        fprintf(stdout, "[LOG] Writing changes to disk ...\n");
+        if(csvl_write_codes(csv_pathname, columns[i], codes[i], n_codes[i], dictionaries[i], onehot) == -1){
+            fprintf(stderr, "[FAIL] Can't write changes to disk for column %d\n", columns[i]);
+            fprintf(stderr, "[LOG] Exiting ...\n");
+            return -1;
+        }
+
+        // The one-hot columns move the following columns, the one of the groups too:
+        for(int j = 0; onehot && j < cols_array_dim; ++j){
+            if(cols_array[j] > columns[i]) cols_array[j] += dictionaries[i]->n_keys - 1;
+        }
+        if(onehot && group_column != NULL && * group_column > columns[i]) * group_column += dictionaries[i]->n_keys - 1;
+
+        free(codes[i]);
+        dictl_free(dictionaries[i]);
+    }
+
+    fprintf(stdout, "[LOG] END encoding of %s\n", csv_pathname);
+
+    free(columns);
+    free(dictionaries);
+    free(codes);
+    free(n_codes);
+    return 0;
+}
+
+// Float as the ordered integer used by the group kernels (see ordered_int in kernels.ocl):
+cl_int ordered_int(float value)
+{
+    cl_int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits >= 0 ? bits : bits ^ 0x7fffffff;
+}
+
+int normalize_groups(const char * csv_pathname, const int * cols_array, int cols_array_dim, int group_column, csvl_cache * cache)
+{
+    cl_int err;
+    struct timespec start, end;
+    size_t n_rows;
+    size_t n_elements;
+
+    // Mapping the keys of the group column to dense group ids while parsing:
+    dictl * groups = dictl_create();
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int * group_ids = csvl_load_groups(csv_pathname, group_column, groups, &n_rows);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if(group_ids == NULL || n_rows == 0){
+        fprintf(stderr, "[FAIL] Can't load from disk the groups of column %d\n", group_column);
+        fprintf(stderr, "[LOG] Exiting ...\n");
+        return -1;
+    }
+
+    const int n_groups = groups->n_keys;
+    fprintf(stdout, "[LOG] Grouping:          %zu rows, %d groups, %.5f ms\n", n_rows, n_groups,
+            (end.tv_sec - start.tv_sec) * 1.0e3 + (end.tv_nsec - start.tv_nsec) * 1.0e-6);
+
+    // Wrapped OpenCL boilerplate:
+    cl_platform_id p = select_platform();
+    cl_device_id d = select_device(p);
+    cl_context c = create_context(p, d);
+    cl_command_queue q = create_queue(c, d);
+    tracel_calibrate(q);
+    cl_program prog = create_kernels(c, d, n_rows);
+
+    cl_kernel reduce_k = clCreateKernel(prog, GROUP_MAX_MIN_FIND_KERNEL_NAME, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel ", GROUP_MAX_MIN_FIND_KERNEL_NAME);
+    cl_kernel normalize_k = clCreateKernel(prog, NORMALIZE_GROUPS_KERNEL_NAME, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel ", NORMALIZE_GROUPS_KERNEL_NAME);
+
+    // The group ids are copied once, and the max and min of each group stay on the device:
+    cl_mem group_buffer = clCreateBuffer(c, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR | CL_MEM_HOST_NO_ACCESS,
+                                         n_rows * sizeof(cl_int), group_ids, &err);
+    ocl_check(err, "[FAIL] Can't create the group buffer - normalizing groups");
+    metricl_track_buffer(group_buffer);
+    bytes_copied += n_rows * sizeof(cl_int);
+
+    cl_mem max_buffer = clCreateBuffer(c, CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS, n_groups * sizeof(cl_int), NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the max buffer - normalizing groups");
+    metricl_track_buffer(max_buffer);
+    cl_mem min_buffer = clCreateBuffer(c, CL_MEM_READ_WRITE | CL_MEM_HOST_NO_ACCESS, n_groups * sizeof(cl_int), NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the min buffer - normalizing groups");
+    metricl_track_buffer(min_buffer);
+
+    const cl_int lowest = ordered_int(-FLT_MAX);
+    const cl_int highest = ordered_int(FLT_MAX);
+
+    fprintf(stdout, "[LOG] START normalization of %s by the %d groups of column %d\n", csv_pathname, n_groups, group_column);
+
+    for(int i = 0; i < cols_array_dim; ++i){
+        cl_event fill_event[2], group_max_min_find_event, normalize_event, read_event;
+
+        fprintf(stdout, "\n");
+
+        // Loading data from disk:
+        float * host_buffer = load_column(csv_pathname, cols_array[i], cache, &n_elements);
+        if(host_buffer == NULL || n_elements != n_rows){
+            fprintf(stderr, "[FAIL] Can't load from disk column %d\n", cols_array[i]);
+            fprintf(stderr, "[LOG] Exiting ...\n");
+            return -1;
+        }
+
+        const size_t db_memsize = n_elements * sizeof(float);
+        cl_mem device_buffer = clCreateBuffer(c, CL_MEM_READ_WRITE | CL_MEM_COPY_HOST_PTR | CL_MEM_HOST_READ_ONLY,
+                                              db_memsize, host_buffer, &err);
+        ocl_check(err, "[FAIL] Can't create the device buffer - normalizing groups");
+        metricl_track_buffer(device_buffer);
+        bytes_copied += db_memsize;
+
+        // Resetting the max and min of every group:
+        err = clEnqueueFillBuffer(q, max_buffer, &lowest, sizeof(lowest), 0, n_groups * sizeof(cl_int), 0, NULL, fill_event);
+        ocl_check(err, "[FAIL] Can't reset the max of the groups");
+        err = clEnqueueFillBuffer(q, min_buffer, &highest, sizeof(highest), 0, n_groups * sizeof(cl_int), 1, fill_event, fill_event + 1);
+        ocl_check(err, "[FAIL] Can't reset the min of the groups");
+
+        // Reducing every group in a single pass, and normalizing each element with the max and min of its group:
+        group_max_min_find_event = launch_group_max_min_find(reduce_k, q, fill_event[1], max_buffer, min_buffer,
+                                                             device_buffer, group_buffer, n_elements,
+                                                             N_WORK_ITEMS_PER_WORK_GROUP, N_WORK_GROUPS);
+        normalize_event = launch_normalize_groups(normalize_k, q, d, group_max_min_find_event,
+                                                  device_buffer, max_buffer, min_buffer, group_buffer, n_elements);
+
+        // Reading data from device:
+        float * normalized_buffer = malloc(db_memsize);
+        err = clEnqueueReadBuffer(q, device_buffer, CL_TRUE, 0, db_memsize, normalized_buffer, 1, &normalize_event, &read_event);
+        ocl_check(err, "[FAIL] Can't read the normalized buffer from device");
+        bytes_copied += db_memsize;
+        tracel_event("fill", fill_event[0]);
+        tracel_event("fill", fill_event[1]);
+        tracel_event(GROUP_MAX_MIN_FIND_KERNEL_NAME, group_max_min_find_event);
+        tracel_event(NORMALIZE_GROUPS_KERNEL_NAME, normalize_event);
+        tracel_event("read", read_event);
+
+        // Times and bandwidths check:
+        const double reduce_ms = runtime_ms(group_max_min_find_event);
+        const double reduce_gbs = (n_elements * (sizeof(float) + sizeof(cl_int)) + n_groups * 2 * sizeof(cl_int))/1.0e6/reduce_ms;
+        const double normalize_ms = runtime_ms(normalize_event);
+        const double normalize_gbs = (n_elements * (sizeof(float) * 2 + sizeof(cl_int)))/1.0e6/normalize_ms;
+
+        fprintf(stdout, "[LOG] Group Max & Min:   %zu elements, %d groups, %.5f ms, %.5f GB/s\n", n_elements, n_groups, reduce_ms, reduce_gbs);
+        fprintf(stdout, "[LOG] Normalize groups:  %zu elements, %.5f ms, %.5f GB/s\n", n_elements, normalize_ms, normalize_gbs);
+
+        clReleaseMemObject(device_buffer);
+        if(cache == NULL) free(host_buffer);
+
+        // Writing data to disk:
+        fprintf(stdout, "[LOG] Writing changes to disk ...\n");
+        err = write_column(csv_pathname, normalized_buffer, n_elements, cols_array[i]);
+        free(normalized_buffer);
+        if(err == -1){
+            fprintf(stderr, "[FAIL] Can't write changes to disk for column %d\n", cols_array[i]);
+            fprintf(stderr, "[LOG] Exiting ...\n");
+            return -1;
+        }
+    }
+
+    fprintf(stdout, "\n");
+    if(close_output() == -1) return -1;
+    fprintf(stdout, "[LOG] Bytes copied between host and device: %zu\n", bytes_copied);
+    fprintf(stdout, "[LOG] END normalization of %s\n", csv_pathname);
+
+    free(group_ids);
+    dictl_free(groups);
+    if(cache != NULL) csvl_cache_close(cache);
+    clReleaseMemObject(group_buffer);
+    clReleaseMemObject(max_buffer);
+    clReleaseMemObject(min_buffer);
+    clReleaseKernel(reduce_k);
+    clReleaseKernel(normalize_k);
+    clReleaseProgram(prog);
+    clReleaseCommandQueue(q);
+    clReleaseContext(c);
+    return 0;
+}
+
+float * arrow_batch_column(arrowl_table * table, int batch, int field, float * temp_buffer)
+{
+    arrowl_batch * b = &table->batches[batch];
+
+    // Float32 columns are used in place, float64 ones are narrowed into the temporary buffer:
+    if(table->fields[field].precision == ARROWL_FLOAT32) return (float *) b->columns[field];
+
+    const double * column = (const double *) b->columns[field];
+    for(int64_t i = 0; i < b->length; ++i) temp_buffer[i] = (float) column[i];
+    return temp_buffer;
+}
+
+int arrow_fill_nulls(arrowl_table * table, int batch, int field, float * column)
+{
+    arrowl_batch * b = &table->batches[batch];
+    const uint8_t * validity = b->validity[field];
+    if(validity == NULL) return 1;
+
+    // Null slots have undefined values: they get a valid value of the batch, so that they do not change max and min:
+    int64_t first_valid = 0;
+    while(first_valid < b->length && !(validity[first_valid / 8] & (1 << (first_valid % 8)))) ++first_valid;
+    if(first_valid == b->length) return 0;
+
+    for(int64_t i = 0; i < b->length; ++i){
+        if(!(validity[i / 8] & (1 << (i % 8)))) column[i] = column[first_valid];
+    }
+    return 1;
+}
+
+int normalize_arrow(arrowl_table * table, const char * arrow_pathname, const int * cols_array, int cols_array_dim,
+                    const char * output_pathname, int output_format)
+{
+    cl_int err;
+
+    for(int i = 0; i < cols_array_dim; ++i){
+        if(cols_array[i] < 1 || cols_array[i] > table->n_fields){
+            fprintf(stderr, "[FAIL] Column %d does not exist in %s\n", cols_array[i], arrow_pathname);
+            return -1;
+        }
+    }
+
+    // Wrapped OpenCL boilerplate:
+    cl_platform_id p = select_platform();
+    cl_device_id d = select_device(p);
+    cl_context c = create_context(p, d);
+    cl_command_queue q = create_queue(c, d);
+    tracel_calibrate(q);
+
+    int64_t max_length = 0;
+    for(int b = 0; b < table->n_batches; ++b){
+        if(max_length < table->batches[b].length) max_length = table->batches[b].length;
+    }
+    cl_program prog = create_kernels(c, d, max_length);
+    float * temp_buffer = (float *) malloc(sizeof(float) * (max_length + 1));
+    float * max_min = (float *) malloc(sizeof(float) * 2 * cols_array_dim);
+
+    fprintf(stdout, "[LOG] START normalization of %s (Arrow, %d record batches)\n", arrow_pathname, table->n_batches);
+
+    // Reducing every record batch straight from the mapping and merging the partial max and min:
+    for(int i = 0; i < cols_array_dim; ++i){
+        const int field = cols_array[i] - 1;
+        max_min[2 * i] = -FLT_MAX;
+        max_min[2 * i + 1] = FLT_MAX;
+
+        for(int b = 0; b < table->n_batches; ++b){
+            const int n_elements = table->batches[b].length;
+            float * column = arrow_batch_column(table, b, field, temp_buffer);
+            float partial_max_min[2];
+
+            if(n_elements == 0 || !arrow_fill_nulls(table, b, field, column)) continue;
+
+            cl_mem device_buffer = clCreateBuffer(c, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, n_elements * sizeof(float), column, &err);
+            ocl_check(err, "[FAIL] Can't create the device buffer from the record batch - Arrow");
+            metricl_track_buffer(device_buffer);
+
+            get_max_min_device(device_buffer, n_elements, partial_max_min, 0, prog, c, q);
+            clReleaseMemObject(device_buffer);
+
+            if(max_min[2 * i] < partial_max_min[0]) max_min[2 * i] = partial_max_min[0];
+            if(max_min[2 * i + 1] > partial_max_min[1]) max_min[2 * i + 1] = partial_max_min[1];
+        }
+
+        fprintf(stdout, "[LOG] Getting Max & Min: field %s, %lld elements || Max: %f Min: %f\n",
+                table->fields[field].name, (long long) table->n_rows, max_min[2 * i], max_min[2 * i + 1]);
+    }
+
+    // Creating the output, the not normalized fields are copied as they are:
+    char * pathname;
+    if(output_pathname == NULL){
+        pathname = malloc(strlen(arrow_pathname) + 20);
+        sprintf(pathname, "%s.normalized%s", arrow_pathname, output_format == ARROWL_STREAM ? ".arrows" : ".arrow");
+    }
+    else{
+        pathname = user_pathname(output_pathname);
+    }
+
+    arrowl_writer * writer = arrowl_writer_open(pathname, output_format, table->fields, table->n_fields);
+    free(pathname);
+    if(writer == NULL) return -1;
+
+    // Normalizing every record batch in place and emitting it:
+    for(int b = 0; b < table->n_batches; ++b){
+        arrowl_batch * batch = &table->batches[b];
+        const int n_elements = batch->length;
+
+        for(int i = 0; i < cols_array_dim && n_elements > 0; ++i){
+            const int field = cols_array[i] - 1;
+            float * column = arrow_batch_column(table, b, field, temp_buffer);
+            arrow_fill_nulls(table, b, field, column);
+
+            cl_mem device_buffer = clCreateBuffer(c, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, n_elements * sizeof(float), column, &err);
+            ocl_check(err, "[FAIL] Can't create the device buffer from the record batch - Arrow");
+            metricl_track_buffer(device_buffer);
+
+            cl_event normalize_event = normalize_device(device_buffer, n_elements, max_min[2 * i], max_min[2 * i + 1], 0, prog, q, d);
+
+            // Mapping the buffer makes the normalized values visible in the host pointer:
+            float * mapped = clEnqueueMapBuffer(q, device_buffer, CL_TRUE, CL_MAP_READ, 0, n_elements * sizeof(float), 1, &normalize_event, NULL, &err);
+            ocl_check(err, "[FAIL] Can't map the record batch buffer - Arrow");
+            if(mapped != column) memcpy(column, mapped, n_elements * sizeof(float));
+
+            err = clEnqueueUnmapMemObject(q, device_buffer, mapped, 0, NULL, NULL);
+            ocl_check(err, "[FAIL] Can't unmap the record batch buffer - Arrow");
+            err = clFinish(q);
+            ocl_check(err, "[FAIL] Can't complete command queue - Arrow");
+
+            clReleaseEvent(normalize_event);
+            clReleaseMemObject(device_buffer);
+
+            // Widening the normalized values back for float64 fields:
+            if(table->fields[field].precision == ARROWL_FLOAT64){
+                double * wide_column = (double *) batch->columns[field];
+                for(int k = 0; k < n_elements; ++k) wide_column[k] = column[k];
+            }
+        }
+
+        if(arrowl_write_batch(writer, batch->length, batch->columns, batch->validity, batch->null_counts) != 0){
+            fprintf(stderr, "[FAIL] Can't write record batch %d\n", b);
+            return -1;
+        }
+        metricl_add(METRICL_ROWS, n_elements);
+        metricl_add(METRICL_VALUES, (uint64_t) n_elements * cols_array_dim);
+    }
+
+    fprintf(stdout, "[LOG] Writing:           %zu bytes (Arrow)\n", writer->position);
+    if(arrowl_writer_close(writer) != 0) return -1;
+    fprintf(stdout, "[LOG] Bytes copied between host and device: %zu\n", bytes_copied);
+    fprintf(stdout, "[LOG] END normalization of %s\n", arrow_pathname);
+
+    free(temp_buffer);
+    free(max_min);
+    arrowl_close(table);
+    clReleaseProgram(prog);
+    clReleaseCommandQueue(q);
+    clReleaseContext(c);
+    return 0;
+}
+
+int normalize_incremental(const char * csv_pathname, const int * cols_array, int cols_array_dim, const char * output_pathname)
+{
+    struct stat output_st;
+    uint64_t end_offset;
+    float ** new_rows = (float **) malloc(sizeof(float *) * cols_array_dim);
+
+    char * state_pathname = malloc(strlen(csv_pathname) + strlen(STATL_STATE_SUFFIX) + 1);
+    char * raw_pathname = malloc(strlen(csv_pathname) + strlen(STATL_RAW_SUFFIX) + 1);
+    sprintf(state_pathname, "%s%s", csv_pathname, STATL_STATE_SUFFIX);
+    sprintf(raw_pathname, "%s%s", csv_pathname, STATL_RAW_SUFFIX);
+
+    // Resuming from the state of the previous run, if it matches the columns and the output, and the source only grew since then:
+    struct stat csv_st;
+    statl_stats * state = statl_load(state_pathname);
+    if(state != NULL && stat(csv_pathname, &csv_st) == 0 && (uint64_t) csv_st.st_size < state->header.source_offset){
+        fprintf(stdout, "[LOG] %s is shorter than the rows already processed (truncated or rotated), starting from scratch\n", csv_pathname);
+        statl_free(state);
+        state = NULL;
+    }
+    if(state != NULL && !(statl_same_columns(state, cols_array, cols_array_dim) &&
+                          stat(output_pathname, &output_st) == 0 && (uint64_t) output_st.st_size == state->header.output_size)){
+        fprintf(stdout, "[LOG] The state of %s does not match this run, starting from scratch\n", csv_pathname);
+        statl_free(state);
+        state = NULL;
+    }
+    if(state == NULL){
+        state = statl_create(cols_array, cols_array_dim);
+        remove(raw_pathname);
+    }
+
+    const uint64_t offset = state->header.source_offset;
+    const int fresh = offset == 0;
+
+    fprintf(stdout, "[LOG] START incremental normalization of %s from byte %llu (%llu rows already processed)\n",
+            csv_pathname, (unsigned long long) offset, (unsigned long long) state->header.source_rows);
+
+    // Parsing only the appended rows:
+    const int64_t n_new = csvl_load_frows(csv_pathname, offset, cols_array, cols_array_dim, new_rows, &end_offset);
+    if(n_new <= 0){
+        if(n_new == 0){
+            fprintf(stdout, "[LOG] No new rows to normalize\n");
+            fprintf(stdout, "[LOG] END incremental normalization of %s\n", csv_pathname);
+        }
+        for(int i = 0; i < cols_array_dim && n_new == 0; ++i) free(new_rows[i]);
+        free(new_rows);
+        free(state_pathname);
+        free(raw_pathname);
+        statl_free(state);
+        return n_new == 0 ? 0 : -1;
+    }
+
+    // Wrapped OpenCL boilerplate:
+    cl_platform_id p = select_platform();
+    cl_device_id d = select_device(p);
+    cl_context c = create_context(p, d);
+    cl_command_queue q = create_queue(c, d);
+    tracel_calibrate(q);
+    cl_program prog = create_kernels(c, d, n_new);
+
+    // Reducing the new rows and merging them into the stored max and min:
+    int changed = 0;
+    for(int i = 0; i < cols_array_dim; ++i){
+        float * tail_max_min = get_max_min(new_rows[i], n_new, 1, prog, c, q);
+        changed |= statl_update(&state->columns[i], tail_max_min[0], tail_max_min[1], n_new);
+        free(tail_max_min);
+    }
+
+    FILE * output_fd = NULL;
+    int64_t written = -1;
+
+    if(fresh || !changed){
+        // Max and min did not change, so only the new rows must be normalized and appended:
+        fprintf(stdout, "[LOG] Max & Min %s: normalizing %lld new rows\n", fresh ? "computed" : "unchanged", (long long) n_new);
+
+        float ** normalized = (float **) malloc(sizeof(float *) * cols_array_dim);
+        for(int i = 0; i < cols_array_dim; ++i){
+            normalized[i] = normalize(new_rows[i], n_new, state->columns[i].max, state->columns[i].min, 1, prog, c, q, d);
+        }
+
+        output_fd = fopen(output_pathname, fresh ? "w" : "a");
+        written = output_fd == NULL ? -1 : csvl_write_frows(csv_pathname, output_fd, offset, end_offset, cols_array, cols_array_dim, normalized, n_new);
+
+        for(int i = 0; i < cols_array_dim; ++i) free(normalized[i]);
+        free(normalized);
+    }
+    else{
+        // Max or min changed: every row is normalized again, from the raw copy instead of the CSV text:
+        float ** all_rows = (float **) malloc(sizeof(float *) * cols_array_dim);
+        const int64_t n_old = statl_raw_load(raw_pathname, all_rows, cols_array_dim, n_new);
+        if(n_old != -1) fprintf(stdout, "[LOG] Max & Min changed: normalizing %lld rows again\n", (long long) (n_old + n_new));
+
+        for(int i = 0; i < cols_array_dim && n_old != -1; ++i){
+            memcpy(all_rows[i] + n_old, new_rows[i], sizeof(float) * n_new);
+            float * normalized = normalize(all_rows[i], n_old + n_new, state->columns[i].max, state->columns[i].min, 1, prog, c, q, d);
+            free(all_rows[i]);
+            all_rows[i] = normalized;
+        }
+
+        if(n_old != -1){
+            output_fd = fopen(output_pathname, "w");
+            written = output_fd == NULL ? -1 : csvl_write_frows(csv_pathname, output_fd, 0, end_offset, cols_array, cols_array_dim, all_rows, n_old + n_new);
+            for(int i = 0; i < cols_array_dim; ++i) free(all_rows[i]);
+        }
+        free(all_rows);
+    }
+
+    int result = 0;
+    if(output_fd != NULL && fclose(output_fd) != 0) written = -1;
+    if(written == -1){
+        fprintf(stderr, "[FAIL] Can't write the normalized rows to %s\n", output_pathname);
+        result = -1;
+    }
+
+    // Storing the raw new rows and the state only once the output is complete:
+    if(result == 0 && statl_raw_append(raw_pathname, new_rows, cols_array_dim, n_new) == -1) result = -1;
+
+    if(result == 0){
+        stat(output_pathname, &output_st);
+        state->header.source_offset = end_offset;
+        state->header.source_rows += n_new;
+        state->header.output_size = output_st.st_size;
+        if(statl_save(state_pathname, state) == -1) result = -1;
+    }
+
+    if(result == 0){
+        fprintf(stdout, "[LOG] Bytes copied between host and device: %zu\n", bytes_copied);
+        fprintf(stdout, "[LOG] END incremental normalization of %s: %llu rows in %s\n",
+                csv_pathname, (unsigned long long) state->header.source_rows, output_pathname);
+    }
+
+    for(int i = 0; i < cols_array_dim; ++i) free(new_rows[i]);
+    free(new_rows);
+    free(state_pathname);
+    free(raw_pathname);
+    statl_free(state);
+    clReleaseProgram(prog);
+    clReleaseCommandQueue(q);
+    clReleaseContext(c);
+    return result;
+}
+
+/*
+    Normalizing the columns of a CSV file into a separate CSV file, with every step recorded in
+    the journal of the job once it is durable: the max and min and the normalized values of
+    each column, then the chunks of the output. A run stopped halfway is resumed from the last
+    of them, and the output appears at its pathname only once it is complete.
+*/
+int normalize_journaled(const char * csv_pathname, const int * cols_array, int cols_array_dim, csvl_cache * cache,
+                        const char * output_pathname, int resume)
+{
+    struct timespec start;
+    size_t n_elements;
+
+    jobl_job * job = jobl_open(output_pathname, csv_pathname, cols_array, cols_array_dim, resume);
+    if(job == NULL){
+        if(cache != NULL) csvl_cache_close(cache);
+        return -1;
+    }
+
+    int n_done = 0;
+    for(int i = 0; i < cols_array_dim; ++i) n_done += job->column_done[i];
+
+    fprintf(stdout, "[LOG] START journaled normalization of %s into %s (%d of %d columns, %llu of %llu output chunks already done)\n",
+            csv_pathname, output_pathname, n_done, cols_array_dim,
+            (unsigned long long) job->output_chunks, (unsigned long long) job->header.n_chunks);
+
+    if(job->done){
+        fprintf(stdout, "[LOG] %s is already complete\n", output_pathname);
+        const int result = jobl_finish(job, output_pathname);
+        jobl_close(job);
+        if(cache != NULL) csvl_cache_close(cache);
+        return result;
+    }
+
+    // The device is only needed for the columns not normalized yet:
+    cl_context c = NULL;
+    cl_command_queue q = NULL;
+    cl_program prog = NULL;
+    cl_device_id d = NULL;
+
+    if(n_done < cols_array_dim){
+        struct stat csv_st;
+        size_t max_elements = cache != NULL ? cache->header.n_rows : SIZE_MAX;
+        if(cache == NULL && stat(csv_pathname, &csv_st) == 0) max_elements = csv_st.st_size / 2;
+
+        // Wrapped OpenCL boilerplate:
+        cl_platform_id p = select_platform();
+        d = select_device(p);
+        c = create_context(p, d);
+        q = create_queue(c, d);
+        tracel_calibrate(q);
+        prog = create_kernels(c, d, max_elements);
+    }
+
+    int result = 0;
+    for(int i = 0; result == 0 && i < cols_array_dim; ++i){
+        if(job->column_done[i]) continue;
+        fprintf(stdout, "\n");
+
+        // Loading data from disk:
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        float * host_buffer = load_column(csv_pathname, cols_array[i], cache, &n_elements);
+        stage_since(STAGEL_PARSE, start);
+        if(host_buffer == NULL){
+            fprintf(stderr, "[FAIL] Can't load from disk column %d\n", cols_array[i]);
+            result = -1;
+            break;
+        }
+
+        // Max and min of a previous run are not reduced again:
+        if(job->stats_done[i]){
+            fprintf(stdout, "[LOG] Max & Min of column %d from the journal\n", cols_array[i]);
+        }
+        else{
+            float * max_min = get_max_min(host_buffer, n_elements, 1, prog, c, q);
+            const int saved = jobl_save_stats(job, i, max_min[0], max_min[1]);
+            free(max_min);
+            if(saved != 0){
+                if(cache == NULL) free(host_buffer);
+                result = -1;
+                break;
+            }
+        }
+
+        float * normalized = normalize(host_buffer, n_elements, job->max[i], job->min[i], 1, prog, c, q, d);
+        if(cache == NULL) free(host_buffer);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        const int saved = jobl_save_column(job, i, normalized, n_elements);
+        stage_since(STAGEL_WRITE, start);
+        free(normalized);
+        if(saved != 0){
+            result = -1;
+            break;
+        }
+        metricl_add(METRICL_VALUES, n_elements);
+        account_rows(n_elements);
+    }
+    fprintf(stdout, "\n");
+
+    // The device and the cache are released whether every column is normalized or not:
+    if(prog != NULL){
+        clReleaseProgram(prog);
+        clReleaseCommandQueue(q);
+        clReleaseContext(c);
+    }
+    if(cache != NULL) csvl_cache_close(cache);
+    if(result == -1){
+        jobl_close(job);
+        return -1;
+    }
+
+    // Every column of the output, from the files of the job:
+    float ** columns = (float **) malloc(sizeof(float *) * cols_array_dim);
+    size_t n_rows = 0;
+    for(int i = 0; i < cols_array_dim; ++i){
+        columns[i] = jobl_load_column(job, i, &n_elements);
+        if(columns[i] == NULL || (i > 0 && n_elements != n_rows)){
+            fprintf(stderr, "[FAIL] Can't read the normalized column %d of the job\n", cols_array[i]);
+            free(columns);
+            jobl_close(job);
+            return -1;
+        }
+        n_rows = n_elements;
+    }
+
+    // Writing the rows chunk by chunk after the last checkpoint, each of them synced and recorded:
+    FILE * output_fd = jobl_open_output(job);
+    float ** buffers = (float **) malloc(sizeof(float *) * cols_array_dim);
+    result = output_fd == NULL ? -1 : 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for(uint64_t k = job->output_chunks; result == 0 && k < job->header.n_chunks; ++k){
+        uint64_t begin, end;
+        if(csvl_shard_range(csv_pathname, (int) k, (int) job->header.n_chunks, &begin, &end) == -1){
+            result = -1;
+            break;
+        }
+
+        // The header of the CSV file is copied with the first chunk:
+        if(k == 0) begin = 0;
+
+        // The chunk can't write more rows than the ones left in the columns:
+        const uint64_t rows_left = job->output_rows < n_rows ? n_rows - job->output_rows : 0;
+        for(int i = 0; i < cols_array_dim; ++i) buffers[i] = columns[i] + job->output_rows;
+        const int64_t written = csvl_write_frows(csv_pathname, output_fd, begin, end, cols_array, cols_array_dim, buffers, rows_left);
+        if(written == -1 || jobl_save_output(job, output_fd, k + 1, job->output_rows + written) != 0){
+            result = -1;
+        }
+    }
+    stage_since(STAGEL_WRITE, start);
+
+    if(result == 0 && job->output_rows != n_rows){
+        fprintf(stderr, "[FAIL] %llu rows written to %s instead of %zu\n", (unsigned long long) job->output_rows, output_pathname, n_rows);
+        result = -1;
+    }
+    if(output_fd != NULL && fclose(output_fd) != 0) result = -1;
+    if(result == 0) result = jobl_finish(job, output_pathname);
+
+    if(result == -1){
+        fprintf(stderr, "[FAIL] Can't write the normalized rows to %s\n", output_pathname);
+    }
+    else{
+        fprintf(stdout, "[LOG] Bytes copied between host and device: %zu\n", bytes_copied);
+        fprintf(stdout, "[LOG] END journaled normalization of %s: %zu rows written to %s\n", csv_pathname, n_rows, output_pathname);
+    }
+
+    free(buffers);
+    free(columns);
+    jobl_close(job);
+    return result;
+}
+
+int fit_stats(const char * csv_pathname, const int * cols_array, int cols_array_dim, const char * stats_pathname,
+              uint64_t begin, uint64_t end)
+{
+    int n_rows;
+    statl_stats * stats = statl_create(cols_array, cols_array_dim);
+
+    csvl_stream * stream = csvl_stream_open(csv_pathname, begin, end, cols_array, cols_array_dim, stream_chunk_rows());
+    if(stream == NULL){
+        statl_free(stats);
+        return -1;
+    }
+
+    // Wrapped OpenCL boilerplate:
+    cl_platform_id p = select_platform();
+    cl_device_id d = select_device(p);
+    cl_context c = create_context(p, d);
+    cl_command_queue q = create_queue(c, d);
+    tracel_calibrate(q);
+    cl_program prog = create_kernels(c, d, stream->capacity);
+
+    fprintf(stdout, "[LOG] START fit of %s (bytes %llu - %llu)\n", csv_pathname,
+            (unsigned long long) stream->position, (unsigned long long) (end == UINT64_MAX ? 0 : end));
+
+    // Reducing the file chunk by chunk, merging the partial max and min:
+    while((n_rows = csvl_stream_read(stream)) > 0){
+        for(int i = 0; i < cols_array_dim; ++i){
+            float * chunk_max_min = get_max_min(stream->buffers[i], n_rows, 0, prog, c, q);
+            statl_update(&stats->columns[i], chunk_max_min[0], chunk_max_min[1], n_rows);
+            free(chunk_max_min);
+        }
+    }
+
+    // Statistics of a part of a compressed file would be wrong:
+    int result = n_rows == -1 ? -1 : 0;
+
+    for(int i = 0; i < cols_array_dim; ++i){
+        fprintf(stdout, "[LOG] Getting Max & Min: column %d, %lld elements || Max: %f Min: %f\n",
+                stats->columns[i].column, (long long) stats->columns[i].count, stats->columns[i].max, stats->columns[i].min);
+    }
+
+    if(result == 0) result = statl_save(stats_pathname, stats);
+    if(result == 0) fprintf(stdout, "[LOG] END fit of %s, statistics written to %s\n", csv_pathname, stats_pathname);
+
+    csvl_stream_close(stream);
+    statl_free(stats);
+    clReleaseProgram(prog);
+    clReleaseCommandQueue(q);
+    clReleaseContext(c);
+    return result;
+}
+
+int transform_stats(const char * csv_pathname, const int * cols_array, int cols_array_dim,
+                    const char * stats_pathname, const char * output_pathname,
+                    uint64_t begin, uint64_t end, int write_header)
+{
+    int n_rows = 0;
+    statl_stats * stats = statl_load(stats_pathname);
+    if(stats == NULL){
+        fprintf(stderr, "[FAIL] Can't read the statistics %s\n", stats_pathname);
+        return -1;
+    }
+
+    // Every column to transform must have been fitted:
+    int result = 0;
+    int * stats_index = (int *) malloc(sizeof(int) * cols_array_dim);
+    for(int i = 0; i < cols_array_dim && result == 0; ++i){
+        stats_index[i] = statl_find(stats, cols_array[i]);
+        if(stats_index[i] == -1){
+            fprintf(stderr, "[FAIL] Column %d is not in the statistics %s\n", cols_array[i], stats_pathname);
+            result = -1;
+        }
+    }
+
+    csvl_stream * stream = result == 0 ? csvl_stream_open(csv_pathname, begin, end, cols_array, cols_array_dim, stream_chunk_rows()) : NULL;
+    if(stream == NULL) result = -1;
+
+    // Compressed on a thread if the output ends in .gz or .zst:
+    zipl_file * output_file = result == 0 ? zipl_open_write(output_pathname, zipl_format_of_name(output_pathname)) : NULL;
+    if(result == 0 && output_file == NULL){
+        fprintf(stderr, "[FAIL] Can't create %s\n", output_pathname);
+        result = -1;
+    }
+
+    // Everything acquired so far is released on the same path, whatever failed:
+    if(result == -1){
+        if(stream != NULL) csvl_stream_close(stream);
+        free(stats_index);
+        statl_free(stats);
+        return -1;
+    }
+    FILE * output_fd = output_file->fd;
+
+    // Wrapped OpenCL boilerplate:
+    cl_platform_id p = select_platform();
+    cl_device_id d = select_device(p);
+    cl_context c = create_context(p, d);
+    cl_command_queue q = create_queue(c, d);
+    tracel_calibrate(q);
+    cl_program prog = create_kernels(c, d, stream->capacity);
+
+    fprintf(stdout, "[LOG] START transform of %s with %s\n", csv_pathname, stats_pathname);
+
+    // One pass: every chunk is normalized with the stored max and min and written right away:
+    result = (write_header && fprintf(output_fd, "%s", stream->header) < 0) ? -1 : 0;
+    float ** normalized = (float **) malloc(sizeof(float *) * cols_array_dim);
+    long total_rows = 0;
+
+    while(result == 0 && (n_rows = csvl_stream_read(stream)) > 0){
+        for(int i = 0; i < cols_array_dim; ++i){
+            const statl_column * column = &stats->columns[stats_index[i]];
+            normalized[i] = normalize(stream->buffers[i], n_rows, column->max, column->min, 0, prog, c, q, d);
+        }
+
+        result = csvl_stream_write(stream, output_fd, normalized);
+        total_rows += n_rows;
+        metricl_add(METRICL_ROWS, n_rows);
+        metricl_add(METRICL_VALUES, (uint64_t) n_rows * cols_array_dim);
+
+        for(int i = 0; i < cols_array_dim; ++i) free(normalized[i]);
+    }
+    if(n_rows == -1) result = -1;
+
+    if(zipl_close(output_file) != 0) result = -1;
+    if(result == -1){
+        fprintf(stderr, "[FAIL] Can't write the normalized rows to %s\n", output_pathname);
+    }
+    else{
+        fprintf(stdout, "[LOG] Bytes copied between host and device: %zu\n", bytes_copied);
+        fprintf(stdout, "[LOG] END transform of %s: %ld rows written to %s\n", csv_pathname, total_rows, output_pathname);
+    }
+
+    free(normalized);
+    free(stats_index);
+    csvl_stream_close(stream);
+    statl_free(stats);
+    clReleaseProgram(prog);
+    clReleaseCommandQueue(q);
+    clReleaseContext(c);
+    return result;
+}
+
+int normalize_stream(FILE * output_fd, char ** cols_args, int n_cols_args, const char * stats_pathname, streaml_options * options)
+{
+    statl_stats * stats = NULL;
+    int * cols_array;
+    int cols_array_dim;
+
+    if(options->window < 0){
+        fprintf(stderr, "[FAIL] The window of %d rows is not valid, it must be positive\n", options->window);
+        return -1;
+    }
+    if((stats_pathname == NULL) == (options->window <= 0)){
+        fprintf(stderr, "[FAIL] Streaming needs either --stats or --window\n");
+        return -1;
+    }
+    if(options->batch_rows < 1 || options->batch_timeout_us < 0){
+        fprintf(stderr, "[FAIL] Micro-batches need at least one row and a timeout >= 0\n");
+        return -1;
+    }
+
+    if(stats_pathname != NULL){
+        stats = statl_load(stats_pathname);
+        if(stats == NULL){
+            fprintf(stderr, "[FAIL] Can't read the statistics %s\n", stats_pathname);
+            return -1;
+        }
+    }
+
+    // The columns are the given ones, or every column of the statistics:
+    if(n_cols_args > 0){
+        cols_array_dim = n_cols_args;
+        cols_array = (int *) malloc(sizeof(int) * cols_array_dim);
+        for(int i = 0; i < cols_array_dim; ++i){
+            cols_array[i] = atoi(cols_args[i]);
+            if(cols_array[i] < 1 || (stats != NULL && statl_find(stats, cols_array[i]) == -1)){
+                fprintf(stderr, "[FAIL] Column %s can't be streamed\n", cols_args[i]);
+                return -1;
+            }
+        }
+    }
+    else if(stats != NULL){
+        cols_array_dim = stats->header.n_columns;
+        cols_array = (int *) malloc(sizeof(int) * cols_array_dim);
+        for(int i = 0; i < cols_array_dim; ++i) cols_array[i] = stats->columns[i].column;
+    }
+    else{
+        fprintf(stderr, "[FAIL] Streaming with --window needs the columns to normalize\n");
+        return -1;
+    }
+
+    const int result = streaml_run(STDIN_FILENO, output_fd, cols_array, cols_array_dim, stats, options, KERNELS_PATHNAME);
+
+    fclose(output_fd);
+    free(cols_array);
+    if(stats != NULL) statl_free(stats);
+    return result;
+}
+
+int merge_stats(const char * stats_pathname, char ** partial_pathnames, int n_partials)
+{
+    statl_stats * stats = NULL;
+
+    // Merging the partial statistics in the given order (any order gives the same result):
+    for(int i = 0; i < n_partials; ++i){
+        char * pathname = user_pathname(partial_pathnames[i]);
+        statl_stats * partial = statl_load(pathname);
+        if(partial == NULL){
+            fprintf(stderr, "[FAIL] Can't read the statistics %s\n", pathname);
+            free(pathname);
+            if(stats != NULL) statl_free(stats);
+            return -1;
+        }
+        free(pathname);
+
+        if(stats == NULL){
+            stats = partial;
+            continue;
+        }
+        const int merged = statl_merge(stats, partial);
+        statl_free(partial);
+        if(merged == -1){
+            statl_free(stats);
+            return -1;
+        }
+    }
+
+    for(uint64_t i = 0; i < stats->header.n_columns; ++i){
+        fprintf(stdout, "[LOG] Merged Max & Min: column %d, %lld elements || Max: %f Min: %f\n",
+                stats->columns[i].column, (long long) stats->columns[i].count, stats->columns[i].max, stats->columns[i].min);
+    }
+
+    const int result = statl_save(stats_pathname, stats);
+    if(result == 0) fprintf(stdout, "[LOG] Merged %d statistics into %s\n", n_partials, stats_pathname);
+
+    statl_free(stats);
+    return result;
+}
+
+// Parsing the options of the daemon, the jobs are run by daemonl:
+int normalize_daemon(FILE * output_fd, char ** args, int n_args)
+{
+    char * socket_pathname = NULL;
+    daemonl_options options = {CSVNORM_SLOTS, (int) sysconf(_SC_NPROCESSORS_ONLN), ".."};
+
+    for(int a = 0; a < n_args; a += 2){
+        if(a + 1 >= n_args){
+            fprintf(stderr, "[FAIL] Option %s needs a value\n", args[a]);
+            free(socket_pathname);
+            return -1;
+        }
+        if(strcmp(args[a], "--socket") == 0){
+            free(socket_pathname);
+            socket_pathname = user_pathname(args[a + 1]);
+        }
+        else if(strcmp(args[a], "--slots") == 0) options.n_slots = atoi(args[a + 1]);
+        else if(strcmp(args[a], "--threads") == 0) options.n_threads = atoi(args[a + 1]);
+        else{
+            fprintf(stderr, "[FAIL] Unknown option %s\n", args[a]);
+            free(socket_pathname);
+            return -1;
+        }
+    }
+
+    const int result = daemonl_run(stdin, output_fd, socket_pathname, &options, KERNELS_PATHNAME, &bytes_copied);
+    fclose(output_fd);
+    free(socket_pathname);
+    return result;
+}
+
+// Parsing the options, the files and the columns of the batch, the files are normalized by daemonl:
+int normalize_batch(char ** args, int n_args)
+{
+    char * output_dir = NULL, * output_pathname = NULL, * list_pathname = NULL;
+    int in_place = 0;
+    daemonl_options options = {CSVNORM_SLOTS, (int) sysconf(_SC_NPROCESSORS_ONLN), ".."};
+
+    // Parsing the options, given before the files:
+    int a = 0;
+    for(; a < n_args && strncmp(args[a], "--", 2) == 0; a += 2){
+        if(strcmp(args[a], "--in-place") == 0){
+            in_place = 1;
+            --a;
+            continue;
+        }
+        if(a + 1 >= n_args){
+            fprintf(stdout, "[FAIL] Option %s needs a value\n", args[a]);
+            return -1;
+        }
+        if(strcmp(args[a], "--output-dir") == 0) output_dir = user_pathname(args[a + 1]);
+        else if(strcmp(args[a], "--output") == 0) output_pathname = user_pathname(args[a + 1]);
+        else if(strcmp(args[a], "--list") == 0) list_pathname = args[a + 1];
+        else if(strcmp(args[a], "--slots") == 0) options.n_slots = atoi(args[a + 1]);
+        else if(strcmp(args[a], "--threads") == 0) options.n_threads = atoi(args[a + 1]);
+        else{
+            fprintf(stdout, "[FAIL] Unknown option %s\n", args[a]);
+            return -1;
+        }
+    }
+    if((output_dir != NULL) + (output_pathname != NULL) + in_place != 1){
+        fprintf(stdout, "[FAIL] The batch needs exactly one of --output-dir, --output and --in-place\n");
+        return -1;
+    }
+
+    // The columns are the trailing indexes (every numeric column when none is given, or with ALL):
+    int n_trailing = 0;
+    for(const char * arg; a < n_args - n_trailing; ++n_trailing){
+        arg = args[n_args - n_trailing - 1];
+        if(strcmp(arg, "ALL") != 0 && !(arg[strspn(arg, "0123456789")] == '\0' && atoi(arg) >= 1)) break;
+    }
+    int n_columns = n_trailing;
+    int * columns = (int *) malloc(sizeof(int) * (n_trailing + 1));
+    for(int c = 0; c < n_trailing; ++c){
+        columns[c] = atoi(args[n_args - n_trailing + c]);
+        if(strcmp(args[n_args - n_trailing + c], "ALL") == 0) n_columns = 0;
+    }
+
+    // Files of the list (one per line, "-" for the standard input), of the arguments and of their glob patterns:
+    char ** csv_pathnames = NULL;
+    int n_files = 0, files_size = 0;
+    int result = 0;
+
+    if(list_pathname != NULL){
+        char * line = NULL;
+        size_t line_size = 0;
+        FILE * list_fd = strcmp(list_pathname, "-") == 0 ? stdin : fopen(list_pathname, "r");
+        if(list_fd == NULL){
+            fprintf(stdout, "[FAIL] Can't read the list %s\n", list_pathname);
+            result = -1;
+        }
+        while(result == 0 && getline(&line, &line_size, list_fd) != -1){
+            line[strcspn(line, "\r\n")] = '\0';
+            if(line[0] != '\0') result = daemonl_batch_add(options.root, line, &csv_pathnames, &n_files, &files_size);
+        }
+        free(line);
+        if(list_fd != NULL && list_fd != stdin) fclose(list_fd);
+    }
+    for(int i = a; i < n_args - n_trailing && result == 0; ++i){
+        result = daemonl_batch_add(options.root, args[i], &csv_pathnames, &n_files, &files_size);
+    }
+
+    if(result == 0){
+        result = daemonl_batch(csv_pathnames, n_files, output_dir, output_pathname, columns, n_columns,
+                               &options, KERNELS_PATHNAME, &bytes_copied);
+    }
+
+    for(int f = 0; f < n_files; ++f) free(csv_pathnames[f]);
+    free(csv_pathnames);
+    free(columns);
+    free(output_dir);
+    free(output_pathname);
+    return result;
+}
+
+int main(int argc, char *argv[]){
+    clock_gettime(CLOCK_MONOTONIC, &run_start);
+    const char * const stages_env = getenv("CSVL_STAGES");
+    if(stages_env && stages_env[0] != '\0'){
+        stages_pathname = user_pathname(stages_env);
+        atexit(write_stages);
+    }
+    const char * const trace_env = getenv("CSVL_TRACE");
+    if(trace_env && trace_env[0] != '\0'){
+        char * trace_pathname = user_pathname(trace_env);
+        if(tracel_open(trace_pathname) == 0) atexit(write_trace);
+        free(trace_pathname);
+    }
+    const char * const metrics_env = getenv("CSVL_METRICS");
+    if(metrics_env && metrics_env[0] != '\0'){
+        const char * const interval_env = getenv("CSVL_METRICS_INTERVAL");
+        char * metrics_pathname = user_pathname(metrics_env);
+        if(metricl_start(metrics_pathname, interval_env ? atof(interval_env) : 0, collect_metrics) == 0) atexit(write_metrics);
+        free(metrics_pathname);
+    }
+
+    // Streaming writes the normalized rows (and the daemon its replies) to the standard output, so every log goes to the standard error:
+    FILE * stream_output_fd = NULL;
+    if(argc > 1 && (strcmp(argv[1], "stream") == 0 || strcmp(argv[1], "daemon") == 0)){
+        fflush(stdout);
+        stream_output_fd = fdopen(dup(STDOUT_FILENO), "w");
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+        setvbuf(stdout, NULL, _IOLBF, 0);
+    }
+
+    printf("--------------------------------------------------\n");
+    printf("              PARALLEL NORMALIZATION              \n");
+    printf("--------------------------------------------------\n");
+
+    int err;
+
+    // Parsing the command (fit, transform or stream), given before the options:
+    char * program_name = argv[0];
+    char * command = NULL;
+    char * stats_pathname = NULL;
+
+    if(argc > 1 && (strcmp(argv[1], "fit") == 0 || strcmp(argv[1], "transform") == 0 || strcmp(argv[1], "stream") == 0)){
+        command = argv[1];
+        ++argv;
+        --argc;
+    }
+
+    // Normalizing the files of the jobs given to the daemon:
+    if(argc > 1 && strcmp(argv[1], "daemon") == 0){
+        return normalize_daemon(stream_output_fd, argv + 2, argc - 2);
+    }
+
+    // Normalizing a batch of files with one warm handle:
+    if(argc > 1 && strcmp(argv[1], "batch") == 0){
+        return normalize_batch(argv + 2, argc - 2);
+    }
+
+    // Merging the partial statistics of the shards:
+    if(argc > 1 && strcmp(argv[1], "merge-stats") == 0){
+        if(argc < 4){
+            fprintf(stdout, "[FAIL] Example of use: %s merge-stats stats_pathname partial_stats_pathname1 ... partial_stats_pathnameN\n", program_name);
+            return -1;
+        }
+        stats_pathname = user_pathname(argv[2]);
+        return merge_stats(stats_pathname, argv + 3, argc - 3);
+    }
+
+    // Parsing the options, given before the pathname:
+    char * output_format = "csv";
+    char * output_pathname = NULL;
+    int incremental = 0;
+    int resume = 0;
+    int shard = -1, n_shards = 0;
+    int group_column = -1;
+    int encoding = -1;
+    char * dictionary_prefix = NULL;
+    streaml_options stream_options = {STREAML_BATCH_ROWS, STREAML_BATCH_TIMEOUT_US, 0, 0};
+
+    while((argc > 2 || (stream_output_fd != NULL && argc > 1)) && strncmp(argv[1], "--", 2) == 0){
+        if(strcmp(argv[1], "--incremental") == 0 || strcmp(argv[1], "--cpu") == 0 || (strcmp(argv[1], "--resume") == 0 && command == NULL)){
+            if(strcmp(argv[1], "--incremental") == 0) incremental = 1;
+            else if(strcmp(argv[1], "--resume") == 0) resume = 1;
+            else stream_options.use_cpu = 1;
+            ++argv;
+            --argc;
+            continue;
+        }
+        if(argc < 3){
+            fprintf(stdout, "[FAIL] Option %s needs a value\n", argv[1]);
+            return -1;
+        }
+        if(strcmp(argv[1], "--format") == 0){
+            output_format = argv[2];
+        }
+        else if(strcmp(argv[1], "--output") == 0){
+            output_pathname = argv[2];
+        }
+        else if(strcmp(argv[1], "--stats") == 0 && stream_output_fd != NULL){
+            stats_pathname = user_pathname(argv[2]);
+        }
+        else if(strcmp(argv[1], "--window") == 0 && stream_output_fd != NULL){
+            stream_options.window = atoi(argv[2]);
+        }
+        else if(strcmp(argv[1], "--batch-rows") == 0 && stream_output_fd != NULL){
+            stream_options.batch_rows = atoi(argv[2]);
+        }
+        else if(strcmp(argv[1], "--batch-timeout-us") == 0 && stream_output_fd != NULL){
+            stream_options.batch_timeout_us = atol(argv[2]);
+        }
+        else if(strcmp(argv[1], "--encode") == 0 && command == NULL){
+            if(strcmp(argv[2], "label") == 0) encoding = 0;
+            else if(strcmp(argv[2], "onehot") == 0) encoding = 1;
+            else{
+                fprintf(stdout, "[FAIL] Unknown encoding %s, it must be label or onehot\n", argv[2]);
+                return -1;
+            }
+        }
+        else if(strcmp(argv[1], "--quantize") == 0 && command == NULL){
+            output_element = binl_element(argv[2]);
+            if(output_element == -1){
+                fprintf(stdout, "[FAIL] Unknown quantization %s, it must be u8, u16 or fp16\n", argv[2]);
+                return -1;
+            }
+        }
+        else if(strcmp(argv[1], "--dict") == 0 && command == NULL){
+            dictionary_prefix = user_pathname(argv[2]);
+        }
+        else if(strcmp(argv[1], "--group-by") == 0 && command == NULL){
+            group_column = atoi(argv[2]);
+        }
+        else if(strcmp(argv[1], "--shard") == 0 && command != NULL){
+            if(sscanf(argv[2], "%d/%d", &shard, &n_shards) != 2 || n_shards < 1 || shard < 0 || shard >= n_shards){
+                fprintf(stdout, "[FAIL] Shard %s is not valid, it must be i/N with 0 <= i < N\n", argv[2]);
+                return -1;
+            }
+        }
+        else{
+            fprintf(stdout, "[FAIL] Unknown option %s\n", argv[1]);
+            return -1;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+
+    // Normalizing the standard input into the standard output:
+    if(stream_output_fd != NULL){
+        return normalize_stream(stream_output_fd, argv + 1, argc - 1, stats_pathname, &stream_options);
+    }
+
+    // Statistics file of the command:
+    if(command != NULL && argc > 2){
+        stats_pathname = user_pathname(argv[1]);
+        ++argv;
+        --argc;
+    }
+
+    if(argc < 3 && !(command != NULL && strcmp(command, "transform") == 0 && argc == 2)){
+        fprintf(stdout, "[FAIL] Example of use: %s fit [--shard i/N] stats_pathname csv_pathname col_index1 ... col_indexN | ALL\n", program_name);
+        fprintf(stdout, "                       %s stream [--stats stats_pathname | --window rows] [--batch-rows rows] [--batch-timeout-us us] [--cpu] [col_index1 ... col_indexN] < input.csv > output.csv\n", program_name);
+        fprintf(stdout, "                       %s batch (--output-dir dir | --output pathname | --in-place) [--list pathname] [--slots n] [--threads n] csv_pathname_or_glob... [col_index1 ... col_indexN | ALL]\n", program_name);
+        fprintf(stdout, "                       %s daemon [--socket pathname] [--slots n] [--threads n] < jobs\n", program_name);
+        fprintf(stdout, "                       %s merge-stats stats_pathname partial_stats_pathname1 ... partial_stats_pathnameN\n", program_name);
+        fprintf(stdout, "                       %s transform [--shard i/N] [--output pathname] stats_pathname csv_pathname [col_index1 ... col_indexN]\n", program_name);
+        fprintf(stdout, "                       %s [--incremental | --group-by col_index] [--encode label|onehot] [--dict prefix] [--quantize u8|u16|fp16] [--format csv|npy|npy-columns|raw|arrow|arrow-stream] [--output pathname] [--resume] csv_or_arrow_pathname col_index1 col_index2 ... col_indexN \n", program_name);
+        fprintf(stdout, "                       %s [--incremental | --group-by col_index] [--encode label|onehot] [--dict prefix] [--quantize u8|u16|fp16] [--format csv|npy|npy-columns|raw|arrow|arrow-stream] [--output pathname] [--resume] csv_or_arrow_pathname ALL\n", program_name);
+        return -1;
+    }
+
+    int binary_format = -1;
+    const int arrow_format = arrowl_format(output_format);
+    if(strcmp(output_format, "csv") != 0 && arrow_format == -1){
+        binary_format = binl_format(output_format);
+        if(binary_format == -1){
+            fprintf(stdout, "[FAIL] Unknown output format %s\n", output_format);
+            return -1;
+        }
+    }
+
+    // Building the pathname:
+    char * suffix = "../";
+    char * temp_pathname = argv[1];
+
+    char * csv_pathname = malloc(strlen(suffix) + strlen(temp_pathname) + 1);
+    strcpy(csv_pathname, suffix);
+    strcat(csv_pathname, temp_pathname);
+    csv_pathname = realpath(csv_pathname, NULL);
+
+    // Consistency Check:
+    FILE * fd = fopen(csv_pathname, "r"); 
+    if(fd == NULL){
+        fprintf(stdout, "[FAIL] Given file does not exist\n");
+        return -1;
+    }
+    fclose(fd);
+
+    struct stat input_st;
+    metricl_add(METRICL_FILES, 1);
+    if(stat(csv_pathname, &input_st) == 0) metricl_add(METRICL_INPUT_BYTES, input_st.st_size);
+
+    // Arrow files are normalized record batch by record batch, into an Arrow output:
+    const int arrow_input = arrowl_is_arrow(csv_pathname);
+    arrowl_table * arrow_table = NULL;
+    if(arrow_input){
+        if(strcmp(output_format, "csv") != 0 && arrow_format == -1){
+            fprintf(stdout, "[FAIL] Arrow files can only be normalized into Arrow files\n");
+            return -1;
+        }
+        arrow_table = arrowl_open(csv_pathname);
+        if(arrow_table == NULL) return -1;
+    }
+
+    // Creating the array with the columns to normalize:
+    int * cols_array;
+    int cols_array_dim;
+
+    if(argc == 2){
+        // Transforming every column of the statistics:
+        statl_stats * stats = statl_load(stats_pathname);
+        if(stats == NULL){
+            fprintf(stdout, "[FAIL] Can't read the statistics %s\n", stats_pathname);
+            return -1;
+        }
+        cols_array_dim = stats->header.n_columns;
+        cols_array = (int *) malloc(sizeof(int) * cols_array_dim);
+
+        for(int i = 0; i<cols_array_dim; ++i){
+            cols_array[i] = stats->columns[i].column;
+        }
+        statl_free(stats);
+    }
+    else if(strcmp("ALL", argv[2]) == 0){
+        cols_array_dim = arrow_input ? arrow_table->n_fields : csvl_ncols(csv_pathname);
+        cols_array = (int *) malloc(sizeof(int) * cols_array_dim);
+
+        for(int i = 0; i<cols_array_dim; ++i){
+            cols_array[i] = i+1;
+        }
+    }
+    else{
+        cols_array_dim = argc - 2;
+        cols_array = (int *) malloc(sizeof(int) * cols_array_dim);
+
+        int current = 0;
+        for(int i = 0; i<cols_array_dim; ++i){
+            cols_array[i] = atoi(argv[i+2]);
+        }
+    }
+
+    // String columns of a CSV file are never parsed as numbers, they are encoded or skipped:
+    int * encode_array = NULL;
+    int encode_array_dim = 0;
+
+    if(!arrow_input){
+        int csv_ncols;
+        int * types = csvl_column_types(csv_pathname, &csv_ncols);
+        if(types == NULL) return -1;
+
+        encode_array = (int *) malloc(sizeof(int) * (cols_array_dim + 1));
+
+        int kept = 0;
+        for(int i = 0; i < cols_array_dim; ++i){
+            const int column = cols_array[i];
+
+            if(column < 1 || column > csv_ncols || types[column - 1] == CSVL_FLOAT || column == group_column){
+                cols_array[kept++] = column;
+            }
+            else if(encoding != -1){
+                encode_array[encode_array_dim++] = column;
+            }
+            else{
+                fprintf(stdout, "[LOG] Column %d is not numeric, skipped (it can be encoded with --encode)\n", column);
+            }
+        }
+        cols_array_dim = kept;
+        free(types);
+
+        if(cols_array_dim == 0 && encode_array_dim == 0){
+            fprintf(stdout, "[FAIL] No numeric column to normalize\n");
+            return -1;
+        }
+    }
+
+    if(encoding != -1 && (arrow_input || incremental || binary_format != -1 || arrow_format != -1)){
+        fprintf(stdout, "[FAIL] String columns are only encoded in place, in CSV files\n");
+        return -1;
+    }
+
+    // Groups are keyed by a column of the CSV file, which is never normalized itself:
+    if(group_column != -1){
+        if(arrow_input || incremental){
+            fprintf(stdout, "[FAIL] Group-wise normalization only reads CSV files, and is not incremental\n");
+            return -1;
+        }
+        if(group_column < 1 || group_column > csvl_ncols(csv_pathname)){
+            fprintf(stdout, "[FAIL] Group column %d is not valid\n", group_column);
+            return -1;
+        }
+
+        int kept = 0;
+        for(int i = 0; i < cols_array_dim; ++i){
+            if(cols_array[i] != group_column) cols_array[kept++] = cols_array[i];
+        }
+        cols_array_dim = kept;
+        if(cols_array_dim == 0){
+            fprintf(stdout, "[FAIL] No column to normalize by the groups of column %d\n", group_column);
+            return -1;
+        }
+    }
+
+    // Quantized columns are written as compact integers in CSV files, or as they are in binary files:
+    if(output_element != BINL_FLOAT32){
+        if(arrow_input || incremental || group_column != -1){
+            fprintf(stdout, "[FAIL] Quantized normalization only reads CSV files, and is neither incremental nor group-wise\n");
+            return -1;
+        }
+        if(arrow_format != -1 || (output_element == BINL_FLOAT16 && binary_format == -1)){
+            fprintf(stdout, "[FAIL] Quantized columns are written in CSV or binary formats (fp16 ones only in binary formats)\n");
+            return -1;
+        }
+    }
+
+    // A CSV output is written aside and journaled, so that the run can be resumed (the CSV file is normalized in place otherwise):
+    const int journaled = command == NULL && !arrow_input && !incremental && (resume || (output_pathname != NULL && binary_format == -1 && arrow_format == -1));
+    if(resume && (arrow_input || incremental)){
+        fprintf(stdout, "[FAIL] Only CSV files normalized into a separate CSV file are resumed (incremental runs resume on their own)\n");
+        return -1;
+    }
+    if(journaled && (binary_format != -1 || arrow_format != -1 || encode_array_dim > 0 || group_column != -1 || output_element != BINL_FLOAT32)){
+        fprintf(stdout, "[FAIL] Journaled normalization only writes float CSV files, without encoded, grouped or quantized columns\n");
+        return -1;
+    }
+
+    // Fitting the statistics, or applying them in a single streaming pass:
+    if(command != NULL){
+        if(arrow_input){
+            fprintf(stdout, "[FAIL] The %s command only reads CSV files\n", command);
+            return -1;
+        }
+
+        // A shard is a byte range of the rows, the whole file otherwise:
+        uint64_t begin = 0, end = UINT64_MAX;
+        if(shard != -1 && csvl_shard_range(csv_pathname, shard, n_shards, &begin, &end) == -1) return -1;
+
+        if(strcmp(command, "fit") == 0){
+            return fit_stats(csv_pathname, cols_array, cols_array_dim, stats_pathname, begin, end);
+        }
+
+        // Each shard writes its own segment of the output, to be concatenated in shard order:
+        char * pathname;
+        if(output_pathname == NULL){
+            pathname = malloc(strlen(csv_pathname) + 32);
+            if(shard == -1) sprintf(pathname, "%s.normalized.csv", csv_pathname);
+            else sprintf(pathname, "%s.normalized.csv.%d", csv_pathname, shard);
+        }
+        else{
+            pathname = user_pathname(output_pathname);
+        }
+
+        err = transform_stats(csv_pathname, cols_array, cols_array_dim, stats_pathname, pathname, begin, end, shard <= 0);
+        free(pathname);
+        return err;
+    }
+
+    // Every other mode reads the CSV file more than once, or at random:
+    if(!arrow_input && zipl_format(csv_pathname) != ZIPL_NONE){
+        fprintf(stdout, "[FAIL] %s is compressed: it is read by fit and transform, batch or the daemon\n", csv_pathname);
+        return -1;
+    }
+
+    if(arrow_input){
+        return normalize_arrow(arrow_table, csv_pathname, cols_array, cols_array_dim, output_pathname,
+                               arrow_format == -1 ? ARROWL_FILE : arrow_format);
+    }
+
+    // Append-only CSV files keep their state, and are normalized into a separate CSV file:
+    if(incremental){
+        if(binary_format != -1 || arrow_format != -1){
+            fprintf(stdout, "[FAIL] Incremental normalization only writes CSV files\n");
+            return -1;
+        }
+
+        char * pathname;
+        if(output_pathname == NULL){
+            pathname = malloc(strlen(csv_pathname) + 16);
+            sprintf(pathname, "%s.normalized.csv", csv_pathname);
+        }
+        else{
+            pathname = user_pathname(output_pathname);
+        }
+
+        err = normalize_incremental(csv_pathname, cols_array, cols_array_dim, pathname);
+        free(pathname);
+        return err;
+    }
+
+    // Encoding the string columns in place, before the numeric ones are normalized:
+    if(encode_array_dim > 0){
+        if(dictionary_prefix == NULL) dictionary_prefix = csv_pathname;
+
+        err = encode_columns(csv_pathname, encode_array, encode_array_dim, cols_array, cols_array_dim,
+                             group_column != -1 ? &group_column : NULL, encoding, dictionary_prefix);
+        if(err == -1 || cols_array_dim == 0) return err;
+        fprintf(stdout, "\n");
+    }
+
+    // Parsing the rows on the device (OCL_DEVICE_PARSE=1) instead of the host, for float columns:
+    const char * const device_parse_env = getenv("OCL_DEVICE_PARSE");
+    const int device_parse = device_parse_env && strcmp(device_parse_env, "1") == 0 && output_element == BINL_FLOAT32 && group_column == -1;
+
+    // Mapping the columnar cache of the CSV file, written on the first run (CSVL_CACHE=0 disables it, as device parsing does).
+    // A CSV file normalized in place changes right away, so a cache of it would never hit again:
+    const int in_place = !journaled && binary_format == -1 && arrow_format == -1;
+    csvl_cache * cache = NULL;
+    const char * const cache_env = getenv("CSVL_CACHE");
+    if(!(cache_env && strcmp(cache_env, "0") == 0) && !device_parse && !in_place){
+        struct timespec start;
+        struct stat before_st, after_st;
+        char * cache_pathname = malloc(strlen(csv_pathname) + strlen(CSVL_CACHE_SUFFIX) + 1);
+        sprintf(cache_pathname, "%s%s", csv_pathname, CSVL_CACHE_SUFFIX);
+        const int cached = stat(cache_pathname, &before_st) == 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        cache = csvl_cache_open(csv_pathname);
+        stage_since(STAGEL_PARSE, start);
+
+        // A cache written again is renamed over the old one, so a hit keeps the same file:
+        const int hit = cache != NULL && cached && stat(cache_pathname, &after_st) == 0 && after_st.st_ino == before_st.st_ino;
+        metricl_add(hit ? METRICL_CACHE_HITS : METRICL_CACHE_MISSES, 1);
+        free(cache_pathname);
+    }
+
+    // Creating the binary output, the CSV file is normalized in place otherwise:
+    if(binary_format != -1){
+        // Rows beyond 2^31 too, which the headers of the npy and raw files hold:
+        const int64_t n_rows = cache != NULL ? (int64_t) cache->header.n_rows : csvl_nrows(csv_pathname) - 1;
+        if(n_rows < 0) return -1;
+        char * pathname;
+
+        if(output_pathname == NULL){
+            // Default output next to the CSV file:
+            pathname = malloc(strlen(csv_pathname) + 8);
+            sprintf(pathname, "%s%s", csv_pathname, binary_format == BINL_RAW ? ".raw" : binary_format == BINL_NPY ? ".npy" : "");
+        }
+        else{
+            pathname = user_pathname(output_pathname);
+        }
+
+        output_writer = binl_open(pathname, binary_format, (size_t) n_rows, cols_array_dim, output_element);
+        free(pathname);
+        if(output_writer == NULL) return -1;
+    }
+
+    // Creating the Arrow output, with one float32 field for each normalized column:
+    if(arrow_format != -1){
+        arrowl_field * fields = (arrowl_field *) malloc(sizeof(arrowl_field) * cols_array_dim);
+        char * pathname;
+
+        for(int i = 0; i < cols_array_dim; ++i){
+            fields[i].name = csvl_column_name(csv_pathname, cols_array[i]);
+            fields[i].precision = ARROWL_FLOAT32;
+            if(fields[i].name == NULL) fields[i].name = strdup("");
+        }
+
+        if(output_pathname == NULL){
+            pathname = malloc(strlen(csv_pathname) + 8);
+            sprintf(pathname, "%s%s", csv_pathname, arrow_format == ARROWL_STREAM ? ".arrows" : ".arrow");
+        }
+        else{
+            pathname = user_pathname(output_pathname);
+        }
+
+        arrow_writer = arrowl_writer_open(pathname, arrow_format, fields, cols_array_dim);
+        for(int i = 0; i < cols_array_dim; ++i) free(fields[i].name);
+        free(fields);
+        free(pathname);
+        if(arrow_writer == NULL) return -1;
+
+        arrow_column_numbers = cols_array;
+        arrow_n_columns = cols_array_dim;
+        // Rows beyond 2^31 too, the batches are written ARROWL_BATCH_ROWS at a time (none if the file can't be read):
+        const int64_t n_rows = cache != NULL ? (int64_t) cache->header.n_rows : csvl_nrows(csv_pathname) - 1;
+        arrow_n_rows = n_rows > 0 ? (size_t) n_rows : 0;
+        arrow_columns = (float **) calloc(cols_array_dim, sizeof(float *));
+    }
+
+    if(journaled){
+        // Journaled runs parse every column on the host and normalize it on one device, whatever these ask for:
+        const char * const zero_copy_env = getenv("OCL_ZERO_COPY");
+        const char * const devices_env = getenv("OCL_DEVICES");
+        if((device_parse_env && strcmp(device_parse_env, "1") == 0) || (zero_copy_env && atoi(zero_copy_env) != 0) ||
+           (devices_env && devices_env[0] != '\0')){
+            fprintf(stdout, "[LOG] OCL_DEVICE_PARSE, OCL_ZERO_COPY and OCL_DEVICES are not used by journaled runs (--output)\n");
+        }
+
+        char * pathname;
+        if(output_pathname == NULL){
+            pathname = malloc(strlen(csv_pathname) + 16);
+            sprintf(pathname, "%s.normalized.csv", csv_pathname);
+        }
+        else{
+            pathname = user_pathname(output_pathname);
+        }
+
+        err = normalize_journaled(csv_pathname, cols_array, cols_array_dim, cache, pathname, resume);
+        free(pathname);
+        return err;
+    }
+
+    // Normalizing each group of rows with its own max and min:
+    if(group_column != -1){
+        return normalize_groups(csv_pathname, cols_array, cols_array_dim, group_column, cache);
+    }
+
+    // Spreading the columns over every selected device (quantized columns stay on the first one):
+    const char * const devices_env = getenv("OCL_DEVICES");
+    if(devices_env && devices_env[0] != '\0' && output_element == BINL_FLOAT32 && !device_parse){
+        return normalize_multi_device(csv_pathname, cols_array, cols_array_dim, cache);
+    }
+
+    // Rows of the columns, at most one every 2 bytes of the file ("0\n") without the cache:
+    struct stat csv_st;
+    size_t max_elements = cache != NULL ? cache->header.n_rows : SIZE_MAX;
+    if(cache == NULL && stat(csv_pathname, &csv_st) == 0) max_elements = csv_st.st_size / 2;
+
+    // Wrapped OpenCL boilerplate:
+    cl_platform_id p = select_platform();
+    cl_device_id d = select_device(p);
+    cl_context c = create_context(p, d);
+    cl_command_queue q = create_queue(c, d);
+    tracel_calibrate(q);
+    cl_program prog = create_kernels(c, d, max_elements);
+
+    size_t n_elements;
+    float * host_buffer;
+    float temp_max, temp_min;
+    float * temp_max_min;
+
+    // Parsing straight into device memory when the device shares it with the host:
+    const char * const zero_copy_env = getenv("OCL_ZERO_COPY");
+    int zero_copy = device_unified_memory(d);
+    if(zero_copy_env && zero_copy_env[0] != '\0'){
+        zero_copy = atoi(zero_copy_env);
+    }
+
+    // Quantized columns are read back from a separate device buffer, never mapped:
+    if(output_element != BINL_FLOAT32) zero_copy = 0;
+
+    // Parsing and normalizing every column on the device, unless the file does not fit in its memory:
+    int parsed = 0;
+    if(device_parse){
+        fprintf(stdout, "[LOG] START normalization of %s (device parsing)\n", csv_pathname);
+        err = normalize_device_parse(csv_pathname, cols_array, cols_array_dim, 1, prog, c, q, d);
+        if(err == -1){
+            fprintf(stderr, "[LOG] Exiting ...\n");
+            return -1;
+        }
+        parsed = err == 0;
+    }
+    if(!parsed) fprintf(stdout, "[LOG] START normalization of %s%s\n", csv_pathname, zero_copy ? " (zero-copy)" : "");
+
+    for(int i=0; i<cols_array_dim && !parsed; ++i)
+    {
+        fprintf(stdout, "\n");
+
+        if(zero_copy){
+            err = normalize_zero_copy(csv_pathname, cols_array[i], cache, 1, prog, c, q, d);
+            if(err == -1){
+                fprintf(stderr, "[FAIL] Can't normalize column %d\n", cols_array[i]);
+                fprintf(stderr, "[LOG] Exiting ...\n");
+                return -1;
+            }
+            continue;
+        }
+
+        // Loading data from disk:
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        host_buffer = load_column(csv_pathname, cols_array[i], cache, &n_elements);
+        stage_since(STAGEL_PARSE, start);
+        if(host_buffer == NULL){
+            fprintf(stderr, "[FAIL] Can't load from disk column %d\n", cols_array[i]);
+            fprintf(stderr, "[LOG] Exiting ...\n");
+            return -1;
+        }
+
+        // Normalizing Data using the GPU:
+        temp_max_min = get_max_min(host_buffer, n_elements, 1, prog, c, q);
+
+        if(output_element != BINL_FLOAT32){
+            void * quantized_buffer = normalize_quantized(host_buffer, n_elements, temp_max_min[0], temp_max_min[1], output_element, 1, prog, c, q, d);
+
+            fprintf(stdout, "[LOG] Writing changes to disk ...\n");
+            err = write_column(csv_pathname, quantized_buffer, n_elements, cols_array[i]);
+            free(quantized_buffer);
+            if(err == -1){
+                fprintf(stderr, "[FAIL] Can't write changes to disk for column %d\n", cols_array[i]);
+                fprintf(stderr, "[LOG] Exiting ...\n");
+                return -1;
+            }
+            continue;
+        }
 
         host_buffer = normalize(host_buffer, n_elements, temp_max_min[0], temp_max_min[1], 1, prog, c, q, d);
 
         // Writing data to disk:
         fprintf(stdout, "[LOG] Writing changes to disk ...\n");
-        err = csvl_write_fcolumn(csv_pathname, host_buffer, n_elements, cols_array[i]);
+        err = write_column(csv_pathname, host_buffer, n_elements, cols_array[i]);
         if(err == -1){
             fprintf(stderr, "[FAIL] Can't write changes to disk for column %d\n", cols_array[i]);
             fprintf(stderr, "[LOG] Exiting ...\n");
@@ -341,8 +2817,12 @@ int main(int argc, char *argv[]){
         }
     }
 
-    fprintf(stdout, "\n[LOG] END normalization of %s\n", csv_pathname);
+    fprintf(stdout, "\n");
+    if(close_output() == -1) return -1;
+    fprintf(stdout, "[LOG] Bytes copied between host and device: %zu\n", bytes_copied);
+    fprintf(stdout, "[LOG] END normalization of %s\n", csv_pathname);
 
+    if(cache != NULL) csvl_cache_close(cache);
     clReleaseProgram(prog);
     clReleaseCommandQueue(q);
     clReleaseContext(c);
@@ -45,13 +45,13 @@ int test_nrows(){
 
 void test_load_fcolumn(){
     int n_rows = test_nrows();
-    int n_elements;
+    size_t n_elements;
     float * float_column_buffer = csvl_load_fcolumn(csv_test_pathname, 2, &n_elements);
-    if(n_elements != n_rows - 1){
+    if(n_elements != (size_t) (n_rows - 1)){
         fprintf(stderr, "[CSVL TEST][FAIL] Error loading a float column of the CSV file\n");
         return;
     }
-    for(int i = 0; i < n_elements; ++i){
+    for(size_t i = 0; i < n_elements; ++i){
         if(float_column_buffer[i] != FLOAT_ARRAY_TEST[i]){
             fprintf(stderr, "[CSVL TEST][FAIL] Error loading a float column of the CSV file\n");
             return;
@@ -65,13 +65,13 @@ void test_write_fcolumn(){
     csvl_write_fcolumn(csv_test_pathname, SAMPLE_BUFFER, SAMPLE_BUFFER_DIM, 2);
 
     int n_rows = test_nrows();
-    int n_elements;
+    size_t n_elements;
     float * float_column_buffer = csvl_load_fcolumn(csv_test_pathname, 2, &n_elements);
-    if(n_elements != n_rows - 1){
+    if(n_elements != (size_t) (n_rows - 1)){
         fprintf(stderr, "[CSVL TEST][FAIL] Error loading an ovverode float column of the CSV file\n");
         return;
     }
-    for(int i = 0; i < n_elements; ++i){
+    for(size_t i = 0; i < n_elements; ++i){
         if(float_column_buffer[i] != SAMPLE_BUFFER[i]){
             fprintf(stderr, "[CSVL TEST][FAIL] Error loading an overrode float column of the CSV file\n");
             return;
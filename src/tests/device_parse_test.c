@@ -0,0 +1,188 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    device_parse_test.c
+    C program for testing the parsing and the formatting of a CSV file on the OpenCL device:
+    the normalized columns and the rewritten rows must be the same as the host ones
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Data for Testing:
+
+char CSV_PATHNAME_TEST[]    = "data/credit_card_fraud_PCA.csv";
+char HOST_OUTPUT_TEST[]     = "data/device_parse_test_host.raw";
+char DEVICE_OUTPUT_TEST[]   = "data/device_parse_test_device.raw";
+char HOST_CSV_TEST[]        = "data/device_parse_test_host.csv";
+char DEVICE_CSV_TEST[]      = "data/device_parse_test_device.csv";
+char main_directory[]       = "..";
+char project_directory[]    = "../..";
+
+// Running main on every column of the file, parsed by the host or by the device, into a raw file (in place without it):
+int run_main(const char * csv_pathname, char * output_pathname, const char * device_parse)
+{
+    // The child must not write again what is still buffered:
+    fflush(stdout);
+    const pid_t pid = fork();
+    if(pid == 0){
+        setenv("OCL_DEVICE_PARSE", device_parse, 1);
+        setenv("CSVL_CACHE", "0", 1);
+
+        // Logs are not needed, only the output file:
+        if(freopen("/dev/null", "w", stdout) == NULL) exit(127);
+
+        char * args[] = {"./main", "--format", "raw", "--output", output_pathname, (char *) csv_pathname, "ALL", NULL};
+        char * in_place_args[] = {"./main", (char *) csv_pathname, "ALL", NULL};
+
+        // main runs in bin, as usual, to find the kernels:
+        if(chdir(main_directory) == 0) execv("./main", output_pathname != NULL ? args : in_place_args);
+        exit(127);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+// Reading a whole file, relative to the root of the project:
+char * read_file(const char * pathname, size_t * size)
+{
+    char * full_pathname = malloc(strlen(project_directory) + strlen(pathname) + 2);
+    sprintf(full_pathname, "%s/%s", project_directory, pathname);
+
+    FILE * fd = fopen(full_pathname, "rb");
+    free(full_pathname);
+    if(fd == NULL) return NULL;
+
+    fseek(fd, 0, SEEK_END);
+    * size = ftell(fd);
+    fseek(fd, 0, SEEK_SET);
+
+    char * content = malloc(* size + 1);
+    if(fread(content, 1, * size, fd) != * size){
+        free(content);
+        content = NULL;
+    }
+    fclose(fd);
+    return content;
+}
+
+// Writing a whole file, relative to the root of the project:
+int write_file(const char * pathname, const char * content, size_t size)
+{
+    char * full_pathname = malloc(strlen(project_directory) + strlen(pathname) + 2);
+    sprintf(full_pathname, "%s/%s", project_directory, pathname);
+
+    FILE * fd = fopen(full_pathname, "wb");
+    free(full_pathname);
+    if(fd == NULL) return -1;
+
+    const int result = fwrite(content, 1, size, fd) == size ? 0 : -1;
+    fclose(fd);
+    return result;
+}
+
+void remove_output(const char * pathname)
+{
+    char * full_pathname = malloc(strlen(project_directory) + strlen(pathname) + 2);
+    sprintf(full_pathname, "%s/%s", project_directory, pathname);
+    remove(full_pathname);
+    free(full_pathname);
+}
+
+// Routines for Testing:
+
+int test_device_parse(const char * csv_pathname)
+{
+    size_t host_size, device_size;
+
+    if(run_main(csv_pathname, HOST_OUTPUT_TEST, "0") != 0 || run_main(csv_pathname, DEVICE_OUTPUT_TEST, "1") != 0){
+        fprintf(stderr, "[DEVICE PARSE TEST][FAIL] Can't normalize %s\n", csv_pathname);
+        return -1;
+    }
+
+    char * host_output = read_file(HOST_OUTPUT_TEST, &host_size);
+    char * device_output = read_file(DEVICE_OUTPUT_TEST, &device_size);
+    remove_output(HOST_OUTPUT_TEST);
+    remove_output(DEVICE_OUTPUT_TEST);
+
+    if(host_output == NULL || device_output == NULL || host_size != device_size){
+        fprintf(stderr, "[DEVICE PARSE TEST][FAIL] The outputs of %s have different sizes\n", csv_pathname);
+        return -1;
+    }
+
+    // Every byte of the normalized columns (and of the header) must be the same:
+    size_t different = 0;
+    for(size_t i = 0; i < host_size; ++i){
+        if(host_output[i] != device_output[i]) ++different;
+    }
+    free(host_output);
+    free(device_output);
+
+    if(different > 0){
+        fprintf(stderr, "[DEVICE PARSE TEST][FAIL] %zu of %zu bytes of the outputs of %s are different\n", different, host_size, csv_pathname);
+        return -1;
+    }
+
+    fprintf(stdout, "[DEVICE PARSE TEST][OK] The columns of %s parsed on the device are the same as the host ones (%zu bytes)\n",
+            csv_pathname, host_size);
+    return 0;
+}
+
+int test_device_format(const char * csv_pathname)
+{
+    size_t csv_size, host_size, device_size;
+
+    // Normalizing two copies of the file in place:
+    char * csv = read_file(csv_pathname, &csv_size);
+    if(csv == NULL || write_file(HOST_CSV_TEST, csv, csv_size) != 0 || write_file(DEVICE_CSV_TEST, csv, csv_size) != 0){
+        fprintf(stderr, "[DEVICE PARSE TEST][FAIL] Can't copy %s\n", csv_pathname);
+        free(csv);
+        return -1;
+    }
+    free(csv);
+
+    if(run_main(HOST_CSV_TEST, NULL, "0") != 0 || run_main(DEVICE_CSV_TEST, NULL, "1") != 0){
+        fprintf(stderr, "[DEVICE PARSE TEST][FAIL] Can't normalize %s in place\n", csv_pathname);
+        remove_output(HOST_CSV_TEST);
+        remove_output(DEVICE_CSV_TEST);
+        return -1;
+    }
+
+    char * host_output = read_file(HOST_CSV_TEST, &host_size);
+    char * device_output = read_file(DEVICE_CSV_TEST, &device_size);
+    remove_output(HOST_CSV_TEST);
+    remove_output(DEVICE_CSV_TEST);
+
+    // The rows formatted by the device must be the same, byte by byte, as the ones written by the host:
+    const int same = host_output != NULL && device_output != NULL && host_size == device_size &&
+                     memcmp(host_output, device_output, host_size) == 0;
+    free(host_output);
+    free(device_output);
+
+    if(!same){
+        fprintf(stderr, "[DEVICE PARSE TEST][FAIL] The rows of %s formatted on the device are different from the host ones\n", csv_pathname);
+        return -1;
+    }
+
+    fprintf(stdout, "[DEVICE PARSE TEST][OK] The rows of %s formatted on the device are the same as the host ones (%zu bytes)\n",
+            csv_pathname, host_size);
+    return 0;
+}
+
+int main(int argc, char * argv[]){
+    // CSV file to parse, relative to the root of the project (the fraud dataset by default):
+    const char * csv_pathname = argc > 1 ? argv[1] : CSV_PATHNAME_TEST;
+
+    const int parse_result = test_device_parse(csv_pathname);
+    const int format_result = test_device_format(csv_pathname);
+
+    return parse_result == 0 && format_result == 0 ? 0 : 1;
+}
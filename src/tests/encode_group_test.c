@@ -0,0 +1,116 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    encode_group_test.c
+    C program for testing one-hot encoding together with group-wise normalization:
+    the one-hot columns move the column of the groups, which must still key the groups
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// Data for Testing:
+
+char CSV_PATHNAME_TEST[]    = "data/encode_group_test.csv";
+char DICTIONARY_TEST[]      = "data/encode_group_test.csv.2.csvld";
+char main_directory[]       = "..";
+char project_directory[]    = "../..";
+
+// A string column (2) before the column of the groups (4):
+char CSV_TEST[] =
+    "a,city,v,g\n"
+    "1,x,10,1\n"
+    "2,y,20,1\n"
+    "3,z,30,2\n"
+    "4,x,50,2\n"
+    "5,y,40,1\n";
+
+// Columns 1 and 3 normalized within the groups of column 4, whatever the city of the row:
+char EXPECTED_TEST[] =
+    "a,\"city=x\",\"city=y\",\"city=z\",v,g\n"
+    "0.000000,1,0,0,0.000000,1\n"
+    "0.250000,0,1,0,0.333333,1\n"
+    "0.000000,0,0,1,0.000000,2\n"
+    "1.000000,1,0,0,1.000000,2\n"
+    "1.000000,0,1,0,1.000000,1\n";
+
+// Running main in place, with one-hot encoding and the groups of column 4:
+int run_main(const char * csv_pathname)
+{
+    // The child must not write again what is still buffered:
+    fflush(stdout);
+    const pid_t pid = fork();
+    if(pid == 0){
+        // Logs are not needed, only the output file:
+        if(freopen("/dev/null", "w", stdout) == NULL) exit(127);
+
+        char * args[] = {"./main", "--encode", "onehot", "--group-by", "4", (char *) csv_pathname, "ALL", NULL};
+
+        // main runs in bin, as usual, to find the kernels:
+        if(chdir(main_directory) == 0) execv("./main", args);
+        exit(127);
+    }
+
+    int status;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+// Full pathname of a file relative to the root of the project:
+char * project_pathname(const char * pathname)
+{
+    char * full_pathname = malloc(strlen(project_directory) + strlen(pathname) + 2);
+    sprintf(full_pathname, "%s/%s", project_directory, pathname);
+    return full_pathname;
+}
+
+// Routines for Testing:
+
+int test_encode_group()
+{
+    char * csv_pathname = project_pathname(CSV_PATHNAME_TEST);
+    char * dictionary_pathname = project_pathname(DICTIONARY_TEST);
+    char content[sizeof(EXPECTED_TEST) * 2];
+    size_t size = 0;
+
+    FILE * fd = fopen(csv_pathname, "w");
+    const int written = fd != NULL && fputs(CSV_TEST, fd) >= 0;
+    if(fd != NULL) fclose(fd);
+    remove(dictionary_pathname);
+
+    const int run = written && run_main(CSV_PATHNAME_TEST) == 0;
+
+    fd = run ? fopen(csv_pathname, "r") : NULL;
+    if(fd != NULL){
+        size = fread(content, 1, sizeof(content) - 1, fd);
+        fclose(fd);
+    }
+    content[size] = '\0';
+
+    remove(csv_pathname);
+    remove(dictionary_pathname);
+    free(csv_pathname);
+    free(dictionary_pathname);
+
+    if(!run){
+        fprintf(stderr, "[ENCODE GROUP TEST][FAIL] Can't encode and normalize %s\n", CSV_PATHNAME_TEST);
+        return -1;
+    }
+    if(strcmp(content, EXPECTED_TEST) != 0){
+        fprintf(stderr, "[ENCODE GROUP TEST][FAIL] The groups of %s are not the ones of column 4:\n%s", CSV_PATHNAME_TEST, content);
+        return -1;
+    }
+
+    fprintf(stdout, "[ENCODE GROUP TEST][OK] One-hot columns before the column of the groups do not change the groups\n");
+    return 0;
+}
+
+int main(){
+    return test_encode_group() == 0 ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    kernel_index64_test.c
+    C program for testing the 64 bits index kernels: one reduction and one normalize
+    launch over more than 2^31 elements, each element of the normalized buffer checked
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include "../libs/ocl_wrapper/ocl_wrapper.h"
+#include "../libs/kernel_launchers/kernel_launchers.h"
+
+// Data for Testing:
+
+uint64_t N_ELEMENTS_TEST    = 2147483648ULL + 1048576 + 3;
+float    MAX_TEST           = 7.0f;
+float    MIN_TEST           = -3.0f;
+char     KERNELS_PATHNAME[] = "../../src/kernels/kernels.ocl";
+char     BUFFER_PATHNAME[]  = "../../data/kernel_index64_test.f32";
+
+/*
+    Every element is 0 but the max, the last one, and the min, the one after 2^31 (in the
+    middle of smaller buffers): both are only reached by indexes a 32 bits int can't hold
+*/
+uint64_t min_index_of(uint64_t n_elements){
+    return n_elements > 2147483648ULL + 1 ? 2147483648ULL + 1 : n_elements / 2;
+}
+
+/*
+    Mapping a sparse file of n_elements floats, so that the buffer needs neither that much memory
+    nor writing its zeros: the device buffer is created on it (CL_MEM_USE_HOST_PTR).
+*/
+float * map_elements(uint64_t n_elements){
+    const int fd = open(BUFFER_PATHNAME, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) return NULL;
+
+    void * data = MAP_FAILED;
+    if(ftruncate(fd, n_elements * sizeof(float)) == 0){
+        data = mmap(NULL, n_elements * sizeof(float), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    return data == MAP_FAILED ? NULL : (float *) data;
+}
+
+// Routines for Testing:
+
+int test_kernel_index64(uint64_t n_elements){
+    cl_int err;
+    float max_min[2];
+
+    cl_platform_id p = select_platform();
+    cl_device_id d = select_device(p);
+    cl_context c = create_context(p, d);
+    cl_command_queue q = create_queue(c, d);
+
+    cl_ulong max_alloc;
+    err = clGetDeviceInfo(d, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(max_alloc), &max_alloc, NULL);
+    ocl_check(err, "[FAIL] Can't get the max allocation size");
+    if(n_elements * sizeof(float) > max_alloc){
+        fprintf(stderr, "[KERNEL INDEX64 TEST][FAIL] %llu elements do not fit in a buffer of the device (%llu bytes at most)\n",
+                (unsigned long long) n_elements, (unsigned long long) max_alloc);
+        return -1;
+    }
+
+    // The 64 bits index kernels, normal with one WorkItem per element, so that its global ids go beyond 2^31 too:
+    kernel_variant variant = kernel_variant_for(d, n_elements);
+    variant.index64 = 1;
+    variant.vector_width = 1;
+    cl_program prog = kernel_program(KERNELS_PATHNAME, c, d, &variant);
+
+    float * elements = map_elements(n_elements);
+    if(elements == NULL){
+        fprintf(stderr, "[KERNEL INDEX64 TEST][FAIL] Can't map %s\n", BUFFER_PATHNAME);
+        return -1;
+    }
+    const uint64_t min_index = min_index_of(n_elements);
+    elements[n_elements - 1] = MAX_TEST;
+    elements[min_index] = MIN_TEST;
+
+    cl_mem buffer = clCreateBuffer(c, CL_MEM_READ_WRITE | CL_MEM_USE_HOST_PTR, n_elements * sizeof(float), elements, &err);
+    ocl_check(err, "[FAIL] Can't create the buffer of the elements");
+    cl_mem support_buffer = clCreateBuffer(c, CL_MEM_READ_WRITE, N_WORK_GROUPS * 2 * sizeof(float), NULL, &err);
+    ocl_check(err, "[FAIL] Can't create the support buffer");
+
+    // Reducing the elements, then the partial results of the WorkGroups, as the host program does:
+    cl_kernel max_min_k = clCreateKernel(prog, MAX_MIN_FIND_KERNEL_NAME, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel ", MAX_MIN_FIND_KERNEL_NAME);
+    cl_event events[2];
+    events[0] = launch_max_min_find(max_min_k, q, NULL, support_buffer, buffer, n_elements, N_WORK_ITEMS_PER_WORK_GROUP, N_WORK_GROUPS);
+    events[1] = launch_max_min_find(max_min_k, q, events[0], support_buffer, support_buffer, N_WORK_GROUPS * 2, N_WORK_ITEMS_PER_WORK_GROUP, 1);
+    err = clEnqueueReadBuffer(q, support_buffer, CL_TRUE, 0, sizeof(max_min), max_min, 1, events + 1, NULL);
+    ocl_check(err, "[FAIL] Can't read the max and min values from device");
+
+    int result = 0;
+    if(max_min[0] != MAX_TEST || max_min[1] != MIN_TEST){
+        fprintf(stderr, "[KERNEL INDEX64 TEST][FAIL] Max & Min of %llu elements are %f and %f instead of %f and %f\n",
+                (unsigned long long) n_elements, max_min[0], max_min[1], MAX_TEST, MIN_TEST);
+        result = -1;
+    }
+
+    // Normalizing with the expected max and min, whatever the reduction gave:
+    cl_kernel normal_k = clCreateKernel(prog, NORMALIZE_KERNEL_NAME, &err);
+    ocl_check(err, "[FAIL] Can't create the kernel ", NORMALIZE_KERNEL_NAME);
+    clReleaseEvent(launch_normalize(normal_k, q, d, buffer, n_elements, MAX_TEST, MIN_TEST));
+
+    float * normalized = (float *) clEnqueueMapBuffer(q, buffer, CL_TRUE, CL_MAP_READ, 0, n_elements * sizeof(float), 0, NULL, NULL, &err);
+    ocl_check(err, "[FAIL] Can't map the normalized elements");
+
+    const float zero = (0.0f - MIN_TEST) / (MAX_TEST - MIN_TEST);
+    uint64_t wrong = 0, first_wrong = 0;
+    for(uint64_t i = 0; i < n_elements; ++i){
+        const float expected = i == n_elements - 1 ? 1.0f : i == min_index ? 0.0f : zero;
+        if(normalized[i] != expected && wrong++ == 0) first_wrong = i;
+    }
+    if(wrong > 0){
+        fprintf(stderr, "[KERNEL INDEX64 TEST][FAIL] %llu of %llu normalized elements are wrong, the first one at %llu (%f)\n",
+                (unsigned long long) wrong, (unsigned long long) n_elements, (unsigned long long) first_wrong, normalized[first_wrong]);
+        result = -1;
+    }
+
+    clEnqueueUnmapMemObject(q, buffer, normalized, 0, NULL, NULL);
+    clFinish(q);
+
+    if(result == 0){
+        fprintf(stdout, "[KERNEL INDEX64 TEST][OK] One reduction and one normalize launch over %llu elements (64 bits indexes)\n",
+                (unsigned long long) n_elements);
+    }
+
+    clReleaseEvent(events[0]);
+    clReleaseEvent(events[1]);
+    clReleaseKernel(max_min_k);
+    clReleaseKernel(normal_k);
+    clReleaseMemObject(buffer);
+    clReleaseMemObject(support_buffer);
+    clReleaseProgram(prog);
+    clReleaseCommandQueue(q);
+    clReleaseContext(c);
+    munmap(elements, n_elements * sizeof(float));
+    remove(BUFFER_PATHNAME);
+    return result;
+}
+
+int main(int argc, char * argv[]){
+    // Elements of the buffer, more than 2^31 by default (a smaller count still runs the 64 bits kernels):
+    const uint64_t n_elements = argc > 1 ? strtoull(argv[1], NULL, 10) : N_ELEMENTS_TEST;
+    if(n_elements < 2){
+        fprintf(stderr, "[KERNEL INDEX64 TEST][FAIL] Example of use: %s [elements]\n", argv[0]);
+        return -1;
+    }
+
+    return test_kernel_index64(n_elements) == 0 ? 0 : 1;
+}
@@ -0,0 +1,236 @@
+/*
+    AY 19/20
+    Salvatore Campisi
+    Parallel Programming on GPU
+    CSV Parallel Normalization
+
+    stream_index64_test.c
+    C program for testing a streaming run of more than 2^31 elements: the max and min of a
+    synthetic column are reduced on the device by main fit, then its rows are piped through
+    main stream with those statistics and every normalized value is checked
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../libs/statl/statl.h"
+
+// Data for Testing:
+
+int64_t N_ELEMENTS_TEST     = 3000000000LL;
+int     PERIOD_TEST         = 997;
+int     MAX_TEST            = 1997;
+int     MIN_TEST            = -1000;
+char    CSV_PATHNAME_TEST[] = "data/stream_index64_test.csv";
+char    STATS_TEST[]        = "data/stream_index64_test.stats";
+char    CHUNK_ROWS_TEST[]   = "4194304";
+char    BATCH_ROWS_TEST[]   = "65536";
+char    main_directory[]    = "..";
+char    project_directory[] = "../..";
+
+/*
+    Every row is a sawtooth of period PERIOD_TEST but the max and the min of the column, the rows
+    after 2^31 (in the middle of smaller runs): both are only reached by row indexes a 32 bits int can't hold
+*/
+int64_t max_row_of(int64_t n_rows){
+    return n_rows > 2147483648LL + 3 ? 2147483648LL + 3 : n_rows / 2;
+}
+
+int64_t min_row_of(int64_t n_rows){
+    return n_rows > 2147483648LL + 3 ? 2147483648LL + 1 : n_rows / 2 + 1;
+}
+
+int value_of(int64_t r, int64_t n_rows){
+    if(r == max_row_of(n_rows)) return MAX_TEST;
+    if(r == min_row_of(n_rows)) return MIN_TEST;
+    return (int) (r % PERIOD_TEST);
+}
+
+double expected_of(int64_t r, int64_t n_rows){
+    return (value_of(r, n_rows) - MIN_TEST) / (double) (MAX_TEST - MIN_TEST);
+}
+
+// Full pathname of a file relative to the root of the project:
+char * project_pathname(const char * pathname){
+    char * full_pathname = malloc(strlen(project_directory) + strlen(pathname) + 2);
+    sprintf(full_pathname, "%s/%s", project_directory, pathname);
+    return full_pathname;
+}
+
+// Writing the synthetic rows, formatted by hand since printf would take most of the run:
+int write_rows(const char * pathname, int64_t n_rows){
+    FILE * csv_fd = fopen(pathname, "w");
+    if(csv_fd == NULL) return -1;
+
+    const size_t buffer_size = 1 << 20;
+    char * buffer = (char *) malloc(buffer_size + 16);
+    size_t used = sprintf(buffer, "\"C1\"\n");
+    int result = 0;
+
+    for(int64_t r = 0; r < n_rows && result == 0; ++r){
+        int value = value_of(r, n_rows);
+        char digits[16];
+        int n_digits = 0;
+
+        if(value < 0){
+            buffer[used++] = '-';
+            value = -value;
+        }
+        do{
+            digits[n_digits++] = '0' + value % 10;
+            value /= 10;
+        } while(value > 0);
+        while(n_digits > 0) buffer[used++] = digits[--n_digits];
+        buffer[used++] = '\n';
+
+        if(used >= buffer_size){
+            if(fwrite(buffer, 1, used, csv_fd) != used) result = -1;
+            used = 0;
+        }
+    }
+    if(result == 0 && fwrite(buffer, 1, used, csv_fd) != used) result = -1;
+    if(fclose(csv_fd) != 0) result = -1;
+
+    free(buffer);
+    return result;
+}
+
+// Running main in bin, as usual to find the kernels, with the given standard input and output (-1 to keep them):
+pid_t start_main(char ** args, int input_fd, int output_fd){
+    // The child must not write again what is still buffered:
+    fflush(stdout);
+    const pid_t pid = fork();
+    if(pid == 0){
+        if(input_fd != -1) dup2(input_fd, STDIN_FILENO);
+        if(output_fd != -1) dup2(output_fd, STDOUT_FILENO);
+        else if(freopen("/dev/null", "w", stdout) == NULL) exit(127);
+
+        if(chdir(main_directory) == 0) execv("./main", args);
+        exit(127);
+    }
+    return pid;
+}
+
+int wait_main(pid_t pid){
+    int status;
+    if(pid == -1 || waitpid(pid, &status, 0) == -1) return -1;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+// Routines for Testing:
+
+// Max and min reduced by main fit over every row, and rows counted in 64 bits:
+int test_fit(int64_t n_rows, const char * stats_pathname){
+    char * args[] = {"./main", "fit", STATS_TEST, CSV_PATHNAME_TEST, "1", NULL};
+
+    // Bigger chunks than the default ones, for fewer launches over billions of rows:
+    setenv("CSVL_CHUNK_ROWS", CHUNK_ROWS_TEST, 0);
+    if(wait_main(start_main(args, -1, -1)) != 0){
+        fprintf(stderr, "[STREAM TEST][FAIL] Can't fit %s\n", CSV_PATHNAME_TEST);
+        return -1;
+    }
+
+    statl_stats * stats = statl_load(stats_pathname);
+    if(stats == NULL) return -1;
+
+    const statl_column * column = &stats->columns[0];
+    const int fitted = stats->header.n_columns == 1 && column->count == n_rows &&
+                       column->max == (float) MAX_TEST && column->min == (float) MIN_TEST;
+    if(!fitted){
+        fprintf(stderr, "[STREAM TEST][FAIL] Max & Min of %lld rows are %f and %f (%lld rows) instead of %f and %f\n",
+                (long long) n_rows, column->max, column->min, (long long) column->count, (float) MAX_TEST, (float) MIN_TEST);
+    }
+    else{
+        fprintf(stdout, "[STREAM TEST][OK] Max & Min of %lld rows reduced on the device: %f (row %lld) and %f (row %lld)\n",
+                (long long) n_rows, column->max, (long long) max_row_of(n_rows), column->min, (long long) min_row_of(n_rows));
+    }
+
+    statl_free(stats);
+    return fitted ? 0 : -1;
+}
+
+// Every row of the column streamed through main stream with the fitted statistics, and checked:
+int test_stream(int64_t n_rows, const char * csv_pathname, char * extra_option){
+    int from_main[2];
+    char * args[] = {"./main", "stream", "--stats", STATS_TEST, "--batch-rows", BATCH_ROWS_TEST, extra_option, "1", NULL};
+    if(extra_option == NULL){
+        args[6] = "1";
+        args[7] = NULL;
+    }
+
+    const int input_fd = open(csv_pathname, O_RDONLY);
+    if(input_fd == -1 || pipe(from_main) != 0){
+        fprintf(stderr, "[STREAM TEST][FAIL] Can't pipe %s through main stream\n", CSV_PATHNAME_TEST);
+        if(input_fd != -1) close(input_fd);
+        return -1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    const pid_t pid = start_main(args, input_fd, from_main[1]);
+    close(input_fd);
+    close(from_main[1]);
+
+    // Checking every normalized value, in row order:
+    FILE * output_fd = fdopen(from_main[0], "r");
+    char row[1024];
+    int64_t r = -1;
+    int64_t errors = 0;
+
+    while(fgets(row, sizeof(row), output_fd) != NULL){
+        if(r >= 0){
+            const double value = strtod(row, NULL);
+            if(fabs(value - expected_of(r, n_rows)) > 1e-6 && errors++ < 10){
+                fprintf(stderr, "[STREAM TEST][FAIL] Row %lld is %f instead of %f\n", (long long) r, value, expected_of(r, n_rows));
+            }
+        }
+        ++r;
+    }
+    fclose(output_fd);
+
+    const int status = wait_main(pid);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    const double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1.0e-9;
+
+    if(status != 0 || r != n_rows || errors > 0){
+        fprintf(stderr, "[STREAM TEST][FAIL] %lld of %lld rows normalized, %lld wrong values\n",
+                (long long) (r < 0 ? 0 : r), (long long) n_rows, (long long) errors);
+        return -1;
+    }
+
+    fprintf(stdout, "[STREAM TEST][OK] Correctly normalized %lld elements (last row index %s 2^31) in %.1f s, %.0f rows/s\n",
+            (long long) n_rows, n_rows - 1 > INT32_MAX ? "above" : "below", seconds, n_rows / seconds);
+    return 0;
+}
+
+int main(int argc, char * argv[]){
+    // Elements of the run (3 billion by default), and an option of main stream (e.g. --cpu):
+    const int64_t n_elements = argc > 1 ? atoll(argv[1]) : N_ELEMENTS_TEST;
+    char * extra_option = argc > 2 ? argv[2] : NULL;
+    if(n_elements < 4){
+        fprintf(stderr, "[STREAM TEST][FAIL] Example of use: %s [elements] [--cpu]\n", argv[0]);
+        return 1;
+    }
+
+    char * csv_pathname = project_pathname(CSV_PATHNAME_TEST);
+    char * stats_pathname = project_pathname(STATS_TEST);
+
+    int result = write_rows(csv_pathname, n_elements);
+    if(result != 0) fprintf(stderr, "[STREAM TEST][FAIL] Can't write %s\n", CSV_PATHNAME_TEST);
+    if(result == 0) result = test_fit(n_elements, stats_pathname);
+    if(result == 0) result = test_stream(n_elements, csv_pathname, extra_option);
+
+    remove(csv_pathname);
+    remove(stats_pathname);
+    free(csv_pathname);
+    free(stats_pathname);
+    return result == 0 ? 0 : 1;
+}